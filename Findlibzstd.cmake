@@ -0,0 +1,46 @@
+################################################################################
+#  THIS FILE IS 100% GENERATED BY ZPROJECT; DO NOT EDIT EXCEPT EXPERIMENTALLY  #
+#  Read the zproject/README.md for information about making permanent changes. #
+################################################################################
+
+if (NOT MSVC)
+    find_package(PkgConfig)
+    pkg_check_modules(PC_LIBZSTD "libzstd")
+    if (PC_LIBZSTD_FOUND)
+        # add CFLAGS from pkg-config file, e.g. draft api.
+        add_definitions(${PC_LIBZSTD_CFLAGS} ${PC_LIBZSTD_CFLAGS_OTHER})
+        # some libraries install the headers is a subdirectory of the include dir
+        # returned by pkg-config, so use a wildcard match to improve chances of finding
+        # headers and SOs.
+        set(PC_LIBZSTD_INCLUDE_HINTS ${PC_LIBZSTD_INCLUDE_DIRS} ${PC_LIBZSTD_INCLUDE_DIRS}/*)
+        set(PC_LIBZSTD_LIBRARY_HINTS ${PC_LIBZSTD_LIBRARY_DIRS} ${PC_LIBZSTD_LIBRARY_DIRS}/*)
+    endif(PC_LIBZSTD_FOUND)
+endif (NOT MSVC)
+
+find_path (
+    ${CMAKE_FIND_PACKAGE_NAME}_INCLUDE_DIRS
+    NAMES zstd.h
+    HINTS ${PC_LIBZSTD_INCLUDE_HINTS}
+)
+
+find_library (
+    ${CMAKE_FIND_PACKAGE_NAME}_LIBRARIES
+    NAMES libzstd zstd
+    HINTS ${PC_LIBZSTD_LIBRARY_HINTS}
+)
+
+include(FindPackageHandleStandardArgs)
+
+find_package_handle_standard_args(
+    ${CMAKE_FIND_PACKAGE_NAME}
+    REQUIRED_VARS ${CMAKE_FIND_PACKAGE_NAME}_LIBRARIES ${CMAKE_FIND_PACKAGE_NAME}_INCLUDE_DIRS
+)
+mark_as_advanced(
+    ${CMAKE_FIND_PACKAGE_NAME}_FOUND
+    ${CMAKE_FIND_PACKAGE_NAME}_LIBRARIES ${CMAKE_FIND_PACKAGE_NAME}_INCLUDE_DIRS
+)
+
+################################################################################
+#  THIS FILE IS 100% GENERATED BY ZPROJECT; DO NOT EDIT EXCEPT EXPERIMENTALLY  #
+#  Read the zproject/README.md for information about making permanent changes. #
+################################################################################
@@ -86,6 +86,39 @@ ZYRE_EXPORT void
 ZYRE_EXPORT void
     zyre_event_test (bool verbose);
 
+#ifdef ZYRE_BUILD_DRAFT_API
+//  *** Draft method, for development use, may change without warning ***
+//  Returns the number of the request that a REQUEST, REPLY or NOREPLY event
+//  is about, which zyre_reply takes to answer a REQUEST; 0 for other events.
+ZYRE_EXPORT uint64_t
+    zyre_event_request (zyre_event_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Returns why the request of a NOREPLY event will get no reply: "unknown",
+//  "unsupported", "exit" or "timeout"; NULL for other events.
+ZYRE_EXPORT const char *
+    zyre_event_reason (zyre_event_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Returns the name of the object that a STREAM event carries a chunk of;
+//  NULL for other events. The chunk is the event's message, or with a
+//  stream sink, the path of the complete file.
+ZYRE_EXPORT const char *
+    zyre_event_object (zyre_event_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Returns the offset in its object of a STREAM event's chunk; 0 for other
+//  events.
+ZYRE_EXPORT uint64_t
+    zyre_event_offset (zyre_event_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Returns the size of the object that a STREAM event carries a chunk of;
+//  0 for other events.
+ZYRE_EXPORT uint64_t
+    zyre_event_total (zyre_event_t *self);
+
+#endif // ZYRE_BUILD_DRAFT_API
 //  @end
 
 #ifdef __cplusplus
@@ -54,6 +54,7 @@ BuildRequires:  pkgconfig
 BuildRequires:  xmlto
 BuildRequires:  zeromq-devel
 BuildRequires:  czmq-devel
+BuildRequires:  libzstd-devel
 %if %{with python_cffi}
 BuildRequires:  python-cffi
 BuildRequires:  python-devel
@@ -47,6 +47,115 @@ s_node_recv (zyre_t *node, char* command, char* expected)
 }
 
 
+//  Round trips we time for the latency of each way of taking events
+#define LATENCY_ROUNDS 1000
+
+typedef struct {
+    zyre_t *node;               //  Our node
+    char **peers;               //  Remote nodes we send to
+    int max_node;               //  Number of remote nodes
+    int rounds;                 //  Round trips done so far
+    int64_t sent_at;            //  When we sent the current round trip
+    int64_t *latencies;         //  Round trip times, in usecs
+    zsock_t *done;              //  Handler signals here when done
+} latency_t;
+
+static int
+s_latency_compare (const void *item1, const void *item2)
+{
+    int64_t latency1 = *(const int64_t *) item1;
+    int64_t latency2 = *(const int64_t *) item2;
+    return latency1 < latency2? -1: latency1 > latency2? 1: 0;
+}
+
+static void
+s_latency_print (latency_t *self, const char *mode)
+{
+    qsort (self->latencies, LATENCY_ROUNDS, sizeof (int64_t), s_latency_compare);
+    printf ("WHISPER round trip with %s: p50 %ld usec, p99 %ld usec\n", mode,
+            (long) self->latencies [LATENCY_ROUNDS / 2],
+            (long) self->latencies [LATENCY_ROUNDS * 99 / 100]);
+}
+
+//  Event handler that times each round trip and starts the next one, on
+//  the node's own thread
+
+static void
+s_latency_handler (zmsg_t *event, void *arg)
+{
+    latency_t *self = (latency_t *) arg;
+    zframe_t *frame = zmsg_first (event);
+    if (!zframe_streq (frame, "WHISPER"))
+        return;
+    zmsg_next (event);          //  Peer UUID
+    zmsg_next (event);          //  Peer name
+    frame = zmsg_next (event);
+    if (!frame || !zframe_streq (frame, "R:WHISPER"))
+        return;
+
+    self->latencies [self->rounds++] = zclock_usecs () - self->sent_at;
+    if (self->rounds < LATENCY_ROUNDS) {
+        self->sent_at = zclock_usecs ();
+        zyre_whispers (self->node, self->peers [self->rounds % self->max_node], "S:WHISPER");
+    }
+    else
+        zsock_signal (self->done, 0);
+}
+
+
+//  SHOUTs we time for the delivery latency to the whole group, and the
+//  fan-out of the relay tree we compare with sending to each peer
+#define SHOUT_ROUNDS 100
+#define RELAY_FANOUT 4
+
+//  Time SHOUTs one at a time, each until all remote nodes answered it, and
+//  return the median time in usecs
+
+static int64_t
+s_shout_latency (zyre_t *node, int max_node, const char *mode)
+{
+    int64_t *latencies = (int64_t *) zmalloc (sizeof (int64_t) * SHOUT_ROUNDS);
+    int round;
+    for (round = 0; round < SHOUT_ROUNDS; round++) {
+        int64_t sent_at = zclock_usecs ();
+        zyre_shouts (node, "GLOBAL", "S:SHOUT");
+        int answers = 0;
+        while (answers < max_node)
+            if (s_node_recv (node, "SHOUT", "R:SHOUT"))
+                answers++;
+        latencies [round] = zclock_usecs () - sent_at;
+    }
+    qsort (latencies, SHOUT_ROUNDS, sizeof (int64_t), s_latency_compare);
+    printf ("SHOUT to all with %s: p50 %ld usec, p99 %ld usec\n", mode,
+            (long) latencies [SHOUT_ROUNDS / 2],
+            (long) latencies [SHOUT_ROUNDS * 99 / 100]);
+    int64_t median = latencies [SHOUT_ROUNDS / 2];
+    free (latencies);
+    return median;
+}
+
+
+//  Return resident set size of this process in KB, or 0 if we can't tell
+
+static long
+s_rss_kb (void)
+{
+    long rss_pages = 0;
+#if defined (__UNIX__)
+    FILE *statm = fopen ("/proc/self/statm", "r");
+    if (statm) {
+        long size_pages;
+        if (fscanf (statm, "%ld %ld", &size_pages, &rss_pages) != 2)
+            rss_pages = 0;
+        fclose (statm);
+    }
+    return rss_pages * (sysconf (_SC_PAGESIZE) / 1024);
+#else
+    return rss_pages;
+#endif
+}
+
+
 int
 main (int argc, char *argv [])
 {
@@ -59,16 +168,47 @@ main (int argc, char *argv [])
     int nbr_hello_response = 0;
     int nbr_message = 0;
     int nbr_message_response = 0;
+    //  With "curve", all nodes use CURVE security, so the coordination time
+    //  measures the cost of secure connection setup
+    bool curve = false;
+    //  With "shared", we send to all peers through one shared socket, so
+    //  the memory per peer can be compared with one socket per peer
+    bool shared = false;
+    //  With "budget=N", the node takes up to N messages per wakeup, so the
+    //  throughput can be compared with one message per wakeup (budget=1)
+    int budget = 0;
 
     if (argc > 1)
         max_node = atoi (argv [1]);
     if (argc > 2)
         max_message = atoi (argv [2]);
+    int argn;
+    for (argn = 3; argn < argc; argn++) {
+        if (streq (argv [argn], "curve"))
+            curve = true;
+        else
+        if (streq (argv [argn], "shared"))
+            shared = true;
+        else
+        if (strncmp (argv [argn], "budget=", 7) == 0)
+            budget = atoi (argv [argn] + 7);
+    }
 
     //  Set max sockets to system maximum
     zsys_set_max_sockets(0);
 
     zyre_t *node = zyre_new (NULL);
+    zcert_t *cert = NULL;
+    if (curve) {
+        assert (zsys_has_curve ());
+        cert = zcert_new ();
+        zyre_set_zcert (node, cert);
+    }
+    if (shared)
+        zyre_set_shared_mailbox (node);
+    if (budget)
+        zyre_set_recv_budget (node, budget);
+    long rss_at_start = s_rss_kb ();
     zyre_start (node);
     zyre_join (node, "GLOBAL");
 
@@ -93,6 +233,11 @@ main (int argc, char *argv [])
                 elapse = zclock_mono () - start;
                 printf ("Took %ld ms to coordinate with all remote\n",
                         (long) elapse);
+                long rss_at_peers = s_rss_kb ();
+                if (rss_at_start && rss_at_peers)
+                    printf ("Memory per peer with %s: %.1f KB\n",
+                            shared? "shared mailbox": "one mailbox per peer",
+                            (double) (rss_at_peers - rss_at_start) / max_node);
             }
         }
         else
@@ -136,6 +281,8 @@ main (int argc, char *argv [])
     //  Got WHISPER response from the all remote nodes
     elapse = zclock_mono () - start;
     printf ("Took %ld ms to send/receive %d message. %.2f msg/s \n", (long)elapse, max_message, (float) max_message * 1000 / elapse);
+    if (budget)
+        printf ("Node took up to %d messages per wakeup\n", budget);
 
     //  send SHOUT message
     start = zclock_mono ();
@@ -161,7 +308,52 @@ main (int argc, char *argv [])
             (long) elapse, max_message, max_node * max_message,
             (float) max_node * max_message * 1000 / elapse);
 
+    //  Time SHOUT delivery to the whole group, sending to each peer and
+    //  then down a relay tree, and work out what each level of the tree
+    //  costs us
+    int64_t direct = s_shout_latency (node, max_node, "sends to each peer");
+    zyre_set_relay (node, "GLOBAL", RELAY_FANOUT);
+    int64_t relayed = s_shout_latency (node, max_node, "relay tree");
+    zyre_set_relay (node, "GLOBAL", 0);
+    int depth = 0;
+    long reach = 0;
+    long level = 1;
+    while (reach < max_node) {
+        level *= RELAY_FANOUT;
+        reach += level;
+        depth++;
+    }
+    if (depth > 1)
+        printf ("Relay tree of fan-out %d, %d levels: %ld usec per extra hop\n",
+                RELAY_FANOUT, depth, (long) (relayed - direct) / (depth - 1));
+
+    //  Time WHISPER round trips one at a time, first taking events with
+    //  zyre_recv and then with an event handler
+    latency_t latency = { node, peers, max_node, 0, 0, NULL, NULL };
+    latency.latencies = (int64_t *) zmalloc (sizeof (int64_t) * LATENCY_ROUNDS);
+    for (latency.rounds = 0; latency.rounds < LATENCY_ROUNDS; latency.rounds++) {
+        latency.sent_at = zclock_usecs ();
+        zyre_whispers (node, peers [latency.rounds % max_node], "S:WHISPER");
+        while (!s_node_recv (node, "WHISPER", "R:WHISPER"))
+            ;
+        latency.latencies [latency.rounds] = zclock_usecs () - latency.sent_at;
+    }
+    s_latency_print (&latency, "zyre_recv");
+
+    zsock_t *done = zsys_create_pipe (&latency.done);
+    latency.rounds = 0;
+    zyre_set_handler (node, s_latency_handler, &latency);
+    latency.sent_at = zclock_usecs ();
+    zyre_whispers (node, peers [0], "S:WHISPER");
+    zsock_wait (done);
+    zyre_set_handler (node, NULL, NULL);
+    s_latency_print (&latency, "handler");
+    zsock_destroy (&done);
+    zsock_destroy (&latency.done);
+    free (latency.latencies);
+
     zyre_destroy (&node);
+    zcert_destroy (&cert);
     for (nbr_node = 0; nbr_node < max_node; nbr_node++) {
         free (peers[nbr_node]);
     }
@@ -17,11 +17,17 @@
 #include "zyre_classes.h"
 
 // to test performances, run perf_remote [node_count] first then perf_local
+// add "curve" to both command lines to measure CURVE connection setup
 
 static void
 node_actor (zsock_t *pipe, void *args)
 {
     zyre_t *node = zyre_new (NULL);
+    zcert_t *cert = NULL;
+    if (args) {
+        cert = zcert_new ();
+        zyre_set_zcert (node, cert);
+    }
     zyre_start (node);
     zsock_signal (pipe, 0);
 
@@ -110,6 +116,7 @@ node_actor (zsock_t *pipe, void *args)
     }
     zpoller_destroy (&poller);
     zyre_destroy (&node);
+    zcert_destroy (&cert);
 }
 
 
@@ -117,8 +124,13 @@ int main (int argc, char *argv [])
 {
     //  Get number of nodes to simulate, default 25
     int max_node = 25;
+    bool curve = false;
     if (argc > 1)
         max_node = atoi (argv [1]);
+    if (argc > 2)
+        curve = streq (argv [2], "curve");
+    if (curve)
+        assert (zsys_has_curve ());
 
     //  Set max sockets to system maximum
     zsys_set_max_sockets(0);
@@ -128,7 +140,7 @@ int main (int argc, char *argv [])
 
     int node_nbr;
     for (node_nbr = 0; node_nbr < max_node; node_nbr++) {
-        nodes [node_nbr] = zactor_new (node_actor, NULL);
+        nodes [node_nbr] = zactor_new (node_actor, curve? &curve: NULL);
         zclock_log ("I: Started node %d", node_nbr + 1);
     }
 
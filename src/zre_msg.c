@@ -55,6 +55,24 @@ struct _zre_msg_t {
     char group [256];                   //  Group to send to
     char challenger_id [256];           //  ID of the challenger
     char leader_id [256];               //  ID of the elected leader
+    byte challenger [16];               //  UUID of the challenger
+    char lapsed [256];                  //  Leader the challenger leaves out, if any
+    byte leader [16];                   //  UUID of the elected leader
+    uint32_t stream;                    //  Stream number, unique per sender
+    uint64_t offset;                    //  Offset of chunk in object
+    uint64_t total;                     //  Size of object in bytes
+    uint64_t compressed;                //  Content frames compressed with zstd, as bits
+    uint32_t start;                     //  First multicast sequence switched
+    byte origin [16];                   //  UUID of node that sent the message
+    uint32_t serial;                    //  Origin's message number in group
+    byte fanout;                        //  Peers each node relays to, at most
+    byte bound [16];                    //  UUID of last peer to relay to
+    uint32_t span;                      //  Peers in the range, the first included; 0 gives the range back
+    uint64_t correlation;               //  Request number, unique to the sender
+    char key [256];                     //  Key written
+    uint64_t stamp;                     //  Lamport time of the write
+    zhash_t *clock;                     //  Highest stamp we have from each writer, by UUID
+    size_t clock_bytes;                 //  Size of hash content
 };
 
 //  --------------------------------------------------------------------------
@@ -323,6 +341,91 @@ zre_msg_t *
         self = zre_msg_new ();
         zre_msg_set_id (self, ZRE_MSG_GOODBYE);
     }
+    else
+    if (streq ("ZRE_MSG_ELECT_UUID", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_ELECT_UUID);
+    }
+    else
+    if (streq ("ZRE_MSG_LEADER_UUID", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_LEADER_UUID);
+    }
+    else
+    if (streq ("ZRE_MSG_STREAM", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_STREAM);
+    }
+    else
+    if (streq ("ZRE_MSG_STREAM_ACK", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_STREAM_ACK);
+    }
+    else
+    if (streq ("ZRE_MSG_WHISPER_ZSTD", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_WHISPER_ZSTD);
+    }
+    else
+    if (streq ("ZRE_MSG_SHOUT_ZSTD", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_SHOUT_ZSTD);
+    }
+    else
+    if (streq ("ZRE_MSG_MULTICAST", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_MULTICAST);
+    }
+    else
+    if (streq ("ZRE_MSG_MULTICAST_OK", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_MULTICAST_OK);
+    }
+    else
+    if (streq ("ZRE_MSG_RELAY", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_RELAY);
+    }
+    else
+    if (streq ("ZRE_MSG_REQUEST", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_REQUEST);
+    }
+    else
+    if (streq ("ZRE_MSG_REPLY", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_REPLY);
+    }
+    else
+    if (streq ("ZRE_MSG_HELLO_WANTED", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_HELLO_WANTED);
+    }
+    else
+    if (streq ("ZRE_MSG_HEADERS", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_HEADERS);
+    }
+    else
+    if (streq ("ZRE_MSG_STORE_SET", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_STORE_SET);
+    }
+    else
+    if (streq ("ZRE_MSG_STORE_SYNC", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_STORE_SYNC);
+    }
+    else
+    if (streq ("ZRE_MSG_CATCHUP", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_CATCHUP);
+    }
+    else
+    if (streq ("ZRE_MSG_HISTORY", message)) {
+        self = zre_msg_new ();
+        zre_msg_set_id (self, ZRE_MSG_HISTORY);
+    }
     else
        {
         zsys_error ("message=%s is not known", message);
@@ -779,1444 +882,5087 @@ zre_msg_t *
             self->sequence = uvalue;
             }
             break;
-    }
-    return self;
-}
-
-
-//  --------------------------------------------------------------------------
-//  Destroy the zre_msg
-
-void
-zre_msg_destroy (zre_msg_t **self_p)
-{
-    assert (self_p);
-    if (*self_p) {
-        zre_msg_t *self = *self_p;
-
-        //  Free class properties
-        zframe_destroy (&self->routing_id);
-        if (self->groups)
-            zlist_destroy (&self->groups);
-        zhash_destroy (&self->headers);
-        zmsg_destroy (&self->content);
-
-        //  Free object itself
-        free (self);
-        *self_p = NULL;
-    }
-}
-
-
-//  --------------------------------------------------------------------------
-//  Create a deep copy of a zre_msg instance
-
-zre_msg_t *
-zre_msg_dup (zre_msg_t *other)
-{
-    assert (other);
-    zre_msg_t *copy = zre_msg_new ();
-
-    // Copy the routing and message id
-    zre_msg_set_routing_id (copy, zre_msg_routing_id (other));
-    zre_msg_set_id (copy, zre_msg_id (other));
-
-
-    // Copy the rest of the fields
-    zre_msg_set_sequence (copy, zre_msg_sequence (other));
-    zre_msg_set_endpoint (copy, zre_msg_endpoint (other));
-    {
-        zlist_t *lcopy = zlist_dup (zre_msg_groups (other));
-        zre_msg_set_groups (copy, &lcopy);
-    }
-    zre_msg_set_status (copy, zre_msg_status (other));
-    zre_msg_set_name (copy, zre_msg_name (other));
-    {
-        zhash_t *dup_hash = zhash_dup (zre_msg_headers (other));
-        zre_msg_set_headers (copy, &dup_hash);
-    }
-    {
-        zmsg_t *dup_msg = zmsg_dup (zre_msg_content (other));
-        zre_msg_set_content (copy, &dup_msg);
-    }
-    zre_msg_set_group (copy, zre_msg_group (other));
-    zre_msg_set_challenger_id (copy, zre_msg_challenger_id (other));
-    zre_msg_set_leader_id (copy, zre_msg_leader_id (other));
-
-    return copy;
-}
-
-
-//  --------------------------------------------------------------------------
-//  Receive a zre_msg from the socket. Returns 0 if OK, -1 if
-//  the recv was interrupted, or -2 if the message is malformed.
-//  Blocks if there is no message waiting.
-
-int
-zre_msg_recv (zre_msg_t *self, zsock_t *input)
-{
-    assert (input);
-    int rc = 0;
-    zmq_msg_t frame;
-    zmq_msg_init (&frame);
-
-    if (zsock_type (input) == ZMQ_ROUTER) {
-        zframe_destroy (&self->routing_id);
-        self->routing_id = zframe_recv (input);
-        if (!self->routing_id || !zsock_rcvmore (input)) {
-            zsys_warning ("zre_msg: no routing ID");
-            rc = -1;            //  Interrupted
-            goto malformed;
-        }
-    }
-    int size;
-    size = zmq_msg_recv (&frame, zsock_resolve (input), 0);
-    if (size == -1) {
-        if (errno != EAGAIN)
-            zsys_warning ("zre_msg: interrupted");
-        rc = -1;                //  Interrupted
-        goto malformed;
-    }
-    self->needle = (byte *) zmq_msg_data (&frame);
-    self->ceiling = self->needle + zmq_msg_size (&frame);
-
-
-    //  Get and check protocol signature
-    uint16_t signature;
-    GET_NUMBER2 (signature);
-    if (signature != (0xAAA0 | 1)) {
-        zsys_warning ("zre_msg: invalid signature");
-        rc = -2;                //  Malformed
-        goto malformed;
-    }
-    //  Get message id and parse per message type
-    GET_NUMBER1 (self->id);
-
-    switch (self->id) {
-        case ZRE_MSG_HELLO:
+        case ZRE_MSG_ELECT_UUID:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
             {
-                byte version;
-                GET_NUMBER1 (version);
-                if (version != 2) {
-                    zsys_warning ("zre_msg: version is invalid");
-                    rc = -2;    //  Malformed
-                    goto malformed;
-                }
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
             }
-            GET_NUMBER2 (self->sequence);
-            GET_STRING (self->endpoint);
             {
-                size_t list_size;
-                GET_NUMBER4 (list_size);
-                zlist_destroy (&self->groups);
-                self->groups = zlist_new ();
-                zlist_autofree (self->groups);
-                while (list_size--) {
-                    char *string = NULL;
-                    GET_LONGSTR (string);
-                    zlist_append (self->groups, string);
-                    free (string);
-                }
+            char *s = zconfig_get (content, "group", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->group, s, 255);
             }
-            GET_NUMBER1 (self->status);
-            GET_STRING (self->name);
             {
-                size_t hash_size;
-                GET_NUMBER4 (hash_size);
-                zhash_destroy (&self->headers);
-                self->headers = zhash_new ();
-                zhash_autofree (self->headers);
-                while (hash_size--) {
-                    char key [256];
-                    char *value = NULL;
-                    GET_STRING (key);
-                    GET_LONGSTR (value);
-                    zhash_insert (self->headers, key, value);
-                    free (value);
-                }
+            char *s = zconfig_get (content, "challenger", NULL);
+            if (!s || strlen (s) != 2 * 16) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            memcpy (self->challenger, bvalue, 16);
+            free (bvalue);
             }
-            break;
-
-        case ZRE_MSG_WHISPER:
             {
-                byte version;
-                GET_NUMBER1 (version);
-                if (version != 2) {
-                    zsys_warning ("zre_msg: version is invalid");
-                    rc = -2;    //  Malformed
-                    goto malformed;
-                }
+            char *s = zconfig_get (content, "lapsed", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->lapsed, s, 255);
             }
-            GET_NUMBER2 (self->sequence);
-            //  Get zero or more remaining frames
-            zmsg_destroy (&self->content);
-            if (zsock_rcvmore (input))
-                self->content = zmsg_recv (input);
-            else
-                self->content = zmsg_new ();
             break;
-
-        case ZRE_MSG_SHOUT:
+        case ZRE_MSG_LEADER_UUID:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
             {
-                byte version;
-                GET_NUMBER1 (version);
-                if (version != 2) {
-                    zsys_warning ("zre_msg: version is invalid");
-                    rc = -2;    //  Malformed
-                    goto malformed;
-                }
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
             }
-            GET_NUMBER2 (self->sequence);
-            GET_STRING (self->group);
-            //  Get zero or more remaining frames
-            zmsg_destroy (&self->content);
-            if (zsock_rcvmore (input))
-                self->content = zmsg_recv (input);
-            else
-                self->content = zmsg_new ();
-            break;
-
-        case ZRE_MSG_JOIN:
             {
-                byte version;
-                GET_NUMBER1 (version);
-                if (version != 2) {
-                    zsys_warning ("zre_msg: version is invalid");
-                    rc = -2;    //  Malformed
-                    goto malformed;
-                }
+            char *s = zconfig_get (content, "group", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->group, s, 255);
             }
-            GET_NUMBER2 (self->sequence);
-            GET_STRING (self->group);
-            GET_NUMBER1 (self->status);
-            break;
-
-        case ZRE_MSG_LEAVE:
             {
-                byte version;
-                GET_NUMBER1 (version);
-                if (version != 2) {
-                    zsys_warning ("zre_msg: version is invalid");
-                    rc = -2;    //  Malformed
-                    goto malformed;
-                }
+            char *s = zconfig_get (content, "leader", NULL);
+            if (!s || strlen (s) != 2 * 16) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            memcpy (self->leader, bvalue, 16);
+            free (bvalue);
             }
-            GET_NUMBER2 (self->sequence);
-            GET_STRING (self->group);
-            GET_NUMBER1 (self->status);
             break;
-
-        case ZRE_MSG_PING:
+        case ZRE_MSG_STREAM:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
             {
-                byte version;
-                GET_NUMBER1 (version);
-                if (version != 2) {
-                    zsys_warning ("zre_msg: version is invalid");
-                    rc = -2;    //  Malformed
-                    goto malformed;
-                }
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
             }
-            GET_NUMBER2 (self->sequence);
-            break;
-
-        case ZRE_MSG_PING_OK:
             {
-                byte version;
-                GET_NUMBER1 (version);
-                if (version != 2) {
-                    zsys_warning ("zre_msg: version is invalid");
-                    rc = -2;    //  Malformed
-                    goto malformed;
-                }
+            char *es = NULL;
+            char *s = zconfig_get (content, "stream", NULL);
+            if (!s) {
+                zsys_error ("content/stream not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/stream: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->stream = uvalue;
             }
-            GET_NUMBER2 (self->sequence);
-            break;
-
-        case ZRE_MSG_ELECT:
             {
-                byte version;
-                GET_NUMBER1 (version);
-                if (version != 2) {
-                    zsys_warning ("zre_msg: version is invalid");
-                    rc = -2;    //  Malformed
-                    goto malformed;
-                }
+            char *s = zconfig_get (content, "name", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->name, s, 255);
             }
-            GET_NUMBER2 (self->sequence);
-            GET_STRING (self->group);
-            GET_STRING (self->challenger_id);
-            break;
-
-        case ZRE_MSG_LEADER:
             {
-                byte version;
-                GET_NUMBER1 (version);
-                if (version != 2) {
-                    zsys_warning ("zre_msg: version is invalid");
-                    rc = -2;    //  Malformed
-                    goto malformed;
-                }
+            char *es = NULL;
+            char *s = zconfig_get (content, "offset", NULL);
+            if (!s) {
+                zsys_error ("content/offset not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/offset: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->offset = uvalue;
             }
-            GET_NUMBER2 (self->sequence);
-            GET_STRING (self->group);
-            GET_STRING (self->leader_id);
-            break;
-
-        case ZRE_MSG_GOODBYE:
             {
-                byte version;
-                GET_NUMBER1 (version);
-                if (version != 2) {
-                    zsys_warning ("zre_msg: version is invalid");
-                    rc = -2;    //  Malformed
-                    goto malformed;
-                }
+            char *es = NULL;
+            char *s = zconfig_get (content, "total", NULL);
+            if (!s) {
+                zsys_error ("content/total not found");
+                zre_msg_destroy (&self);
+                return NULL;
             }
-            GET_NUMBER2 (self->sequence);
-            break;
-
-        default:
-            zsys_warning ("zre_msg: bad message ID");
-            rc = -2;            //  Malformed
-            goto malformed;
-    }
-    //  Successful return
-    zmq_msg_close (&frame);
-    return rc;
-
-    //  Error returns
-    malformed:
-        zmq_msg_close (&frame);
-        return rc;              //  Invalid message
-}
-
-
-//  --------------------------------------------------------------------------
-//  Send the zre_msg to the socket. Does not destroy it. Returns 0 if
-//  OK, else -1.
-
-int
-zre_msg_send (zre_msg_t *self, zsock_t *output)
-{
-    assert (self);
-    assert (output);
-
-    if (zsock_type (output) == ZMQ_ROUTER)
-        zframe_send (&self->routing_id, output, ZFRAME_MORE + ZFRAME_REUSE);
-
-    size_t frame_size = 2 + 1;          //  Signature and message ID
-
-    switch (self->id) {
-        case ZRE_MSG_HELLO:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->endpoint);
-            frame_size += 4;            //  Size is 4 octets
-            if (self->groups) {
-                char *groups = (char *) zlist_first (self->groups);
-                while (groups) {
-                    frame_size += 4 + strlen (groups);
-                    groups = (char *) zlist_next (self->groups);
-                }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/total: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
             }
-            frame_size += 1;            //  status
-            frame_size += 1 + strlen (self->name);
-            frame_size += 4;            //  Size is 4 octets
-            if (self->headers) {
-                self->headers_bytes = 0;
-                char *item = (char *) zhash_first (self->headers);
-                while (item) {
-                    self->headers_bytes += 1 + strlen (zhash_cursor (self->headers));
-                    self->headers_bytes += 4 + strlen (item);
-                    item = (char *) zhash_next (self->headers);
-                }
+            self->total = uvalue;
             }
-            frame_size += self->headers_bytes;
-            break;
-        case ZRE_MSG_WHISPER:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            break;
-        case ZRE_MSG_SHOUT:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->group);
-            break;
-        case ZRE_MSG_JOIN:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->group);
+            {
+            char *s = zconfig_get (content, "content", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            if (!bvalue) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zframe_new (bvalue, strlen (s) / 2);
+            zmsg_t *msg = zmsg_decode (frame);
+            zframe_destroy (&frame);
+#else
+            zmsg_t *msg = zmsg_decode (bvalue, strlen (s) / 2);
+#endif
+            free (bvalue);
+            self->content = msg;
+            }
+            break;
+        case ZRE_MSG_STREAM_ACK:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "stream", NULL);
+            if (!s) {
+                zsys_error ("content/stream not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/stream: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->stream = uvalue;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "offset", NULL);
+            if (!s) {
+                zsys_error ("content/offset not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/offset: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->offset = uvalue;
+            }
+            break;
+        case ZRE_MSG_WHISPER_ZSTD:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "compressed", NULL);
+            if (!s) {
+                zsys_error ("content/compressed not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/compressed: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->compressed = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "content", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            if (!bvalue) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zframe_new (bvalue, strlen (s) / 2);
+            zmsg_t *msg = zmsg_decode (frame);
+            zframe_destroy (&frame);
+#else
+            zmsg_t *msg = zmsg_decode (bvalue, strlen (s) / 2);
+#endif
+            free (bvalue);
+            self->content = msg;
+            }
+            break;
+        case ZRE_MSG_SHOUT_ZSTD:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "group", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->group, s, 255);
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "compressed", NULL);
+            if (!s) {
+                zsys_error ("content/compressed not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/compressed: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->compressed = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "content", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            if (!bvalue) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zframe_new (bvalue, strlen (s) / 2);
+            zmsg_t *msg = zmsg_decode (frame);
+            zframe_destroy (&frame);
+#else
+            zmsg_t *msg = zmsg_decode (bvalue, strlen (s) / 2);
+#endif
+            free (bvalue);
+            self->content = msg;
+            }
+            break;
+        case ZRE_MSG_MULTICAST:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "group", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->group, s, 255);
+            }
+            {
+            char *s = zconfig_get (content, "endpoint", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->endpoint, s, 255);
+            }
+            break;
+        case ZRE_MSG_MULTICAST_OK:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "group", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->group, s, 255);
+            }
+            {
+            char *s = zconfig_get (content, "endpoint", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->endpoint, s, 255);
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "start", NULL);
+            if (!s) {
+                zsys_error ("content/start not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/start: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->start = uvalue;
+            }
+            break;
+        case ZRE_MSG_RELAY:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "origin", NULL);
+            if (!s || strlen (s) != 2 * 16) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            memcpy (self->origin, bvalue, 16);
+            free (bvalue);
+            }
+            {
+            char *s = zconfig_get (content, "group", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->group, s, 255);
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "serial", NULL);
+            if (!s) {
+                zsys_error ("content/serial not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/serial: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->serial = uvalue;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "fanout", NULL);
+            if (!s) {
+                zsys_error ("content/fanout not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/fanout: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->fanout = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "bound", NULL);
+            if (!s || strlen (s) != 2 * 16) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            memcpy (self->bound, bvalue, 16);
+            free (bvalue);
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "span", NULL);
+            if (!s) {
+                zsys_error ("content/span not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/span: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->span = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "content", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            if (!bvalue) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zframe_new (bvalue, strlen (s) / 2);
+            zmsg_t *msg = zmsg_decode (frame);
+            zframe_destroy (&frame);
+#else
+            zmsg_t *msg = zmsg_decode (bvalue, strlen (s) / 2);
+#endif
+            free (bvalue);
+            self->content = msg;
+            }
+            break;
+        case ZRE_MSG_REQUEST:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "correlation", NULL);
+            if (!s) {
+                zsys_error ("content/correlation not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/correlation: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->correlation = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "content", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            if (!bvalue) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zframe_new (bvalue, strlen (s) / 2);
+            zmsg_t *msg = zmsg_decode (frame);
+            zframe_destroy (&frame);
+#else
+            zmsg_t *msg = zmsg_decode (bvalue, strlen (s) / 2);
+#endif
+            free (bvalue);
+            self->content = msg;
+            }
+            break;
+        case ZRE_MSG_REPLY:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "correlation", NULL);
+            if (!s) {
+                zsys_error ("content/correlation not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/correlation: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->correlation = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "content", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            if (!bvalue) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zframe_new (bvalue, strlen (s) / 2);
+            zmsg_t *msg = zmsg_decode (frame);
+            zframe_destroy (&frame);
+#else
+            zmsg_t *msg = zmsg_decode (bvalue, strlen (s) / 2);
+#endif
+            free (bvalue);
+            self->content = msg;
+            }
+            break;
+        case ZRE_MSG_HELLO_WANTED:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            break;
+        case ZRE_MSG_HEADERS:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            zconfig_t *zhash = zconfig_locate (content, "headers");
+            if (zhash) {
+                zhash_t *hash = zhash_new ();
+                zhash_autofree (hash);
+                zconfig_t *child;
+                for (child = zconfig_child (zhash);
+                                child != NULL;
+                                child = zconfig_next (child))
+                {
+                    zhash_update (hash, zconfig_name (child), zconfig_value (child));
+                }
+                self->headers = hash;
+            }
+            }
+            break;
+        case ZRE_MSG_STORE_SET:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "group", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->group, s, 255);
+            }
+            {
+            char *s = zconfig_get (content, "key", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->key, s, 255);
+            }
+            {
+            char *s = zconfig_get (content, "origin", NULL);
+            if (!s || strlen (s) != 2 * 16) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            memcpy (self->origin, bvalue, 16);
+            free (bvalue);
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "stamp", NULL);
+            if (!s) {
+                zsys_error ("content/stamp not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/stamp: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->stamp = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "content", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            if (!bvalue) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zframe_new (bvalue, strlen (s) / 2);
+            zmsg_t *msg = zmsg_decode (frame);
+            zframe_destroy (&frame);
+#else
+            zmsg_t *msg = zmsg_decode (bvalue, strlen (s) / 2);
+#endif
+            free (bvalue);
+            self->content = msg;
+            }
+            break;
+        case ZRE_MSG_STORE_SYNC:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "group", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->group, s, 255);
+            }
+            {
+            zconfig_t *zhash = zconfig_locate (content, "clock");
+            if (zhash) {
+                zhash_t *hash = zhash_new ();
+                zhash_autofree (hash);
+                zconfig_t *child;
+                for (child = zconfig_child (zhash);
+                                child != NULL;
+                                child = zconfig_next (child))
+                {
+                    zhash_update (hash, zconfig_name (child), zconfig_value (child));
+                }
+                self->clock = hash;
+            }
+            }
+            break;
+        case ZRE_MSG_CATCHUP:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "group", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->group, s, 255);
+            }
+            break;
+        case ZRE_MSG_HISTORY:
+            content = zconfig_locate (config, "content");
+            if (!content) {
+                zsys_error ("Can't find 'content' section");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "sequence", NULL);
+            if (!s) {
+                zsys_error ("content/sequence not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/sequence: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->sequence = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "group", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            strncpy (self->group, s, 255);
+            }
+            {
+            char *es = NULL;
+            char *s = zconfig_get (content, "serial", NULL);
+            if (!s) {
+                zsys_error ("content/serial not found");
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            uint64_t uvalue = (uint64_t) strtoll (s, &es, 10);
+            if (es != s+strlen (s)) {
+                zsys_error ("content/serial: %s is not a number", s);
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            self->serial = uvalue;
+            }
+            {
+            char *s = zconfig_get (content, "content", NULL);
+            if (!s) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+            byte *bvalue;
+            BYTES_FROM_STR (bvalue, s);
+            if (!bvalue) {
+                zre_msg_destroy (&self);
+                return NULL;
+            }
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zframe_new (bvalue, strlen (s) / 2);
+            zmsg_t *msg = zmsg_decode (frame);
+            zframe_destroy (&frame);
+#else
+            zmsg_t *msg = zmsg_decode (bvalue, strlen (s) / 2);
+#endif
+            free (bvalue);
+            self->content = msg;
+            }
+            break;
+    }
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the zre_msg
+
+void
+zre_msg_destroy (zre_msg_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        zre_msg_t *self = *self_p;
+
+        //  Free class properties
+        zframe_destroy (&self->routing_id);
+        if (self->groups)
+            zlist_destroy (&self->groups);
+        zhash_destroy (&self->headers);
+        zmsg_destroy (&self->content);
+        zhash_destroy (&self->clock);
+
+        //  Free object itself
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a deep copy of a zre_msg instance
+
+zre_msg_t *
+zre_msg_dup (zre_msg_t *other)
+{
+    assert (other);
+    zre_msg_t *copy = zre_msg_new ();
+
+    // Copy the routing and message id
+    zre_msg_set_routing_id (copy, zre_msg_routing_id (other));
+    zre_msg_set_id (copy, zre_msg_id (other));
+
+
+    // Copy the rest of the fields
+    zre_msg_set_sequence (copy, zre_msg_sequence (other));
+    zre_msg_set_endpoint (copy, zre_msg_endpoint (other));
+    {
+        zlist_t *lcopy = zlist_dup (zre_msg_groups (other));
+        zre_msg_set_groups (copy, &lcopy);
+    }
+    zre_msg_set_status (copy, zre_msg_status (other));
+    zre_msg_set_name (copy, zre_msg_name (other));
+    {
+        zhash_t *dup_hash = zhash_dup (zre_msg_headers (other));
+        zre_msg_set_headers (copy, &dup_hash);
+    }
+    {
+        zmsg_t *dup_msg = zmsg_dup (zre_msg_content (other));
+        zre_msg_set_content (copy, &dup_msg);
+    }
+    zre_msg_set_group (copy, zre_msg_group (other));
+    zre_msg_set_challenger_id (copy, zre_msg_challenger_id (other));
+    zre_msg_set_leader_id (copy, zre_msg_leader_id (other));
+    zre_msg_set_challenger (copy, zre_msg_challenger (other));
+    zre_msg_set_lapsed (copy, zre_msg_lapsed (other));
+    zre_msg_set_leader (copy, zre_msg_leader (other));
+    zre_msg_set_stream (copy, zre_msg_stream (other));
+    zre_msg_set_offset (copy, zre_msg_offset (other));
+    zre_msg_set_total (copy, zre_msg_total (other));
+    zre_msg_set_compressed (copy, zre_msg_compressed (other));
+    zre_msg_set_start (copy, zre_msg_start (other));
+    zre_msg_set_origin (copy, zre_msg_origin (other));
+    zre_msg_set_serial (copy, zre_msg_serial (other));
+    zre_msg_set_fanout (copy, zre_msg_fanout (other));
+    zre_msg_set_bound (copy, zre_msg_bound (other));
+    zre_msg_set_span (copy, zre_msg_span (other));
+    zre_msg_set_correlation (copy, zre_msg_correlation (other));
+    zre_msg_set_key (copy, zre_msg_key (other));
+    zre_msg_set_stamp (copy, zre_msg_stamp (other));
+    {
+        zhash_t *dup_hash = zhash_dup (zre_msg_clock (other));
+        zre_msg_set_clock (copy, &dup_hash);
+    }
+
+    return copy;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Receive a zre_msg from the socket. Returns 0 if OK, -1 if
+//  the recv was interrupted, or -2 if the message is malformed.
+//  Blocks if there is no message waiting.
+
+int
+zre_msg_recv (zre_msg_t *self, zsock_t *input)
+{
+    assert (input);
+    int rc = 0;
+    zmq_msg_t frame;
+    zmq_msg_init (&frame);
+
+    if (zsock_type (input) == ZMQ_ROUTER) {
+        zframe_destroy (&self->routing_id);
+        self->routing_id = zframe_recv (input);
+        if (!self->routing_id || !zsock_rcvmore (input)) {
+            zsys_warning ("zre_msg: no routing ID");
+            rc = -1;            //  Interrupted
+            goto malformed;
+        }
+    }
+    int size;
+    size = zmq_msg_recv (&frame, zsock_resolve (input), 0);
+    if (size == -1) {
+        if (errno != EAGAIN)
+            zsys_warning ("zre_msg: interrupted");
+        rc = -1;                //  Interrupted
+        goto malformed;
+    }
+    self->needle = (byte *) zmq_msg_data (&frame);
+    self->ceiling = self->needle + zmq_msg_size (&frame);
+
+
+    //  Get and check protocol signature
+    uint16_t signature;
+    GET_NUMBER2 (signature);
+    if (signature != (0xAAA0 | 1)) {
+        zsys_warning ("zre_msg: invalid signature");
+        rc = -2;                //  Malformed
+        goto malformed;
+    }
+    //  Get message id and parse per message type
+    GET_NUMBER1 (self->id);
+
+    switch (self->id) {
+        case ZRE_MSG_HELLO:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->endpoint);
+            {
+                size_t list_size;
+                GET_NUMBER4 (list_size);
+                zlist_destroy (&self->groups);
+                self->groups = zlist_new ();
+                zlist_autofree (self->groups);
+                while (list_size--) {
+                    char *string = NULL;
+                    GET_LONGSTR (string);
+                    zlist_append (self->groups, string);
+                    free (string);
+                }
+            }
+            GET_NUMBER1 (self->status);
+            GET_STRING (self->name);
+            {
+                size_t hash_size;
+                GET_NUMBER4 (hash_size);
+                zhash_destroy (&self->headers);
+                self->headers = zhash_new ();
+                zhash_autofree (self->headers);
+                while (hash_size--) {
+                    char key [256];
+                    char *value = NULL;
+                    GET_STRING (key);
+                    GET_LONGSTR (value);
+                    zhash_insert (self->headers, key, value);
+                    free (value);
+                }
+            }
+            break;
+
+        case ZRE_MSG_WHISPER:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            //  Get zero or more remaining frames
+            zmsg_destroy (&self->content);
+            if (zsock_rcvmore (input))
+                self->content = zmsg_recv (input);
+            else
+                self->content = zmsg_new ();
+            break;
+
+        case ZRE_MSG_SHOUT:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            //  Get zero or more remaining frames
+            zmsg_destroy (&self->content);
+            if (zsock_rcvmore (input))
+                self->content = zmsg_recv (input);
+            else
+                self->content = zmsg_new ();
+            break;
+
+        case ZRE_MSG_JOIN:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            GET_NUMBER1 (self->status);
+            break;
+
+        case ZRE_MSG_LEAVE:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            GET_NUMBER1 (self->status);
+            break;
+
+        case ZRE_MSG_PING:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_PING_OK:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_ELECT:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            GET_STRING (self->challenger_id);
+            break;
+
+        case ZRE_MSG_LEADER:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            GET_STRING (self->leader_id);
+            break;
+
+        case ZRE_MSG_GOODBYE:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_ELECT_UUID:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            GET_OCTETS (self->challenger, 16);
+            GET_STRING (self->lapsed);
+            break;
+
+        case ZRE_MSG_LEADER_UUID:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            GET_OCTETS (self->leader, 16);
+            break;
+
+        case ZRE_MSG_STREAM:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_NUMBER4 (self->stream);
+            GET_STRING (self->name);
+            GET_NUMBER8 (self->offset);
+            GET_NUMBER8 (self->total);
+            //  Get zero or more remaining frames
+            zmsg_destroy (&self->content);
+            if (zsock_rcvmore (input))
+                self->content = zmsg_recv (input);
+            else
+                self->content = zmsg_new ();
+            break;
+
+        case ZRE_MSG_STREAM_ACK:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_NUMBER4 (self->stream);
+            GET_NUMBER8 (self->offset);
+            break;
+
+        case ZRE_MSG_WHISPER_ZSTD:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_NUMBER8 (self->compressed);
+            //  Get zero or more remaining frames
+            zmsg_destroy (&self->content);
+            if (zsock_rcvmore (input))
+                self->content = zmsg_recv (input);
+            else
+                self->content = zmsg_new ();
+            break;
+
+        case ZRE_MSG_SHOUT_ZSTD:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            GET_NUMBER8 (self->compressed);
+            //  Get zero or more remaining frames
+            zmsg_destroy (&self->content);
+            if (zsock_rcvmore (input))
+                self->content = zmsg_recv (input);
+            else
+                self->content = zmsg_new ();
+            break;
+
+        case ZRE_MSG_MULTICAST:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            GET_STRING (self->endpoint);
+            break;
+
+        case ZRE_MSG_MULTICAST_OK:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            GET_STRING (self->endpoint);
+            GET_NUMBER4 (self->start);
+            break;
+
+        case ZRE_MSG_RELAY:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_OCTETS (self->origin, 16);
+            GET_STRING (self->group);
+            GET_NUMBER4 (self->serial);
+            GET_NUMBER1 (self->fanout);
+            GET_OCTETS (self->bound, 16);
+            GET_NUMBER4 (self->span);
+            //  Get zero or more remaining frames
+            zmsg_destroy (&self->content);
+            if (zsock_rcvmore (input))
+                self->content = zmsg_recv (input);
+            else
+                self->content = zmsg_new ();
+            break;
+
+        case ZRE_MSG_REQUEST:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_NUMBER8 (self->correlation);
+            //  Get zero or more remaining frames
+            zmsg_destroy (&self->content);
+            if (zsock_rcvmore (input))
+                self->content = zmsg_recv (input);
+            else
+                self->content = zmsg_new ();
+            break;
+
+        case ZRE_MSG_REPLY:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_NUMBER8 (self->correlation);
+            //  Get zero or more remaining frames
+            zmsg_destroy (&self->content);
+            if (zsock_rcvmore (input))
+                self->content = zmsg_recv (input);
+            else
+                self->content = zmsg_new ();
+            break;
+
+        case ZRE_MSG_HELLO_WANTED:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_HEADERS:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            {
+                size_t hash_size;
+                GET_NUMBER4 (hash_size);
+                zhash_destroy (&self->headers);
+                self->headers = zhash_new ();
+                zhash_autofree (self->headers);
+                while (hash_size--) {
+                    char key [256];
+                    char *value = NULL;
+                    GET_STRING (key);
+                    GET_LONGSTR (value);
+                    zhash_insert (self->headers, key, value);
+                    free (value);
+                }
+            }
+            break;
+
+        case ZRE_MSG_STORE_SET:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            GET_STRING (self->key);
+            GET_OCTETS (self->origin, 16);
+            GET_NUMBER8 (self->stamp);
+            //  Get zero or more remaining frames
+            zmsg_destroy (&self->content);
+            if (zsock_rcvmore (input))
+                self->content = zmsg_recv (input);
+            else
+                self->content = zmsg_new ();
+            break;
+
+        case ZRE_MSG_STORE_SYNC:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            {
+                size_t hash_size;
+                GET_NUMBER4 (hash_size);
+                zhash_destroy (&self->clock);
+                self->clock = zhash_new ();
+                zhash_autofree (self->clock);
+                while (hash_size--) {
+                    char key [256];
+                    char *value = NULL;
+                    GET_STRING (key);
+                    GET_LONGSTR (value);
+                    zhash_insert (self->clock, key, value);
+                    free (value);
+                }
+            }
+            break;
+
+        case ZRE_MSG_CATCHUP:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            break;
+
+        case ZRE_MSG_HISTORY:
+            {
+                byte version;
+                GET_NUMBER1 (version);
+                if (version != 2) {
+                    zsys_warning ("zre_msg: version is invalid");
+                    rc = -2;    //  Malformed
+                    goto malformed;
+                }
+            }
+            GET_NUMBER2 (self->sequence);
+            GET_STRING (self->group);
+            GET_NUMBER4 (self->serial);
+            //  Get zero or more remaining frames
+            zmsg_destroy (&self->content);
+            if (zsock_rcvmore (input))
+                self->content = zmsg_recv (input);
+            else
+                self->content = zmsg_new ();
+            break;
+
+        default:
+            zsys_warning ("zre_msg: bad message ID");
+            rc = -2;            //  Malformed
+            goto malformed;
+    }
+    //  Successful return
+    zmq_msg_close (&frame);
+    return rc;
+
+    //  Error returns
+    malformed:
+        zmq_msg_close (&frame);
+        return rc;              //  Invalid message
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send the zre_msg to the socket. Does not destroy it. Returns 0 if
+//  OK, else -1.
+
+int
+zre_msg_send (zre_msg_t *self, zsock_t *output)
+{
+    assert (self);
+    assert (output);
+
+    if (zsock_type (output) == ZMQ_ROUTER)
+        zframe_send (&self->routing_id, output, ZFRAME_MORE + ZFRAME_REUSE);
+
+    size_t frame_size = 2 + 1;          //  Signature and message ID
+
+    switch (self->id) {
+        case ZRE_MSG_HELLO:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->endpoint);
+            frame_size += 4;            //  Size is 4 octets
+            if (self->groups) {
+                char *groups = (char *) zlist_first (self->groups);
+                while (groups) {
+                    frame_size += 4 + strlen (groups);
+                    groups = (char *) zlist_next (self->groups);
+                }
+            }
+            frame_size += 1;            //  status
+            frame_size += 1 + strlen (self->name);
+            frame_size += 4;            //  Size is 4 octets
+            if (self->headers) {
+                self->headers_bytes = 0;
+                char *item = (char *) zhash_first (self->headers);
+                while (item) {
+                    self->headers_bytes += 1 + strlen (zhash_cursor (self->headers));
+                    self->headers_bytes += 4 + strlen (item);
+                    item = (char *) zhash_next (self->headers);
+                }
+            }
+            frame_size += self->headers_bytes;
+            break;
+        case ZRE_MSG_WHISPER:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            break;
+        case ZRE_MSG_SHOUT:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            break;
+        case ZRE_MSG_JOIN:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1;            //  status
+            break;
+        case ZRE_MSG_LEAVE:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1;            //  status
+            break;
+        case ZRE_MSG_PING:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            break;
+        case ZRE_MSG_PING_OK:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            break;
+        case ZRE_MSG_ELECT:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1 + strlen (self->challenger_id);
+            break;
+        case ZRE_MSG_LEADER:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1 + strlen (self->leader_id);
+            break;
+        case ZRE_MSG_GOODBYE:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            break;
+        case ZRE_MSG_ELECT_UUID:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 16;           //  challenger
+            frame_size += 1 + strlen (self->lapsed);
+            break;
+        case ZRE_MSG_LEADER_UUID:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 16;           //  leader
+            break;
+        case ZRE_MSG_STREAM:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 4;            //  stream
+            frame_size += 1 + strlen (self->name);
+            frame_size += 8;            //  offset
+            frame_size += 8;            //  total
+            break;
+        case ZRE_MSG_STREAM_ACK:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 4;            //  stream
+            frame_size += 8;            //  offset
+            break;
+        case ZRE_MSG_WHISPER_ZSTD:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 8;            //  compressed
+            break;
+        case ZRE_MSG_SHOUT_ZSTD:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 8;            //  compressed
+            break;
+        case ZRE_MSG_MULTICAST:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1 + strlen (self->endpoint);
+            break;
+        case ZRE_MSG_MULTICAST_OK:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1 + strlen (self->endpoint);
+            frame_size += 4;            //  start
+            break;
+        case ZRE_MSG_RELAY:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 16;           //  origin
+            frame_size += 1 + strlen (self->group);
+            frame_size += 4;            //  serial
+            frame_size += 1;            //  fanout
+            frame_size += 16;           //  bound
+            frame_size += 4;            //  span
+            break;
+        case ZRE_MSG_REQUEST:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 8;            //  correlation
+            break;
+        case ZRE_MSG_REPLY:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 8;            //  correlation
+            break;
+        case ZRE_MSG_HELLO_WANTED:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            break;
+        case ZRE_MSG_HEADERS:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 4;            //  Size is 4 octets
+            if (self->headers) {
+                self->headers_bytes = 0;
+                char *item = (char *) zhash_first (self->headers);
+                while (item) {
+                    self->headers_bytes += 1 + strlen (zhash_cursor (self->headers));
+                    self->headers_bytes += 4 + strlen (item);
+                    item = (char *) zhash_next (self->headers);
+                }
+            }
+            frame_size += self->headers_bytes;
+            break;
+        case ZRE_MSG_STORE_SET:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1 + strlen (self->key);
+            frame_size += 16;           //  origin
+            frame_size += 8;            //  stamp
+            break;
+        case ZRE_MSG_STORE_SYNC:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 4;            //  Size is 4 octets
+            if (self->clock) {
+                self->clock_bytes = 0;
+                char *item = (char *) zhash_first (self->clock);
+                while (item) {
+                    self->clock_bytes += 1 + strlen (zhash_cursor (self->clock));
+                    self->clock_bytes += 4 + strlen (item);
+                    item = (char *) zhash_next (self->clock);
+                }
+            }
+            frame_size += self->clock_bytes;
+            break;
+        case ZRE_MSG_CATCHUP:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            break;
+        case ZRE_MSG_HISTORY:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 4;            //  serial
+            break;
+    }
+
+    zmq_msg_t frame;
+    zmq_msg_init_size (&frame, frame_size);
+    self->needle = (byte *) zmq_msg_data (&frame);
+
+    //  Now serialize message into the frame
+    PUT_NUMBER2 (0xAAA0 | 1);
+    PUT_NUMBER1 (self->id);
+    bool have_content = false;
+    size_t nbr_frames = 1;              //  Total number of frames to send
+
+    switch (self->id) {
+        case ZRE_MSG_HELLO:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->endpoint);
+            if (self->groups) {
+                PUT_NUMBER4 (zlist_size (self->groups));
+                char *groups = (char *) zlist_first (self->groups);
+                while (groups) {
+                    PUT_LONGSTR (groups);
+                    groups = (char *) zlist_next (self->groups);
+                }
+            }
+            else
+                PUT_NUMBER4 (0);    //  Empty string array
+            PUT_NUMBER1 (self->status);
+            PUT_STRING (self->name);
+            if (self->headers) {
+                PUT_NUMBER4 (zhash_size (self->headers));
+                char *item = (char *) zhash_first (self->headers);
+                while (item) {
+                    PUT_STRING (zhash_cursor (self->headers));
+                    PUT_LONGSTR (item);
+                    item = (char *) zhash_next (self->headers);
+                }
+            }
+            else
+                PUT_NUMBER4 (0);    //  Empty hash
+            break;
+
+        case ZRE_MSG_WHISPER:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            have_content = true;
+            break;
+
+        case ZRE_MSG_SHOUT:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            have_content = true;
+            break;
+
+        case ZRE_MSG_JOIN:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_NUMBER1 (self->status);
+            break;
+
+        case ZRE_MSG_LEAVE:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_NUMBER1 (self->status);
+            break;
+
+        case ZRE_MSG_PING:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_PING_OK:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_ELECT:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_STRING (self->challenger_id);
+            break;
+
+        case ZRE_MSG_LEADER:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_STRING (self->leader_id);
+            break;
+
+        case ZRE_MSG_GOODBYE:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_ELECT_UUID:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_OCTETS (self->challenger, 16);
+            PUT_STRING (self->lapsed);
+            break;
+
+        case ZRE_MSG_LEADER_UUID:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_OCTETS (self->leader, 16);
+            break;
+
+        case ZRE_MSG_STREAM:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_NUMBER4 (self->stream);
+            PUT_STRING (self->name);
+            PUT_NUMBER8 (self->offset);
+            PUT_NUMBER8 (self->total);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            have_content = true;
+            break;
+
+        case ZRE_MSG_STREAM_ACK:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_NUMBER4 (self->stream);
+            PUT_NUMBER8 (self->offset);
+            break;
+
+        case ZRE_MSG_WHISPER_ZSTD:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_NUMBER8 (self->compressed);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            have_content = true;
+            break;
+
+        case ZRE_MSG_SHOUT_ZSTD:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_NUMBER8 (self->compressed);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            have_content = true;
+            break;
+
+        case ZRE_MSG_MULTICAST:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_STRING (self->endpoint);
+            break;
+
+        case ZRE_MSG_MULTICAST_OK:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_STRING (self->endpoint);
+            PUT_NUMBER4 (self->start);
+            break;
+
+        case ZRE_MSG_RELAY:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_OCTETS (self->origin, 16);
+            PUT_STRING (self->group);
+            PUT_NUMBER4 (self->serial);
+            PUT_NUMBER1 (self->fanout);
+            PUT_OCTETS (self->bound, 16);
+            PUT_NUMBER4 (self->span);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            have_content = true;
+            break;
+
+        case ZRE_MSG_REQUEST:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_NUMBER8 (self->correlation);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            have_content = true;
+            break;
+
+        case ZRE_MSG_REPLY:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_NUMBER8 (self->correlation);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            have_content = true;
+            break;
+
+        case ZRE_MSG_HELLO_WANTED:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_HEADERS:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            if (self->headers) {
+                PUT_NUMBER4 (zhash_size (self->headers));
+                char *item = (char *) zhash_first (self->headers);
+                while (item) {
+                    PUT_STRING (zhash_cursor (self->headers));
+                    PUT_LONGSTR (item);
+                    item = (char *) zhash_next (self->headers);
+                }
+            }
+            else
+                PUT_NUMBER4 (0);    //  Empty hash
+            break;
+
+        case ZRE_MSG_STORE_SET:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_STRING (self->key);
+            PUT_OCTETS (self->origin, 16);
+            PUT_NUMBER8 (self->stamp);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            have_content = true;
+            break;
+
+        case ZRE_MSG_STORE_SYNC:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            if (self->clock) {
+                PUT_NUMBER4 (zhash_size (self->clock));
+                char *item = (char *) zhash_first (self->clock);
+                while (item) {
+                    PUT_STRING (zhash_cursor (self->clock));
+                    PUT_LONGSTR (item);
+                    item = (char *) zhash_next (self->clock);
+                }
+            }
+            else
+                PUT_NUMBER4 (0);    //  Empty hash
+            break;
+
+        case ZRE_MSG_CATCHUP:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            break;
+
+        case ZRE_MSG_HISTORY:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_NUMBER4 (self->serial);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            have_content = true;
+            break;
+
+    }
+
+    //  Now send the data frame
+    zmq_msg_send (&frame, zsock_resolve (output), --nbr_frames? ZMQ_SNDMORE: 0);
+
+    //  Now send the content if necessary
+    if (have_content) {
+        if (self->content) {
+            zframe_t *frame = zmsg_first (self->content);
+            while (frame) {
+                zframe_send (&frame, output, ZFRAME_REUSE + (--nbr_frames? ZFRAME_MORE: 0));
+                frame = zmsg_next (self->content);
+            }
+        }
+        else
+            zmq_send (zsock_resolve (output), NULL, 0, 0);
+    }
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Encode the first frame of zre_msg. Does not destroy it. Returns the frame if
+//  OK, else NULL.
+
+zframe_t *
+zre_msg_encode (zre_msg_t *self)
+{
+    assert (self);
+
+    size_t frame_size = 2 + 1;          //  Signature and message ID
+
+    switch (self->id) {
+        case ZRE_MSG_HELLO:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->endpoint);
+            frame_size += 4;            //  Size is 4 octets
+            if (self->groups) {
+                char *groups = (char *) zlist_first (self->groups);
+                while (groups) {
+                    frame_size += 4 + strlen (groups);
+                    groups = (char *) zlist_next (self->groups);
+                }
+            }
+            frame_size += 1;            //  status
+            frame_size += 1 + strlen (self->name);
+            frame_size += 4;            //  Size is 4 octets
+            if (self->headers) {
+                self->headers_bytes = 0;
+                char *item = (char *) zhash_first (self->headers);
+                while (item) {
+                    self->headers_bytes += 1 + strlen (zhash_cursor (self->headers));
+                    self->headers_bytes += 4 + strlen (item);
+                    item = (char *) zhash_next (self->headers);
+                }
+            }
+            frame_size += self->headers_bytes;
+            break;
+        case ZRE_MSG_WHISPER:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            break;
+        case ZRE_MSG_SHOUT:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            break;
+        case ZRE_MSG_JOIN:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1;            //  status
+            break;
+        case ZRE_MSG_LEAVE:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
             frame_size += 1;            //  status
             break;
-        case ZRE_MSG_LEAVE:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->group);
-            frame_size += 1;            //  status
+        case ZRE_MSG_PING:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            break;
+        case ZRE_MSG_PING_OK:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            break;
+        case ZRE_MSG_ELECT:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1 + strlen (self->challenger_id);
+            break;
+        case ZRE_MSG_LEADER:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1 + strlen (self->leader_id);
+            break;
+        case ZRE_MSG_GOODBYE:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            break;
+        case ZRE_MSG_ELECT_UUID:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 16;           //  challenger
+            frame_size += 1 + strlen (self->lapsed);
+            break;
+        case ZRE_MSG_LEADER_UUID:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 16;           //  leader
+            break;
+        case ZRE_MSG_STREAM:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 4;            //  stream
+            frame_size += 1 + strlen (self->name);
+            frame_size += 8;            //  offset
+            frame_size += 8;            //  total
+            break;
+        case ZRE_MSG_STREAM_ACK:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 4;            //  stream
+            frame_size += 8;            //  offset
+            break;
+        case ZRE_MSG_WHISPER_ZSTD:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 8;            //  compressed
+            break;
+        case ZRE_MSG_SHOUT_ZSTD:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 8;            //  compressed
+            break;
+        case ZRE_MSG_MULTICAST:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1 + strlen (self->endpoint);
+            break;
+        case ZRE_MSG_MULTICAST_OK:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1 + strlen (self->endpoint);
+            frame_size += 4;            //  start
+            break;
+        case ZRE_MSG_RELAY:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 16;           //  origin
+            frame_size += 1 + strlen (self->group);
+            frame_size += 4;            //  serial
+            frame_size += 1;            //  fanout
+            frame_size += 16;           //  bound
+            frame_size += 4;            //  span
+            break;
+        case ZRE_MSG_REQUEST:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 8;            //  correlation
+            break;
+        case ZRE_MSG_REPLY:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 8;            //  correlation
+            break;
+        case ZRE_MSG_HELLO_WANTED:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            break;
+        case ZRE_MSG_HEADERS:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 4;            //  Size is 4 octets
+            if (self->headers) {
+                self->headers_bytes = 0;
+                char *item = (char *) zhash_first (self->headers);
+                while (item) {
+                    self->headers_bytes += 1 + strlen (zhash_cursor (self->headers));
+                    self->headers_bytes += 4 + strlen (item);
+                    item = (char *) zhash_next (self->headers);
+                }
+            }
+            frame_size += self->headers_bytes;
+            break;
+        case ZRE_MSG_STORE_SET:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 1 + strlen (self->key);
+            frame_size += 16;           //  origin
+            frame_size += 8;            //  stamp
+            break;
+        case ZRE_MSG_STORE_SYNC:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 4;            //  Size is 4 octets
+            if (self->clock) {
+                self->clock_bytes = 0;
+                char *item = (char *) zhash_first (self->clock);
+                while (item) {
+                    self->clock_bytes += 1 + strlen (zhash_cursor (self->clock));
+                    self->clock_bytes += 4 + strlen (item);
+                    item = (char *) zhash_next (self->clock);
+                }
+            }
+            frame_size += self->clock_bytes;
+            break;
+        case ZRE_MSG_CATCHUP:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            break;
+        case ZRE_MSG_HISTORY:
+            frame_size += 1;            //  version
+            frame_size += 2;            //  sequence
+            frame_size += 1 + strlen (self->group);
+            frame_size += 4;            //  serial
+            break;
+    }
+
+    zframe_t *frame = zframe_new (NULL, frame_size);
+    self->needle = (byte *) zframe_data (frame);
+
+    //  Now serialize message into the frame
+    PUT_NUMBER2 (0xAAA0 | 1);
+    PUT_NUMBER1 (self->id);
+    size_t nbr_frames = 1;              //  Total number of frames to send
+
+    switch (self->id) {
+        case ZRE_MSG_HELLO:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->endpoint);
+            if (self->groups) {
+                PUT_NUMBER4 (zlist_size (self->groups));
+                char *groups = (char *) zlist_first (self->groups);
+                while (groups) {
+                    PUT_LONGSTR (groups);
+                    groups = (char *) zlist_next (self->groups);
+                }
+            }
+            else
+                PUT_NUMBER4 (0);    //  Empty string array
+            PUT_NUMBER1 (self->status);
+            PUT_STRING (self->name);
+            if (self->headers) {
+                PUT_NUMBER4 (zhash_size (self->headers));
+                char *item = (char *) zhash_first (self->headers);
+                while (item) {
+                    PUT_STRING (zhash_cursor (self->headers));
+                    PUT_LONGSTR (item);
+                    item = (char *) zhash_next (self->headers);
+                }
+            }
+            else
+                PUT_NUMBER4 (0);    //  Empty hash
+            break;
+
+        case ZRE_MSG_WHISPER:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            break;
+
+        case ZRE_MSG_SHOUT:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            break;
+
+        case ZRE_MSG_JOIN:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_NUMBER1 (self->status);
+            break;
+
+        case ZRE_MSG_LEAVE:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_NUMBER1 (self->status);
+            break;
+
+        case ZRE_MSG_PING:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_PING_OK:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_ELECT:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_STRING (self->challenger_id);
+            break;
+
+        case ZRE_MSG_LEADER:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_STRING (self->leader_id);
+            break;
+
+        case ZRE_MSG_GOODBYE:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_ELECT_UUID:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_OCTETS (self->challenger, 16);
+            PUT_STRING (self->lapsed);
+            break;
+
+        case ZRE_MSG_LEADER_UUID:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_OCTETS (self->leader, 16);
+            break;
+
+        case ZRE_MSG_STREAM:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_NUMBER4 (self->stream);
+            PUT_STRING (self->name);
+            PUT_NUMBER8 (self->offset);
+            PUT_NUMBER8 (self->total);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            break;
+
+        case ZRE_MSG_STREAM_ACK:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_NUMBER4 (self->stream);
+            PUT_NUMBER8 (self->offset);
+            break;
+
+        case ZRE_MSG_WHISPER_ZSTD:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_NUMBER8 (self->compressed);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            break;
+
+        case ZRE_MSG_SHOUT_ZSTD:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_NUMBER8 (self->compressed);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            break;
+
+        case ZRE_MSG_MULTICAST:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_STRING (self->endpoint);
+            break;
+
+        case ZRE_MSG_MULTICAST_OK:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_STRING (self->endpoint);
+            PUT_NUMBER4 (self->start);
+            break;
+
+        case ZRE_MSG_RELAY:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_OCTETS (self->origin, 16);
+            PUT_STRING (self->group);
+            PUT_NUMBER4 (self->serial);
+            PUT_NUMBER1 (self->fanout);
+            PUT_OCTETS (self->bound, 16);
+            PUT_NUMBER4 (self->span);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            break;
+
+        case ZRE_MSG_REQUEST:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_NUMBER8 (self->correlation);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            break;
+
+        case ZRE_MSG_REPLY:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_NUMBER8 (self->correlation);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            break;
+
+        case ZRE_MSG_HELLO_WANTED:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            break;
+
+        case ZRE_MSG_HEADERS:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            if (self->headers) {
+                PUT_NUMBER4 (zhash_size (self->headers));
+                char *item = (char *) zhash_first (self->headers);
+                while (item) {
+                    PUT_STRING (zhash_cursor (self->headers));
+                    PUT_LONGSTR (item);
+                    item = (char *) zhash_next (self->headers);
+                }
+            }
+            else
+                PUT_NUMBER4 (0);    //  Empty hash
+            break;
+
+        case ZRE_MSG_STORE_SET:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_STRING (self->key);
+            PUT_OCTETS (self->origin, 16);
+            PUT_NUMBER8 (self->stamp);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            break;
+
+        case ZRE_MSG_STORE_SYNC:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            if (self->clock) {
+                PUT_NUMBER4 (zhash_size (self->clock));
+                char *item = (char *) zhash_first (self->clock);
+                while (item) {
+                    PUT_STRING (zhash_cursor (self->clock));
+                    PUT_LONGSTR (item);
+                    item = (char *) zhash_next (self->clock);
+                }
+            }
+            else
+                PUT_NUMBER4 (0);    //  Empty hash
+            break;
+
+        case ZRE_MSG_CATCHUP:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            break;
+
+        case ZRE_MSG_HISTORY:
+            PUT_NUMBER1 (2);
+            PUT_NUMBER2 (self->sequence);
+            PUT_STRING (self->group);
+            PUT_NUMBER4 (self->serial);
+            nbr_frames += self->content? zmsg_size (self->content): 1;
+            break;
+
+    }
+
+    return frame;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Print contents of message to stdout
+
+void
+zre_msg_print (zre_msg_t *self)
+{
+    assert (self);
+    switch (self->id) {
+        case ZRE_MSG_HELLO:
+            zsys_debug ("ZRE_MSG_HELLO:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    endpoint='%s'", self->endpoint);
+            zsys_debug ("    groups=");
+            if (self->groups) {
+                char *groups = (char *) zlist_first (self->groups);
+                while (groups) {
+                    zsys_debug ("        '%s'", groups);
+                    groups = (char *) zlist_next (self->groups);
+                }
+            }
+            zsys_debug ("    status=%ld", (long) self->status);
+            zsys_debug ("    name='%s'", self->name);
+            zsys_debug ("    headers=");
+            if (self->headers) {
+                char *item = (char *) zhash_first (self->headers);
+                while (item) {
+                    zsys_debug ("        %s=%s", zhash_cursor (self->headers), item);
+                    item = (char *) zhash_next (self->headers);
+                }
+            }
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_WHISPER:
+            zsys_debug ("ZRE_MSG_WHISPER:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    content=");
+            if (self->content)
+                zmsg_print (self->content);
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_SHOUT:
+            zsys_debug ("ZRE_MSG_SHOUT:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    content=");
+            if (self->content)
+                zmsg_print (self->content);
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_JOIN:
+            zsys_debug ("ZRE_MSG_JOIN:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    status=%ld", (long) self->status);
+            break;
+
+        case ZRE_MSG_LEAVE:
+            zsys_debug ("ZRE_MSG_LEAVE:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    status=%ld", (long) self->status);
+            break;
+
+        case ZRE_MSG_PING:
+            zsys_debug ("ZRE_MSG_PING:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            break;
+
+        case ZRE_MSG_PING_OK:
+            zsys_debug ("ZRE_MSG_PING_OK:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            break;
+
+        case ZRE_MSG_ELECT:
+            zsys_debug ("ZRE_MSG_ELECT:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    challenger_id='%s'", self->challenger_id);
+            break;
+
+        case ZRE_MSG_LEADER:
+            zsys_debug ("ZRE_MSG_LEADER:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    leader_id='%s'", self->leader_id);
+            break;
+
+        case ZRE_MSG_GOODBYE:
+            zsys_debug ("ZRE_MSG_GOODBYE:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            break;
+
+        case ZRE_MSG_ELECT_UUID:
+            zsys_debug ("ZRE_MSG_ELECT_UUID:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, self->challenger, 16);
+                zsys_debug ("    challenger=%s", hex);
+                zstr_free (&hex);
+            }
+            zsys_debug ("    lapsed='%s'", self->lapsed);
+            break;
+
+        case ZRE_MSG_LEADER_UUID:
+            zsys_debug ("ZRE_MSG_LEADER_UUID:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, self->leader, 16);
+                zsys_debug ("    leader=%s", hex);
+                zstr_free (&hex);
+            }
+            break;
+
+        case ZRE_MSG_STREAM:
+            zsys_debug ("ZRE_MSG_STREAM:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    stream=%ld", (long) self->stream);
+            zsys_debug ("    name='%s'", self->name);
+            zsys_debug ("    offset=%ld", (long) self->offset);
+            zsys_debug ("    total=%ld", (long) self->total);
+            zsys_debug ("    content=");
+            if (self->content)
+                zmsg_print (self->content);
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_STREAM_ACK:
+            zsys_debug ("ZRE_MSG_STREAM_ACK:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    stream=%ld", (long) self->stream);
+            zsys_debug ("    offset=%ld", (long) self->offset);
+            break;
+
+        case ZRE_MSG_WHISPER_ZSTD:
+            zsys_debug ("ZRE_MSG_WHISPER_ZSTD:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    compressed=%ld", (long) self->compressed);
+            zsys_debug ("    content=");
+            if (self->content)
+                zmsg_print (self->content);
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_SHOUT_ZSTD:
+            zsys_debug ("ZRE_MSG_SHOUT_ZSTD:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    compressed=%ld", (long) self->compressed);
+            zsys_debug ("    content=");
+            if (self->content)
+                zmsg_print (self->content);
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_MULTICAST:
+            zsys_debug ("ZRE_MSG_MULTICAST:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    endpoint='%s'", self->endpoint);
+            break;
+
+        case ZRE_MSG_MULTICAST_OK:
+            zsys_debug ("ZRE_MSG_MULTICAST_OK:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    endpoint='%s'", self->endpoint);
+            zsys_debug ("    start=%ld", (long) self->start);
+            break;
+
+        case ZRE_MSG_RELAY:
+            zsys_debug ("ZRE_MSG_RELAY:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, self->origin, 16);
+                zsys_debug ("    origin=%s", hex);
+                zstr_free (&hex);
+            }
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    serial=%ld", (long) self->serial);
+            zsys_debug ("    fanout=%ld", (long) self->fanout);
+            {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, self->bound, 16);
+                zsys_debug ("    bound=%s", hex);
+                zstr_free (&hex);
+            }
+            zsys_debug ("    span=%ld", (long) self->span);
+            zsys_debug ("    content=");
+            if (self->content)
+                zmsg_print (self->content);
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_REQUEST:
+            zsys_debug ("ZRE_MSG_REQUEST:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    correlation=%ld", (long) self->correlation);
+            zsys_debug ("    content=");
+            if (self->content)
+                zmsg_print (self->content);
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_REPLY:
+            zsys_debug ("ZRE_MSG_REPLY:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    correlation=%ld", (long) self->correlation);
+            zsys_debug ("    content=");
+            if (self->content)
+                zmsg_print (self->content);
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_HELLO_WANTED:
+            zsys_debug ("ZRE_MSG_HELLO_WANTED:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            break;
+
+        case ZRE_MSG_HEADERS:
+            zsys_debug ("ZRE_MSG_HEADERS:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    headers=");
+            if (self->headers) {
+                char *item = (char *) zhash_first (self->headers);
+                while (item) {
+                    zsys_debug ("        %s=%s", zhash_cursor (self->headers), item);
+                    item = (char *) zhash_next (self->headers);
+                }
+            }
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_STORE_SET:
+            zsys_debug ("ZRE_MSG_STORE_SET:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    key='%s'", self->key);
+            {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, self->origin, 16);
+                zsys_debug ("    origin=%s", hex);
+                zstr_free (&hex);
+            }
+            zsys_debug ("    stamp=%ld", (long) self->stamp);
+            zsys_debug ("    content=");
+            if (self->content)
+                zmsg_print (self->content);
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_STORE_SYNC:
+            zsys_debug ("ZRE_MSG_STORE_SYNC:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    clock=");
+            if (self->clock) {
+                char *item = (char *) zhash_first (self->clock);
+                while (item) {
+                    zsys_debug ("        %s=%s", zhash_cursor (self->clock), item);
+                    item = (char *) zhash_next (self->clock);
+                }
+            }
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+        case ZRE_MSG_CATCHUP:
+            zsys_debug ("ZRE_MSG_CATCHUP:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            break;
+
+        case ZRE_MSG_HISTORY:
+            zsys_debug ("ZRE_MSG_HISTORY:");
+            zsys_debug ("    version=2");
+            zsys_debug ("    sequence=%ld", (long) self->sequence);
+            zsys_debug ("    group='%s'", self->group);
+            zsys_debug ("    serial=%ld", (long) self->serial);
+            zsys_debug ("    content=");
+            if (self->content)
+                zmsg_print (self->content);
+            else
+                zsys_debug ("(NULL)");
+            break;
+
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Export class as zconfig_t*. Caller is responsibe for destroying the instance
+
+zconfig_t *
+zre_msg_zpl (zre_msg_t *self, zconfig_t *parent)
+{
+    assert (self);
+
+    zconfig_t *root = zconfig_new ("zre_msg", parent);
+
+    switch (self->id) {
+        case ZRE_MSG_HELLO:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_HELLO");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "endpoint", "%s", self->endpoint);
+            if (self->groups) {
+                zconfig_t *strings = zconfig_new ("groups", config);
+                size_t i = 0;
+                char *groups = (char *) zlist_first (self->groups);
+                while (groups) {
+                    char *key = zsys_sprintf ("%zu", i);
+                    zconfig_putf (strings, key, "%s", groups);
+                    zstr_free (&key);
+                    i++;
+                    groups = (char *) zlist_next (self->groups);
+                }
+            }
+            zconfig_putf (config, "status", "%ld", (long) self->status);
+            zconfig_putf (config, "name", "%s", self->name);
+            if (self->headers) {
+                zconfig_t *hash = zconfig_new ("headers", config);
+                char *item = (char *) zhash_first (self->headers);
+                while (item) {
+                    zconfig_putf (hash, zhash_cursor (self->headers), "%s", item);
+                    item = (char *) zhash_next (self->headers);
+                }
+            }
+            break;
+            }
+        case ZRE_MSG_WHISPER:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_WHISPER");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            {
+            char *hex = NULL;
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zmsg_encode (self->content);
+            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            zframe_destroy (&frame);
+#else
+            byte *buffer;
+            size_t size = zmsg_encode (self->content, &buffer);
+            STR_FROM_BYTES (hex, buffer, size);
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            free (buffer); buffer= NULL;
+#endif
+            }
+            break;
+            }
+        case ZRE_MSG_SHOUT:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_SHOUT");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            {
+            char *hex = NULL;
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zmsg_encode (self->content);
+            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            zframe_destroy (&frame);
+#else
+            byte *buffer;
+            size_t size = zmsg_encode (self->content, &buffer);
+            STR_FROM_BYTES (hex, buffer, size);
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            free (buffer); buffer= NULL;
+#endif
+            }
+            break;
+            }
+        case ZRE_MSG_JOIN:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_JOIN");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            zconfig_putf (config, "status", "%ld", (long) self->status);
+            break;
+            }
+        case ZRE_MSG_LEAVE:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_LEAVE");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            zconfig_putf (config, "status", "%ld", (long) self->status);
+            break;
+            }
+        case ZRE_MSG_PING:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_PING");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            break;
+            }
+        case ZRE_MSG_PING_OK:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_PING_OK");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            break;
+            }
+        case ZRE_MSG_ELECT:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_ELECT");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            zconfig_putf (config, "challenger_id", "%s", self->challenger_id);
             break;
-        case ZRE_MSG_PING:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
+            }
+        case ZRE_MSG_LEADER:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_LEADER");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            zconfig_putf (config, "leader_id", "%s", self->leader_id);
             break;
-        case ZRE_MSG_PING_OK:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
+            }
+        case ZRE_MSG_GOODBYE:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_GOODBYE");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            break;
+            }
+        case ZRE_MSG_ELECT_UUID:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_ELECT_UUID");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            {
+            char *hex = NULL;
+            STR_FROM_BYTES (hex, self->challenger, 16);
+            zconfig_putf (config, "challenger", "%s", hex);
+            zstr_free (&hex);
+            }
+            zconfig_putf (config, "lapsed", "%s", self->lapsed);
+            break;
+            }
+        case ZRE_MSG_LEADER_UUID:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_LEADER_UUID");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            {
+            char *hex = NULL;
+            STR_FROM_BYTES (hex, self->leader, 16);
+            zconfig_putf (config, "leader", "%s", hex);
+            zstr_free (&hex);
+            }
+            break;
+            }
+        case ZRE_MSG_STREAM:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_STREAM");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "stream", "%ld", (long) self->stream);
+            zconfig_putf (config, "name", "%s", self->name);
+            zconfig_putf (config, "offset", "%ld", (long) self->offset);
+            zconfig_putf (config, "total", "%ld", (long) self->total);
+            {
+            char *hex = NULL;
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zmsg_encode (self->content);
+            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            zframe_destroy (&frame);
+#else
+            byte *buffer;
+            size_t size = zmsg_encode (self->content, &buffer);
+            STR_FROM_BYTES (hex, buffer, size);
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            free (buffer); buffer= NULL;
+#endif
+            }
+            break;
+            }
+        case ZRE_MSG_STREAM_ACK:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_STREAM_ACK");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "stream", "%ld", (long) self->stream);
+            zconfig_putf (config, "offset", "%ld", (long) self->offset);
+            break;
+            }
+        case ZRE_MSG_WHISPER_ZSTD:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_WHISPER_ZSTD");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "compressed", "%ld", (long) self->compressed);
+            {
+            char *hex = NULL;
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zmsg_encode (self->content);
+            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            zframe_destroy (&frame);
+#else
+            byte *buffer;
+            size_t size = zmsg_encode (self->content, &buffer);
+            STR_FROM_BYTES (hex, buffer, size);
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            free (buffer); buffer= NULL;
+#endif
+            }
+            break;
+            }
+        case ZRE_MSG_SHOUT_ZSTD:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_SHOUT_ZSTD");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            zconfig_putf (config, "compressed", "%ld", (long) self->compressed);
+            {
+            char *hex = NULL;
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zmsg_encode (self->content);
+            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            zframe_destroy (&frame);
+#else
+            byte *buffer;
+            size_t size = zmsg_encode (self->content, &buffer);
+            STR_FROM_BYTES (hex, buffer, size);
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            free (buffer); buffer= NULL;
+#endif
+            }
+            break;
+            }
+        case ZRE_MSG_MULTICAST:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_MULTICAST");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            zconfig_putf (config, "endpoint", "%s", self->endpoint);
+            break;
+            }
+        case ZRE_MSG_MULTICAST_OK:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_MULTICAST_OK");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            zconfig_putf (config, "endpoint", "%s", self->endpoint);
+            zconfig_putf (config, "start", "%ld", (long) self->start);
             break;
-        case ZRE_MSG_ELECT:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->group);
-            frame_size += 1 + strlen (self->challenger_id);
+            }
+        case ZRE_MSG_RELAY:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_RELAY");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            {
+            char *hex = NULL;
+            STR_FROM_BYTES (hex, self->origin, 16);
+            zconfig_putf (config, "origin", "%s", hex);
+            zstr_free (&hex);
+            }
+            zconfig_putf (config, "group", "%s", self->group);
+            zconfig_putf (config, "serial", "%ld", (long) self->serial);
+            zconfig_putf (config, "fanout", "%ld", (long) self->fanout);
+            {
+            char *hex = NULL;
+            STR_FROM_BYTES (hex, self->bound, 16);
+            zconfig_putf (config, "bound", "%s", hex);
+            zstr_free (&hex);
+            }
+            zconfig_putf (config, "span", "%ld", (long) self->span);
+            {
+            char *hex = NULL;
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zmsg_encode (self->content);
+            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            zframe_destroy (&frame);
+#else
+            byte *buffer;
+            size_t size = zmsg_encode (self->content, &buffer);
+            STR_FROM_BYTES (hex, buffer, size);
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            free (buffer); buffer= NULL;
+#endif
+            }
             break;
-        case ZRE_MSG_LEADER:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->group);
-            frame_size += 1 + strlen (self->leader_id);
+            }
+        case ZRE_MSG_REQUEST:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_REQUEST");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "correlation", "%ld", (long) self->correlation);
+            {
+            char *hex = NULL;
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zmsg_encode (self->content);
+            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            zframe_destroy (&frame);
+#else
+            byte *buffer;
+            size_t size = zmsg_encode (self->content, &buffer);
+            STR_FROM_BYTES (hex, buffer, size);
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            free (buffer); buffer= NULL;
+#endif
+            }
             break;
-        case ZRE_MSG_GOODBYE:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
+            }
+        case ZRE_MSG_REPLY:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_REPLY");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "correlation", "%ld", (long) self->correlation);
+            {
+            char *hex = NULL;
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zmsg_encode (self->content);
+            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            zframe_destroy (&frame);
+#else
+            byte *buffer;
+            size_t size = zmsg_encode (self->content, &buffer);
+            STR_FROM_BYTES (hex, buffer, size);
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            free (buffer); buffer= NULL;
+#endif
+            }
             break;
-    }
+            }
+        case ZRE_MSG_HELLO_WANTED:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_HELLO_WANTED");
 
-    zmq_msg_t frame;
-    zmq_msg_init_size (&frame, frame_size);
-    self->needle = (byte *) zmq_msg_data (&frame);
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
 
-    //  Now serialize message into the frame
-    PUT_NUMBER2 (0xAAA0 | 1);
-    PUT_NUMBER1 (self->id);
-    bool have_content = false;
-    size_t nbr_frames = 1;              //  Total number of frames to send
 
-    switch (self->id) {
-        case ZRE_MSG_HELLO:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->endpoint);
-            if (self->groups) {
-                PUT_NUMBER4 (zlist_size (self->groups));
-                char *groups = (char *) zlist_first (self->groups);
-                while (groups) {
-                    PUT_LONGSTR (groups);
-                    groups = (char *) zlist_next (self->groups);
-                }
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            break;
             }
-            else
-                PUT_NUMBER4 (0);    //  Empty string array
-            PUT_NUMBER1 (self->status);
-            PUT_STRING (self->name);
+        case ZRE_MSG_HEADERS:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_HEADERS");
+
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
+
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
             if (self->headers) {
-                PUT_NUMBER4 (zhash_size (self->headers));
+                zconfig_t *hash = zconfig_new ("headers", config);
                 char *item = (char *) zhash_first (self->headers);
                 while (item) {
-                    PUT_STRING (zhash_cursor (self->headers));
-                    PUT_LONGSTR (item);
+                    zconfig_putf (hash, zhash_cursor (self->headers), "%s", item);
                     item = (char *) zhash_next (self->headers);
                 }
             }
-            else
-                PUT_NUMBER4 (0);    //  Empty hash
-            break;
-
-        case ZRE_MSG_WHISPER:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            nbr_frames += self->content? zmsg_size (self->content): 1;
-            have_content = true;
             break;
+            }
+        case ZRE_MSG_STORE_SET:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_STORE_SET");
 
-        case ZRE_MSG_SHOUT:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->group);
-            nbr_frames += self->content? zmsg_size (self->content): 1;
-            have_content = true;
-            break;
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
 
-        case ZRE_MSG_JOIN:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->group);
-            PUT_NUMBER1 (self->status);
-            break;
 
-        case ZRE_MSG_LEAVE:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->group);
-            PUT_NUMBER1 (self->status);
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            zconfig_putf (config, "key", "%s", self->key);
+            {
+            char *hex = NULL;
+            STR_FROM_BYTES (hex, self->origin, 16);
+            zconfig_putf (config, "origin", "%s", hex);
+            zstr_free (&hex);
+            }
+            zconfig_putf (config, "stamp", "%ld", (long) self->stamp);
+            {
+            char *hex = NULL;
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zmsg_encode (self->content);
+            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            zframe_destroy (&frame);
+#else
+            byte *buffer;
+            size_t size = zmsg_encode (self->content, &buffer);
+            STR_FROM_BYTES (hex, buffer, size);
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            free (buffer); buffer= NULL;
+#endif
+            }
             break;
+            }
+        case ZRE_MSG_STORE_SYNC:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_STORE_SYNC");
 
-        case ZRE_MSG_PING:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            break;
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
 
-        case ZRE_MSG_PING_OK:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            break;
 
-        case ZRE_MSG_ELECT:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->group);
-            PUT_STRING (self->challenger_id);
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            if (self->clock) {
+                zconfig_t *hash = zconfig_new ("clock", config);
+                char *item = (char *) zhash_first (self->clock);
+                while (item) {
+                    zconfig_putf (hash, zhash_cursor (self->clock), "%s", item);
+                    item = (char *) zhash_next (self->clock);
+                }
+            }
             break;
+            }
+        case ZRE_MSG_CATCHUP:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_CATCHUP");
 
-        case ZRE_MSG_LEADER:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->group);
-            PUT_STRING (self->leader_id);
-            break;
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
 
-        case ZRE_MSG_GOODBYE:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
+
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
             break;
+            }
+        case ZRE_MSG_HISTORY:
+        {
+            zconfig_put (root, "message", "ZRE_MSG_HISTORY");
 
-    }
+            if (self->routing_id) {
+                char *hex = NULL;
+                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
+                zconfig_putf (root, "routing_id", "%s", hex);
+                zstr_free (&hex);
+            }
 
-    //  Now send the data frame
-    zmq_msg_send (&frame, zsock_resolve (output), --nbr_frames? ZMQ_SNDMORE: 0);
 
-    //  Now send the content if necessary
-    if (have_content) {
-        if (self->content) {
-            zframe_t *frame = zmsg_first (self->content);
-            while (frame) {
-                zframe_send (&frame, output, ZFRAME_REUSE + (--nbr_frames? ZFRAME_MORE: 0));
-                frame = zmsg_next (self->content);
+            zconfig_t *config = zconfig_new ("content", root);
+            zconfig_putf (config, "version", "%s", "2");
+            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
+            zconfig_putf (config, "group", "%s", self->group);
+            zconfig_putf (config, "serial", "%ld", (long) self->serial);
+            {
+            char *hex = NULL;
+#if CZMQ_VERSION_MAJOR == 4
+            zframe_t *frame = zmsg_encode (self->content);
+            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            zframe_destroy (&frame);
+#else
+            byte *buffer;
+            size_t size = zmsg_encode (self->content, &buffer);
+            STR_FROM_BYTES (hex, buffer, size);
+            zconfig_putf (config, "content", "%s", hex);
+            zstr_free (&hex);
+            free (buffer); buffer= NULL;
+#endif
+            }
+            break;
             }
-        }
-        else
-            zmq_send (zsock_resolve (output), NULL, 0, 0);
     }
-    return 0;
+    return root;
 }
 
 //  --------------------------------------------------------------------------
-//  Encode the first frame of zre_msg. Does not destroy it. Returns the frame if
-//  OK, else NULL.
+//  Get/set the message routing_id
 
 zframe_t *
-zre_msg_encode (zre_msg_t *self)
+zre_msg_routing_id (zre_msg_t *self)
 {
     assert (self);
+    return self->routing_id;
+}
 
-    size_t frame_size = 2 + 1;          //  Signature and message ID
+void
+zre_msg_set_routing_id (zre_msg_t *self, zframe_t *routing_id)
+{
+    if (self->routing_id)
+        zframe_destroy (&self->routing_id);
+    self->routing_id = zframe_dup (routing_id);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get/set the zre_msg id
+
+int
+zre_msg_id (zre_msg_t *self)
+{
+    assert (self);
+    return self->id;
+}
+
+void
+zre_msg_set_id (zre_msg_t *self, int id)
+{
+    self->id = id;
+}
+
+//  --------------------------------------------------------------------------
+//  Return a printable command string
 
+const char *
+zre_msg_command (zre_msg_t *self)
+{
+    assert (self);
     switch (self->id) {
         case ZRE_MSG_HELLO:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->endpoint);
-            frame_size += 4;            //  Size is 4 octets
-            if (self->groups) {
-                char *groups = (char *) zlist_first (self->groups);
-                while (groups) {
-                    frame_size += 4 + strlen (groups);
-                    groups = (char *) zlist_next (self->groups);
-                }
-            }
-            frame_size += 1;            //  status
-            frame_size += 1 + strlen (self->name);
-            frame_size += 4;            //  Size is 4 octets
-            if (self->headers) {
-                self->headers_bytes = 0;
-                char *item = (char *) zhash_first (self->headers);
-                while (item) {
-                    self->headers_bytes += 1 + strlen (zhash_cursor (self->headers));
-                    self->headers_bytes += 4 + strlen (item);
-                    item = (char *) zhash_next (self->headers);
-                }
-            }
-            frame_size += self->headers_bytes;
+            return ("HELLO");
             break;
         case ZRE_MSG_WHISPER:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
+            return ("WHISPER");
             break;
         case ZRE_MSG_SHOUT:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->group);
+            return ("SHOUT");
             break;
         case ZRE_MSG_JOIN:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->group);
-            frame_size += 1;            //  status
+            return ("JOIN");
             break;
         case ZRE_MSG_LEAVE:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->group);
-            frame_size += 1;            //  status
+            return ("LEAVE");
             break;
         case ZRE_MSG_PING:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
+            return ("PING");
             break;
         case ZRE_MSG_PING_OK:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
+            return ("PING_OK");
             break;
         case ZRE_MSG_ELECT:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->group);
-            frame_size += 1 + strlen (self->challenger_id);
+            return ("ELECT");
             break;
         case ZRE_MSG_LEADER:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
-            frame_size += 1 + strlen (self->group);
-            frame_size += 1 + strlen (self->leader_id);
+            return ("LEADER");
             break;
         case ZRE_MSG_GOODBYE:
-            frame_size += 1;            //  version
-            frame_size += 2;            //  sequence
+            return ("GOODBYE");
+            break;
+        case ZRE_MSG_ELECT_UUID:
+            return ("ELECT_UUID");
+            break;
+        case ZRE_MSG_LEADER_UUID:
+            return ("LEADER_UUID");
+            break;
+        case ZRE_MSG_STREAM:
+            return ("STREAM");
+            break;
+        case ZRE_MSG_STREAM_ACK:
+            return ("STREAM_ACK");
+            break;
+        case ZRE_MSG_WHISPER_ZSTD:
+            return ("WHISPER_ZSTD");
+            break;
+        case ZRE_MSG_SHOUT_ZSTD:
+            return ("SHOUT_ZSTD");
+            break;
+        case ZRE_MSG_MULTICAST:
+            return ("MULTICAST");
+            break;
+        case ZRE_MSG_MULTICAST_OK:
+            return ("MULTICAST_OK");
+            break;
+        case ZRE_MSG_RELAY:
+            return ("RELAY");
+            break;
+        case ZRE_MSG_REQUEST:
+            return ("REQUEST");
+            break;
+        case ZRE_MSG_REPLY:
+            return ("REPLY");
+            break;
+        case ZRE_MSG_HELLO_WANTED:
+            return ("HELLO_WANTED");
+            break;
+        case ZRE_MSG_HEADERS:
+            return ("HEADERS");
+            break;
+        case ZRE_MSG_STORE_SET:
+            return ("STORE_SET");
+            break;
+        case ZRE_MSG_STORE_SYNC:
+            return ("STORE_SYNC");
+            break;
+        case ZRE_MSG_CATCHUP:
+            return ("CATCHUP");
+            break;
+        case ZRE_MSG_HISTORY:
+            return ("HISTORY");
             break;
     }
+    return "?";
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get/set the sequence field
+
+uint16_t
+zre_msg_sequence (zre_msg_t *self)
+{
+    assert (self);
+    return self->sequence;
+}
+
+void
+zre_msg_set_sequence (zre_msg_t *self, uint16_t sequence)
+{
+    assert (self);
+    self->sequence = sequence;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get/set the endpoint field
+
+const char *
+zre_msg_endpoint (zre_msg_t *self)
+{
+    assert (self);
+    return self->endpoint;
+}
+
+void
+zre_msg_set_endpoint (zre_msg_t *self, const char *value)
+{
+    assert (self);
+    assert (value);
+    if (value == self->endpoint)
+        return;
+    strncpy (self->endpoint, value, 255);
+    self->endpoint [255] = 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get the groups field, without transferring ownership
+
+zlist_t *
+zre_msg_groups (zre_msg_t *self)
+{
+    assert (self);
+    return self->groups;
+}
+
+//  Get the groups field and transfer ownership to caller
+
+zlist_t *
+zre_msg_get_groups (zre_msg_t *self)
+{
+    assert (self);
+    zlist_t *groups = self->groups;
+    self->groups = NULL;
+    return groups;
+}
 
-    zframe_t *frame = zframe_new (NULL, frame_size);
-    self->needle = (byte *) zframe_data (frame);
+//  Set the groups field, transferring ownership from caller
 
-    //  Now serialize message into the frame
-    PUT_NUMBER2 (0xAAA0 | 1);
-    PUT_NUMBER1 (self->id);
-    size_t nbr_frames = 1;              //  Total number of frames to send
+void
+zre_msg_set_groups (zre_msg_t *self, zlist_t **groups_p)
+{
+    assert (self);
+    assert (groups_p);
+    zlist_destroy (&self->groups);
+    self->groups = *groups_p;
+    *groups_p = NULL;
+}
 
-    switch (self->id) {
-        case ZRE_MSG_HELLO:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->endpoint);
-            if (self->groups) {
-                PUT_NUMBER4 (zlist_size (self->groups));
-                char *groups = (char *) zlist_first (self->groups);
-                while (groups) {
-                    PUT_LONGSTR (groups);
-                    groups = (char *) zlist_next (self->groups);
-                }
-            }
-            else
-                PUT_NUMBER4 (0);    //  Empty string array
-            PUT_NUMBER1 (self->status);
-            PUT_STRING (self->name);
-            if (self->headers) {
-                PUT_NUMBER4 (zhash_size (self->headers));
-                char *item = (char *) zhash_first (self->headers);
-                while (item) {
-                    PUT_STRING (zhash_cursor (self->headers));
-                    PUT_LONGSTR (item);
-                    item = (char *) zhash_next (self->headers);
-                }
-            }
-            else
-                PUT_NUMBER4 (0);    //  Empty hash
-            break;
 
-        case ZRE_MSG_WHISPER:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            nbr_frames += self->content? zmsg_size (self->content): 1;
-            break;
 
-        case ZRE_MSG_SHOUT:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->group);
-            nbr_frames += self->content? zmsg_size (self->content): 1;
-            break;
+//  --------------------------------------------------------------------------
+//  Get/set the status field
 
-        case ZRE_MSG_JOIN:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->group);
-            PUT_NUMBER1 (self->status);
-            break;
+byte
+zre_msg_status (zre_msg_t *self)
+{
+    assert (self);
+    return self->status;
+}
 
-        case ZRE_MSG_LEAVE:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->group);
-            PUT_NUMBER1 (self->status);
-            break;
+void
+zre_msg_set_status (zre_msg_t *self, byte status)
+{
+    assert (self);
+    self->status = status;
+}
 
-        case ZRE_MSG_PING:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            break;
 
-        case ZRE_MSG_PING_OK:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            break;
+//  --------------------------------------------------------------------------
+//  Get/set the name field
 
-        case ZRE_MSG_ELECT:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->group);
-            PUT_STRING (self->challenger_id);
-            break;
+const char *
+zre_msg_name (zre_msg_t *self)
+{
+    assert (self);
+    return self->name;
+}
 
-        case ZRE_MSG_LEADER:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            PUT_STRING (self->group);
-            PUT_STRING (self->leader_id);
-            break;
+void
+zre_msg_set_name (zre_msg_t *self, const char *value)
+{
+    assert (self);
+    assert (value);
+    if (value == self->name)
+        return;
+    strncpy (self->name, value, 255);
+    self->name [255] = 0;
+}
 
-        case ZRE_MSG_GOODBYE:
-            PUT_NUMBER1 (2);
-            PUT_NUMBER2 (self->sequence);
-            break;
 
-    }
+//  --------------------------------------------------------------------------
+//  Get the headers field without transferring ownership
 
-    return frame;
+zhash_t *
+zre_msg_headers (zre_msg_t *self)
+{
+    assert (self);
+    return self->headers;
+}
+
+//  Get the headers field and transfer ownership to caller
+
+zhash_t *
+zre_msg_get_headers (zre_msg_t *self)
+{
+    zhash_t *headers = self->headers;
+    self->headers = NULL;
+    return headers;
+}
+
+//  Set the headers field, transferring ownership from caller
+
+void
+zre_msg_set_headers (zre_msg_t *self, zhash_t **headers_p)
+{
+    assert (self);
+    assert (headers_p);
+    zhash_destroy (&self->headers);
+    self->headers = *headers_p;
+    *headers_p = NULL;
 }
 
 
 //  --------------------------------------------------------------------------
-//  Print contents of message to stdout
+//  Get the content field without transferring ownership
+
+zmsg_t *
+zre_msg_content (zre_msg_t *self)
+{
+    assert (self);
+    return self->content;
+}
+
+//  Get the content field and transfer ownership to caller
+
+zmsg_t *
+zre_msg_get_content (zre_msg_t *self)
+{
+    zmsg_t *content = self->content;
+    self->content = NULL;
+    return content;
+}
+
+//  Set the content field, transferring ownership from caller
 
 void
-zre_msg_print (zre_msg_t *self)
+zre_msg_set_content (zre_msg_t *self, zmsg_t **msg_p)
 {
     assert (self);
-    switch (self->id) {
-        case ZRE_MSG_HELLO:
-            zsys_debug ("ZRE_MSG_HELLO:");
-            zsys_debug ("    version=2");
-            zsys_debug ("    sequence=%ld", (long) self->sequence);
-            zsys_debug ("    endpoint='%s'", self->endpoint);
-            zsys_debug ("    groups=");
-            if (self->groups) {
-                char *groups = (char *) zlist_first (self->groups);
-                while (groups) {
-                    zsys_debug ("        '%s'", groups);
-                    groups = (char *) zlist_next (self->groups);
-                }
-            }
-            zsys_debug ("    status=%ld", (long) self->status);
-            zsys_debug ("    name='%s'", self->name);
-            zsys_debug ("    headers=");
-            if (self->headers) {
-                char *item = (char *) zhash_first (self->headers);
-                while (item) {
-                    zsys_debug ("        %s=%s", zhash_cursor (self->headers), item);
-                    item = (char *) zhash_next (self->headers);
-                }
-            }
-            else
-                zsys_debug ("(NULL)");
-            break;
+    assert (msg_p);
+    zmsg_destroy (&self->content);
+    self->content = *msg_p;
+    *msg_p = NULL;
+}
 
-        case ZRE_MSG_WHISPER:
-            zsys_debug ("ZRE_MSG_WHISPER:");
-            zsys_debug ("    version=2");
-            zsys_debug ("    sequence=%ld", (long) self->sequence);
-            zsys_debug ("    content=");
-            if (self->content)
-                zmsg_print (self->content);
-            else
-                zsys_debug ("(NULL)");
-            break;
 
-        case ZRE_MSG_SHOUT:
-            zsys_debug ("ZRE_MSG_SHOUT:");
-            zsys_debug ("    version=2");
-            zsys_debug ("    sequence=%ld", (long) self->sequence);
-            zsys_debug ("    group='%s'", self->group);
-            zsys_debug ("    content=");
-            if (self->content)
-                zmsg_print (self->content);
-            else
-                zsys_debug ("(NULL)");
-            break;
+//  --------------------------------------------------------------------------
+//  Get/set the group field
+
+const char *
+zre_msg_group (zre_msg_t *self)
+{
+    assert (self);
+    return self->group;
+}
+
+void
+zre_msg_set_group (zre_msg_t *self, const char *value)
+{
+    assert (self);
+    assert (value);
+    if (value == self->group)
+        return;
+    strncpy (self->group, value, 255);
+    self->group [255] = 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get/set the challenger_id field
+
+const char *
+zre_msg_challenger_id (zre_msg_t *self)
+{
+    assert (self);
+    return self->challenger_id;
+}
+
+void
+zre_msg_set_challenger_id (zre_msg_t *self, const char *value)
+{
+    assert (self);
+    assert (value);
+    if (value == self->challenger_id)
+        return;
+    strncpy (self->challenger_id, value, 255);
+    self->challenger_id [255] = 0;
+}
 
-        case ZRE_MSG_JOIN:
-            zsys_debug ("ZRE_MSG_JOIN:");
-            zsys_debug ("    version=2");
-            zsys_debug ("    sequence=%ld", (long) self->sequence);
-            zsys_debug ("    group='%s'", self->group);
-            zsys_debug ("    status=%ld", (long) self->status);
-            break;
 
-        case ZRE_MSG_LEAVE:
-            zsys_debug ("ZRE_MSG_LEAVE:");
-            zsys_debug ("    version=2");
-            zsys_debug ("    sequence=%ld", (long) self->sequence);
-            zsys_debug ("    group='%s'", self->group);
-            zsys_debug ("    status=%ld", (long) self->status);
-            break;
+//  --------------------------------------------------------------------------
+//  Get/set the leader_id field
 
-        case ZRE_MSG_PING:
-            zsys_debug ("ZRE_MSG_PING:");
-            zsys_debug ("    version=2");
-            zsys_debug ("    sequence=%ld", (long) self->sequence);
-            break;
+const char *
+zre_msg_leader_id (zre_msg_t *self)
+{
+    assert (self);
+    return self->leader_id;
+}
 
-        case ZRE_MSG_PING_OK:
-            zsys_debug ("ZRE_MSG_PING_OK:");
-            zsys_debug ("    version=2");
-            zsys_debug ("    sequence=%ld", (long) self->sequence);
-            break;
+void
+zre_msg_set_leader_id (zre_msg_t *self, const char *value)
+{
+    assert (self);
+    assert (value);
+    if (value == self->leader_id)
+        return;
+    strncpy (self->leader_id, value, 255);
+    self->leader_id [255] = 0;
+}
 
-        case ZRE_MSG_ELECT:
-            zsys_debug ("ZRE_MSG_ELECT:");
-            zsys_debug ("    version=2");
-            zsys_debug ("    sequence=%ld", (long) self->sequence);
-            zsys_debug ("    group='%s'", self->group);
-            zsys_debug ("    challenger_id='%s'", self->challenger_id);
-            break;
 
-        case ZRE_MSG_LEADER:
-            zsys_debug ("ZRE_MSG_LEADER:");
-            zsys_debug ("    version=2");
-            zsys_debug ("    sequence=%ld", (long) self->sequence);
-            zsys_debug ("    group='%s'", self->group);
-            zsys_debug ("    leader_id='%s'", self->leader_id);
-            break;
+//  --------------------------------------------------------------------------
+//  Get/set the challenger field
 
-        case ZRE_MSG_GOODBYE:
-            zsys_debug ("ZRE_MSG_GOODBYE:");
-            zsys_debug ("    version=2");
-            zsys_debug ("    sequence=%ld", (long) self->sequence);
-            break;
+byte *
+zre_msg_challenger (zre_msg_t *self)
+{
+    assert (self);
+    return self->challenger;
+}
 
-    }
+void
+zre_msg_set_challenger (zre_msg_t *self, byte *challenger)
+{
+    assert (self);
+    memcpy (self->challenger, challenger, 16);
 }
 
+
 //  --------------------------------------------------------------------------
-//  Export class as zconfig_t*. Caller is responsibe for destroying the instance
+//  Get/set the lapsed field
 
-zconfig_t *
-zre_msg_zpl (zre_msg_t *self, zconfig_t *parent)
+const char *
+zre_msg_lapsed (zre_msg_t *self)
 {
     assert (self);
+    return self->lapsed;
+}
 
-    zconfig_t *root = zconfig_new ("zre_msg", parent);
+void
+zre_msg_set_lapsed (zre_msg_t *self, const char *value)
+{
+    assert (self);
+    assert (value);
+    if (value == self->lapsed)
+        return;
+    strncpy (self->lapsed, value, 255);
+    self->lapsed [255] = 0;
+}
 
-    switch (self->id) {
-        case ZRE_MSG_HELLO:
-        {
-            zconfig_put (root, "message", "ZRE_MSG_HELLO");
 
-            if (self->routing_id) {
-                char *hex = NULL;
-                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
-                zconfig_putf (root, "routing_id", "%s", hex);
-                zstr_free (&hex);
-            }
+//  --------------------------------------------------------------------------
+//  Get/set the leader field
 
+byte *
+zre_msg_leader (zre_msg_t *self)
+{
+    assert (self);
+    return self->leader;
+}
 
-            zconfig_t *config = zconfig_new ("content", root);
-            zconfig_putf (config, "version", "%s", "2");
-            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
-            zconfig_putf (config, "endpoint", "%s", self->endpoint);
-            if (self->groups) {
-                zconfig_t *strings = zconfig_new ("groups", config);
-                size_t i = 0;
-                char *groups = (char *) zlist_first (self->groups);
-                while (groups) {
-                    char *key = zsys_sprintf ("%zu", i);
-                    zconfig_putf (strings, key, "%s", groups);
-                    zstr_free (&key);
-                    i++;
-                    groups = (char *) zlist_next (self->groups);
-                }
-            }
-            zconfig_putf (config, "status", "%ld", (long) self->status);
-            zconfig_putf (config, "name", "%s", self->name);
-            if (self->headers) {
-                zconfig_t *hash = zconfig_new ("headers", config);
-                char *item = (char *) zhash_first (self->headers);
-                while (item) {
-                    zconfig_putf (hash, zhash_cursor (self->headers), "%s", item);
-                    item = (char *) zhash_next (self->headers);
-                }
-            }
-            break;
-            }
-        case ZRE_MSG_WHISPER:
-        {
-            zconfig_put (root, "message", "ZRE_MSG_WHISPER");
+void
+zre_msg_set_leader (zre_msg_t *self, byte *leader)
+{
+    assert (self);
+    memcpy (self->leader, leader, 16);
+}
 
-            if (self->routing_id) {
-                char *hex = NULL;
-                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
-                zconfig_putf (root, "routing_id", "%s", hex);
-                zstr_free (&hex);
-            }
 
+//  --------------------------------------------------------------------------
+//  Get/set the stream field
 
-            zconfig_t *config = zconfig_new ("content", root);
-            zconfig_putf (config, "version", "%s", "2");
-            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
-            {
-            char *hex = NULL;
-#if CZMQ_VERSION_MAJOR == 4
-            zframe_t *frame = zmsg_encode (self->content);
-            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
-            zconfig_putf (config, "content", "%s", hex);
-            zstr_free (&hex);
-            zframe_destroy (&frame);
-#else
-            byte *buffer;
-            size_t size = zmsg_encode (self->content, &buffer);
-            STR_FROM_BYTES (hex, buffer, size);
-            zconfig_putf (config, "content", "%s", hex);
-            zstr_free (&hex);
-            free (buffer); buffer= NULL;
-#endif
-            }
-            break;
-            }
-        case ZRE_MSG_SHOUT:
-        {
-            zconfig_put (root, "message", "ZRE_MSG_SHOUT");
+uint32_t
+zre_msg_stream (zre_msg_t *self)
+{
+    assert (self);
+    return self->stream;
+}
 
-            if (self->routing_id) {
-                char *hex = NULL;
-                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
-                zconfig_putf (root, "routing_id", "%s", hex);
-                zstr_free (&hex);
-            }
+void
+zre_msg_set_stream (zre_msg_t *self, uint32_t stream)
+{
+    assert (self);
+    self->stream = stream;
+}
 
 
-            zconfig_t *config = zconfig_new ("content", root);
-            zconfig_putf (config, "version", "%s", "2");
-            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
-            zconfig_putf (config, "group", "%s", self->group);
-            {
-            char *hex = NULL;
-#if CZMQ_VERSION_MAJOR == 4
-            zframe_t *frame = zmsg_encode (self->content);
-            STR_FROM_BYTES (hex, zframe_data (frame), zframe_size (frame));
-            zconfig_putf (config, "content", "%s", hex);
-            zstr_free (&hex);
-            zframe_destroy (&frame);
-#else
-            byte *buffer;
-            size_t size = zmsg_encode (self->content, &buffer);
-            STR_FROM_BYTES (hex, buffer, size);
-            zconfig_putf (config, "content", "%s", hex);
-            zstr_free (&hex);
-            free (buffer); buffer= NULL;
-#endif
-            }
-            break;
-            }
-        case ZRE_MSG_JOIN:
-        {
-            zconfig_put (root, "message", "ZRE_MSG_JOIN");
+//  --------------------------------------------------------------------------
+//  Get/set the offset field
 
-            if (self->routing_id) {
-                char *hex = NULL;
-                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
-                zconfig_putf (root, "routing_id", "%s", hex);
-                zstr_free (&hex);
-            }
+uint64_t
+zre_msg_offset (zre_msg_t *self)
+{
+    assert (self);
+    return self->offset;
+}
 
+void
+zre_msg_set_offset (zre_msg_t *self, uint64_t offset)
+{
+    assert (self);
+    self->offset = offset;
+}
 
-            zconfig_t *config = zconfig_new ("content", root);
-            zconfig_putf (config, "version", "%s", "2");
-            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
-            zconfig_putf (config, "group", "%s", self->group);
-            zconfig_putf (config, "status", "%ld", (long) self->status);
-            break;
-            }
-        case ZRE_MSG_LEAVE:
-        {
-            zconfig_put (root, "message", "ZRE_MSG_LEAVE");
 
-            if (self->routing_id) {
-                char *hex = NULL;
-                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
-                zconfig_putf (root, "routing_id", "%s", hex);
-                zstr_free (&hex);
-            }
+//  --------------------------------------------------------------------------
+//  Get/set the total field
+
+uint64_t
+zre_msg_total (zre_msg_t *self)
+{
+    assert (self);
+    return self->total;
+}
 
+void
+zre_msg_set_total (zre_msg_t *self, uint64_t total)
+{
+    assert (self);
+    self->total = total;
+}
 
-            zconfig_t *config = zconfig_new ("content", root);
-            zconfig_putf (config, "version", "%s", "2");
-            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
-            zconfig_putf (config, "group", "%s", self->group);
-            zconfig_putf (config, "status", "%ld", (long) self->status);
-            break;
-            }
-        case ZRE_MSG_PING:
-        {
-            zconfig_put (root, "message", "ZRE_MSG_PING");
 
-            if (self->routing_id) {
-                char *hex = NULL;
-                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
-                zconfig_putf (root, "routing_id", "%s", hex);
-                zstr_free (&hex);
-            }
+//  --------------------------------------------------------------------------
+//  Get/set the compressed field
 
+uint64_t
+zre_msg_compressed (zre_msg_t *self)
+{
+    assert (self);
+    return self->compressed;
+}
 
-            zconfig_t *config = zconfig_new ("content", root);
-            zconfig_putf (config, "version", "%s", "2");
-            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
-            break;
-            }
-        case ZRE_MSG_PING_OK:
-        {
-            zconfig_put (root, "message", "ZRE_MSG_PING_OK");
+void
+zre_msg_set_compressed (zre_msg_t *self, uint64_t compressed)
+{
+    assert (self);
+    self->compressed = compressed;
+}
 
-            if (self->routing_id) {
-                char *hex = NULL;
-                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
-                zconfig_putf (root, "routing_id", "%s", hex);
-                zstr_free (&hex);
-            }
 
+//  --------------------------------------------------------------------------
+//  Get/set the start field
 
-            zconfig_t *config = zconfig_new ("content", root);
-            zconfig_putf (config, "version", "%s", "2");
-            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
-            break;
-            }
-        case ZRE_MSG_ELECT:
-        {
-            zconfig_put (root, "message", "ZRE_MSG_ELECT");
+uint32_t
+zre_msg_start (zre_msg_t *self)
+{
+    assert (self);
+    return self->start;
+}
 
-            if (self->routing_id) {
-                char *hex = NULL;
-                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
-                zconfig_putf (root, "routing_id", "%s", hex);
-                zstr_free (&hex);
-            }
+void
+zre_msg_set_start (zre_msg_t *self, uint32_t start)
+{
+    assert (self);
+    self->start = start;
+}
 
 
-            zconfig_t *config = zconfig_new ("content", root);
-            zconfig_putf (config, "version", "%s", "2");
-            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
-            zconfig_putf (config, "group", "%s", self->group);
-            zconfig_putf (config, "challenger_id", "%s", self->challenger_id);
-            break;
-            }
-        case ZRE_MSG_LEADER:
-        {
-            zconfig_put (root, "message", "ZRE_MSG_LEADER");
+//  --------------------------------------------------------------------------
+//  Get/set the origin field
 
-            if (self->routing_id) {
-                char *hex = NULL;
-                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
-                zconfig_putf (root, "routing_id", "%s", hex);
-                zstr_free (&hex);
-            }
+byte *
+zre_msg_origin (zre_msg_t *self)
+{
+    assert (self);
+    return self->origin;
+}
 
+void
+zre_msg_set_origin (zre_msg_t *self, byte *origin)
+{
+    assert (self);
+    memcpy (self->origin, origin, 16);
+}
 
-            zconfig_t *config = zconfig_new ("content", root);
-            zconfig_putf (config, "version", "%s", "2");
-            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
-            zconfig_putf (config, "group", "%s", self->group);
-            zconfig_putf (config, "leader_id", "%s", self->leader_id);
-            break;
-            }
-        case ZRE_MSG_GOODBYE:
-        {
-            zconfig_put (root, "message", "ZRE_MSG_GOODBYE");
 
-            if (self->routing_id) {
-                char *hex = NULL;
-                STR_FROM_BYTES (hex, zframe_data (self->routing_id), zframe_size (self->routing_id));
-                zconfig_putf (root, "routing_id", "%s", hex);
-                zstr_free (&hex);
-            }
+//  --------------------------------------------------------------------------
+//  Get/set the serial field
 
+uint32_t
+zre_msg_serial (zre_msg_t *self)
+{
+    assert (self);
+    return self->serial;
+}
 
-            zconfig_t *config = zconfig_new ("content", root);
-            zconfig_putf (config, "version", "%s", "2");
-            zconfig_putf (config, "sequence", "%ld", (long) self->sequence);
-            break;
-            }
-    }
-    return root;
+void
+zre_msg_set_serial (zre_msg_t *self, uint32_t serial)
+{
+    assert (self);
+    self->serial = serial;
 }
 
+
 //  --------------------------------------------------------------------------
-//  Get/set the message routing_id
+//  Get/set the fanout field
 
-zframe_t *
-zre_msg_routing_id (zre_msg_t *self)
+byte
+zre_msg_fanout (zre_msg_t *self)
 {
     assert (self);
-    return self->routing_id;
+    return self->fanout;
 }
 
 void
-zre_msg_set_routing_id (zre_msg_t *self, zframe_t *routing_id)
+zre_msg_set_fanout (zre_msg_t *self, byte fanout)
 {
-    if (self->routing_id)
-        zframe_destroy (&self->routing_id);
-    self->routing_id = zframe_dup (routing_id);
+    assert (self);
+    self->fanout = fanout;
 }
 
 
 //  --------------------------------------------------------------------------
-//  Get/set the zre_msg id
+//  Get/set the bound field
 
-int
-zre_msg_id (zre_msg_t *self)
+byte *
+zre_msg_bound (zre_msg_t *self)
 {
     assert (self);
-    return self->id;
+    return self->bound;
 }
 
 void
-zre_msg_set_id (zre_msg_t *self, int id)
+zre_msg_set_bound (zre_msg_t *self, byte *bound)
 {
-    self->id = id;
+    assert (self);
+    memcpy (self->bound, bound, 16);
 }
 
+
 //  --------------------------------------------------------------------------
-//  Return a printable command string
+//  Get/set the span field
 
-const char *
-zre_msg_command (zre_msg_t *self)
+uint32_t
+zre_msg_span (zre_msg_t *self)
 {
     assert (self);
-    switch (self->id) {
-        case ZRE_MSG_HELLO:
-            return ("HELLO");
-            break;
-        case ZRE_MSG_WHISPER:
-            return ("WHISPER");
-            break;
-        case ZRE_MSG_SHOUT:
-            return ("SHOUT");
-            break;
-        case ZRE_MSG_JOIN:
-            return ("JOIN");
-            break;
-        case ZRE_MSG_LEAVE:
-            return ("LEAVE");
-            break;
-        case ZRE_MSG_PING:
-            return ("PING");
-            break;
-        case ZRE_MSG_PING_OK:
-            return ("PING_OK");
-            break;
-        case ZRE_MSG_ELECT:
-            return ("ELECT");
-            break;
-        case ZRE_MSG_LEADER:
-            return ("LEADER");
-            break;
-        case ZRE_MSG_GOODBYE:
-            return ("GOODBYE");
-            break;
-    }
-    return "?";
+    return self->span;
+}
+
+void
+zre_msg_set_span (zre_msg_t *self, uint32_t span)
+{
+    assert (self);
+    self->span = span;
 }
 
 
 //  --------------------------------------------------------------------------
-//  Get/set the sequence field
+//  Get/set the correlation field
 
-uint16_t
-zre_msg_sequence (zre_msg_t *self)
+uint64_t
+zre_msg_correlation (zre_msg_t *self)
 {
     assert (self);
-    return self->sequence;
+    return self->correlation;
 }
 
 void
-zre_msg_set_sequence (zre_msg_t *self, uint16_t sequence)
+zre_msg_set_correlation (zre_msg_t *self, uint64_t correlation)
 {
     assert (self);
-    self->sequence = sequence;
+    self->correlation = correlation;
 }
 
 
 //  --------------------------------------------------------------------------
-//  Get/set the endpoint field
+//  Get/set the key field
 
 const char *
-zre_msg_endpoint (zre_msg_t *self)
+zre_msg_key (zre_msg_t *self)
 {
     assert (self);
-    return self->endpoint;
+    return self->key;
 }
 
 void
-zre_msg_set_endpoint (zre_msg_t *self, const char *value)
+zre_msg_set_key (zre_msg_t *self, const char *value)
 {
     assert (self);
     assert (value);
-    if (value == self->endpoint)
+    if (value == self->key)
         return;
-    strncpy (self->endpoint, value, 255);
-    self->endpoint [255] = 0;
+    strncpy (self->key, value, 255);
+    self->key [255] = 0;
 }
 
 
 //  --------------------------------------------------------------------------
-//  Get the groups field, without transferring ownership
+//  Get/set the stamp field
 
-zlist_t *
-zre_msg_groups (zre_msg_t *self)
+uint64_t
+zre_msg_stamp (zre_msg_t *self)
 {
     assert (self);
-    return self->groups;
+    return self->stamp;
 }
 
-//  Get the groups field and transfer ownership to caller
-
-zlist_t *
-zre_msg_get_groups (zre_msg_t *self)
+void
+zre_msg_set_stamp (zre_msg_t *self, uint64_t stamp)
 {
     assert (self);
-    zlist_t *groups = self->groups;
-    self->groups = NULL;
-    return groups;
+    self->stamp = stamp;
 }
 
-//  Set the groups field, transferring ownership from caller
 
-void
-zre_msg_set_groups (zre_msg_t *self, zlist_t **groups_p)
+//  --------------------------------------------------------------------------
+//  Get the clock field without transferring ownership
+
+zhash_t *
+zre_msg_clock (zre_msg_t *self)
 {
     assert (self);
-    assert (groups_p);
-    zlist_destroy (&self->groups);
-    self->groups = *groups_p;
-    *groups_p = NULL;
+    return self->clock;
 }
 
+//  Get the clock field and transfer ownership to caller
 
-
-//  --------------------------------------------------------------------------
-//  Get/set the status field
-
-byte
-zre_msg_status (zre_msg_t *self)
+zhash_t *
+zre_msg_get_clock (zre_msg_t *self)
 {
-    assert (self);
-    return self->status;
+    zhash_t *clock = self->clock;
+    self->clock = NULL;
+    return clock;
 }
 
+//  Set the clock field, transferring ownership from caller
+
 void
-zre_msg_set_status (zre_msg_t *self, byte status)
+zre_msg_set_clock (zre_msg_t *self, zhash_t **clock_p)
 {
     assert (self);
-    self->status = status;
+    assert (clock_p);
+    zhash_destroy (&self->clock);
+    self->clock = *clock_p;
+    *clock_p = NULL;
 }
 
 
 //  --------------------------------------------------------------------------
-//  Get/set the name field
+//  Selftest
 
-const char *
-zre_msg_name (zre_msg_t *self)
+void
+zre_msg_test (bool verbose)
 {
+    printf (" * zre_msg: ");
+
+    if (verbose)
+        printf ("\n");
+
+    //  @selftest
+    //  Simple create/destroy test
+    zconfig_t *config;
+    zre_msg_t *self = zre_msg_new ();
     assert (self);
-    return self->name;
-}
+    zre_msg_destroy (&self);
+	static const int MAX_INSTANCE = 3;
+    //  Create pair of sockets we can send through
+    //  We must bind before connect if we wish to remain compatible with ZeroMQ < v4
+    zsock_t *output = zsock_new (ZMQ_DEALER);
+    assert (output);
+    int rc = zsock_bind (output, "inproc://selftest-zre_msg");
+    assert (rc == 0);
+
+    zsock_t *input = zsock_new (ZMQ_ROUTER);
+    assert (input);
+    rc = zsock_connect (input, "inproc://selftest-zre_msg");
+    assert (rc == 0);
 
-void
-zre_msg_set_name (zre_msg_t *self, const char *value)
-{
-    assert (self);
-    assert (value);
-    if (value == self->name)
-        return;
-    strncpy (self->name, value, 255);
-    self->name [255] = 0;
-}
 
+    //  Encode/send/decode and verify each message type
+    int instance;
+    self = zre_msg_new ();
+    zre_msg_set_id (self, ZRE_MSG_HELLO);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_endpoint (self, "Life is short but Now lasts for ever");
+    zlist_t *hello_groups = zlist_new ();
+    zlist_append (hello_groups, "Name: Brutus");
+    zlist_append (hello_groups, "Age: 43");
+    zre_msg_set_groups (self, &hello_groups);
+    zre_msg_set_status (self, 123);
+    zre_msg_set_name (self, "Life is short but Now lasts for ever");
+    zhash_t *hello_headers = zhash_new ();
+    zhash_insert (hello_headers, "Name", (void*)"Brutus");
+    zre_msg_set_headers (self, &hello_headers);
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
-//  --------------------------------------------------------------------------
-//  Get the headers field without transferring ownership
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-zhash_t *
-zre_msg_headers (zre_msg_t *self)
-{
-    assert (self);
-    return self->headers;
-}
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_endpoint (self), "Life is short but Now lasts for ever"));
+        zlist_t *groups = zre_msg_get_groups (self);
+        assert (groups);
+        assert (zlist_size (groups) == 2);
+        assert (streq ((char *) zlist_first (groups), "Name: Brutus"));
+        assert (streq ((char *) zlist_next (groups), "Age: 43"));
+        zlist_destroy (&groups);
+        zlist_destroy (&hello_groups);
+        assert (zre_msg_status (self) == 123);
+        assert (streq (zre_msg_name (self), "Life is short but Now lasts for ever"));
+        zhash_t *headers = zre_msg_get_headers (self);
+        // Order of values is not guaranted
+        assert (zhash_size (headers) == 1);
+        assert (streq ((char *) zhash_first (headers), "Brutus"));
+        assert (streq ((char *) zhash_cursor (headers), "Name"));
+        zhash_destroy (&headers);
+        if (instance == MAX_INSTANCE - 1)
+            zhash_destroy (&hello_headers);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_WHISPER);
+    zre_msg_set_sequence (self, 123);
+    zmsg_t *whisper_content = zmsg_new ();
+    zre_msg_set_content (self, &whisper_content);
+    zmsg_addstr (zre_msg_content (self), "Captcha Diem");
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
-//  Get the headers field and transfer ownership to caller
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-zhash_t *
-zre_msg_get_headers (zre_msg_t *self)
-{
-    zhash_t *headers = self->headers;
-    self->headers = NULL;
-    return headers;
-}
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (zmsg_size (zre_msg_content (self)) == 1);
+        char *content = zmsg_popstr (zre_msg_content (self));
+        assert (streq (content, "Captcha Diem"));
+        zstr_free (&content);
+        if (instance == MAX_INSTANCE - 1)
+            zmsg_destroy (&whisper_content);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_SHOUT);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    zmsg_t *shout_content = zmsg_new ();
+    zre_msg_set_content (self, &shout_content);
+    zmsg_addstr (zre_msg_content (self), "Captcha Diem");
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
-//  Set the headers field, transferring ownership from caller
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-void
-zre_msg_set_headers (zre_msg_t *self, zhash_t **headers_p)
-{
-    assert (self);
-    assert (headers_p);
-    zhash_destroy (&self->headers);
-    self->headers = *headers_p;
-    *headers_p = NULL;
-}
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (zmsg_size (zre_msg_content (self)) == 1);
+        char *content = zmsg_popstr (zre_msg_content (self));
+        assert (streq (content, "Captcha Diem"));
+        zstr_free (&content);
+        if (instance == MAX_INSTANCE - 1)
+            zmsg_destroy (&shout_content);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_JOIN);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    zre_msg_set_status (self, 123);
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-//  --------------------------------------------------------------------------
-//  Get the content field without transferring ownership
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (zre_msg_status (self) == 123);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_LEAVE);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    zre_msg_set_status (self, 123);
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
-zmsg_t *
-zre_msg_content (zre_msg_t *self)
-{
-    assert (self);
-    return self->content;
-}
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-//  Get the content field and transfer ownership to caller
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (zre_msg_status (self) == 123);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_PING);
+    zre_msg_set_sequence (self, 123);
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
-zmsg_t *
-zre_msg_get_content (zre_msg_t *self)
-{
-    zmsg_t *content = self->content;
-    self->content = NULL;
-    return content;
-}
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
+
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_PING_OK);
+    zre_msg_set_sequence (self, 123);
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
-//  Set the content field, transferring ownership from caller
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-void
-zre_msg_set_content (zre_msg_t *self, zmsg_t **msg_p)
-{
-    assert (self);
-    assert (msg_p);
-    zmsg_destroy (&self->content);
-    self->content = *msg_p;
-    *msg_p = NULL;
-}
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_ELECT);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    zre_msg_set_challenger_id (self, "Life is short but Now lasts for ever");
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-//  --------------------------------------------------------------------------
-//  Get/set the group field
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (streq (zre_msg_challenger_id (self), "Life is short but Now lasts for ever"));
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_LEADER);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    zre_msg_set_leader_id (self, "Life is short but Now lasts for ever");
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
-const char *
-zre_msg_group (zre_msg_t *self)
-{
-    assert (self);
-    return self->group;
-}
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-void
-zre_msg_set_group (zre_msg_t *self, const char *value)
-{
-    assert (self);
-    assert (value);
-    if (value == self->group)
-        return;
-    strncpy (self->group, value, 255);
-    self->group [255] = 0;
-}
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (streq (zre_msg_leader_id (self), "Life is short but Now lasts for ever"));
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_GOODBYE);
+    zre_msg_set_sequence (self, 123);
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-//  --------------------------------------------------------------------------
-//  Get/set the challenger_id field
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
 
-const char *
-zre_msg_challenger_id (zre_msg_t *self)
-{
-    assert (self);
-    return self->challenger_id;
-}
+    zre_msg_set_id (self, ZRE_MSG_ELECT_UUID);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    byte elect_uuid_challenger [16];
+    memset (elect_uuid_challenger, 123, 16);
+    zre_msg_set_challenger (self, elect_uuid_challenger);
+    zre_msg_set_lapsed (self, "Life is short but Now lasts for ever");
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
-void
-zre_msg_set_challenger_id (zre_msg_t *self, const char *value)
-{
-    assert (self);
-    assert (value);
-    if (value == self->challenger_id)
-        return;
-    strncpy (self->challenger_id, value, 255);
-    self->challenger_id [255] = 0;
-}
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (zre_msg_challenger (self) [0] == 123);
+        assert (zre_msg_challenger (self) [16 - 1] == 123);
+        assert (streq (zre_msg_lapsed (self), "Life is short but Now lasts for ever"));
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_LEADER_UUID);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    byte leader_uuid_leader [16];
+    memset (leader_uuid_leader, 123, 16);
+    zre_msg_set_leader (self, leader_uuid_leader);
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
-//  --------------------------------------------------------------------------
-//  Get/set the leader_id field
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-const char *
-zre_msg_leader_id (zre_msg_t *self)
-{
-    assert (self);
-    return self->leader_id;
-}
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (zre_msg_leader (self) [0] == 123);
+        assert (zre_msg_leader (self) [16 - 1] == 123);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_STREAM);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_stream (self, 123);
+    zre_msg_set_name (self, "Life is short but Now lasts for ever");
+    zre_msg_set_offset (self, 123);
+    zre_msg_set_total (self, 123);
+    zmsg_t *stream_content = zmsg_new ();
+    zre_msg_set_content (self, &stream_content);
+    zmsg_addstr (zre_msg_content (self), "Captcha Diem");
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
-void
-zre_msg_set_leader_id (zre_msg_t *self, const char *value)
-{
-    assert (self);
-    assert (value);
-    if (value == self->leader_id)
-        return;
-    strncpy (self->leader_id, value, 255);
-    self->leader_id [255] = 0;
-}
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (zre_msg_stream (self) == 123);
+        assert (streq (zre_msg_name (self), "Life is short but Now lasts for ever"));
+        assert (zre_msg_offset (self) == 123);
+        assert (zre_msg_total (self) == 123);
+        assert (zmsg_size (zre_msg_content (self)) == 1);
+        char *content = zmsg_popstr (zre_msg_content (self));
+        assert (streq (content, "Captcha Diem"));
+        zstr_free (&content);
+        if (instance == MAX_INSTANCE - 1)
+            zmsg_destroy (&stream_content);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_STREAM_ACK);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_stream (self, 123);
+    zre_msg_set_offset (self, 123);
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-//  --------------------------------------------------------------------------
-//  Selftest
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (zre_msg_stream (self) == 123);
+        assert (zre_msg_offset (self) == 123);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_WHISPER_ZSTD);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_compressed (self, 123);
+    zmsg_t *whisper_zstd_content = zmsg_new ();
+    zre_msg_set_content (self, &whisper_zstd_content);
+    zmsg_addstr (zre_msg_content (self), "Captcha Diem");
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
-void
-zre_msg_test (bool verbose)
-{
-    printf (" * zre_msg: ");
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (zre_msg_compressed (self) == 123);
+        assert (zmsg_size (zre_msg_content (self)) == 1);
+        char *content = zmsg_popstr (zre_msg_content (self));
+        assert (streq (content, "Captcha Diem"));
+        zstr_free (&content);
+        if (instance == MAX_INSTANCE - 1)
+            zmsg_destroy (&whisper_zstd_content);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_SHOUT_ZSTD);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    zre_msg_set_compressed (self, 123);
+    zmsg_t *shout_zstd_content = zmsg_new ();
+    zre_msg_set_content (self, &shout_zstd_content);
+    zmsg_addstr (zre_msg_content (self), "Captcha Diem");
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
     if (verbose)
-        printf ("\n");
+        zconfig_print (config);
 
-    //  @selftest
-    //  Simple create/destroy test
-    zconfig_t *config;
-    zre_msg_t *self = zre_msg_new ();
-    assert (self);
-    zre_msg_destroy (&self);
-	static const int MAX_INSTANCE = 3;
-    //  Create pair of sockets we can send through
-    //  We must bind before connect if we wish to remain compatible with ZeroMQ < v4
-    zsock_t *output = zsock_new (ZMQ_DEALER);
-    assert (output);
-    int rc = zsock_bind (output, "inproc://selftest-zre_msg");
-    assert (rc == 0);
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-    zsock_t *input = zsock_new (ZMQ_ROUTER);
-    assert (input);
-    rc = zsock_connect (input, "inproc://selftest-zre_msg");
-    assert (rc == 0);
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (zre_msg_compressed (self) == 123);
+        assert (zmsg_size (zre_msg_content (self)) == 1);
+        char *content = zmsg_popstr (zre_msg_content (self));
+        assert (streq (content, "Captcha Diem"));
+        zstr_free (&content);
+        if (instance == MAX_INSTANCE - 1)
+            zmsg_destroy (&shout_zstd_content);
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_MULTICAST);
+    zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    zre_msg_set_endpoint (self, "Life is short but Now lasts for ever");
+    // convert to zpl
+    config = zre_msg_zpl (self, NULL);
+    if (verbose)
+        zconfig_print (config);
 
+    //  Send twice
+    zre_msg_send (self, output);
+    zre_msg_send (self, output);
 
-    //  Encode/send/decode and verify each message type
-    int instance;
-    self = zre_msg_new ();
-    zre_msg_set_id (self, ZRE_MSG_HELLO);
+    for (instance = 0; instance < MAX_INSTANCE; instance++) {
+        zre_msg_t *self_temp = self;
+        if (instance < MAX_INSTANCE - 1)
+            zre_msg_recv (self, input);
+        else {
+            self = zre_msg_new_zpl (config);
+            assert (self);
+            zconfig_destroy (&config);
+        }
+        if (instance < MAX_INSTANCE - 1)
+            assert (zre_msg_routing_id (self));
+        assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (streq (zre_msg_endpoint (self), "Life is short but Now lasts for ever"));
+        if (instance == MAX_INSTANCE - 1) {
+            zre_msg_destroy (&self);
+            self = self_temp;
+        }
+    }
+    zre_msg_set_id (self, ZRE_MSG_MULTICAST_OK);
     zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
     zre_msg_set_endpoint (self, "Life is short but Now lasts for ever");
-    zlist_t *hello_groups = zlist_new ();
-    zlist_append (hello_groups, "Name: Brutus");
-    zlist_append (hello_groups, "Age: 43");
-    zre_msg_set_groups (self, &hello_groups);
-    zre_msg_set_status (self, 123);
-    zre_msg_set_name (self, "Life is short but Now lasts for ever");
-    zhash_t *hello_headers = zhash_new ();
-    zhash_insert (hello_headers, "Name", (void*)"Brutus");
-    zre_msg_set_headers (self, &hello_headers);
+    zre_msg_set_start (self, 123);
     // convert to zpl
     config = zre_msg_zpl (self, NULL);
     if (verbose)
@@ -2238,33 +5984,28 @@ zre_msg_test (bool verbose)
         if (instance < MAX_INSTANCE - 1)
             assert (zre_msg_routing_id (self));
         assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
         assert (streq (zre_msg_endpoint (self), "Life is short but Now lasts for ever"));
-        zlist_t *groups = zre_msg_get_groups (self);
-        assert (groups);
-        assert (zlist_size (groups) == 2);
-        assert (streq ((char *) zlist_first (groups), "Name: Brutus"));
-        assert (streq ((char *) zlist_next (groups), "Age: 43"));
-        zlist_destroy (&groups);
-        zlist_destroy (&hello_groups);
-        assert (zre_msg_status (self) == 123);
-        assert (streq (zre_msg_name (self), "Life is short but Now lasts for ever"));
-        zhash_t *headers = zre_msg_get_headers (self);
-        // Order of values is not guaranted
-        assert (zhash_size (headers) == 1);
-        assert (streq ((char *) zhash_first (headers), "Brutus"));
-        assert (streq ((char *) zhash_cursor (headers), "Name"));
-        zhash_destroy (&headers);
-        if (instance == MAX_INSTANCE - 1)
-            zhash_destroy (&hello_headers);
+        assert (zre_msg_start (self) == 123);
         if (instance == MAX_INSTANCE - 1) {
             zre_msg_destroy (&self);
             self = self_temp;
         }
     }
-    zre_msg_set_id (self, ZRE_MSG_WHISPER);
+    zre_msg_set_id (self, ZRE_MSG_RELAY);
     zre_msg_set_sequence (self, 123);
-    zmsg_t *whisper_content = zmsg_new ();
-    zre_msg_set_content (self, &whisper_content);
+    byte relay_origin [16];
+    memset (relay_origin, 123, 16);
+    zre_msg_set_origin (self, relay_origin);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    zre_msg_set_serial (self, 123);
+    zre_msg_set_fanout (self, 123);
+    byte relay_bound [16];
+    memset (relay_bound, 123, 16);
+    zre_msg_set_bound (self, relay_bound);
+    zre_msg_set_span (self, 123);
+    zmsg_t *relay_content = zmsg_new ();
+    zre_msg_set_content (self, &relay_content);
     zmsg_addstr (zre_msg_content (self), "Captcha Diem");
     // convert to zpl
     config = zre_msg_zpl (self, NULL);
@@ -2287,22 +6028,30 @@ zre_msg_test (bool verbose)
         if (instance < MAX_INSTANCE - 1)
             assert (zre_msg_routing_id (self));
         assert (zre_msg_sequence (self) == 123);
+        assert (zre_msg_origin (self) [0] == 123);
+        assert (zre_msg_origin (self) [16 - 1] == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (zre_msg_serial (self) == 123);
+        assert (zre_msg_fanout (self) == 123);
+        assert (zre_msg_bound (self) [0] == 123);
+        assert (zre_msg_bound (self) [16 - 1] == 123);
+        assert (zre_msg_span (self) == 123);
         assert (zmsg_size (zre_msg_content (self)) == 1);
         char *content = zmsg_popstr (zre_msg_content (self));
         assert (streq (content, "Captcha Diem"));
         zstr_free (&content);
         if (instance == MAX_INSTANCE - 1)
-            zmsg_destroy (&whisper_content);
+            zmsg_destroy (&relay_content);
         if (instance == MAX_INSTANCE - 1) {
             zre_msg_destroy (&self);
             self = self_temp;
         }
     }
-    zre_msg_set_id (self, ZRE_MSG_SHOUT);
+    zre_msg_set_id (self, ZRE_MSG_REQUEST);
     zre_msg_set_sequence (self, 123);
-    zre_msg_set_group (self, "Life is short but Now lasts for ever");
-    zmsg_t *shout_content = zmsg_new ();
-    zre_msg_set_content (self, &shout_content);
+    zre_msg_set_correlation (self, 123);
+    zmsg_t *request_content = zmsg_new ();
+    zre_msg_set_content (self, &request_content);
     zmsg_addstr (zre_msg_content (self), "Captcha Diem");
     // convert to zpl
     config = zre_msg_zpl (self, NULL);
@@ -2325,22 +6074,24 @@ zre_msg_test (bool verbose)
         if (instance < MAX_INSTANCE - 1)
             assert (zre_msg_routing_id (self));
         assert (zre_msg_sequence (self) == 123);
-        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (zre_msg_correlation (self) == 123);
         assert (zmsg_size (zre_msg_content (self)) == 1);
         char *content = zmsg_popstr (zre_msg_content (self));
         assert (streq (content, "Captcha Diem"));
         zstr_free (&content);
         if (instance == MAX_INSTANCE - 1)
-            zmsg_destroy (&shout_content);
+            zmsg_destroy (&request_content);
         if (instance == MAX_INSTANCE - 1) {
             zre_msg_destroy (&self);
             self = self_temp;
         }
     }
-    zre_msg_set_id (self, ZRE_MSG_JOIN);
+    zre_msg_set_id (self, ZRE_MSG_REPLY);
     zre_msg_set_sequence (self, 123);
-    zre_msg_set_group (self, "Life is short but Now lasts for ever");
-    zre_msg_set_status (self, 123);
+    zre_msg_set_correlation (self, 123);
+    zmsg_t *reply_content = zmsg_new ();
+    zre_msg_set_content (self, &reply_content);
+    zmsg_addstr (zre_msg_content (self), "Captcha Diem");
     // convert to zpl
     config = zre_msg_zpl (self, NULL);
     if (verbose)
@@ -2362,17 +6113,20 @@ zre_msg_test (bool verbose)
         if (instance < MAX_INSTANCE - 1)
             assert (zre_msg_routing_id (self));
         assert (zre_msg_sequence (self) == 123);
-        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
-        assert (zre_msg_status (self) == 123);
+        assert (zre_msg_correlation (self) == 123);
+        assert (zmsg_size (zre_msg_content (self)) == 1);
+        char *content = zmsg_popstr (zre_msg_content (self));
+        assert (streq (content, "Captcha Diem"));
+        zstr_free (&content);
+        if (instance == MAX_INSTANCE - 1)
+            zmsg_destroy (&reply_content);
         if (instance == MAX_INSTANCE - 1) {
             zre_msg_destroy (&self);
             self = self_temp;
         }
     }
-    zre_msg_set_id (self, ZRE_MSG_LEAVE);
+    zre_msg_set_id (self, ZRE_MSG_HELLO_WANTED);
     zre_msg_set_sequence (self, 123);
-    zre_msg_set_group (self, "Life is short but Now lasts for ever");
-    zre_msg_set_status (self, 123);
     // convert to zpl
     config = zre_msg_zpl (self, NULL);
     if (verbose)
@@ -2394,15 +6148,16 @@ zre_msg_test (bool verbose)
         if (instance < MAX_INSTANCE - 1)
             assert (zre_msg_routing_id (self));
         assert (zre_msg_sequence (self) == 123);
-        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
-        assert (zre_msg_status (self) == 123);
         if (instance == MAX_INSTANCE - 1) {
             zre_msg_destroy (&self);
             self = self_temp;
         }
     }
-    zre_msg_set_id (self, ZRE_MSG_PING);
+    zre_msg_set_id (self, ZRE_MSG_HEADERS);
     zre_msg_set_sequence (self, 123);
+    zhash_t *headers_headers = zhash_new ();
+    zhash_insert (headers_headers, "Name", (void*)"Brutus");
+    zre_msg_set_headers (self, &headers_headers);
     // convert to zpl
     config = zre_msg_zpl (self, NULL);
     if (verbose)
@@ -2424,13 +6179,30 @@ zre_msg_test (bool verbose)
         if (instance < MAX_INSTANCE - 1)
             assert (zre_msg_routing_id (self));
         assert (zre_msg_sequence (self) == 123);
+        zhash_t *headers = zre_msg_get_headers (self);
+        // Order of values is not guaranted
+        assert (zhash_size (headers) == 1);
+        assert (streq ((char *) zhash_first (headers), "Brutus"));
+        assert (streq ((char *) zhash_cursor (headers), "Name"));
+        zhash_destroy (&headers);
+        if (instance == MAX_INSTANCE - 1)
+            zhash_destroy (&headers_headers);
         if (instance == MAX_INSTANCE - 1) {
             zre_msg_destroy (&self);
             self = self_temp;
         }
     }
-    zre_msg_set_id (self, ZRE_MSG_PING_OK);
+    zre_msg_set_id (self, ZRE_MSG_STORE_SET);
     zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    zre_msg_set_key (self, "Life is short but Now lasts for ever");
+    byte store_set_origin [16];
+    memset (store_set_origin, 123, 16);
+    zre_msg_set_origin (self, store_set_origin);
+    zre_msg_set_stamp (self, 123);
+    zmsg_t *store_set_content = zmsg_new ();
+    zre_msg_set_content (self, &store_set_content);
+    zmsg_addstr (zre_msg_content (self), "Captcha Diem");
     // convert to zpl
     config = zre_msg_zpl (self, NULL);
     if (verbose)
@@ -2452,15 +6224,28 @@ zre_msg_test (bool verbose)
         if (instance < MAX_INSTANCE - 1)
             assert (zre_msg_routing_id (self));
         assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (streq (zre_msg_key (self), "Life is short but Now lasts for ever"));
+        assert (zre_msg_origin (self) [0] == 123);
+        assert (zre_msg_origin (self) [16 - 1] == 123);
+        assert (zre_msg_stamp (self) == 123);
+        assert (zmsg_size (zre_msg_content (self)) == 1);
+        char *content = zmsg_popstr (zre_msg_content (self));
+        assert (streq (content, "Captcha Diem"));
+        zstr_free (&content);
+        if (instance == MAX_INSTANCE - 1)
+            zmsg_destroy (&store_set_content);
         if (instance == MAX_INSTANCE - 1) {
             zre_msg_destroy (&self);
             self = self_temp;
         }
     }
-    zre_msg_set_id (self, ZRE_MSG_ELECT);
+    zre_msg_set_id (self, ZRE_MSG_STORE_SYNC);
     zre_msg_set_sequence (self, 123);
     zre_msg_set_group (self, "Life is short but Now lasts for ever");
-    zre_msg_set_challenger_id (self, "Life is short but Now lasts for ever");
+    zhash_t *store_sync_clock = zhash_new ();
+    zhash_insert (store_sync_clock, "Name", (void*)"Brutus");
+    zre_msg_set_clock (self, &store_sync_clock);
     // convert to zpl
     config = zre_msg_zpl (self, NULL);
     if (verbose)
@@ -2483,16 +6268,22 @@ zre_msg_test (bool verbose)
             assert (zre_msg_routing_id (self));
         assert (zre_msg_sequence (self) == 123);
         assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
-        assert (streq (zre_msg_challenger_id (self), "Life is short but Now lasts for ever"));
+        zhash_t *clock = zre_msg_get_clock (self);
+        // Order of values is not guaranted
+        assert (zhash_size (clock) == 1);
+        assert (streq ((char *) zhash_first (clock), "Brutus"));
+        assert (streq ((char *) zhash_cursor (clock), "Name"));
+        zhash_destroy (&clock);
+        if (instance == MAX_INSTANCE - 1)
+            zhash_destroy (&store_sync_clock);
         if (instance == MAX_INSTANCE - 1) {
             zre_msg_destroy (&self);
             self = self_temp;
         }
     }
-    zre_msg_set_id (self, ZRE_MSG_LEADER);
+    zre_msg_set_id (self, ZRE_MSG_CATCHUP);
     zre_msg_set_sequence (self, 123);
     zre_msg_set_group (self, "Life is short but Now lasts for ever");
-    zre_msg_set_leader_id (self, "Life is short but Now lasts for ever");
     // convert to zpl
     config = zre_msg_zpl (self, NULL);
     if (verbose)
@@ -2515,14 +6306,18 @@ zre_msg_test (bool verbose)
             assert (zre_msg_routing_id (self));
         assert (zre_msg_sequence (self) == 123);
         assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
-        assert (streq (zre_msg_leader_id (self), "Life is short but Now lasts for ever"));
         if (instance == MAX_INSTANCE - 1) {
             zre_msg_destroy (&self);
             self = self_temp;
         }
     }
-    zre_msg_set_id (self, ZRE_MSG_GOODBYE);
+    zre_msg_set_id (self, ZRE_MSG_HISTORY);
     zre_msg_set_sequence (self, 123);
+    zre_msg_set_group (self, "Life is short but Now lasts for ever");
+    zre_msg_set_serial (self, 123);
+    zmsg_t *history_content = zmsg_new ();
+    zre_msg_set_content (self, &history_content);
+    zmsg_addstr (zre_msg_content (self), "Captcha Diem");
     // convert to zpl
     config = zre_msg_zpl (self, NULL);
     if (verbose)
@@ -2544,12 +6339,19 @@ zre_msg_test (bool verbose)
         if (instance < MAX_INSTANCE - 1)
             assert (zre_msg_routing_id (self));
         assert (zre_msg_sequence (self) == 123);
+        assert (streq (zre_msg_group (self), "Life is short but Now lasts for ever"));
+        assert (zre_msg_serial (self) == 123);
+        assert (zmsg_size (zre_msg_content (self)) == 1);
+        char *content = zmsg_popstr (zre_msg_content (self));
+        assert (streq (content, "Captcha Diem"));
+        zstr_free (&content);
+        if (instance == MAX_INSTANCE - 1)
+            zmsg_destroy (&history_content);
         if (instance == MAX_INSTANCE - 1) {
             zre_msg_destroy (&self);
             self = self_temp;
         }
     }
-
     zre_msg_destroy (&self);
     zsock_destroy (&input);
     zsock_destroy (&output);
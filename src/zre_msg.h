@@ -83,6 +83,119 @@
     GOODBYE - Peer is leaving
         version             number 1    Version number (2)
         sequence            number 2    Cyclic sequence number
+
+    ELECT_UUID - Challenge for group leadership, binary form
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        group               string      Name of group
+        challenger          octets [16] UUID of the challenger
+        lapsed              string      Leader the challenger leaves out, if any
+
+    LEADER_UUID - Announce group leader, binary form
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        group               string      Name of group
+        leader              octets [16] UUID of the elected leader
+
+    STREAM - Send a chunk of a large object, to peers that list "streams" in X-ZRE-FEATURES
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        stream              number 4    Stream number, unique per sender
+        name                string      Name of the object
+        offset              number 8    Offset of chunk in object
+        total               number 8    Size of object in bytes
+        content             msg         Chunk data
+
+    STREAM_ACK - Tell the sender how much of a stream we took, opening its window
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        stream              number 4    Stream number, unique per sender
+        offset              number 8    Bytes taken so far
+
+    WHISPER_ZSTD - Send a multi-part message to a peer, with some frames compressed
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        compressed          number 8    Content frames compressed with zstd, as bits
+        content             msg         Wrapped message content
+
+    SHOUT_ZSTD - Send a multi-part message to a group, with some frames compressed
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        group               string      Group to send to
+        compressed          number 8    Content frames compressed with zstd, as bits
+        content             msg         Wrapped message content
+
+    MULTICAST - Take SHOUTs to a group on a multicast endpoint, or over TCP if empty
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        group               string      Group the SHOUTs go to
+        endpoint            string      Multicast endpoint, empty for TCP
+
+    MULTICAST_OK - Switch SHOUTs to a group as asked, from a multicast sequence number
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        group               string      Group the SHOUTs go to
+        endpoint            string      Multicast endpoint, empty for TCP
+        start               number 4    First multicast sequence switched
+
+    RELAY - Send a group message on down a relay tree
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        origin              octets [16] UUID of node that sent the message
+        group               string      Group the message goes to
+        serial              number 4    Origin's message number in group
+        fanout              number 1    Peers each node relays to, at most
+        bound               octets [16] UUID of last peer to relay to
+        span                number 4    Peers in the range, the first included; 0 gives the range back
+        content             msg         Wrapped message content
+
+    REQUEST - Send a request to a peer, which answers with a REPLY
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        correlation         number 8    Request number, unique to the sender
+        content             msg         Wrapped message content
+
+    REPLY - Answer a peer's request
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        correlation         number 8    Number of the request we answer
+        content             msg         Wrapped message content
+
+    HELLO_WANTED - Ask a peer for all of its HELLO, when we no longer have what its compact HELLO builds on
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+
+    HEADERS - Tell a peer which of our header values changed since our HELLO
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        headers             hash        Header values that changed
+
+    STORE_SET - Tell a peer about a write to a group's replicated store
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        group               string      Group to send to
+        key                 string      Key written
+        origin              octets [16] UUID of node that wrote the value
+        stamp               number 8    Lamport time of the write
+        content             msg         Value written, no frames if key was deleted
+
+    STORE_SYNC - Ask a peer for the writes to a group's store that we don't have
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        group               string      Group to send to
+        clock               hash        Highest stamp we have from each writer, by UUID
+
+    CATCHUP - Ask a peer to replay the SHOUTs it kept for a group, just before we join it
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        group               string      Group we are about to join
+
+    HISTORY - Replay a SHOUT we sent to a group before the peer joined it
+        version             number 1    Version number (2)
+        sequence            number 2    Cyclic sequence number
+        group               string      Group the SHOUT went to
+        serial              number 4    Our number for the SHOUT in the group
+        content             msg         Wrapped message content
 */
 
 
@@ -96,6 +209,23 @@
 #define ZRE_MSG_ELECT                       8
 #define ZRE_MSG_LEADER                      9
 #define ZRE_MSG_GOODBYE                     10
+#define ZRE_MSG_ELECT_UUID                  11
+#define ZRE_MSG_LEADER_UUID                 12
+#define ZRE_MSG_STREAM                      13
+#define ZRE_MSG_STREAM_ACK                  14
+#define ZRE_MSG_WHISPER_ZSTD                15
+#define ZRE_MSG_SHOUT_ZSTD                  16
+#define ZRE_MSG_MULTICAST                   17
+#define ZRE_MSG_MULTICAST_OK                18
+#define ZRE_MSG_RELAY                       19
+#define ZRE_MSG_REQUEST                     20
+#define ZRE_MSG_REPLY                       21
+#define ZRE_MSG_HELLO_WANTED                22
+#define ZRE_MSG_HEADERS                     23
+#define ZRE_MSG_STORE_SET                   24
+#define ZRE_MSG_STORE_SYNC                  25
+#define ZRE_MSG_CATCHUP                     26
+#define ZRE_MSG_HISTORY                     27
 
 #include <czmq.h>
 
@@ -237,6 +367,112 @@ ZYRE_PRIVATE const char *
 ZYRE_PRIVATE void
     zre_msg_set_leader_id (zre_msg_t *self, const char *value);
 
+//  Get/set the challenger field
+ZYRE_PRIVATE byte *
+    zre_msg_challenger (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_challenger (zre_msg_t *self, byte *challenger);
+
+//  Get/set the lapsed field
+ZYRE_PRIVATE const char *
+    zre_msg_lapsed (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_lapsed (zre_msg_t *self, const char *value);
+
+//  Get/set the leader field
+ZYRE_PRIVATE byte *
+    zre_msg_leader (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_leader (zre_msg_t *self, byte *leader);
+
+//  Get/set the stream field
+ZYRE_PRIVATE uint32_t
+    zre_msg_stream (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_stream (zre_msg_t *self, uint32_t stream);
+
+//  Get/set the offset field
+ZYRE_PRIVATE uint64_t
+    zre_msg_offset (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_offset (zre_msg_t *self, uint64_t offset);
+
+//  Get/set the total field
+ZYRE_PRIVATE uint64_t
+    zre_msg_total (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_total (zre_msg_t *self, uint64_t total);
+
+//  Get/set the compressed field
+ZYRE_PRIVATE uint64_t
+    zre_msg_compressed (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_compressed (zre_msg_t *self, uint64_t compressed);
+
+//  Get/set the start field
+ZYRE_PRIVATE uint32_t
+    zre_msg_start (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_start (zre_msg_t *self, uint32_t start);
+
+//  Get/set the origin field
+ZYRE_PRIVATE byte *
+    zre_msg_origin (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_origin (zre_msg_t *self, byte *origin);
+
+//  Get/set the serial field
+ZYRE_PRIVATE uint32_t
+    zre_msg_serial (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_serial (zre_msg_t *self, uint32_t serial);
+
+//  Get/set the fanout field
+ZYRE_PRIVATE byte
+    zre_msg_fanout (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_fanout (zre_msg_t *self, byte fanout);
+
+//  Get/set the bound field
+ZYRE_PRIVATE byte *
+    zre_msg_bound (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_bound (zre_msg_t *self, byte *bound);
+
+//  Get/set the span field
+ZYRE_PRIVATE uint32_t
+    zre_msg_span (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_span (zre_msg_t *self, uint32_t span);
+
+//  Get/set the correlation field
+ZYRE_PRIVATE uint64_t
+    zre_msg_correlation (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_correlation (zre_msg_t *self, uint64_t correlation);
+
+//  Get/set the key field
+ZYRE_PRIVATE const char *
+    zre_msg_key (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_key (zre_msg_t *self, const char *value);
+
+//  Get/set the stamp field
+ZYRE_PRIVATE uint64_t
+    zre_msg_stamp (zre_msg_t *self);
+ZYRE_PRIVATE void
+    zre_msg_set_stamp (zre_msg_t *self, uint64_t stamp);
+
+//  Get a copy of the clock field
+ZYRE_PRIVATE zhash_t *
+    zre_msg_clock (zre_msg_t *self);
+//  Get the clock field and transfer ownership to caller
+ZYRE_PRIVATE zhash_t *
+    zre_msg_get_clock (zre_msg_t *self);
+//  Set the clock field, transferring ownership from caller
+ZYRE_PRIVATE void
+    zre_msg_set_clock (zre_msg_t *self, zhash_t **hash_p);
+
 //  Self test of this class
 ZYRE_PRIVATE void
     zre_msg_test (bool verbose);
@@ -39,6 +39,24 @@
             a peer has sent this node a message
         SHOUT fromnode name groupname message
             a peer has sent one of our groups a message
+        STREAM fromnode name objectname offset size chunk
+            a peer has sent us the next chunk of a stream; with a stream
+            sink, the chunk is the path of the file, once it is complete
+        REQUEST fromnode name request message
+            a peer has sent us a request, to answer with zyre_reply
+        REPLY fromnode name request message
+            a peer has answered a request we sent with zyre_request
+        NOREPLY fromnode name request reason
+            a request we sent will get no reply, because the peer is
+            "unknown", is "unsupported", did "exit", or hit "timeout"
+        HEADER-UPDATE fromnode name headers
+            a peer has changed some of its headers since it entered
+        HISTORY fromnode name groupname message
+            a peer has replayed a message it sent one of our groups before
+            we joined it, see zyre_join_catchup
+        STEP-DOWN ournode name groupname
+            we were leader of a group with a leader lease, and we stopped
+            leading it, see zyre_set_leader_lease
 
     In SHOUT and WHISPER the message is zero or more frames, and can hold
     any ZeroMQ message. In ENTER, the headers frame contains a packed
@@ -59,11 +77,15 @@
 //  Structure of our class
 
 struct _zyre_t {
-    zactor_t *actor;            //  A Zyre instance wraps the actor instance
+    void *actor;                //  Node actor, or pipe to embedded node
+    zyre_node_t *node;          //  Node we run in the caller's thread, if any
+    zsock_t *node_pipe;         //  That node's end of the pipe
     zsock_t *inbox;             //  Receives incoming cluster traffic
     char *uuid;                 //  Copy of node UUID string
     char *name;                 //  Copy of node name
     char *endpoint;             //  Copy of last endpoint bound to
+    zhash_t *rings;             //  Node's groups, for key owner lookups
+    uint64_t last_request;      //  Number of last request we sent
 };
 
 
@@ -95,6 +117,51 @@ zyre_new (const char *name)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Constructor, creates a new Zyre node that runs in the caller's thread
+//  rather than a thread of its own, so an application can run it in its own
+//  event loop. Wait until zyre_fd is readable, or for zyre_timeout msecs,
+//  then call zyre_step; read events from zyre_socket after each step. All
+//  other methods work as for zyre_new, from the same thread.
+
+zyre_t *
+zyre_new_embedded (const char *name)
+{
+    zyre_t *self = (zyre_t *) zmalloc (sizeof (zyre_t));
+    assert (self);
+
+    //  Create front-to-back pipe pair for data traffic
+    zsock_t *outbox;
+    self->inbox = zsys_create_pipe (&outbox);
+
+    //  Commands wait on the pipe until the application steps the node, so
+    //  the pipe must never fill up and block the application
+    self->actor = zsys_create_pipe (&self->node_pipe);
+    zsock_set_sndhwm (self->actor, 0);
+    zsock_set_rcvhwm (self->node_pipe, 0);
+    self->node = zyre_node_new (self->node_pipe, outbox);
+    assert (self->node);
+
+    //  Send name, if any, to node ending
+    if (name)
+        zstr_sendx (self->actor, "SET NAME", name, NULL);
+
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  If the node runs in our thread, have it handle the commands we sent it,
+//  so we can read its answer
+
+static void
+s_node_sync (zyre_t *self)
+{
+    if (self->node)
+        zyre_node_recv_commands (self->node);
+}
+
+
 //  --------------------------------------------------------------------------
 //  Destructor, destroys a Zyre node. When you destroy a node, any
 //  messages it is sending or receiving will be discarded.
@@ -105,7 +172,13 @@ zyre_destroy (zyre_t **self_p)
     assert (self_p);
     if (*self_p) {
         zyre_t *self = *self_p;
-        zactor_destroy (&self->actor);
+        if (self->node) {
+            zyre_node_destroy (&self->node);
+            zsock_destroy (&self->node_pipe);
+            zsock_destroy ((zsock_t **) &self->actor);
+        }
+        else
+            zactor_destroy ((zactor_t **) &self->actor);
         zsock_destroy (&self->inbox);
         zstr_free (&self->uuid);
         zstr_free (&self->name);
@@ -126,6 +199,7 @@ zyre_uuid (zyre_t *self)
     //  Hold uuid string in zyre object so caller gets a safe reference
     zstr_free (&self->uuid);
     zstr_sendx (self->actor, "UUID", NULL);
+    s_node_sync (self);
     self->uuid = zstr_recv (self->actor);
     return self->uuid;
 }
@@ -142,6 +216,7 @@ zyre_name (zyre_t *self)
     //  Hold name in zyre object so caller gets a safe reference
     zstr_free (&self->name);
     zstr_sendx (self->actor, "NAME", NULL);
+    s_node_sync (self);
     self->name = zstr_recv (self->actor);
     return self->name;
 }
@@ -163,6 +238,8 @@ zyre_set_name (zyre_t *self, const char *name)
 //  --------------------------------------------------------------------------
 //  Set node header; these are provided to other nodes during discovery
 //  and come in each ENTER message.
+//  Changes after the node started reach peers shortly after, as a
+//  HEADER-UPDATE event.
 
 void
 zyre_set_header (zyre_t *self, const char *name, const char *format, ...)
@@ -318,6 +395,7 @@ zyre_set_endpoint (zyre_t *self, const char *format, ...)
 
     zstr_sendx (self->actor, "SET ENDPOINT", string, NULL);
     free (string);
+    s_node_sync (self);
     return zsock_wait (self->actor) == 0? 0: -1;
 }
 
@@ -334,6 +412,642 @@ zyre_set_contest_in_group (zyre_t *self, const char *group) {
     zstr_sendx (self->actor, "SET CONTEST" , group, NULL);
 }
 
+//  --------------------------------------------------------------------------
+//  Set a leader lease for the given group, in milliseconds. The elected
+//  leader renews its lease with any traffic it sends to the group, and
+//  followers that contest the group start a new election as soon as the
+//  lease lapses. A leader that has not heard from a majority of the group
+//  for a whole lease, or that learns the others let its lease lapse, stops
+//  leading and emits STEP-DOWN. Default is 0, no lease.
+
+void
+zyre_set_leader_lease (zyre_t *self, const char *group, int interval)
+{
+    assert (self);
+    assert (group);
+    zstr_sendm (self->actor, "SET LEADER LEASE");
+    zstr_sendm (self->actor, group);
+    zstr_sendf (self->actor, "%d", interval);
+}
+
+//  --------------------------------------------------------------------------
+//  Limit the rate at which the node connects to new peers, in connects per
+//  second. Peers beyond the rate are queued, and peers that share one of our
+//  groups are connected first. Default is 0, meaning no limit.
+
+void
+zyre_set_connect_rate (zyre_t *self, int rate)
+{
+    assert (self);
+    zstr_sendm (self->actor, "SET CONNECT RATE");
+    zstr_sendf (self->actor, "%d", rate);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Limit the number of peer connects the node has in flight, that is peers
+//  we connected to that have not yet greeted us. Default is 0, meaning no
+//  limit.
+
+void
+zyre_set_max_handshakes (zyre_t *self, int max)
+{
+    assert (self);
+    zstr_sendm (self->actor, "SET MAX HANDSHAKES");
+    zstr_sendf (self->actor, "%d", max);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Spread the node's peer mailboxes over this many worker threads, which
+//  then do the sending to peers, including SHOUT fan-out. Default is 0,
+//  meaning the node thread sends to all peers. Call before zyre_start.
+
+void
+zyre_set_workers (zyre_t *self, int workers)
+{
+    assert (self);
+    zstr_sendm (self->actor, "SET WORKERS");
+    zstr_sendf (self->actor, "%d", workers);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send to all peers through one shared ROUTER socket, instead of one
+//  DEALER socket per peer. This saves a socket, a send queue and a pipe per
+//  peer, which matters in large meshes. Needs libzmq with
+//  ZMQ_CONNECT_ROUTING_ID (4.3 or later); otherwise the node keeps one
+//  socket per peer. Ignored if the node has worker threads. Call before
+//  zyre_start.
+
+void
+zyre_set_shared_mailbox (zyre_t *self)
+{
+    assert (self);
+    zstr_send (self->actor, "SET SHARED MAILBOX");
+}
+
+
+//  --------------------------------------------------------------------------
+//  Exchange messages by pointer with other nodes in this process that
+//  also call this, instead of encoding them and sending them through
+//  libzmq. Sequencing and events stay the same. Ignored if the node uses
+//  CURVE. Call before zyre_start.
+
+void
+zyre_set_direct (zyre_t *self)
+{
+    assert (self);
+    zstr_send (self->actor, "SET DIRECT");
+}
+
+
+//  --------------------------------------------------------------------------
+//  Let peers on this host move their mailboxes to us from TCP to IPC, and
+//  move ours to peers that do the same. The node binds an IPC endpoint
+//  under /tmp next to its TCP endpoint and removes the socket file when it
+//  is destroyed. A peer only moves once a PING over IPC comes back, and
+//  otherwise stays on TCP. UNIX only; ignored elsewhere, and for inproc or
+//  IPC endpoints. Call before zyre_start.
+
+void
+zyre_set_ipc_upgrade (zyre_t *self)
+{
+    assert (self);
+    zstr_send (self->actor, "SET IPC UPGRADE");
+}
+
+
+//  --------------------------------------------------------------------------
+//  Deliver events to a handler on the node's own thread, instead of through
+//  zyre_recv. This saves a pipe hop, a thread wakeup and a copy per event.
+//  The node does nothing else while the handler runs, so the handler must
+//  return quickly, and must not call any zyre method on this node: the
+//  node can't read its pipe while it runs the handler, so a call that
+//  waits on the node, or a send that fills the pipe, blocks forever. To
+//  answer events, hand them to another thread. Pass a NULL handler to go
+//  back to zyre_recv.
+//  Events queued before the call stay readable with zyre_recv.
+
+void
+zyre_set_handler (zyre_t *self, zyre_handler_fn handler, void *arg)
+{
+    assert (self);
+    zyre_handler_fn *handler_ref = handler;
+    zsock_send (self->actor, "sbb", "SET HANDLER",
+                &handler_ref, sizeof (handler_ref), &arg, sizeof (arg));
+}
+
+
+//  --------------------------------------------------------------------------
+//  Choose the events the node delivers, as a mask of ZYRE_EVENT_* flags.
+//  The node drops other events before they reach the application. STOP is
+//  always delivered. Default is ZYRE_EVENT_ALL.
+
+void
+zyre_set_event_filter (zyre_t *self, int mask)
+{
+    assert (self);
+    zstr_sendm (self->actor, "SET EVENT FILTER");
+    zstr_sendf (self->actor, "%d", mask);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Deliver SHOUT events only for groups whose names start with one of the
+//  prefixes subscribed to. With no subscriptions, which is the default,
+//  SHOUTs from all our groups are delivered.
+
+void
+zyre_subscribe_shouts (zyre_t *self, const char *prefix)
+{
+    assert (self);
+    assert (prefix);
+    zstr_sendx (self->actor, "SUBSCRIBE SHOUTS", prefix, NULL);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Remove a prefix added with zyre_subscribe_shouts.
+
+void
+zyre_unsubscribe_shouts (zyre_t *self, const char *prefix)
+{
+    assert (self);
+    assert (prefix);
+    zstr_sendx (self->actor, "UNSUBSCRIBE SHOUTS", prefix, NULL);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Limit the events the node holds for the application when zyre_recv
+//  falls behind, by count and by total size in bytes; 0 means no limit.
+//  Over a limit, the node drops the oldest WHISPER, SHOUT, EVASIVE and
+//  SILENT events it holds, and keeps membership events. Default is no limit.
+
+void
+zyre_set_outbox_limits (zyre_t *self, int max_events, int max_bytes)
+{
+    assert (self);
+    zstr_sendm (self->actor, "SET OUTBOX LIMITS");
+    zstr_sendfm (self->actor, "%d", max_events);
+    zstr_sendf (self->actor, "%d", max_bytes);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of events the node dropped because the application
+//  fell behind, since the node was created.
+
+uint64_t
+zyre_events_dropped (zyre_t *self)
+{
+    assert (self);
+    uint64_t dropped;
+    zstr_send (self->actor, "EVENTS DROPPED");
+    s_node_sync (self);
+    zsock_recv (self->actor, "8", &dropped);
+    return dropped;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Stream a file to a peer, in chunks, without holding it in memory. The
+//  peer gets the file under the given name, or under the file's own name
+//  if name is NULL. Returns 0 if OK, -1 if the file cannot be read, or the
+//  peer is not there or does not run a node that supports streams.
+
+int
+zyre_send_file (zyre_t *self, const char *peer, const char *path, const char *name)
+{
+    assert (self);
+    assert (peer);
+    assert (path);
+    zstr_sendx (self->actor, "SEND FILE", peer, path, name? name: "", NULL);
+    s_node_sync (self);
+    return zsock_wait (self->actor) == 0? 0: -1;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Stream an object we hold in memory to a peer, in chunks, under the given
+//  name. The node takes the frame without a copy, and destroys it once the
+//  peer has it all; the peer only holds a window of chunks at a time.
+//  Returns 0 if OK, -1 if the peer is not there or does not run a node
+//  that supports streams. Either way, the frame is gone.
+
+int
+zyre_send_stream (zyre_t *self, const char *peer, const char *name, zframe_t **frame_p)
+{
+    assert (self);
+    assert (peer);
+    assert (name);
+    assert (frame_p);
+    assert (*frame_p);
+    zmsg_t *msg = zmsg_new ();
+    zmsg_addstr (msg, "SEND STREAM");
+    zmsg_addstr (msg, peer);
+    zmsg_addstr (msg, name);
+    zmsg_append (msg, frame_p);
+    zmsg_send (&msg, self->actor);
+    s_node_sync (self);
+    return zsock_wait (self->actor) == 0? 0: -1;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Write streams that peers send us to files in this directory, instead
+//  of passing their chunks up as STREAM events. Pass NULL to go back to
+//  STREAM events. A file takes the name the sender gives the stream, or
+//  a name of our own if that has a / or .. in it. It only appears once
+//  the stream is complete, and never replaces a file that is there;
+//  the STREAM event tells where it is.
+
+void
+zyre_set_stream_sink (zyre_t *self, const char *path)
+{
+    assert (self);
+    zstr_sendx (self->actor, "SET STREAM SINK", path? path: "", NULL);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Compress message frames of at least threshold bytes with zstd, at the
+//  given level, when sending WHISPER and SHOUT messages to peers that
+//  support it. Level 0 means zstd's default. Other peers get the frames
+//  as they are. Default threshold is 0, meaning no compression. Has no
+//  effect if Zyre was built without libzstd.
+
+void
+zyre_set_compression (zyre_t *self, int threshold, int level)
+{
+    assert (self);
+    zstr_sendm (self->actor, "SET COMPRESSION");
+    zstr_sendfm (self->actor, "%d", threshold);
+    zstr_sendf (self->actor, "%d", level);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Compress with this zstd dictionary, as trained by zstd --train, which
+//  helps with many small, similar messages. Peers use the dictionary for
+//  our frames only if they have set the same one. Call before zyre_start.
+
+void
+zyre_set_compression_dict (zyre_t *self, const byte *dict, size_t dict_size)
+{
+    assert (self);
+    assert (dict);
+    zsock_send (self->actor, "sb", "SET COMPRESSION DICT", dict, dict_size);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the node's counters, as a hash of name to value: events-dropped,
+//  compress-bytes-in, compress-bytes-out, compress-ratio, compress-usecs,
+//  decompress-usecs, and recv-bursts and recv-messages, the wakeups that
+//  took messages from peers and how many they took.
+
+zhash_t *
+zyre_stats (zyre_t *self)
+{
+    assert (self);
+    zhash_t *stats;
+    zstr_send (self->actor, "STATS");
+    s_node_sync (self);
+    zsock_recv (self->actor, "p", &stats);
+    return stats;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send SHOUTs to a group by UDP multicast on this endpoint, such as
+//  udp://239.192.1.1:5670, to the peers that listen for them there, and
+//  listen there for the group's SHOUTs from other peers. Peers that don't
+//  listen get SHOUTs over TCP, as do all peers for SHOUTs too large for one
+//  datagram. A peer that finds it lost a multicast SHOUT goes back to TCP
+//  for the group. Set the same endpoint on every peer of the group. Pass
+//  NULL to stop. Needs libzmq with draft RADIO/DISH sockets, and is ignored
+//  if the node uses CURVE.
+
+void
+zyre_set_multicast (zyre_t *self, const char *group, const char *endpoint)
+{
+    assert (self);
+    assert (group);
+    zstr_sendx (self->actor, "SET MULTICAST", group, endpoint? endpoint: "", NULL);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send SHOUTs to a group down a relay tree, instead of to each peer in
+//  turn. We send each SHOUT to at most fanout peers, each of which passes
+//  it on to at most fanout more, and so on, so that the cost of SHOUTs to
+//  very large groups is spread over the group, for a hop per level of the
+//  tree. Peers that cannot relay still get SHOUTs from us directly. Other
+//  nodes relay our SHOUTs whatever they set themselves. Default is 0,
+//  meaning no relay tree. A SHOUT that comes down a relay tree names the
+//  node it came from, as the peers that relayed it tell us; we only check
+//  that the node is in the group, so the name is only as good as the
+//  peers that relay.
+
+void
+zyre_set_relay (zyre_t *self, const char *group, int fanout)
+{
+    assert (self);
+    assert (group);
+    zstr_sendm (self->actor, "SET RELAY");
+    zstr_sendm (self->actor, group);
+    zstr_sendf (self->actor, "%d", fanout);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send message to one peer in a named group, chosen by the group's anycast
+//  policy, or by key if not NULL, so that messages with the same key go to
+//  the same peer for as long as it stays in the group. The peer gets the
+//  message as a WHISPER. Drops the message if the group has no peers.
+//  Destroys message after sending
+
+int
+zyre_anycast (zyre_t *self, const char *group, const char *key, zmsg_t **msg_p)
+{
+    assert (self);
+    assert (group);
+    assert (msg_p);
+
+    if (zstr_sendm (self->actor, "ANYCAST") == -1)
+        return -1;
+    if (zstr_sendm (self->actor, group) == -1)
+        return -1;
+    if (zstr_sendm (self->actor, key? key: "") == -1)
+        return -1;
+    return zmsg_send (msg_p, self->actor);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set how we choose the peer in a group to anycast to: one of
+//  ZYRE_ANYCAST_ROUND_ROBIN, the default, ZYRE_ANYCAST_RANDOM, or
+//  ZYRE_ANYCAST_LEAST_OUTSTANDING, which picks the peer with fewest requests
+//  we sent it that it has not yet answered, see zyre_anycast_request.
+
+void
+zyre_set_anycast_policy (zyre_t *self, const char *group, int policy)
+{
+    assert (self);
+    assert (group);
+    zstr_sendm (self->actor, "SET ANYCAST POLICY");
+    zstr_sendm (self->actor, group);
+    zstr_sendf (self->actor, "%d", policy);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send a request to one peer in a named group, chosen as zyre_anycast
+//  chooses, and return the request's number, or 0 if we could not send it.
+//  We get the answer as a REPLY or NOREPLY event, as for zyre_request; if
+//  the group has no peers, we get a NOREPLY with reason "unknown". Destroys
+//  message after sending
+
+uint64_t
+zyre_anycast_request (zyre_t *self, const char *group, const char *key, int timeout, zmsg_t **msg_p)
+{
+    assert (self);
+    assert (group);
+    assert (msg_p);
+
+    //  Numbered here, from the same count as zyre_request
+    uint64_t request = ++self->last_request;
+    if (zstr_sendm (self->actor, "ANYCAST REQUEST") == -1)
+        return 0;
+    if (zstr_sendm (self->actor, group) == -1)
+        return 0;
+    if (zstr_sendm (self->actor, key? key: "") == -1)
+        return 0;
+    if (zstr_sendfm (self->actor, "%d", timeout) == -1)
+        return 0;
+    if (zstr_sendfm (self->actor, "%" PRIu64, request) == -1)
+        return 0;
+    if (zmsg_send (msg_p, self->actor) == -1)
+        return 0;
+    return request;
+}
+
+
+//  Return the node's table of groups, which lives as long as the node does,
+//  asking the node for it the first time
+
+static zhash_t *
+s_node_groups (zyre_t *self)
+{
+    if (!self->rings) {
+        zstr_sendx (self->actor, "RINGS", NULL);
+        s_node_sync (self);
+        zsock_recv (self->actor, "p", &self->rings);
+    }
+    return self->rings;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the UUID of the peer that owns key in a named group, or NULL if
+//  the group has no peers. The node keeps a consistent-hash ring for each
+//  group, so a key only moves to another peer when its owner leaves, or a
+//  new peer takes over part of its range. Looks up the node's ring
+//  directly, without a round trip to the node, except on the first call.
+
+char *
+zyre_group_owner (zyre_t *self, const char *group, const char *key)
+{
+    assert (self);
+    assert (group);
+    assert (key);
+    return zyre_group_find_owner (s_node_groups (self), group, key);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send message to the peer that owns key in a named group, as by
+//  zyre_group_owner, as a WHISPER. Drops the message if the group has no
+//  peers. Destroys message after sending
+
+int
+zyre_whisper_owner (zyre_t *self, const char *group, const char *key, zmsg_t **msg_p)
+{
+    assert (self);
+    assert (group);
+    assert (key);
+    assert (msg_p);
+
+    if (zstr_sendm (self->actor, "WHISPER OWNER") == -1)
+        return -1;
+    if (zstr_sendm (self->actor, group) == -1)
+        return -1;
+    if (zstr_sendm (self->actor, key) == -1)
+        return -1;
+    return zmsg_send (msg_p, self->actor);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send a request to a single peer specified as UUID string, and return
+//  the request's number, or 0 if we could not send it. The peer gets a
+//  REQUEST event and answers with zyre_reply; we get its answer as a REPLY
+//  event with the same number. If the peer is unknown or cannot take
+//  requests, leaves, or does not answer within timeout msecs, we get a
+//  NOREPLY event instead. A timeout of 0 means wait as long as the peer is
+//  there. Destroys message after sending
+
+uint64_t
+zyre_request (zyre_t *self, const char *peer, int timeout, zmsg_t **msg_p)
+{
+    assert (self);
+    assert (peer);
+    assert (msg_p);
+
+    //  We number requests here, so the caller needn't wait for the node
+    uint64_t request = ++self->last_request;
+    if (zstr_sendm (self->actor, "REQUEST") == -1)
+        return 0;
+    if (zstr_sendm (self->actor, peer) == -1)
+        return 0;
+    if (zstr_sendfm (self->actor, "%d", timeout) == -1)
+        return 0;
+    if (zstr_sendfm (self->actor, "%" PRIu64, request) == -1)
+        return 0;
+    if (zmsg_send (msg_p, self->actor) == -1)
+        return 0;
+    return request;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Answer a request from a peer specified as UUID string, by the number
+//  in its REQUEST event. The peer drops replies that come too late.
+//  Destroys message after sending
+
+int
+zyre_reply (zyre_t *self, const char *peer, uint64_t request, zmsg_t **msg_p)
+{
+    assert (self);
+    assert (peer);
+    assert (msg_p);
+
+    if (zstr_sendm (self->actor, "REPLY") == -1)
+        return -1;
+    if (zstr_sendm (self->actor, peer) == -1)
+        return -1;
+    if (zstr_sendfm (self->actor, "%" PRIu64, request) == -1)
+        return -1;
+    return zmsg_send (msg_p, self->actor);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Write a value to the replicated store of a named group, or delete the
+//  key if value is NULL. Each group we are in has a key-value store that
+//  all its members keep a copy of. Writes go to the other members as they
+//  happen, and members that join catch up on the writes they missed. The
+//  latest write to a key wins, so all members end up with the same
+//  values. Returns once our own copy has the write.
+
+void
+zyre_store_set (zyre_t *self, const char *group, const char *key, const char *value)
+{
+    assert (self);
+    assert (group);
+    assert (key);
+    //  A NULL value would end the message early, so deletes say so
+    if (value)
+        zstr_sendx (self->actor, "STORE SET", group, key, value, NULL);
+    else
+        zstr_sendx (self->actor, "STORE DELETE", group, key, NULL);
+    s_node_sync (self);
+    zsock_wait (self->actor);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the value of key in the replicated store of a named group, or
+//  NULL if there is no such key. Reads our own copy directly, without a
+//  round trip to the node, except on the first call.
+
+char *
+zyre_store_get (zyre_t *self, const char *group, const char *key)
+{
+    assert (self);
+    assert (group);
+    assert (key);
+    return zyre_group_find_value (s_node_groups (self), group, key);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the keys in the replicated store of a named group. Reads our own
+//  copy directly, without a round trip to the node, except on the first
+//  call.
+
+zlist_t *
+zyre_store_keys (zyre_t *self, const char *group)
+{
+    assert (self);
+    assert (group);
+    return zyre_group_find_keys (s_node_groups (self), group);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Keep the SHOUTs we send to a named group, so that peers that join it
+//  later with zyre_join_catchup can catch up on them. We keep at most
+//  messages SHOUTs, for at most msecs, taking at most bytes of content; a
+//  limit of 0 means none. Setting all limits to 0 stops keeping SHOUTs.
+
+void
+zyre_set_history (zyre_t *self, const char *group, int messages, int msecs, size_t bytes)
+{
+    assert (self);
+    assert (group);
+    zstr_sendm (self->actor, "SET HISTORY");
+    zstr_sendm (self->actor, group);
+    zstr_sendfm (self->actor, "%d", messages);
+    zstr_sendfm (self->actor, "%d", msecs);
+    zstr_sendf (self->actor, "%zu", bytes);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Join a named group, as zyre_join, and ask its members to replay the
+//  SHOUTs they kept for it, as by zyre_set_history. Each member replays
+//  only its own SHOUTs, as HISTORY events, ahead of any SHOUT it sends
+//  after our JOIN, so we get each message once. If we were in the group
+//  before, we only get the SHOUTs we missed since we left.
+
+int
+zyre_join_catchup (zyre_t *self, const char *group)
+{
+    assert (self);
+    assert (group);
+    zstr_sendx (self->actor, "JOIN", group, "CATCHUP", NULL);
+    return 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set how many messages the node takes off its inbox, or commands off its
+//  pipe, each time it wakes up, while more are waiting. Larger bursts save
+//  a poll per message under load; smaller ones let the node get to its
+//  other sockets sooner. Default is 32.
+
+void
+zyre_set_recv_budget (zyre_t *self, int budget)
+{
+    assert (self);
+    zstr_sendm (self->actor, "SET RECV BUDGET");
+    zstr_sendf (self->actor, "%d", budget);
+}
+
+
 void
 zyre_set_advertised_endpoint (zyre_t *self, const char *endpoint)
 {
@@ -459,6 +1173,7 @@ zyre_start (zyre_t *self)
     assert (self);
 
     zstr_sendx (self->actor, "START", NULL);
+    s_node_sync (self);
     return zsock_wait (self->actor) == 0? 0: -1;
 }
 
@@ -474,6 +1189,7 @@ zyre_stop (zyre_t *self)
     assert (self);
 
     zstr_sendx (self->actor, "STOP", NULL);
+    s_node_sync (self);
     zsock_wait (self->actor);
 }
 
@@ -511,11 +1227,17 @@ zyre_leave (zyre_t *self, const char *group)
 //  Receive next message from network; the message may be a control
 //  message (ENTER, EXIT, JOIN, LEAVE) or data (WHISPER, SHOUT).
 //  Returns zmsg_t object, or NULL if interrupted
+//  A node made with zyre_new_embedded runs until it has an event for us.
 
 zmsg_t *
 zyre_recv (zyre_t *self)
 {
     assert (self);
+    if (self->node) {
+        while (!(zsock_events (self->inbox) & ZMQ_POLLIN))
+            if (zyre_node_step (self->node, -1))
+                return NULL;
+    }
     return zmsg_recv (self->inbox);
 }
 
@@ -618,6 +1340,7 @@ zyre_peers (zyre_t *self)
 
     zlist_t *peers;
     zstr_send (self->actor, "PEERS");
+    s_node_sync (self);
     zsock_recv (self->actor, "p", &peers);
     return peers;
 }
@@ -636,6 +1359,7 @@ zyre_peers_by_group (zyre_t *self, const char *group)
     zlist_t *peers;
     zstr_sendm (self->actor, "GROUP PEERS");
     zstr_send (self->actor, group);
+    s_node_sync (self);
     zsock_recv (self->actor, "p", &peers);
     return peers;
 }
@@ -654,104 +1378,443 @@ zyre_peer_address (zyre_t *self, const char *peer)
     char *address;
     zstr_sendm (self->actor, "PEER ENDPOINT");
     zstr_send (self->actor, peer);
+    s_node_sync (self);
     zsock_recv (self->actor, "s", &address);
     return address;
 }
 
 //  --------------------------------------------------------------------------
-//  Return the value of a header of a conected peer.  Returns null if peer
-//  or key doesn't exits. Caller owns the string.
+//  Return the value of a header of a conected peer.  Returns null if peer
+//  or key doesn't exits. Caller owns the string.
+
+char *
+zyre_peer_header_value (zyre_t *self, const char *peer, const char *name)
+{
+    assert (self);
+    assert (peer);
+    assert (name);
+
+    zstr_sendm (self->actor, "PEER HEADER");
+    zstr_sendm (self->actor, peer);
+    zstr_send (self->actor, name);
+    s_node_sync (self);
+    return zstr_recv (self->actor);
+}
+
+//  --------------------------------------------------------------------------
+//  Return zlist of currently joined groups. The caller owns this list and
+//  should destroy it when finished with it.
+
+zlist_t *
+zyre_own_groups (zyre_t *self)
+{
+    assert (self);
+
+    zlist_t *groups;
+    zstr_send (self->actor, "OWN GROUPS");
+    s_node_sync (self);
+    zsock_recv (self->actor, "p", &groups);
+    return groups;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return zlist of groups known through connected peers. The caller owns this
+//  list and should destroy it when finished with it.
+
+zlist_t *
+zyre_peer_groups (zyre_t *self)
+{
+    assert (self);
+
+    zlist_t *groups;
+    zstr_send (self->actor, "PEER GROUPS");
+    s_node_sync (self);
+    zsock_recv (self->actor, "p", &groups);
+    return groups;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return node zsock_t socket, for direct polling of socket
+
+zsock_t *
+zyre_socket (zyre_t *self)
+{
+    assert (self);
+
+    return self->inbox;
+}
+
+void *zyre_socket_zmq (zyre_t *self)
+{
+    assert (self);
+
+    return zsock_resolve (self->inbox);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Run one turn of a node made with zyre_new_embedded: wait up to timeout
+//  msecs for input, or until the node next has timed work if that's sooner,
+//  or if timeout is -1; handle whatever came in, and run any timers that
+//  are due. Pass a zero timeout after zyre_fd was readable. Returns 0 if
+//  OK, or -1 if the node was interrupted.
+
+int
+zyre_step (zyre_t *self, int timeout)
+{
+    assert (self);
+    assert (self->node);
+    return zyre_node_step (self->node, timeout);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return how many msecs a node made with zyre_new_embedded can wait before
+//  its next step, if zyre_fd doesn't become readable first. Zero means the
+//  node has work to do now. Ask again after each step.
+
+int
+zyre_timeout (zyre_t *self)
+{
+    assert (self);
+    assert (self->node);
+    return zyre_node_timeout (self->node);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return a descriptor that becomes readable when a node made with
+//  zyre_new_embedded may have input, for the application to poll along
+//  with its own descriptors, or -1 if the platform has no such descriptor.
+//  Readable means only that the node should step: it may find nothing to
+//  do. Without a descriptor, let zyre_step wait for input instead.
+
+int
+zyre_fd (zyre_t *self)
+{
+    assert (self);
+    assert (self->node);
+    return zyre_node_fd (self->node);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Prints zyre node information
+
+void
+zyre_print (zyre_t *self)
+{
+    assert (self);
+
+    zstr_send (self->actor, "DUMP");
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the Zyre version for run-time API detection; returns
+//  major * 10000 + minor * 100 + patch, as a single integer.
+
+uint64_t
+zyre_version (void)
+{
+    return ZYRE_VERSION;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Event handler for the self test; signals the test when it gets a WHISPER
+
+static void
+s_test_handler (zmsg_t *event, void *arg)
+{
+    if (zframe_streq (zmsg_first (event), "WHISPER"))
+        zsock_signal ((zsock_t *) arg, 0);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Take a stream from the node's STREAM events, and check it carries the
+//  data we expect, under the name we expect
+
+static void
+s_test_take_stream (zyre_t *node, const char *name, byte *data, size_t size)
+{
+    size_t taken = 0;
+    while (taken < size) {
+        zmsg_t *msg = zyre_recv (node);
+        assert (msg);
+        char *command = zmsg_popstr (msg);
+        assert (streq (command, "STREAM"));
+        zstr_free (&command);
+        zframe_t *frame = zmsg_pop (msg);       //  Peer UUID
+        zframe_destroy (&frame);
+        frame = zmsg_pop (msg);                 //  Peer name
+        zframe_destroy (&frame);
+        char *value = zmsg_popstr (msg);
+        assert (streq (value, name));
+        zstr_free (&value);
+        value = zmsg_popstr (msg);
+        assert ((size_t) atol (value) == taken);
+        zstr_free (&value);
+        value = zmsg_popstr (msg);
+        assert ((size_t) atol (value) == size);
+        zstr_free (&value);
+        while ((frame = zmsg_pop (msg))) {
+            assert (memcmp (zframe_data (frame), data + taken, zframe_size (frame)) == 0);
+            taken += zframe_size (frame);
+            zframe_destroy (&frame);
+        }
+        zmsg_destroy (&msg);
+    }
+    assert (taken == size);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Take events from the node until we get the one we expect, and return it,
+//  with the command still on it
+
+static zmsg_t *
+s_test_expect (zyre_t *node, const char *command)
+{
+    while (true) {
+        zmsg_t *msg = zyre_recv (node);
+        assert (msg);
+        if (zframe_streq (zmsg_first (msg), command))
+            return msg;
+        zmsg_destroy (&msg);
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Take events from two nodes until one of them gets the one we expect, and
+//  return that node, with the event in *msg_p
 
-char *
-zyre_peer_header_value (zyre_t *self, const char *peer, const char *name)
+static zyre_t *
+s_test_expect_either (zyre_t *first, zyre_t *second, const char *command, zmsg_t **msg_p)
 {
-    assert (self);
-    assert (peer);
-    assert (name);
-
-    zstr_sendm (self->actor, "PEER HEADER");
-    zstr_sendm (self->actor, peer);
-    zstr_send (self->actor, name);
-    return zstr_recv (self->actor);
+    zpoller_t *poller = zpoller_new (zyre_socket (first), zyre_socket (second), NULL);
+    assert (poller);
+    zyre_t *node = NULL;
+    while (!node) {
+        zsock_t *which = (zsock_t *) zpoller_wait (poller, -1);
+        assert (which);
+        zyre_t *from = which == zyre_socket (first)? first: second;
+        zmsg_t *msg = zyre_recv (from);
+        assert (msg);
+        if (zframe_streq (zmsg_first (msg), command)) {
+            *msg_p = msg;
+            node = from;
+        }
+        else
+            zmsg_destroy (&msg);
+    }
+    zpoller_destroy (&poller);
+    return node;
 }
 
+
 //  --------------------------------------------------------------------------
-//  Return zlist of currently joined groups. The caller owns this list and
-//  should destroy it when finished with it.
+//  Run an embedded node in our own poll loop, waiting on its descriptor if
+//  it has one, until it delivers an event of this type; returns the event
 
-zlist_t *
-zyre_own_groups (zyre_t *self)
+static zmsg_t *
+s_test_step_until (zyre_t *node, const char *command)
 {
-    assert (self);
-
-    zlist_t *groups;
-    zstr_send (self->actor, "OWN GROUPS");
-    zsock_recv (self->actor, "p", &groups);
-    return groups;
+    while (true) {
+        while (zsock_events (zyre_socket (node)) & ZMQ_POLLIN) {
+            zmsg_t *msg = zyre_recv (node);
+            assert (msg);
+            if (zframe_streq (zmsg_first (msg), command))
+                return msg;
+            zmsg_destroy (&msg);
+        }
+        int rc;
+        if (zyre_fd (node) == -1)
+            rc = zyre_step (node, -1);
+        else {
+            zmq_pollitem_t item = { NULL, zyre_fd (node), ZMQ_POLLIN, 0 };
+            rc = zmq_poll (&item, 1, zyre_timeout (node));
+            assert (rc >= 0);
+            rc = zyre_step (node, 0);
+        }
+        assert (rc == 0);
+    }
 }
 
 
 //  --------------------------------------------------------------------------
-//  Return zlist of groups known through connected peers. The caller owns this
-//  list and should destroy it when finished with it.
+//  Start a node on an inproc endpoint named after it, or on endpoint if not
+//  NULL, finding other nodes through the gossip hub, which is the node that
+//  binds it and must start first
 
-zlist_t *
-zyre_peer_groups (zyre_t *self)
+static void
+s_test_start (zyre_t *node, zyre_t *hub, const char *endpoint, bool verbose)
 {
-    assert (self);
-
-    zlist_t *groups;
-    zstr_send (self->actor, "PEER GROUPS");
-    zsock_recv (self->actor, "p", &groups);
-    return groups;
+    if (verbose)
+        zyre_set_verbose (node);
+    int rc = endpoint?
+        zyre_set_endpoint (node, "%s", endpoint):
+        zyre_set_endpoint (node, "inproc://zyre-%s", zyre_name (node));
+    assert (rc == 0);
+    if (node == hub)
+        zyre_gossip_bind (node, "inproc://gossip-%s", zyre_name (hub));
+    else
+        zyre_gossip_connect (node, "inproc://gossip-%s", zyre_name (hub));
+    rc = zyre_start (node);
+    assert (rc == 0);
 }
 
 
 //  --------------------------------------------------------------------------
-//  Return node zsock_t socket, for direct polling of socket
+//  Have two nodes that both joined GLOBAL exchange SHOUTs and a WHISPER,
+//  which must arrive in order
 
-zsock_t *
-zyre_socket (zyre_t *self)
+static void
+s_test_exchange (zyre_t *node, zyre_t *partner)
 {
-    assert (self);
+    //  Several SHOUTs, so a node that takes events in bursts has a burst
+    zyre_shouts (partner, "GLOBAL", "One");
+    zyre_shouts (partner, "GLOBAL", "Two");
+    zyre_shouts (partner, "GLOBAL", "Three");
+    zmsg_t *msg = s_test_expect (node, "SHOUT");
+    assert (zframe_streq (zmsg_last (msg), "One"));
+    zmsg_destroy (&msg);
+    msg = s_test_expect (node, "SHOUT");
+    assert (zframe_streq (zmsg_last (msg), "Two"));
+    zmsg_destroy (&msg);
+    msg = s_test_expect (node, "SHOUT");
+    assert (zframe_streq (zmsg_last (msg), "Three"));
+    zmsg_destroy (&msg);
 
-    return self->inbox;
+    zyre_shouts (node, "GLOBAL", "Hello, partner");
+    msg = s_test_expect (partner, "SHOUT");
+    assert (zframe_streq (zmsg_last (msg), "Hello, partner"));
+    zmsg_destroy (&msg);
+    zyre_whispers (node, zyre_uuid (partner), "Just you");
+    msg = s_test_expect (partner, "WHISPER");
+    assert (zframe_streq (zmsg_last (msg), "Just you"));
+    zmsg_destroy (&msg);
 }
 
-void *zyre_socket_zmq (zyre_t *self)
-{
-    assert (self);
 
-    return zsock_resolve (self->inbox);
+//  --------------------------------------------------------------------------
+//  Start two nodes on endpoint, or inproc if NULL, with the first as gossip
+//  hub, and wait until each has seen the other join GLOBAL
+
+static void
+s_test_pair (zyre_t *node, zyre_t *partner, const char *endpoint, bool verbose)
+{
+    s_test_start (node, node, endpoint, verbose);
+    s_test_start (partner, node, endpoint, verbose);
+    zyre_join (node, "GLOBAL");
+    zyre_join (partner, "GLOBAL");
+    zmsg_t *msg = s_test_expect (node, "JOIN");
+    zmsg_destroy (&msg);
+    msg = s_test_expect (partner, "JOIN");
+    zmsg_destroy (&msg);
 }
 
 
 //  --------------------------------------------------------------------------
-//  Prints zyre node information
+//  Event handler for the self test; takes each WHISPER slowly, as an
+//  application that can't keep up would, so the node's inbox backs up
 
-void
-zyre_print (zyre_t *self)
+static void
+s_test_slow_handler (zmsg_t *event, void *arg)
 {
-    assert (self);
+    if (zframe_streq (zmsg_first (event), "WHISPER"))
+        zclock_sleep (5);
+}
 
-    zstr_send (self->actor, "DUMP");
+
+//  --------------------------------------------------------------------------
+//  Whisper in bulk to a partner that takes each message slowly, with or
+//  without the control lane on the partner, until the partner has had time
+//  to take all the data. Returns true if the node kept the partner all
+//  that time, false if the partner expired.
+
+static bool
+s_test_bulk (bool control_lane, bool verbose)
+{
+    zyre_t *node = zyre_new ("bulk");
+    assert (node);
+    zyre_t *partner = zyre_new ("bulk-partner");
+    assert (partner);
+    if (!control_lane)
+        zstr_sendx (partner->actor, "SET FEATURES",
+                    "binary-ids streams multicast relay rpc compact-hello"
+                    " headers store history", NULL);
+    zyre_set_evasive_timeout (node, 100);
+    zyre_set_expired_timeout (node, 1000);
+    s_test_pair (node, partner, "tcp://127.0.0.1:*", verbose);
+    zyre_set_handler (partner, s_test_slow_handler, NULL);
+
+    //  The partner needs two seconds for the data, twice the expiry time
+    byte chunk [1024] = { 0 };
+    int chunk_nbr;
+    for (chunk_nbr = 0; chunk_nbr < 400; chunk_nbr++) {
+        zmsg_t *msg = zmsg_new ();
+        zmsg_addmem (msg, chunk, sizeof (chunk));
+        int rc = zyre_whisper (node, zyre_uuid (partner), &msg);
+        assert (rc == 0);
+    }
+    bool kept = true;
+    zpoller_t *poller = zpoller_new (zyre_socket (node), NULL);
+    int64_t deadline = zclock_mono () + 3000;
+    while (kept && zclock_mono () < deadline) {
+        if (!zpoller_wait (poller, (int) (deadline - zclock_mono ())))
+            break;
+        zmsg_t *msg = zyre_recv (node);
+        assert (msg);
+        if (zframe_streq (zmsg_first (msg), "EXIT"))
+            kept = false;
+        zmsg_destroy (&msg);
+    }
+    zpoller_destroy (&poller);
+    zyre_set_handler (partner, NULL, NULL);
+    zyre_stop (partner);
+    zyre_stop (node);
+    zyre_destroy (&partner);
+    zyre_destroy (&node);
+    return kept;
 }
 
 
 //  --------------------------------------------------------------------------
-//  Return the Zyre version for run-time API detection; returns
-//  major * 10000 + minor * 100 + patch, as a single integer.
+//  Run a node that the caller has set up in some mode against a plain node
+//  over inproc gossip: they must see each other join GLOBAL, and exchange
+//  SHOUTs and a WHISPER. Destroys the node.
 
-uint64_t
-zyre_version (void)
+static void
+s_test_mode (zyre_t **node_p, bool verbose)
 {
-    return ZYRE_VERSION;
+    zyre_t *node = *node_p;
+    char *partner_name = zsys_sprintf ("%s-partner", zyre_name (node));
+    zyre_t *partner = zyre_new (partner_name);
+    assert (partner);
+    zstr_free (&partner_name);
+    s_test_pair (node, partner, NULL, verbose);
+    s_test_exchange (node, partner);
+
+    zyre_stop (partner);
+    zyre_stop (node);
+    zyre_destroy (&partner);
+    zyre_destroy (node_p);
 }
 
 
 //  --------------------------------------------------------------------------
 //  Self test of this class
 
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
 void
 zyre_test (bool verbose)
 {
@@ -772,6 +1835,8 @@ zyre_test (bool verbose)
     assert (node1);
     assert (streq (zyre_name (node1), "node1"));
     zyre_set_header (node1, "X-HELLO", "World");
+    //  The node lists its own features, whatever the application sets
+    zyre_set_header (node1, "X-ZRE-FEATURES", "none");
     if (verbose)
         zyre_set_verbose (node1);
 
@@ -835,6 +1900,9 @@ zyre_test (bool verbose)
     char *value = zyre_peer_header_value (node2, zyre_uuid (node1), "X-HELLO");
     assert (streq (value, "World"));
     zstr_free (&value);
+    value = zyre_peer_header_value (node2, zyre_uuid (node1), "X-ZRE-FEATURES");
+    assert (value && strstr (value, "binary-ids"));
+    zstr_free (&value);
 
     //  One node shouts to GLOBAL
     zyre_shouts (node1, "GLOBAL", "Hello, World");
@@ -920,6 +1988,180 @@ zyre_test (bool verbose)
     assert (zmsg_size (msg) == 3);
     zmsg_destroy (&msg);
 
+    //  Node2 is the only peer node1 knows in GLOBAL, so owns every key
+    char *owner = zyre_group_owner (node1, "GLOBAL", "some key");
+    assert (owner && streq (owner, zyre_uuid (node2)));
+    zstr_free (&owner);
+    assert (zyre_group_owner (node1, "no such group", "some key") == NULL);
+
+    //  Node1 asks node2, which answers; a request to a peer node1 doesn't
+    //  know fails at once
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Question");
+    uint64_t request = zyre_request (node1, zyre_uuid (node2), 5000, &msg);
+    assert (request);
+    msg = zyre_recv (node2);
+    assert (msg);
+    command = zmsg_popstr (msg);
+    assert (streq (command, "REQUEST"));
+    zstr_free (&command);
+    peerid = zmsg_popstr (msg);
+    name = zmsg_popstr (msg);
+    char *number = zmsg_popstr (msg);
+    assert (strtoull (number, NULL, 10) == request);
+    assert (zmsg_size (msg) == 1);
+    zmsg_destroy (&msg);
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Answer");
+    rc = zyre_reply (node2, peerid, request, &msg);
+    assert (rc == 0);
+    zstr_free (&peerid);
+    zstr_free (&name);
+    zstr_free (&number);
+
+    msg = zyre_recv (node1);
+    assert (msg);
+    command = zmsg_popstr (msg);
+    assert (streq (command, "REPLY"));
+    zstr_free (&command);
+    zmsg_destroy (&msg);
+
+    msg = zmsg_new ();
+    request = zyre_request (node1, "no such peer", 0, &msg);
+    msg = zyre_recv (node1);
+    assert (msg);
+    command = zmsg_popstr (msg);
+    assert (streq (command, "NOREPLY"));
+    zstr_free (&command);
+    assert (zmsg_size (msg) == 4);
+    zmsg_destroy (&msg);
+
+    //  A header change after start reaches the peer as HEADER-UPDATE
+    zyre_set_header (node1, "X-LOAD", "%d", 42);
+    msg = zyre_recv (node2);
+    assert (msg);
+    command = zmsg_popstr (msg);
+    assert (streq (command, "HEADER-UPDATE"));
+    zstr_free (&command);
+    assert (zmsg_size (msg) == 3);
+    zmsg_destroy (&msg);
+    value = zyre_peer_header_value (node2, zyre_uuid (node1), "X-LOAD");
+    assert (streq (value, "42"));
+    zstr_free (&value);
+
+    //  A write to a group's store reads back at once, and reaches the
+    //  other members shortly after
+    zyre_store_set (node1, "GLOBAL", "shard-1", "node1");
+    value = zyre_store_get (node1, "GLOBAL", "shard-1");
+    assert (value && streq (value, "node1"));
+    zstr_free (&value);
+    int attempt;
+    for (attempt = 0; attempt < 100; attempt++) {
+        value = zyre_store_get (node2, "GLOBAL", "shard-1");
+        if (value)
+            break;
+        zclock_sleep (10);
+    }
+    assert (value && streq (value, "node1"));
+    zstr_free (&value);
+    zyre_store_set (node2, "GLOBAL", "shard-1", NULL);
+    assert (zyre_store_get (node2, "GLOBAL", "shard-1") == NULL);
+    zlist_t *keys = zyre_store_keys (node2, "GLOBAL");
+    assert (zlist_size (keys) == 0);
+    zlist_destroy (&keys);
+
+    //  Node2 joins a group that node1 kept its SHOUTs for, and catches up
+    zyre_set_history (node1, "ARCHIVE", 10, 0, 0);
+    zyre_shouts (node1, "ARCHIVE", "First");
+    zyre_shouts (node1, "ARCHIVE", "Second");
+    zyre_join_catchup (node2, "ARCHIVE");
+    msg = zyre_recv (node2);
+    assert (msg);
+    command = zmsg_popstr (msg);
+    assert (streq (command, "HISTORY"));
+    zstr_free (&command);
+    assert (zmsg_size (msg) == 4);
+    zmsg_destroy (&msg);
+    msg = zyre_recv (node2);
+    assert (msg);
+    command = zmsg_popstr (msg);
+    assert (streq (command, "HISTORY"));
+    zstr_free (&command);
+    assert (zframe_streq (zmsg_last (msg), "Second"));
+    zmsg_destroy (&msg);
+    msg = zyre_recv (node1);
+    assert (msg);
+    command = zmsg_popstr (msg);
+    assert (streq (command, "JOIN"));
+    zstr_free (&command);
+    zmsg_destroy (&msg);
+
+    //  Node2 takes events through a handler, then goes back to zyre_recv
+    zsock_t *handler_backend;
+    zsock_t *handler_frontend = zsys_create_pipe (&handler_backend);
+    zyre_set_handler (node2, s_test_handler, handler_backend);
+    zyre_whispers (node1, zyre_uuid (node2), "Hello handler");
+    rc = zsock_wait (handler_frontend);
+    assert (rc == 0);
+    zyre_set_handler (node2, NULL, NULL);
+    //  Node2 has dropped the handler once it answers us
+    zlist_t *node2_peers = zyre_peers (node2);
+    zlist_destroy (&node2_peers);
+    zsock_destroy (&handler_frontend);
+    zsock_destroy (&handler_backend);
+
+    //  Node2 only takes SHOUTs for groups it subscribed to
+    zyre_subscribe_shouts (node2, "LOCAL");
+    node2_peers = zyre_peers (node2);
+    zlist_destroy (&node2_peers);
+    zyre_shouts (node1, "GLOBAL", "Filtered");
+    zyre_whispers (node1, zyre_uuid (node2), "Not filtered");
+    msg = zyre_recv (node2);
+    assert (msg);
+    command = zmsg_popstr (msg);
+    assert (streq (command, "WHISPER"));
+    zstr_free (&command);
+    zmsg_destroy (&msg);
+    zyre_unsubscribe_shouts (node2, "LOCAL");
+
+    //  Node1 streams a file to node2, which takes it in chunks
+    zsys_dir_create (SELFTEST_DIR_RW);
+    char *filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RW, "zyre-stream.data");
+    assert (filename);
+    size_t stream_size = 600 * 1024;
+    byte *stream_data = (byte *) zmalloc (stream_size);
+    size_t stream_taken;
+    for (stream_taken = 0; stream_taken < stream_size; stream_taken++)
+        stream_data [stream_taken] = (byte) stream_taken;
+    FILE *file = fopen (filename, "wb");
+    assert (file);
+    rc = (int) fwrite (stream_data, 1, stream_size, file);
+    assert (rc == (int) stream_size);
+    fclose (file);
+    rc = zyre_send_file (node1, zyre_uuid (node2), filename, "object");
+    assert (rc == 0);
+    s_test_take_stream (node2, "object", stream_data, stream_size);
+
+    //  And streams the same data from memory
+    zframe_t *stream_frame = zframe_new (stream_data, stream_size);
+    rc = zyre_send_stream (node1, zyre_uuid (node2), "memory", &stream_frame);
+    assert (rc == 0);
+    assert (stream_frame == NULL);
+    s_test_take_stream (node2, "memory", stream_data, stream_size);
+
+    //  Neither works to a peer that is not there
+    rc = zyre_send_file (node1, "NOT A PEER", filename, "object");
+    assert (rc == -1);
+    stream_frame = zframe_new (stream_data, stream_size);
+    rc = zyre_send_stream (node1, "NOT A PEER", "memory", &stream_frame);
+    assert (rc == -1);
+    assert (stream_frame == NULL);
+    zsys_file_delete (filename);
+    rc = zyre_send_file (node1, zyre_uuid (node2), filename, "object");
+    assert (rc == -1);
+    zstr_free (&filename);
+    free (stream_data);
+
     // Test evasive timeout
     const int evasive_test_interval = 100;
     zyre_set_evasive_timeout (node1, evasive_test_interval);
@@ -962,6 +2204,461 @@ zyre_test (bool verbose)
     zyre_destroy (&node1);
     zyre_destroy (&node2);
 
+    //  Each way of running a node gets a node of its own, against a plain
+    //  node: sending through worker threads
+    zyre_t *node = zyre_new ("workers");
+    assert (node);
+    zyre_set_workers (node, 2);
+    s_test_mode (&node, verbose);
+
+    //  Taking one message at a time, as if there were no bursts
+    node = zyre_new ("recv-budget");
+    assert (node);
+    zyre_set_recv_budget (node, 1);
+    s_test_mode (&node, verbose);
+
+    //  Sending to all peers through one shared mailbox
+    node = zyre_new ("shared-mailbox");
+    assert (node);
+    zyre_set_shared_mailbox (node);
+    s_test_mode (&node, verbose);
+
+    //  Connecting to new peers through the connect scheduler
+    node = zyre_new ("connect-rate");
+    assert (node);
+    zyre_set_connect_rate (node, 10);
+    zyre_set_max_handshakes (node, 1);
+    s_test_mode (&node, verbose);
+
+    //  Running in our own thread, in our own poll loop, where methods that
+    //  wait on the node still get their answers
+    node = zyre_new_embedded ("embedded");
+    assert (node);
+    assert (streq (zyre_name (node), "embedded"));
+    zyre_t *partner = zyre_new ("embedded-partner");
+    assert (partner);
+    s_test_start (node, node, NULL, verbose);
+    s_test_start (partner, node, NULL, verbose);
+    zyre_join (node, "GLOBAL");
+    zyre_join (partner, "GLOBAL");
+    msg = s_test_step_until (node, "JOIN");
+    zmsg_first (msg);
+    assert (zframe_streq (zmsg_next (msg), zyre_uuid (partner)));
+    zmsg_destroy (&msg);
+    peers = zyre_peers (node);
+    assert (zlist_size (peers) == 1);
+    assert (streq ((char *) zlist_first (peers), zyre_uuid (partner)));
+    zlist_destroy (&peers);
+
+    //  Once the node is idle, a SHOUT from the partner makes the descriptor
+    //  readable, and zyre_recv steps the node until it has the event
+    while (zyre_timeout (node) == 0)
+        zyre_step (node, 0);
+    zyre_shouts (partner, "GLOBAL", "Hello, embedded");
+    if (zyre_fd (node) != -1) {
+        zmq_pollitem_t item = { NULL, zyre_fd (node), ZMQ_POLLIN, 0 };
+        rc = zmq_poll (&item, 1, 5000);
+        assert (rc == 1);
+    }
+    msg = s_test_expect (node, "SHOUT");
+    assert (zframe_streq (zmsg_last (msg), "Hello, embedded"));
+    zmsg_destroy (&msg);
+
+    //  Sends go out when the node next steps
+    zyre_whispers (node, zyre_uuid (partner), "Hello, partner");
+    rc = zyre_step (node, 0);
+    assert (rc == 0);
+    msg = s_test_expect (partner, "WHISPER");
+    assert (zframe_streq (zmsg_last (msg), "Hello, partner"));
+    zmsg_destroy (&msg);
+
+    zyre_stop (partner);
+    zyre_stop (node);
+    zyre_destroy (&partner);
+    zyre_destroy (&node);
+
+    //  Nodes in this process that both go direct hand each other messages
+    //  by pointer, with the same events as over libzmq
+    node = zyre_new ("direct");
+    assert (node);
+    partner = zyre_new ("direct-partner");
+    assert (partner);
+    zyre_set_direct (node);
+    zyre_set_direct (partner);
+    s_test_pair (node, partner, NULL, verbose);
+    s_test_exchange (node, partner);
+    zyre_stop (partner);
+    zyre_stop (node);
+    zyre_destroy (&partner);
+    zyre_destroy (&node);
+
+#if defined (__UNIX__)
+    //  Nodes on loopback TCP that opt in move each other to IPC; messages
+    //  keep their order across the move, and the socket files go with the
+    //  nodes
+    node = zyre_new ("ipc-upgrade");
+    assert (node);
+    partner = zyre_new ("ipc-upgrade-partner");
+    assert (partner);
+    zyre_set_ipc_upgrade (node);
+    zyre_set_ipc_upgrade (partner);
+    s_test_pair (node, partner, "tcp://127.0.0.1:*", verbose);
+    char *node_ipc = zsys_sprintf ("/tmp/zyre-%s", zyre_uuid (node));
+    char *partner_ipc = zsys_sprintf ("/tmp/zyre-%s", zyre_uuid (partner));
+    assert (zsys_file_exists (node_ipc));
+    assert (zsys_file_exists (partner_ipc));
+    //  Once while the move may be under way, and once after
+    s_test_exchange (node, partner);
+    zclock_sleep (250);
+    s_test_exchange (node, partner);
+    zyre_stop (partner);
+    zyre_stop (node);
+    zyre_destroy (&partner);
+    zyre_destroy (&node);
+    assert (!zsys_file_exists (node_ipc));
+    assert (!zsys_file_exists (partner_ipc));
+    zstr_free (&node_ipc);
+    zstr_free (&partner_ipc);
+#endif
+
+    //  A node that sends in bulk to a peer that can't keep up keeps that
+    //  peer past the expiry time, as its PINGs and the answers don't wait
+    //  behind the data; a peer without the control lane is lost
+    assert (s_test_bulk (true, verbose));
+    assert (!s_test_bulk (false, verbose));
+
+#if defined (HAVE_LIBZSTD)
+    //  Large frames go to a peer that takes zstd compressed, and come out
+    //  as they went in; small frames go as they are
+    node = zyre_new ("zstd");
+    assert (node);
+    partner = zyre_new ("zstd-partner");
+    assert (partner);
+    zyre_set_compression (node, 1024, 0);
+    s_test_pair (node, partner, NULL, verbose);
+    size_t text_size = 64 * 1024;
+    char *text = (char *) zmalloc (text_size);
+    size_t text_at;
+    for (text_at = 0; text_at < text_size; text_at++)
+        text [text_at] = "Zyre zstd "[text_at % 10];
+    msg = zmsg_new ();
+    zmsg_addmem (msg, text, text_size);
+    zmsg_addstr (msg, "small");
+    rc = zyre_whisper (node, zyre_uuid (partner), &msg);
+    assert (rc == 0);
+    msg = zmsg_new ();
+    zmsg_addmem (msg, text, text_size);
+    rc = zyre_shout (node, "GLOBAL", &msg);
+    assert (rc == 0);
+
+    msg = s_test_expect (partner, "WHISPER");
+    assert (zmsg_size (msg) == 5);
+    zmsg_first (msg);                   //  Command
+    zmsg_next (msg);                    //  Peer UUID
+    zmsg_next (msg);                    //  Peer name
+    zframe_t *frame = zmsg_next (msg);
+    assert (zframe_size (frame) == text_size);
+    assert (memcmp (zframe_data (frame), text, text_size) == 0);
+    assert (zframe_streq (zmsg_next (msg), "small"));
+    zmsg_destroy (&msg);
+    msg = s_test_expect (partner, "SHOUT");
+    frame = zmsg_last (msg);
+    assert (zframe_size (frame) == text_size);
+    assert (memcmp (zframe_data (frame), text, text_size) == 0);
+    zmsg_destroy (&msg);
+    free (text);
+
+    zhash_t *stats = zyre_stats (node);
+    assert (stats);
+    uint64_t bytes_in = strtoull ((char *) zhash_lookup (stats, "compress-bytes-in"), NULL, 10);
+    uint64_t bytes_out = strtoull ((char *) zhash_lookup (stats, "compress-bytes-out"), NULL, 10);
+    assert (bytes_in == 2 * text_size);
+    assert (bytes_out < bytes_in);
+    zhash_destroy (&stats);
+    zyre_stop (partner);
+    zyre_stop (node);
+    zyre_destroy (&partner);
+    zyre_destroy (&node);
+#endif
+
+#if defined (ZMQ_DISH) && defined (CZMQ_BUILD_DRAFT_API)
+    //  A listener that finds a gap in a sender's multicast SHOUTs takes the
+    //  group back over TCP, without losing or repeating any. The sender
+    //  makes the gap by multicasting for a while where only a third node
+    //  listens. Multicast needs a network interface, as beacons do.
+    zactor_t *probe = zactor_new (zbeacon, NULL);
+    assert (probe);
+    zsock_send (probe, "si", "CONFIGURE", 9999);
+    char *hostname = zstr_recv (probe);
+    zactor_destroy (&probe);
+    if (hostname && *hostname) {
+        zyre_t *sender = zyre_new ("multicast");
+        assert (sender);
+        zyre_t *listener = zyre_new ("multicast-listener");
+        assert (listener);
+        zyre_t *other = zyre_new ("multicast-other");
+        assert (other);
+        zyre_set_multicast (listener, "WIDE", "udp://239.192.1.1:5670");
+        zyre_set_multicast (other, "WIDE", "udp://239.192.1.2:5671");
+        s_test_start (sender, sender, NULL, verbose);
+        s_test_start (listener, sender, NULL, verbose);
+        s_test_start (other, sender, NULL, verbose);
+        //  The listener tells the sender where it listens as it joins, so
+        //  the sender takes the same endpoint and joins first
+        zyre_set_multicast (sender, "WIDE", "udp://239.192.1.1:5670");
+        zyre_join (sender, "WIDE");
+        msg = s_test_expect (listener, "JOIN");
+        zmsg_destroy (&msg);
+        zyre_join (listener, "WIDE");
+        msg = s_test_expect (sender, "JOIN");
+        zmsg_destroy (&msg);
+        //  Let the sender's MULTICAST-OK reach the listener
+        zclock_sleep (250);
+        zyre_shouts (sender, "WIDE", "One");
+        msg = s_test_expect (listener, "SHOUT");
+        assert (zframe_streq (zmsg_last (msg), "One"));
+        zmsg_destroy (&msg);
+
+        //  The sender multicasts Two to the other node, and sends it to
+        //  the listener over TCP; the other node joins once the sender is
+        //  on its endpoint, which a round trip to the sender makes sure of
+        zyre_set_multicast (sender, "WIDE", "udp://239.192.1.2:5671");
+        zlist_t *groups = zyre_own_groups (sender);
+        zlist_destroy (&groups);
+        zyre_join (other, "WIDE");
+        msg = s_test_expect (sender, "JOIN");
+        zmsg_destroy (&msg);
+        zclock_sleep (250);
+        zyre_shouts (sender, "WIDE", "Two");
+        msg = s_test_expect (listener, "SHOUT");
+        assert (zframe_streq (zmsg_last (msg), "Two"));
+        zmsg_destroy (&msg);
+
+        //  Back on the listener's endpoint, Three comes after a gap
+        zyre_set_multicast (sender, "WIDE", "udp://239.192.1.1:5670");
+        zyre_shouts (sender, "WIDE", "Three");
+        zyre_shouts (sender, "WIDE", "Four");
+        zclock_sleep (250);
+        zyre_shouts (sender, "WIDE", "Five");
+        msg = s_test_expect (listener, "SHOUT");
+        assert (zframe_streq (zmsg_last (msg), "Three"));
+        zmsg_destroy (&msg);
+        msg = s_test_expect (listener, "SHOUT");
+        assert (zframe_streq (zmsg_last (msg), "Four"));
+        zmsg_destroy (&msg);
+        msg = s_test_expect (listener, "SHOUT");
+        assert (zframe_streq (zmsg_last (msg), "Five"));
+        zmsg_destroy (&msg);
+
+        zyre_stop (other);
+        zyre_stop (listener);
+        zyre_stop (sender);
+        zyre_destroy (&other);
+        zyre_destroy (&listener);
+        zyre_destroy (&sender);
+    }
+    zstr_free (&hostname);
+#endif
+
+    //  SHOUTs down a relay tree of fan-out 1 reach each peer once and in
+    //  order, as from the node that sent them
+    zyre_t *relay_nodes [4];
+    int relay_nbr;
+    for (relay_nbr = 0; relay_nbr < 4; relay_nbr++) {
+        char *relay_name = zsys_sprintf ("relay-%d", relay_nbr);
+        relay_nodes [relay_nbr] = zyre_new (relay_name);
+        assert (relay_nodes [relay_nbr]);
+        zstr_free (&relay_name);
+        s_test_start (relay_nodes [relay_nbr], relay_nodes [0], NULL, verbose);
+        zyre_join (relay_nodes [relay_nbr], "TREE");
+    }
+    zyre_set_relay (relay_nodes [0], "TREE", 1);
+    //  Relays only go to, and come from, peers known to be in the group
+    for (relay_nbr = 0; relay_nbr < 4; relay_nbr++) {
+        int joins;
+        for (joins = 0; joins < 3; joins++) {
+            msg = s_test_expect (relay_nodes [relay_nbr], "JOIN");
+            zmsg_destroy (&msg);
+        }
+    }
+    zyre_shouts (relay_nodes [0], "TREE", "Relayed");
+    zyre_shouts (relay_nodes [0], "TREE", "After");
+    for (relay_nbr = 1; relay_nbr < 4; relay_nbr++) {
+        msg = s_test_expect (relay_nodes [relay_nbr], "SHOUT");
+        zmsg_first (msg);
+        assert (zframe_streq (zmsg_next (msg), zyre_uuid (relay_nodes [0])));
+        assert (zframe_streq (zmsg_last (msg), "Relayed"));
+        zmsg_destroy (&msg);
+        msg = s_test_expect (relay_nodes [relay_nbr], "SHOUT");
+        assert (zframe_streq (zmsg_last (msg), "After"));
+        zmsg_destroy (&msg);
+    }
+    for (relay_nbr = 3; relay_nbr >= 0; relay_nbr--) {
+        zyre_stop (relay_nodes [relay_nbr]);
+        zyre_destroy (&relay_nodes [relay_nbr]);
+    }
+
+    //  A header set after start goes in the HELLO to peers that come
+    //  later, and a change after that reaches them as HEADER-UPDATE
+    node = zyre_new ("late-headers");
+    assert (node);
+    partner = zyre_new ("late-headers-partner");
+    assert (partner);
+    s_test_start (node, node, NULL, verbose);
+    zyre_set_header (node, "X-LATE", "first");
+    s_test_start (partner, node, NULL, verbose);
+    msg = s_test_expect (partner, "ENTER");
+    assert (zmsg_size (msg) == 5);
+    zmsg_first (msg);                   //  Command
+    zmsg_next (msg);                    //  Peer UUID
+    zmsg_next (msg);                    //  Peer name
+    headers = zhash_unpack (zmsg_next (msg));
+    assert (headers);
+    assert (streq ((char *) zhash_lookup (headers, "X-LATE"), "first"));
+    zhash_destroy (&headers);
+    zmsg_destroy (&msg);
+    //  The partner may also get the first value again, if the node sent
+    //  its HELLO before it sent its held-back changes
+    zyre_set_header (node, "X-LATE", "second");
+    while (true) {
+        msg = s_test_expect (partner, "HEADER-UPDATE");
+        headers = zhash_unpack (zmsg_last (msg));
+        assert (headers);
+        const char *late = (const char *) zhash_lookup (headers, "X-LATE");
+        bool second = late && streq (late, "second");
+        zhash_destroy (&headers);
+        zmsg_destroy (&msg);
+        if (second)
+            break;
+    }
+    value = zyre_peer_header_value (partner, zyre_uuid (node), "X-LATE");
+    assert (value && streq (value, "second"));
+    zstr_free (&value);
+    zyre_stop (partner);
+    zyre_stop (node);
+    zyre_destroy (&partner);
+    zyre_destroy (&node);
+
+    //  A node that only takes WHISPERs gets no ENTER, JOIN, SHOUT or EXIT,
+    //  but still gets STOP
+    node = zyre_new ("event-filter");
+    assert (node);
+    partner = zyre_new ("event-filter-partner");
+    assert (partner);
+    zyre_set_event_filter (node, ZYRE_EVENT_WHISPER);
+    s_test_start (node, node, NULL, verbose);
+    s_test_start (partner, node, NULL, verbose);
+    zyre_join (node, "GLOBAL");
+    zyre_join (partner, "GLOBAL");
+    msg = s_test_expect (partner, "JOIN");
+    zmsg_destroy (&msg);
+    zyre_shouts (partner, "GLOBAL", "Filtered");
+    zyre_whispers (partner, zyre_uuid (node), "Kept");
+    msg = zyre_recv (node);
+    assert (msg);
+    assert (zframe_streq (zmsg_first (msg), "WHISPER"));
+    assert (zframe_streq (zmsg_last (msg), "Kept"));
+    zmsg_destroy (&msg);
+    zyre_stop (partner);
+    zyre_stop (node);
+    msg = zyre_recv (node);
+    assert (msg);
+    assert (zframe_streq (zmsg_first (msg), "STOP"));
+    zmsg_destroy (&msg);
+    zyre_destroy (&partner);
+    zyre_destroy (&node);
+
+    //  A client anycasts to a group of two workers: round robin takes each
+    //  in turn, a key always goes to its owner, and least outstanding picks
+    //  the worker with fewer requests it hasn't answered
+    zyre_t *client = zyre_new ("anycast");
+    assert (client);
+    zyre_t *worker1 = zyre_new ("anycast-worker1");
+    assert (worker1);
+    zyre_t *worker2 = zyre_new ("anycast-worker2");
+    assert (worker2);
+    s_test_start (client, client, NULL, verbose);
+    s_test_start (worker1, client, NULL, verbose);
+    s_test_start (worker2, client, NULL, verbose);
+    zyre_join (worker1, "WORK");
+    zyre_join (worker2, "WORK");
+    msg = s_test_expect (client, "JOIN");
+    zmsg_destroy (&msg);
+    msg = s_test_expect (client, "JOIN");
+    zmsg_destroy (&msg);
+
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Round");
+    rc = zyre_anycast (client, "WORK", NULL, &msg);
+    assert (rc == 0);
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Robin");
+    rc = zyre_anycast (client, "WORK", NULL, &msg);
+    assert (rc == 0);
+    msg = s_test_expect (worker1, "WHISPER");
+    zmsg_destroy (&msg);
+    msg = s_test_expect (worker2, "WHISPER");
+    zmsg_destroy (&msg);
+
+    owner = zyre_group_owner (client, "WORK", "sticky");
+    assert (owner);
+    zyre_t *keeper = streq (owner, zyre_uuid (worker1))? worker1: worker2;
+    zstr_free (&owner);
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Sticky 1");
+    rc = zyre_anycast (client, "WORK", "sticky", &msg);
+    assert (rc == 0);
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Sticky 2");
+    rc = zyre_anycast (client, "WORK", "sticky", &msg);
+    assert (rc == 0);
+    msg = s_test_expect (keeper, "WHISPER");
+    assert (zframe_streq (zmsg_last (msg), "Sticky 1"));
+    zmsg_destroy (&msg);
+    msg = s_test_expect (keeper, "WHISPER");
+    assert (zframe_streq (zmsg_last (msg), "Sticky 2"));
+    zmsg_destroy (&msg);
+
+    zyre_set_anycast_policy (client, "WORK", ZYRE_ANYCAST_LEAST_OUTSTANDING);
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Job 1");
+    request = zyre_anycast_request (client, "WORK", NULL, 5000, &msg);
+    assert (request);
+    zyre_t *busy = s_test_expect_either (worker1, worker2, "REQUEST", &msg);
+    zmsg_destroy (&msg);
+    zyre_t *idle = busy == worker1? worker2: worker1;
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Job 2");
+    request = zyre_anycast_request (client, "WORK", NULL, 5000, &msg);
+    assert (request);
+    msg = s_test_expect (idle, "REQUEST");
+    zmsg_destroy (&msg);
+    //  A WHISPER is not an answer, so the busy worker stays busy, while
+    //  the idle one answers its request
+    zyre_whispers (busy, zyre_uuid (client), "Not an answer");
+    msg = s_test_expect (client, "WHISPER");
+    zmsg_destroy (&msg);
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Done");
+    rc = zyre_reply (idle, zyre_uuid (client), request, &msg);
+    assert (rc == 0);
+    msg = s_test_expect (client, "REPLY");
+    zmsg_destroy (&msg);
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Job 3");
+    request = zyre_anycast_request (client, "WORK", NULL, 5000, &msg);
+    assert (request);
+    msg = s_test_expect (idle, "REQUEST");
+    assert (zframe_streq (zmsg_last (msg), "Job 3"));
+    zmsg_destroy (&msg);
+
+    zyre_stop (worker2);
+    zyre_stop (worker1);
+    zyre_stop (client);
+    zyre_destroy (&worker2);
+    zyre_destroy (&worker1);
+    zyre_destroy (&client);
+
     printf ("OK\n");
 
     if (zsys_has_curve()){
@@ -1191,6 +2888,42 @@ zyre_test (bool verbose)
 
         zyre_destroy (&node5);
         zyre_destroy (&node6);
+
+        //  A node that needs CURVE takes no messages by pointer, so a node
+        //  in this process that goes direct can't skip the handshake
+        zyre_t *guarded = zyre_new ("guarded");
+        zyre_t *intruder = zyre_new ("intruder");
+        assert (guarded);
+        assert (intruder);
+        if (verbose) {
+            zyre_set_verbose (guarded);
+            zyre_set_verbose (intruder);
+        }
+        zcert_t *guarded_cert = zcert_new ();
+        assert (guarded_cert);
+        zyre_set_zcert (guarded, guarded_cert);
+        zyre_set_zap_domain (guarded, "TEST");
+        zyre_set_direct (guarded);
+        zyre_set_direct (intruder);
+        rc = zyre_set_endpoint (guarded, "tcp://127.0.0.1:9002");
+        assert (rc == 0);
+        rc = zyre_set_endpoint (intruder, "inproc://zyre-intruder");
+        assert (rc == 0);
+        rc = zyre_start (guarded);
+        assert (rc == 0);
+        rc = zyre_start (intruder);
+        assert (rc == 0);
+        zyre_require_peer (intruder, zyre_uuid (guarded), "tcp://127.0.0.1:9002",
+                           zcert_public_txt (guarded_cert));
+        zpoller_t *poller = zpoller_new (zyre_socket (guarded), NULL);
+        assert (zpoller_wait (poller, 1000) == NULL);
+        zpoller_destroy (&poller);
+
+        zyre_stop (intruder);
+        zyre_stop (guarded);
+        zyre_destroy (&intruder);
+        zyre_destroy (&guarded);
+        zcert_destroy (&guarded_cert);
         zactor_destroy (&auth);
 #if defined (__WINDOWS__)
     zsys_shutdown();
@@ -76,6 +76,44 @@ typedef struct _zyre_node_t zyre_node_t;
 // Default ZAP domain (auth)
 #define ZAP_DOMAIN_DEFAULT	"global"
 
+//  *** Draft constants, defined for internal use only ***
+#define ZYRE_EVENT_ENTER        1        // A peer has joined the network
+#define ZYRE_EVENT_EXIT         2        // A peer has left the network
+#define ZYRE_EVENT_JOIN         4        // A peer has joined a group
+#define ZYRE_EVENT_LEAVE        8        // A peer has left a group
+#define ZYRE_EVENT_EVASIVE      16       // A peer is being evasive
+#define ZYRE_EVENT_SILENT       32       // A peer has not answered our ping
+#define ZYRE_EVENT_LEADER       64       // A group has elected a leader
+#define ZYRE_EVENT_WHISPER      128      // A peer sent us a message
+#define ZYRE_EVENT_SHOUT        256      // A peer sent a message to a group
+#define ZYRE_EVENT_STREAM       512      // A peer sent us part of a stream
+#define ZYRE_EVENT_REQUEST      1024     // A peer sent us a request
+#define ZYRE_EVENT_REPLY        2048     // A peer answered our request, or will not
+#define ZYRE_EVENT_HEADER_UPDATE 4096    // A peer changed its headers
+#define ZYRE_EVENT_HISTORY      8192     // A peer replayed a message it sent a group
+#define ZYRE_EVENT_STEP_DOWN   16384    // We stopped leading a group
+#define ZYRE_EVENT_ALL          32767    // All of the above
+#define ZYRE_ANYCAST_ROUND_ROBIN 0       // Send to each member in turn
+#define ZYRE_ANYCAST_RANDOM     1        // Send to a member at random
+#define ZYRE_ANYCAST_LEAST_OUTSTANDING 2  // Send to the member with fewest unanswered requests
+
+//  *** Draft callbacks, defined for internal use only ***
+// Called on the node's own thread for each event, instead of queuing the
+// event for zyre_recv. The event has the same frames zyre_recv would
+// return. The handler borrows the event and must not keep or destroy it,
+// and must not call zyre methods on the node, see zyre_set_handler.
+typedef void (zyre_handler_fn) (
+    zmsg_t *event, void *arg);
+
+
+//  *** Draft method, defined for internal use only ***
+//  Constructor, creates a new Zyre node that runs in the caller's thread
+//  rather than a thread of its own, so an application can run it in its own
+//  event loop. Wait until zyre_fd is readable, or for zyre_timeout msecs,
+//  then call zyre_step; read events from zyre_socket after each step. All
+//  other methods work as for zyre_new, from the same thread.
+ZYRE_PRIVATE zyre_t *
+    zyre_new_embedded (const char *name);
 
 //  *** Draft method, defined for internal use only ***
 //  Set the TCP port bound by the ROUTER peer-to-peer socket (beacon mode).
@@ -101,6 +139,362 @@ ZYRE_PRIVATE int
 ZYRE_PRIVATE void *
     zyre_socket_zmq (zyre_t *self);
 
+//  *** Draft method, defined for internal use only ***
+//  Set a leader lease for the given group, in milliseconds. The elected leader
+//  renews its lease with any traffic it sends to the group, falling back to a
+//  PING every third of the lease, and followers that contest the group start
+//  a new election as soon as the lease lapses, rather than waiting for the
+//  leader to expire. A leader that has not heard from a majority of the group
+//  for a whole lease, or that learns the others let its lease lapse, stops
+//  leading and emits STEP-DOWN. It leads again only by winning a new election.
+//  Set the same lease on every peer of the group. Default is 0, meaning
+//  leadership is only lost when the leader leaves or expires.
+ZYRE_PRIVATE void
+    zyre_set_leader_lease (zyre_t *self, const char *group, int interval);
+
+//  *** Draft method, defined for internal use only ***
+//  Limit the rate at which the node connects to new peers, in connects per
+//  second. Peers beyond the rate are queued, and peers that share one of our
+//  groups are connected first. Default is 0, meaning no limit.
+ZYRE_PRIVATE void
+    zyre_set_connect_rate (zyre_t *self, int rate);
+
+//  *** Draft method, defined for internal use only ***
+//  Limit the number of peer connects the node has in flight, that is peers
+//  we connected to that have not yet greeted us. Default is 0, meaning no
+//  limit.
+ZYRE_PRIVATE void
+    zyre_set_max_handshakes (zyre_t *self, int max);
+
+//  *** Draft method, defined for internal use only ***
+//  Spread the node's peer mailboxes over this many worker threads, which
+//  then do the sending to peers, including SHOUT fan-out. Default is 0,
+//  meaning the node thread sends to all peers. Call before zyre_start.
+ZYRE_PRIVATE void
+    zyre_set_workers (zyre_t *self, int workers);
+
+//  *** Draft method, defined for internal use only ***
+//  Send to all peers through one shared ROUTER socket, instead of one
+//  DEALER socket per peer. This saves a socket, a send queue and a pipe per
+//  peer, which matters in large meshes. Needs libzmq with
+//  ZMQ_CONNECT_ROUTING_ID (4.3 or later); otherwise the node keeps one
+//  socket per peer. Ignored if the node has worker threads. Call before
+//  zyre_start.
+ZYRE_PRIVATE void
+    zyre_set_shared_mailbox (zyre_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Exchange messages by pointer with other nodes in this process that
+//  also call this, instead of encoding them and sending them through
+//  libzmq. Sequencing and events stay the same. Ignored if the node uses
+//  CURVE. Call before zyre_start.
+ZYRE_PRIVATE void
+    zyre_set_direct (zyre_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Deliver events to a handler on the node's own thread, instead of through
+//  zyre_recv. This saves a pipe hop, a thread wakeup and a copy per event.
+//  The node does nothing else while the handler runs, so the handler must
+//  return quickly, and must not call any zyre method on this node: the
+//  node can't read its pipe while it runs the handler, so a call that
+//  waits on the node, or a send that fills the pipe, blocks forever. To
+//  answer events, hand them to another thread. Pass a NULL handler to go
+//  back to zyre_recv.
+//  Events queued before the call stay readable with zyre_recv.
+ZYRE_PRIVATE void
+    zyre_set_handler (zyre_t *self, zyre_handler_fn handler, void *arg);
+
+//  *** Draft method, defined for internal use only ***
+//  Choose the events the node delivers, as a mask of ZYRE_EVENT_* flags.
+//  The node drops other events before they reach the application. STOP is
+//  always delivered. Default is ZYRE_EVENT_ALL.
+ZYRE_PRIVATE void
+    zyre_set_event_filter (zyre_t *self, int mask);
+
+//  *** Draft method, defined for internal use only ***
+//  Deliver SHOUT events only for groups whose names start with one of the
+//  prefixes subscribed to. With no subscriptions, which is the default,
+//  SHOUTs from all our groups are delivered.
+ZYRE_PRIVATE void
+    zyre_subscribe_shouts (zyre_t *self, const char *prefix);
+
+//  *** Draft method, defined for internal use only ***
+//  Remove a prefix added with zyre_subscribe_shouts.
+ZYRE_PRIVATE void
+    zyre_unsubscribe_shouts (zyre_t *self, const char *prefix);
+
+//  *** Draft method, defined for internal use only ***
+//  Limit the events the node holds for the application when zyre_recv
+//  falls behind, by count and by total size in bytes; 0 means no limit.
+//  The node never waits for the application. When it is over a limit it
+//  drops the oldest WHISPER, SHOUT, EVASIVE and SILENT events it holds,
+//  and keeps every other event, such as ENTER, LEADER or REQUEST. The
+//  outbox pipe holds up to ZSYS_PIPEHWM more events. Default is no limit.
+ZYRE_PRIVATE void
+    zyre_set_outbox_limits (zyre_t *self, int max_events, int max_bytes);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the number of events the node dropped because the application
+//  fell behind, since the node was created.
+ZYRE_PRIVATE uint64_t
+    zyre_events_dropped (zyre_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Stream a file to a peer, in chunks, without holding it in memory. The
+//  peer gets the file under the given name, or under the file's own name
+//  if name is NULL. Returns 0 if OK, -1 if the file cannot be read, or the
+//  peer is not there or does not run a node that supports streams.
+ZYRE_PRIVATE int
+    zyre_send_file (zyre_t *self, const char *peer, const char *path, const char *name);
+
+//  *** Draft method, defined for internal use only ***
+//  Stream an object we hold in memory to a peer, in chunks, under the given
+//  name. The node takes the frame without a copy, and destroys it once the
+//  peer has it all; the peer only holds a window of chunks at a time.
+//  Returns 0 if OK, -1 if the peer is not there or does not run a node
+//  that supports streams. Either way, the frame is gone.
+ZYRE_PRIVATE int
+    zyre_send_stream (zyre_t *self, const char *peer, const char *name, zframe_t **frame_p);
+
+//  *** Draft method, defined for internal use only ***
+//  Write streams that peers send us to files in this directory, instead
+//  of passing their chunks up as STREAM events. Pass NULL to go back to
+//  STREAM events. A file takes the name the sender gives the stream, or
+//  a name of our own if that has a / or .. in it. It only appears once
+//  the stream is complete, and never replaces a file that is there;
+//  the STREAM event tells where it is.
+ZYRE_PRIVATE void
+    zyre_set_stream_sink (zyre_t *self, const char *path);
+
+//  *** Draft method, defined for internal use only ***
+//  Compress message frames of at least threshold bytes with zstd, at the
+//  given level, when sending WHISPER and SHOUT messages to peers that
+//  support it. Level 0 means zstd's default. Other peers get the frames
+//  as they are. Default threshold is 0, meaning no compression. Has no
+//  effect if Zyre was built without libzstd.
+ZYRE_PRIVATE void
+    zyre_set_compression (zyre_t *self, int threshold, int level);
+
+//  *** Draft method, defined for internal use only ***
+//  Compress with this zstd dictionary, as trained by zstd --train, which
+//  helps with many small, similar messages. Peers use the dictionary for
+//  our frames only if they have set the same one. Call before zyre_start.
+ZYRE_PRIVATE void
+    zyre_set_compression_dict (zyre_t *self, const byte *dict, size_t dict_size);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the node's counters, as a hash of name to value: events-dropped,
+//  compress-bytes-in, compress-bytes-out, compress-ratio, compress-usecs,
+//  decompress-usecs, and recv-bursts and recv-messages, the wakeups that
+//  took messages from peers and how many they took.
+//  Caller owns return value and must destroy it when done.
+ZYRE_PRIVATE zhash_t *
+    zyre_stats (zyre_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Send SHOUTs to a group by UDP multicast on this endpoint, such as
+//  udp://239.192.1.1:5670, to the peers that listen for them there, and
+//  listen there for the group's SHOUTs from other peers. Peers that don't
+//  listen get SHOUTs over TCP, as do all peers for SHOUTs too large for one
+//  datagram. A peer that finds it lost a multicast SHOUT goes back to TCP
+//  for the group. Set the same endpoint on every peer of the group. Pass
+//  NULL to stop. Needs libzmq with draft RADIO/DISH sockets, and is ignored
+//  if the node uses CURVE.
+ZYRE_PRIVATE void
+    zyre_set_multicast (zyre_t *self, const char *group, const char *endpoint);
+
+//  *** Draft method, defined for internal use only ***
+//  Send SHOUTs to a group down a relay tree, instead of to each peer in
+//  turn. We send each SHOUT to at most fanout peers, each of which passes
+//  it on to at most fanout more, and so on, so that the cost of SHOUTs to
+//  very large groups is spread over the group, for a hop per level of the
+//  tree. Peers that cannot relay still get SHOUTs from us directly. Other
+//  nodes relay our SHOUTs whatever they set themselves. Default is 0,
+//  meaning no relay tree. A SHOUT that comes down a relay tree names the
+//  node it came from, as the peers that relayed it tell us; we only check
+//  that the node is in the group, so the name is only as good as the
+//  peers that relay.
+ZYRE_PRIVATE void
+    zyre_set_relay (zyre_t *self, const char *group, int fanout);
+
+//  *** Draft method, defined for internal use only ***
+//  Send message to one peer in a named group, chosen by the group's anycast
+//  policy, or by key if not NULL, so that messages with the same key go to
+//  the same peer for as long as it stays in the group. The peer gets the
+//  message as a WHISPER. Drops the message if the group has no peers.
+//  Destroys message after sending
+ZYRE_PRIVATE int
+    zyre_anycast (zyre_t *self, const char *group, const char *key, zmsg_t **msg_p);
+
+//  *** Draft method, defined for internal use only ***
+//  Set how we choose the peer in a group to anycast to: one of
+//  ZYRE_ANYCAST_ROUND_ROBIN, the default, ZYRE_ANYCAST_RANDOM, or
+//  ZYRE_ANYCAST_LEAST_OUTSTANDING, which picks the peer with fewest requests
+//  we sent it that it has not yet answered, see zyre_anycast_request.
+ZYRE_PRIVATE void
+    zyre_set_anycast_policy (zyre_t *self, const char *group, int policy);
+
+//  *** Draft method, defined for internal use only ***
+//  Send a request to one peer in a named group, chosen as zyre_anycast
+//  chooses, and return the request's number, or 0 if we could not send it.
+//  We get the answer as a REPLY or NOREPLY event, as for zyre_request; if
+//  the group has no peers, we get a NOREPLY with reason "unknown". Destroys
+//  message after sending
+ZYRE_PRIVATE uint64_t
+    zyre_anycast_request (zyre_t *self, const char *group, const char *key, int timeout, zmsg_t **msg_p);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the UUID of the peer that owns key in a named group, or NULL if
+//  the group has no peers. The node keeps a consistent-hash ring for each
+//  group, so a key only moves to another peer when its owner leaves, or a
+//  new peer takes over part of its range. Looks up the node's ring
+//  directly, without a round trip to the node, except on the first call.
+//  Caller owns return value and must destroy it when done.
+ZYRE_PRIVATE char *
+    zyre_group_owner (zyre_t *self, const char *group, const char *key);
+
+//  *** Draft method, defined for internal use only ***
+//  Send message to the peer that owns key in a named group, as by
+//  zyre_group_owner, as a WHISPER. Drops the message if the group has no
+//  peers. Destroys message after sending
+ZYRE_PRIVATE int
+    zyre_whisper_owner (zyre_t *self, const char *group, const char *key, zmsg_t **msg_p);
+
+//  *** Draft method, defined for internal use only ***
+//  Send a request to a single peer specified as UUID string, and return
+//  the request's number, or 0 if we could not send it. The peer gets a
+//  REQUEST event and answers with zyre_reply; we get its answer as a REPLY
+//  event with the same number. If the peer is unknown or cannot take
+//  requests, leaves, or does not answer within timeout msecs, we get a
+//  NOREPLY event instead. A timeout of 0 means wait as long as the peer is
+//  there. Destroys message after sending
+ZYRE_PRIVATE uint64_t
+    zyre_request (zyre_t *self, const char *peer, int timeout, zmsg_t **msg_p);
+
+//  *** Draft method, defined for internal use only ***
+//  Answer a request from a peer specified as UUID string, by the number
+//  in its REQUEST event. The peer drops replies that come too late.
+//  Destroys message after sending
+ZYRE_PRIVATE int
+    zyre_reply (zyre_t *self, const char *peer, uint64_t request, zmsg_t **msg_p);
+
+//  *** Draft method, defined for internal use only ***
+//  Write a value to the replicated store of a named group, or delete the
+//  key if value is NULL. Each group we are in has a key-value store that
+//  all its members keep a copy of. Writes go to the other members as they
+//  happen, and members that join catch up on the writes they missed. The
+//  latest write to a key wins, so all members end up with the same
+//  values. Returns once our own copy has the write.
+ZYRE_PRIVATE void
+    zyre_store_set (zyre_t *self, const char *group, const char *key, const char *value);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the value of key in the replicated store of a named group, or
+//  NULL if there is no such key. Reads our own copy directly, without a
+//  round trip to the node, except on the first call.
+//  Caller owns return value and must destroy it when done.
+ZYRE_PRIVATE char *
+    zyre_store_get (zyre_t *self, const char *group, const char *key);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the keys in the replicated store of a named group. Reads our
+//  own copy directly, without a round trip to the node, except on the
+//  first call.
+//  Caller owns return value and must destroy it when done.
+ZYRE_PRIVATE zlist_t *
+    zyre_store_keys (zyre_t *self, const char *group);
+
+//  *** Draft method, defined for internal use only ***
+//  Keep the SHOUTs we send to a named group, so that peers that join it
+//  later with zyre_join_catchup can catch up on them. We keep at most
+//  messages SHOUTs, for at most msecs, taking at most bytes of content; a
+//  limit of 0 means none. Setting all limits to 0 stops keeping SHOUTs.
+ZYRE_PRIVATE void
+    zyre_set_history (zyre_t *self, const char *group, int messages, int msecs, size_t bytes);
+
+//  *** Draft method, defined for internal use only ***
+//  Join a named group, as zyre_join, and ask its members to replay the
+//  SHOUTs they kept for it, as by zyre_set_history. Each member replays
+//  only its own SHOUTs, as HISTORY events, ahead of any SHOUT it sends
+//  after our JOIN, so we get each message once. If we were in the group
+//  before, we only get the SHOUTs we missed since we left.
+ZYRE_PRIVATE int
+    zyre_join_catchup (zyre_t *self, const char *group);
+
+//  *** Draft method, defined for internal use only ***
+//  Set how many messages the node takes off its inbox, or commands off its
+//  pipe, each time it wakes up, while more are waiting. Larger bursts save
+//  a poll per message under load; smaller ones let the node get to its
+//  other sockets sooner. Default is 32.
+ZYRE_PRIVATE void
+    zyre_set_recv_budget (zyre_t *self, int budget);
+
+//  *** Draft method, defined for internal use only ***
+//  Let peers on this host move their mailboxes to us from TCP to IPC, and
+//  move ours to peers that do the same. The node binds an IPC endpoint
+//  under /tmp next to its TCP endpoint and removes the socket file when it
+//  is destroyed. A peer only moves once a PING over IPC comes back, and
+//  otherwise stays on TCP. UNIX only; ignored elsewhere, and for inproc or
+//  IPC endpoints. Call before zyre_start.
+ZYRE_PRIVATE void
+    zyre_set_ipc_upgrade (zyre_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Run one turn of a node made with zyre_new_embedded: wait up to timeout
+//  msecs for input, or until the node next has timed work if that's sooner,
+//  or if timeout is -1; handle whatever came in, and run any timers that
+//  are due. Pass a zero timeout after zyre_fd was readable. Returns 0 if
+//  OK, or -1 if the node was interrupted.
+ZYRE_PRIVATE int
+    zyre_step (zyre_t *self, int timeout);
+
+//  *** Draft method, defined for internal use only ***
+//  Return how many msecs a node made with zyre_new_embedded can wait before
+//  its next step, if zyre_fd doesn't become readable first. Zero means the
+//  node has work to do now. Ask again after each step.
+ZYRE_PRIVATE int
+    zyre_timeout (zyre_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Return a descriptor that becomes readable when a node made with
+//  zyre_new_embedded may have input, for the application to poll along
+//  with its own descriptors, or -1 if the platform has no such descriptor.
+//  Readable means only that the node should step: it may find nothing to
+//  do. Without a descriptor, let zyre_step wait for input instead.
+ZYRE_PRIVATE int
+    zyre_fd (zyre_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Returns the number of the request that a REQUEST, REPLY or NOREPLY event
+//  is about, which zyre_reply takes to answer a REQUEST; 0 for other events.
+ZYRE_PRIVATE uint64_t
+    zyre_event_request (zyre_event_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Returns why the request of a NOREPLY event will get no reply: "unknown",
+//  "unsupported", "exit" or "timeout"; NULL for other events.
+ZYRE_PRIVATE const char *
+    zyre_event_reason (zyre_event_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Returns the name of the object that a STREAM event carries a chunk of;
+//  NULL for other events. The chunk is the event's message, or with a
+//  stream sink, the path of the complete file.
+ZYRE_PRIVATE const char *
+    zyre_event_object (zyre_event_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Returns the offset in its object of a STREAM event's chunk; 0 for other
+//  events.
+ZYRE_PRIVATE uint64_t
+    zyre_event_offset (zyre_event_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Returns the size of the object that a STREAM event carries a chunk of;
+//  0 for other events.
+ZYRE_PRIVATE uint64_t
+    zyre_event_total (zyre_event_t *self);
+
 //  *** Draft method, defined for internal use only ***
 //  Self test of this class.
 ZYRE_PRIVATE void
@@ -25,13 +25,15 @@
 //  Structure of our class
 
 struct _zyre_election_t {
-    char *caw;              //  Current active wave
+    byte caw [ZUUID_LEN];   //  Current active wave
+    bool has_caw;           //  True if there is a current active wave
     zyre_peer_t *father;    //  Father in the current active wave
     unsigned int erec;      //  Number of received election messages
     unsigned int lrec;      //  Number of received leader messages
     bool isLeader;          //  True if leader else false
 
-    char *leader;           //  Leader identity
+    byte leader [ZUUID_LEN];    //  Leader identity
+    bool has_leader;            //  True if leader is known
 };
 
 
@@ -44,13 +46,13 @@ zyre_election_new ()
     zyre_election_t *self = (zyre_election_t *) zmalloc (sizeof (zyre_election_t));
     assert (self);
     //  Initialize class properties here
-    self->caw = NULL;
+    self->has_caw = false;
     self->father = NULL;
     self->erec = 0;
     self->lrec = 0;
     self->isLeader = false;
 
-    self->leader = NULL;
+    self->has_leader = false;
     return self;
 }
 
@@ -64,9 +66,6 @@ zyre_election_destroy (zyre_election_t **self_p)
     assert (self_p);
     if (*self_p) {
         zyre_election_t *self = *self_p;
-        //  Free class properties here
-        zstr_free (&self->caw);
-        zstr_free (&self->leader);
         //  Free object itself
         free (self);
         *self_p = NULL;
@@ -74,11 +73,16 @@ zyre_election_destroy (zyre_election_t **self_p)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Returns true if challenger r beats the current active wave. Binary IDs
+//  sort in the same order as their upper-case hex form, so nodes using the
+//  legacy string messages elect the same leader.
+
 bool
-zyre_election_challenger_superior (zyre_election_t *self, const char *r) {
+zyre_election_challenger_superior (zyre_election_t *self, const byte *r) {
     assert (self);
     assert (r);
-    return !self->caw || strcmp (r, self->caw) < 0;
+    return !self->has_caw || memcmp (r, self->caw, ZUUID_LEN) < 0;
 }
 
 
@@ -86,8 +90,8 @@ void
 zyre_election_reset (zyre_election_t *self)
 {
     assert (self);
-    zstr_free (&self->caw);     //  Free caw when re-initiated
-    zstr_free (&self->leader);  //  Free leader when re-initiated
+    self->has_caw = false;      //  Clear caw when re-initiated
+    self->has_leader = false;   //  Clear leader when re-initiated
     self->father = NULL;        //  Reset father when re-initiated
     self->erec = 0;
     self->lrec = 0;
@@ -95,10 +99,12 @@ zyre_election_reset (zyre_election_t *self)
 
 
 void
-zyre_election_set_caw (zyre_election_t *self, char *caw)
+zyre_election_set_caw (zyre_election_t *self, const byte *caw)
 {
     assert (self);
-    self->caw = caw;
+    assert (caw);
+    memcpy (self->caw, caw, ZUUID_LEN);
+    self->has_caw = true;
 }
 
 
@@ -123,8 +129,9 @@ zyre_election_build_elect_msg (zyre_election_t *self)
 {
     assert (self);
     zre_msg_t *election_msg = zre_msg_new ();
-    zre_msg_set_id (election_msg, ZRE_MSG_ELECT);
-    zre_msg_set_challenger_id (election_msg, self->caw);
+    assert (self->has_caw);
+    zre_msg_set_id (election_msg, ZRE_MSG_ELECT_UUID);
+    zre_msg_set_challenger (election_msg, self->caw);
     return election_msg;
 }
 
@@ -133,29 +140,29 @@ zre_msg_t *
 zyre_election_build_leader_msg (zyre_election_t *self)
 {
     assert (self);
-    assert (self->caw);
+    assert (self->has_caw);
     zre_msg_t *election_msg = zre_msg_new ();
-    zre_msg_set_id (election_msg, ZRE_MSG_LEADER);
-    zre_msg_set_leader_id (election_msg, self->caw);
+    zre_msg_set_id (election_msg, ZRE_MSG_LEADER_UUID);
+    zre_msg_set_leader (election_msg, self->caw);
     return election_msg;
 }
 
 
 bool
-zyre_election_supporting_challenger (zyre_election_t *self, const char *r)
+zyre_election_supporting_challenger (zyre_election_t *self, const byte *r)
 {
     assert (self);
-    assert (self->caw);
+    assert (self->has_caw);
     assert (r);
-    return strcmp (self->caw, r) == 0;
+    return memcmp (self->caw, r, ZUUID_LEN) == 0;
 }
 
 
-const char *
+const byte *
 zyre_election_caw (zyre_election_t *self)
 {
     assert (self);
-    return self->caw;
+    return self->has_caw? self->caw: NULL;
 }
 
 
@@ -179,7 +186,7 @@ bool
 zyre_election_erec_complete (zyre_election_t *self, zyre_group_t *group)
 {
     assert (self);
-    zlist_t *neighbors = zyre_group_peers (group);
+    zlist_t *neighbors = zyre_group_voters (group);
     bool complete = self->erec == zlist_size (neighbors);
     zlist_destroy (&neighbors);
     return complete;
@@ -198,7 +205,7 @@ bool
 zyre_election_lrec_complete (zyre_election_t *self, zyre_group_t *group)
 {
     assert (self);
-    zlist_t *neighbors = zyre_group_peers (group);
+    zlist_t *neighbors = zyre_group_voters (group);
     bool complete = self->lrec == zlist_size (neighbors);
     zlist_destroy (&neighbors);
     return complete;
@@ -209,22 +216,23 @@ zyre_election_lrec_complete (zyre_election_t *self, zyre_group_t *group)
 //  Sets the leader if an election is finished, otherwise NULL.
 
 void
-zyre_election_set_leader (zyre_election_t *self, char *leader)
+zyre_election_set_leader (zyre_election_t *self, const byte *leader)
 {
     assert (self);
-    zstr_free (&self->leader);
-    self->leader = leader;
+    assert (leader);
+    memcpy (self->leader, leader, ZUUID_LEN);
+    self->has_leader = true;
 }
 
 
 //  --------------------------------------------------------------------------
 //  Returns the leader if an election is finished, otherwise NULL.
 
-const char *
+const byte *
 zyre_election_leader (zyre_election_t *self)
 {
     assert (self);
-    return self->leader;
+    return self->has_leader? self->leader: NULL;
 }
 
 
@@ -235,7 +243,7 @@ bool
 zyre_election_won (zyre_election_t *self)
 {
     assert (self);
-    return self->leader? self->isLeader: false;
+    return self->has_leader? self->isLeader: false;
 }
 
 //  --------------------------------------------------------------------------
@@ -245,7 +253,7 @@ bool
 zyre_election_finished (zyre_election_t *self)
 {
     assert (self);
-    return !self->caw && self->leader;
+    return !self->has_caw && self->has_leader;
 }
 
 
@@ -254,17 +262,125 @@ zyre_election_finished (zyre_election_t *self)
 
 void
 zyre_election_print (zyre_election_t *self) {
+    char caw [ZUUID_LEN * 2 + 1] = "(null)";
+    char leader [ZUUID_LEN * 2 + 1] = "(null)";
+    if (self->has_caw)
+        zyre_election_format_id (self->caw, caw);
+    if (self->has_leader)
+        zyre_election_format_id (self->leader, leader);
+
     printf ("zyre_election : {\n");
     printf ("    father: %s\n", zyre_peer_name (self->father));
-    printf ("    CAW: %s\n", self->caw);
+    printf ("    CAW: %s\n", caw);
     printf ("    election count: %d\n", self->erec);
     printf ("    leader count: %d\n", self->lrec);
-    printf ("    state: %s\n", !self->leader? "undecided": self->isLeader? "leader": "loser");
-    printf ("    leader: %s\n", self->leader);
+    printf ("    state: %s\n", !self->has_leader? "undecided": self->isLeader? "leader": "loser");
+    printf ("    leader: %s\n", leader);
     printf ("}\n");
 }
 
 
+//  --------------------------------------------------------------------------
+//  Format a binary ID as the upper-case hex string zuuid_str uses. The
+//  destination must hold ZUUID_LEN * 2 + 1 characters.
+
+void
+zyre_election_format_id (const byte *id, char *dest)
+{
+    static const char hex_char [] = "0123456789ABCDEF";
+    int byte_nbr;
+    for (byte_nbr = 0; byte_nbr < ZUUID_LEN; byte_nbr++) {
+        dest [byte_nbr * 2 + 0] = hex_char [id [byte_nbr] >> 4];
+        dest [byte_nbr * 2 + 1] = hex_char [id [byte_nbr] & 15];
+    }
+    dest [ZUUID_LEN * 2] = 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Parse a hex string ID into binary form. Returns 0 if OK, -1 if the string
+//  is not a valid ID.
+
+int
+zyre_election_parse_id (const char *str, byte *dest)
+{
+    assert (str);
+    if (strlen (str) != ZUUID_LEN * 2)
+        return -1;
+    int byte_nbr;
+    for (byte_nbr = 0; byte_nbr < ZUUID_LEN; byte_nbr++) {
+        unsigned int value = 0;
+        int char_nbr;
+        for (char_nbr = 0; char_nbr < 2; char_nbr++) {
+            char hex = str [byte_nbr * 2 + char_nbr];
+            value <<= 4;
+            if (hex >= '0' && hex <= '9')
+                value |= hex - '0';
+            else
+            if (hex >= 'A' && hex <= 'F')
+                value |= hex - 'A' + 10;
+            else
+            if (hex >= 'a' && hex <= 'f')
+                value |= hex - 'a' + 10;
+            else
+                return -1;
+        }
+        dest [byte_nbr] = (byte) value;
+    }
+    return 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Convert a legacy ELECT or LEADER message, which carries the ID as a hex
+//  string, into its binary ELECT-UUID or LEADER-UUID form. Other messages
+//  are left alone. Returns 0 if OK, -1 if the message carried a bad ID.
+
+int
+zyre_election_msg_upgrade (zre_msg_t *msg)
+{
+    assert (msg);
+    byte id [ZUUID_LEN];
+    if (zre_msg_id (msg) == ZRE_MSG_ELECT) {
+        if (zyre_election_parse_id (zre_msg_challenger_id (msg), id))
+            return -1;
+        zre_msg_set_challenger (msg, id);
+        zre_msg_set_id (msg, ZRE_MSG_ELECT_UUID);
+    }
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_LEADER) {
+        if (zyre_election_parse_id (zre_msg_leader_id (msg), id))
+            return -1;
+        zre_msg_set_leader (msg, id);
+        zre_msg_set_id (msg, ZRE_MSG_LEADER_UUID);
+    }
+    return 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Convert a binary ELECT-UUID or LEADER-UUID message into the legacy
+//  string form, for peers that did not negotiate binary IDs.
+
+void
+zyre_election_msg_downgrade (zre_msg_t *msg)
+{
+    assert (msg);
+    char id [ZUUID_LEN * 2 + 1];
+    if (zre_msg_id (msg) == ZRE_MSG_ELECT_UUID) {
+        zyre_election_format_id (zre_msg_challenger (msg), id);
+        zre_msg_set_challenger_id (msg, id);
+        zre_msg_set_id (msg, ZRE_MSG_ELECT);
+    }
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_LEADER_UUID) {
+        zyre_election_format_id (zre_msg_leader (msg), id);
+        zre_msg_set_leader_id (msg, id);
+        zre_msg_set_id (msg, ZRE_MSG_LEADER);
+    }
+}
+
+
 //  --------------------------------------------------------------------------
 //  Self test of this class
 
@@ -281,6 +397,28 @@ zyre_election_print (zyre_election_t *self) {
 #define SELFTEST_DIR_RO "src/selftest-ro"
 #define SELFTEST_DIR_RW "src/selftest-rw"
 
+#if !defined (__WINDOWS__)
+typedef struct {
+    zsock_t *sink;              //  Where the handler passes events on
+    bool stalled;               //  True once the handler has stalled
+} s_stall_t;
+
+//  Stall the node the first time it delivers an event, as if it had hung,
+//  then pass events on to the test
+
+static void
+s_stall_handler (zmsg_t *event, void *arg)
+{
+    s_stall_t *stall = (s_stall_t *) arg;
+    if (!stall->stalled) {
+        stall->stalled = true;
+        zclock_sleep (1000);
+    }
+    zmsg_t *copy = zmsg_dup (event);
+    zmsg_send (&copy, stall->sink);
+}
+#endif
+
 void
 zyre_election_test (bool verbose)
 {
@@ -290,6 +428,25 @@ zyre_election_test (bool verbose)
 #if !defined (__WINDOWS__)
     //  @selftest
     int rc;
+    //  Binary IDs survive the round trip through the legacy string form
+    zuuid_t *uuid = zuuid_new ();
+    zyre_election_t *election = zyre_election_new ();
+    zyre_election_set_caw (election, zuuid_data (uuid));
+    zre_msg_t *msg = zyre_election_build_elect_msg (election);
+    zyre_election_msg_downgrade (msg);
+    assert (zre_msg_id (msg) == ZRE_MSG_ELECT);
+    assert (streq (zre_msg_challenger_id (msg), zuuid_str (uuid)));
+    rc = zyre_election_msg_upgrade (msg);
+    assert (rc == 0);
+    assert (zre_msg_id (msg) == ZRE_MSG_ELECT_UUID);
+    assert (zyre_election_supporting_challenger (election, zre_msg_challenger (msg)));
+    zre_msg_set_id (msg, ZRE_MSG_LEADER);
+    zre_msg_set_leader_id (msg, "not an id");
+    assert (zyre_election_msg_upgrade (msg) == -1);
+    zre_msg_destroy (&msg);
+    zyre_election_destroy (&election);
+    zuuid_destroy (&uuid);
+
     //  Init zyre nodes
     zyre_t *node1 = zyre_new ("node1");
     assert (node1);
@@ -323,6 +480,8 @@ zyre_election_test (bool verbose)
     //  Join topology
     zyre_set_contest_in_group (node1, "GROUP_1");
     zyre_set_contest_in_group (node2, "GROUP_1");
+    zyre_set_leader_lease (node1, "GROUP_1", 300);
+    zyre_set_leader_lease (node2, "GROUP_1", 300);
     zyre_join (node1, "GROUP_1");
     zyre_join (node2, "GROUP_1");
 
@@ -337,6 +496,7 @@ zyre_election_test (bool verbose)
     int num_of_global_leaders = 0;
     int num_of_global1_leaders = 0;
     int num_of_leader_messages = 0;
+    char *group1_leader = NULL;
 
     zyre_event_t *event;
     do {
@@ -345,6 +505,8 @@ zyre_election_test (bool verbose)
         if (streq (zyre_event_type (event), "LEADER")) {
             if (streq (zyre_event_group (event), "GROUP_1")) {
                 num_of_leader_messages++;
+                if (!group1_leader)
+                    group1_leader = strdup (zyre_event_peer_uuid (event));
                 if (streq (zyre_uuid (node1), zyre_event_peer_uuid (event)))
                     num_of_global_leaders++;
             }
@@ -365,6 +527,8 @@ zyre_election_test (bool verbose)
         if (streq (zyre_event_type (event), "LEADER")) {
             if (streq (zyre_event_group (event), "GROUP_1")) {
                 num_of_leader_messages++;
+                if (!group1_leader)
+                    group1_leader = strdup (zyre_event_peer_uuid (event));
                 if (streq (zyre_uuid (node2), zyre_event_peer_uuid (event)))
                     num_of_global_leaders++;
             }
@@ -384,6 +548,64 @@ zyre_election_test (bool verbose)
     assert (num_of_global_leaders == 1);
     assert (num_of_global1_leaders == 1);
 
+    //  Leader keeps renewing its lease, so leadership does not move
+    zclock_sleep (1000);
+    zpoller_t *poller = zpoller_new (zyre_socket (node1), zyre_socket (node2), NULL);
+    zsock_t *which = (zsock_t *) zpoller_wait (poller, 0);
+    while (which) {
+        event = zyre_event_new (which == zyre_socket (node1)? node1: node2);
+        if (streq (zyre_event_type (event), "LEADER")
+        &&  streq (zyre_event_group (event), "GROUP_1"))
+            assert (streq (zyre_event_peer_uuid (event), group1_leader));
+        zyre_event_destroy (&event);
+        which = (zsock_t *) zpoller_wait (poller, 0);
+    }
+    zpoller_destroy (&poller);
+
+    //  A leader that stalls for longer than its lease is left out: the
+    //  follower takes over, and the old leader steps down when it wakes
+    zyre_t *leader = streq (group1_leader, zyre_uuid (node1))? node1: node2;
+    zyre_t *follower = leader == node1? node2: node1;
+    zsock_t *sink = zsock_new_pair ("@inproc://election-stall");
+    s_stall_t stall = { zsock_new_pair (">inproc://election-stall"), false };
+    zyre_set_handler (leader, s_stall_handler, &stall);
+    zlist_t *peers = zyre_peers (leader);   //  Leader has taken the handler
+    zlist_destroy (&peers);
+    zyre_whispers (follower, zyre_uuid (leader), "%s", "stall");
+
+    bool elected = false;
+    while (!elected) {
+        event = zyre_event_new (follower);
+        if (streq (zyre_event_type (event), "LEADER")
+        &&  streq (zyre_event_group (event), "GROUP_1"))
+            elected = streq (zyre_event_peer_uuid (event), zyre_uuid (follower));
+        zyre_event_destroy (&event);
+    }
+    bool stepped_down = false;
+    while (!stepped_down) {
+        zmsg_t *msg = zmsg_recv (sink);
+        char *type = zmsg_popstr (msg);
+        if (streq (type, "STEP-DOWN")) {
+            char *uuid = zmsg_popstr (msg);
+            char *name = zmsg_popstr (msg);
+            char *group = zmsg_popstr (msg);
+            assert (streq (uuid, group1_leader));
+            assert (streq (group, "GROUP_1"));
+            stepped_down = true;
+            zstr_free (&uuid);
+            zstr_free (&name);
+            zstr_free (&group);
+        }
+        zstr_free (&type);
+        zmsg_destroy (&msg);
+    }
+    zyre_set_handler (leader, NULL, NULL);
+    peers = zyre_peers (leader);            //  Leader has dropped the handler
+    zlist_destroy (&peers);
+    zsock_destroy (&stall.sink);
+    zsock_destroy (&sink);
+    zstr_free (&group1_leader);
+
     //  @TODO: Test leaving leader
 
     zyre_stop (node1);
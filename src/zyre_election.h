@@ -29,16 +29,16 @@ ZYRE_PRIVATE void
     zyre_election_destroy (zyre_election_t **self_p);
 
 ZYRE_PRIVATE bool
-    zyre_election_challenger_superior (zyre_election_t *self, const char *r);
+    zyre_election_challenger_superior (zyre_election_t *self, const byte *r);
 
 ZYRE_PRIVATE void
     zyre_election_reset (zyre_election_t *self);
 
-ZYRE_PRIVATE const char *
+ZYRE_PRIVATE const byte *
     zyre_election_caw (zyre_election_t *self);
 
 ZYRE_PRIVATE void
-    zyre_election_set_caw (zyre_election_t *self, char *caw);
+    zyre_election_set_caw (zyre_election_t *self, const byte *caw);
 
 ZYRE_PRIVATE zyre_peer_t *
     zyre_election_father (zyre_election_t *self);
@@ -53,7 +53,7 @@ ZYRE_PRIVATE zre_msg_t *
     zyre_election_build_leader_msg (zyre_election_t *self);
 
 ZYRE_PRIVATE bool
-    zyre_election_supporting_challenger (zyre_election_t *self, const char *r);
+    zyre_election_supporting_challenger (zyre_election_t *self, const byte *r);
 
 ZYRE_PRIVATE void
     zyre_election_increment_erec (zyre_election_t *self);
@@ -76,12 +76,12 @@ ZYRE_PRIVATE int
     zyre_election_recv (zyre_election_t *self, zre_msg_t *msg, zyre_peer_t *sender);
 
 //  Returns the leader if an election is finished, otherwise NULL.
-ZYRE_PRIVATE const char *
+ZYRE_PRIVATE const byte *
     zyre_election_leader (zyre_election_t *self);
 
 //  Sets the leader if an election is finished, otherwise NULL.
 ZYRE_PRIVATE void
-    zyre_election_set_leader (zyre_election_t *self, char *leader);
+    zyre_election_set_leader (zyre_election_t *self, const byte *leader);
 
 //  Returns true if an election is finished and won.
 ZYRE_PRIVATE bool
@@ -99,6 +99,26 @@ ZYRE_PRIVATE void
 ZYRE_PRIVATE void
     zyre_election_print (zyre_election_t *self);
 
+//  Format a binary ID as an upper-case hex string. The destination must
+//  hold ZUUID_LEN * 2 + 1 characters.
+ZYRE_PRIVATE void
+    zyre_election_format_id (const byte *id, char *dest);
+
+//  Parse a hex string ID into binary form. Returns 0 if OK, -1 if the
+//  string is not a valid ID.
+ZYRE_PRIVATE int
+    zyre_election_parse_id (const char *str, byte *dest);
+
+//  Convert a legacy ELECT or LEADER message into its binary form. Returns
+//  0 if OK, -1 if the message carried a bad ID.
+ZYRE_PRIVATE int
+    zyre_election_msg_upgrade (zre_msg_t *msg);
+
+//  Convert a binary ELECT-UUID or LEADER-UUID message into the legacy
+//  string form, for peers that did not negotiate binary IDs.
+ZYRE_PRIVATE void
+    zyre_election_msg_downgrade (zre_msg_t *msg);
+
 //  Self test of this class
 ZYRE_PRIVATE void
     zyre_election_test (bool verbose);
@@ -34,10 +34,28 @@ struct _zyre_event_t {
     char *peer_addr;        //  Sender ipaddress as string, for an ENTER event
     zhash_t *headers;       //  Headers, for an ENTER event
     char *group;            //  Group name for a SHOUT event
-    zmsg_t *msg;            //  Message payload for SHOUT or WHISPER
+    zmsg_t *msg;            //  Message payload for SHOUT, HISTORY, WHISPER,
+                            //  REQUEST, REPLY or STREAM
+    uint64_t request;       //  Request number, for REQUEST, REPLY, NOREPLY
+    char *reason;           //  Why there is no reply, for NOREPLY
+    char *object;           //  Name of object, for STREAM
+    uint64_t offset;        //  Offset of chunk in object, for STREAM
+    uint64_t total;         //  Size of object, for STREAM
 };
 
 
+//  Pop a number the node sent as a string off an event
+
+static uint64_t
+s_pop_number (zmsg_t *msg)
+{
+    char *string = zmsg_popstr (msg);
+    uint64_t number = string? strtoull (string, NULL, 10): 0;
+    zstr_free (&string);
+    return number;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Constructor: receive an event from the zyre node, wraps zyre_recv.
 //  The event may be a control message (ENTER, EXIT, JOIN, LEAVE) or
@@ -66,6 +84,14 @@ zyre_event_new (zyre_t *node)
         self->peer_addr = zmsg_popstr (msg);
     }
     else
+    if (streq (self->type, "HEADER-UPDATE")) {
+        zframe_t *headers = zmsg_pop (msg);
+        if (headers) {
+            self->headers = zhash_unpack (headers);
+            zframe_destroy (&headers);
+        }
+    }
+    else
     if (streq (self->type, "JOIN"))
         self->group = zmsg_popstr (msg);
     else
@@ -77,15 +103,37 @@ zyre_event_new (zyre_t *node)
         msg = NULL;
     }
     else
-    if (streq (self->type, "SHOUT")) {
+    if (streq (self->type, "SHOUT")
+    ||  streq (self->type, "HISTORY")) {
         self->group = zmsg_popstr (msg);
         self->msg = msg;
         msg = NULL;
     }
     else
-    if (streq (self->type, "LEADER")) {
+    if (streq (self->type, "LEADER")
+    ||  streq (self->type, "STEP-DOWN")) {
         self->group = zmsg_popstr (msg);
     }
+    else
+    if (streq (self->type, "REQUEST")
+    ||  streq (self->type, "REPLY")) {
+        self->request = s_pop_number (msg);
+        self->msg = msg;
+        msg = NULL;
+    }
+    else
+    if (streq (self->type, "NOREPLY")) {
+        self->request = s_pop_number (msg);
+        self->reason = zmsg_popstr (msg);
+    }
+    else
+    if (streq (self->type, "STREAM")) {
+        self->object = zmsg_popstr (msg);
+        self->offset = s_pop_number (msg);
+        self->total = s_pop_number (msg);
+        self->msg = msg;
+        msg = NULL;
+    }
     zmsg_destroy (&msg);
     return self;
 }
@@ -106,6 +154,8 @@ zyre_event_destroy (zyre_event_t **self_p)
         free (self->peer_name);
         free (self->peer_addr);
         free (self->group);
+        free (self->reason);
+        free (self->object);
         free (self->type);
         free (self);
         *self_p = NULL;
@@ -141,6 +191,14 @@ zyre_event_print (zyre_event_t *self)
         zsys_info (" - address=%s", zyre_event_peer_addr (self));
     }
     else
+    if (streq (self->type, "HEADER-UPDATE")) {
+        void *item;
+        zsys_info (" - headers=%zu:", zhash_size (self->headers));
+        for (item = zhash_first (self->headers); item != NULL;
+                item = zhash_next (self->headers))
+            zyre_event_log_pair (zhash_cursor (self->headers), item, self);
+    }
+    else
     if (streq (self->type, "JOIN")) {
         zsys_info (" - group=%s", zyre_event_group (self));
     }
@@ -154,14 +212,38 @@ zyre_event_print (zyre_event_t *self)
         zmsg_print (self->msg);
     }
     else
+    if (streq (self->type, "HISTORY")) {
+        zsys_info (" - group=%s", zyre_event_group (self));
+        zsys_info (" - message:");
+        zmsg_print (self->msg);
+    }
+    else
     if (streq (self->type, "WHISPER")) {
         zsys_info (" - message:");
         zmsg_print (self->msg);
     }
     else
-    if (streq (self->type, "LEADER")) {
+    if (streq (self->type, "LEADER")
+    ||  streq (self->type, "STEP-DOWN")) {
         zsys_info (" - group=%s", zyre_event_group (self));
     }
+    else
+    if (streq (self->type, "REQUEST")
+    ||  streq (self->type, "REPLY")) {
+        zsys_info (" - request=%" PRIu64, self->request);
+        zsys_info (" - message:");
+        zmsg_print (self->msg);
+    }
+    else
+    if (streq (self->type, "NOREPLY")) {
+        zsys_info (" - request=%" PRIu64, self->request);
+        zsys_info (" - reason=%s", self->reason);
+    }
+    else
+    if (streq (self->type, "STREAM")) {
+        zsys_info (" - object=%s", self->object);
+        zsys_info (" - offset=%" PRIu64 " total=%" PRIu64, self->offset, self->total);
+    }
 }
 
 
@@ -272,6 +354,67 @@ zyre_event_get_msg (zyre_event_t *self)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Returns the number of the request that a REQUEST, REPLY or NOREPLY event
+//  is about, which zyre_reply takes to answer a REQUEST; 0 for other events.
+
+uint64_t
+zyre_event_request (zyre_event_t *self)
+{
+    assert (self);
+    return self->request;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Returns why the request of a NOREPLY event will get no reply: "unknown",
+//  "unsupported", "exit" or "timeout"; NULL for other events.
+
+const char *
+zyre_event_reason (zyre_event_t *self)
+{
+    assert (self);
+    return self->reason;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Returns the name of the object that a STREAM event carries a chunk of;
+//  NULL for other events. The chunk is the event's message, or with a
+//  stream sink, the path of the complete file.
+
+const char *
+zyre_event_object (zyre_event_t *self)
+{
+    assert (self);
+    return self->object;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Returns the offset in its object of a STREAM event's chunk; 0 for other
+//  events.
+
+uint64_t
+zyre_event_offset (zyre_event_t *self)
+{
+    assert (self);
+    return self->offset;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Returns the size of the object that a STREAM event carries a chunk of;
+//  0 for other events.
+
+uint64_t
+zyre_event_total (zyre_event_t *self)
+{
+    assert (self);
+    return self->total;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Self test of this class
 
@@ -351,6 +494,64 @@ zyre_event_test (bool verbose)
         }
         zyre_event_destroy (&event);
     }
+
+    //  Node1 sends node2 a request, which node2 answers by its number
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Question");
+    uint64_t request = zyre_request (node1, zyre_uuid (node2), 5000, &msg);
+    assert (request);
+    event = zyre_event_new (node2);
+    while (strneq (zyre_event_type (event), "REQUEST")) {
+        zyre_event_destroy (&event);
+        event = zyre_event_new (node2);
+    }
+    assert (streq (zyre_event_peer_uuid (event), zyre_uuid (node1)));
+    assert (zframe_streq (zmsg_first (zyre_event_msg (event)), "Question"));
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Answer");
+    rc = zyre_reply (node2, zyre_event_peer_uuid (event), zyre_event_request (event), &msg);
+    assert (rc == 0);
+    zyre_event_destroy (&event);
+    event = zyre_event_new (node1);
+    while (strneq (zyre_event_type (event), "REPLY")) {
+        zyre_event_destroy (&event);
+        event = zyre_event_new (node1);
+    }
+    assert (zyre_event_request (event) == request);
+    assert (zframe_streq (zmsg_first (zyre_event_msg (event)), "Answer"));
+    zyre_event_destroy (&event);
+
+    //  A request to a peer we don't know gets a NOREPLY
+    msg = zmsg_new ();
+    zmsg_addstr (msg, "Anyone?");
+    request = zyre_request (node1, "NOT A PEER", 5000, &msg);
+    assert (request);
+    event = zyre_event_new (node1);
+    while (strneq (zyre_event_type (event), "NOREPLY")) {
+        zyre_event_destroy (&event);
+        event = zyre_event_new (node1);
+    }
+    assert (zyre_event_request (event) == request);
+    assert (streq (zyre_event_reason (event), "unknown"));
+    zyre_event_destroy (&event);
+
+    //  Node1 streams node2 an object, which comes as STREAM events
+    zframe_t *object = zframe_new ("Streamed object", 15);
+    rc = zyre_send_stream (node1, zyre_uuid (node2), "object", &object);
+    assert (rc == 0);
+    uint64_t taken = 0;
+    while (taken < 15) {
+        event = zyre_event_new (node2);
+        if (streq (zyre_event_type (event), "STREAM")) {
+            assert (streq (zyre_event_object (event), "object"));
+            assert (zyre_event_offset (event) == taken);
+            assert (zyre_event_total (event) == 15);
+            taken += zmsg_content_size (zyre_event_msg (event));
+        }
+        zyre_event_destroy (&event);
+    }
+    assert (taken == 15);
+
     zyre_destroy (&node1);
     zyre_destroy (&node2);
 #if defined (__WINDOWS__)
@@ -15,6 +15,40 @@
 
 #include "zyre_classes.h"
 
+//  Each peer takes this many points on a group's ring, so keys spread
+//  evenly over the peers, and a peer that leaves hands its keys on to
+//  many peers rather than one
+#define RING_VNODES 64
+
+//  The application looks up key owners on the node's rings, and values in
+//  its stores, from its own thread, so we change rings and stores, and the
+//  table of shared groups, under a lock
+
+#if defined (__WINDOWS__)
+static SRWLOCK s_group_lock = SRWLOCK_INIT;
+#   define GROUP_LOCK    AcquireSRWLockExclusive (&s_group_lock)
+#   define GROUP_UNLOCK ReleaseSRWLockExclusive (&s_group_lock)
+#else
+static pthread_mutex_t s_group_lock = PTHREAD_MUTEX_INITIALIZER;
+#   define GROUP_LOCK    pthread_mutex_lock (&s_group_lock)
+#   define GROUP_UNLOCK pthread_mutex_unlock (&s_group_lock)
+#endif
+
+typedef struct {
+    uint64_t hash;              //  Position on ring
+    zyre_peer_t *peer;          //  Peer owning keys from previous point to here
+} ring_point_t;
+
+//  A key in the group's replicated store. The write with the later stamp
+//  wins, and between equal stamps the one from the higher UUID, so every
+//  node ends up with the same value, whatever order writes come in.
+typedef struct {
+    char *key;                  //  Key written
+    char *value;                //  Value, NULL if key was deleted
+    uint64_t stamp;             //  Lamport time of the write
+    char *writer;               //  UUID of node that wrote it
+} store_entry_t;
+
 //  --------------------------------------------------------------------------
 //  Structure of our class
 
@@ -25,9 +59,39 @@ struct _zyre_group_t {
     bool contest;               //  Wheather the peer actively contest for leadership of this group
     zyre_peer_t *leader;        //  Peer that has been elected as leader for this group
     zyre_election_t *election;  //  Election handler, is NULL if there's no active election
+    int lease;                  //  Leader lease in msecs, 0 if disabled
+    bool leading;               //  True if we hold leadership of this group
+    zyre_peer_t *lapsed;        //  Leader whose lease lapsed, excluded from elections
+    int relay_fanout;           //  Fan-out of our relay tree, 0 if none
+    uint32_t relay_serial;      //  Number of last message we relayed
+    int anycast_policy;         //  How we pick a peer to anycast to
+    char *anycast_last;         //  UUID of last peer we anycast to, if any
+    ring_point_t *ring;         //  Points of peers on ring, in hash order
+    size_t ring_size;           //  Number of points on ring
+    zhash_t *store;             //  Replicated key-value store, by key
+    zhash_t *store_clock;       //  Highest stamp we have from each writer
+    uint64_t store_stamp;       //  Highest stamp we have from anyone
 };
 
 
+static int
+s_string_compare (void *item1, void *item2)
+{
+    return strcmp ((const char *) item1, (const char *) item2);
+}
+
+
+static void
+s_store_entry_destroy (void *argument)
+{
+    store_entry_t *entry = (store_entry_t *) argument;
+    free (entry->key);
+    free (entry->value);
+    free (entry->writer);
+    free (entry);
+}
+
+
 //  Callback when we remove group from container
 
 static void
@@ -48,6 +112,9 @@ zyre_group_new (const char *name, zhash_t *container)
     self->name = strdup (name);
     self->peers = zhash_new ();
     self->contest = false;
+    self->store = zhash_new ();
+    self->store_clock = zhash_new ();
+    zhash_autofree (self->store_clock);
 
     //  Insert into container if requested
     if (container) {
@@ -68,7 +135,11 @@ zyre_group_destroy (zyre_group_t **self_p)
     if (*self_p) {
         zyre_group_t *self = *self_p;
         zhash_destroy (&self->peers);
+        zhash_destroy (&self->store);
+        zhash_destroy (&self->store_clock);
         zyre_election_destroy (&self->election);
+        free (self->anycast_last);
+        free (self->ring);
         free (self->name);
         free (self);
         *self_p = NULL;
@@ -76,6 +147,92 @@ zyre_group_destroy (zyre_group_t **self_p)
 }
 
 
+//  Hash a string onto the ring; FNV-1a, with the bits mixed after, as
+//  FNV-1a alone spreads similar strings poorly
+
+static uint64_t
+s_ring_hash (const char *string, uint32_t vnode)
+{
+    uint64_t hash = 14695981039346656037u;
+    for (; *string; string++)
+        hash = (hash ^ (byte) *string) * 1099511628211u;
+    int shift;
+    for (shift = 0; shift < 32; shift += 8)
+        hash = (hash ^ (byte) (vnode >> shift)) * 1099511628211u;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdu;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+//  Return index of first point on ring at or after hash, or ring size
+
+static size_t
+s_ring_search (zyre_group_t *self, uint64_t hash)
+{
+    size_t low = 0;
+    size_t high = self->ring_size;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (self->ring [middle].hash < hash)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+//  Add peer's points to ring, keeping it in order, so that a join only
+//  moves the points after each new one
+
+static void
+s_ring_add (zyre_group_t *self, zyre_peer_t *peer)
+{
+    GROUP_LOCK;
+    self->ring = (ring_point_t *) realloc (self->ring,
+                 (self->ring_size + RING_VNODES) * sizeof (ring_point_t));
+    assert (self->ring);
+    uint32_t vnode;
+    for (vnode = 0; vnode < RING_VNODES; vnode++) {
+        uint64_t hash = s_ring_hash (zyre_peer_identity (peer), vnode);
+        size_t index = s_ring_search (self, hash);
+        memmove (self->ring + index + 1, self->ring + index,
+                 (self->ring_size - index) * sizeof (ring_point_t));
+        self->ring [index].hash = hash;
+        self->ring [index].peer = peer;
+        self->ring_size++;
+    }
+    GROUP_UNLOCK;
+}
+
+//  Remove peer's points from ring, in one pass
+
+static void
+s_ring_remove (zyre_group_t *self, zyre_peer_t *peer)
+{
+    GROUP_LOCK;
+    size_t index;
+    size_t kept = 0;
+    for (index = 0; index < self->ring_size; index++)
+        if (self->ring [index].peer != peer)
+            self->ring [kept++] = self->ring [index];
+    self->ring_size = kept;
+    GROUP_UNLOCK;
+}
+
+//  Return peer owning key on ring, that is the peer of the first point at
+//  or after the key's hash, going round; NULL if the ring is empty
+
+static zyre_peer_t *
+s_ring_owner (zyre_group_t *self, const char *key)
+{
+    if (self->ring_size == 0)
+        return NULL;
+    size_t index = s_ring_search (self, s_ring_hash (key, 0));
+    return self->ring [index < self->ring_size? index: 0].peer;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Add peer to group
 //  Ignore duplicate joins
@@ -85,7 +242,8 @@ zyre_group_join (zyre_group_t *self, zyre_peer_t *peer)
 {
     assert (self);
     assert (peer);
-    zhash_insert (self->peers, zyre_peer_identity (peer), peer);
+    if (zhash_insert (self->peers, zyre_peer_identity (peer), peer) == 0)
+        s_ring_add (self, peer);
     zyre_peer_set_status (peer, zyre_peer_status (peer) + 1);
 }
 
@@ -98,8 +256,25 @@ zyre_group_leave (zyre_group_t *self, zyre_peer_t *peer)
 {
     assert (self);
     assert (peer);
-    zhash_delete (self->peers, zyre_peer_identity (peer));
+    if (zhash_lookup (self->peers, zyre_peer_identity (peer))) {
+        zhash_delete (self->peers, zyre_peer_identity (peer));
+        s_ring_remove (self, peer);
+    }
     zyre_peer_set_status (peer, zyre_peer_status (peer) + 1);
+    if (self->lapsed == peer)
+        self->lapsed = NULL;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return true if peer is in group
+
+bool
+zyre_group_has_peer (zyre_group_t *self, zyre_peer_t *peer)
+{
+    assert (self);
+    assert (peer);
+    return zhash_lookup (self->peers, zyre_peer_identity (peer)) != NULL;
 }
 
 
@@ -113,16 +288,604 @@ s_peer_send (const char *key, void *item, void *argument)
 }
 
 //  --------------------------------------------------------------------------
-//  Send message to all peers in group
+//  Send message to all peers in group. Peers whose mailboxes are owned by
+//  worker actors are batched, so each worker does its share of the fan-out
+//  in one go.
 
 void
 zyre_group_send (zyre_group_t *self, zre_msg_t **msg_p)
 {
     void *item;
     assert (self);
+    zhash_t *batches = NULL;
     for (item = zhash_first (self->peers); item != NULL;
             item = zhash_next (self->peers))
-        s_peer_send (zhash_cursor (self->peers), item, *msg_p);
+        if (!zyre_peer_batch ((zyre_peer_t *) item, &batches, *msg_p))
+            s_peer_send (zhash_cursor (self->peers), item, *msg_p);
+    zyre_peer_send_batches (&batches, *msg_p);
+    zre_msg_destroy (msg_p);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send message to all peers in group, except that peers that can take
+//  compressed content get the compressed form instead, so we compress once
+//  for the whole group. Destroys both messages.
+
+void
+zyre_group_send_compressed (zyre_group_t *self, zre_msg_t **msg_p,
+                            zre_msg_t **compressed_p, uint32_t dict_id)
+{
+    void *item;
+    assert (self);
+    zhash_t *batches = NULL;
+    zhash_t *compressed_batches = NULL;
+    for (item = zhash_first (self->peers); item != NULL;
+            item = zhash_next (self->peers)) {
+        if (zyre_peer_takes_compressed ((zyre_peer_t *) item, dict_id)) {
+            if (!zyre_peer_batch ((zyre_peer_t *) item, &compressed_batches, *compressed_p))
+                s_peer_send (zhash_cursor (self->peers), item, *compressed_p);
+        }
+        else
+        if (!zyre_peer_batch ((zyre_peer_t *) item, &batches, *msg_p))
+            s_peer_send (zhash_cursor (self->peers), item, *msg_p);
+    }
+    zyre_peer_send_batches (&batches, *msg_p);
+    zyre_peer_send_batches (&compressed_batches, *compressed_p);
+    zre_msg_destroy (msg_p);
+    zre_msg_destroy (compressed_p);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send message to the peers in group that don't take the group's SHOUTs
+//  on the multicast endpoint; returns the number of peers that do, so the
+//  caller knows whether to multicast at all. Destroys the message.
+
+size_t
+zyre_group_send_multicast (zyre_group_t *self, zre_msg_t **msg_p, const char *endpoint)
+{
+    void *item;
+    assert (self);
+    assert (endpoint);
+    size_t listeners = 0;
+    zhash_t *batches = NULL;
+    for (item = zhash_first (self->peers); item != NULL;
+            item = zhash_next (self->peers)) {
+        const char *multicast = zyre_peer_multicast ((zyre_peer_t *) item,
+                                                     zre_msg_group (*msg_p));
+        if (multicast && streq (multicast, endpoint))
+            listeners++;
+        else
+        if (!zyre_peer_batch ((zyre_peer_t *) item, &batches, *msg_p))
+            s_peer_send (zhash_cursor (self->peers), item, *msg_p);
+    }
+    zyre_peer_send_batches (&batches, *msg_p);
+    zre_msg_destroy (msg_p);
+    return listeners;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send a RELAY message to the peers in group that relay, other than its
+//  origin, whose UUIDs are above low and up to high; either may be NULL
+//  for no limit. We split those peers, in UUID order, into as many ranges
+//  as the fan-out, and send the message to the first peer of each range
+//  with the range's last UUID as bound, so that peer relays it to the
+//  rest of its range in turn. Each node sends at most fan-out copies, and
+//  the ranges never overlap, so no peer gets the message twice. Each copy
+//  says how many peers its range holds, as we see it. Returns how many
+//  peers we found in our own range.
+
+static int
+s_relay_compare (const void *item1, const void *item2)
+{
+    return strcmp (zyre_peer_identity (*(zyre_peer_t **) item1),
+                   zyre_peer_identity (*(zyre_peer_t **) item2));
+}
+
+static size_t
+s_relay_ranges (zyre_group_t *self, zre_msg_t *msg, const char *low, const char *high)
+{
+    zuuid_t *uuid = zuuid_new ();
+    zuuid_set (uuid, zre_msg_origin (msg));
+    char *origin = strdup (zuuid_str (uuid));
+
+    size_t count = 0;
+    zyre_peer_t **peers = (zyre_peer_t **) zmalloc (sizeof (zyre_peer_t *) * (zhash_size (self->peers) + 1));
+    zyre_peer_t *peer = (zyre_peer_t *) zhash_first (self->peers);
+    while (peer) {
+        const char *identity = zyre_peer_identity (peer);
+        if ((zyre_peer_features (peer) & ZYRE_PEER_FEATURE_RELAY)
+        &&  strneq (identity, origin)
+        &&  (!low || strcmp (identity, low) > 0)
+        &&  (!high || strcmp (identity, high) <= 0))
+            peers [count++] = peer;
+        peer = (zyre_peer_t *) zhash_next (self->peers);
+    }
+    qsort (peers, count, sizeof (zyre_peer_t *), s_relay_compare);
+
+    size_t fanout = zre_msg_fanout (msg)? zre_msg_fanout (msg): 1;
+    size_t first = 0;
+    size_t range;
+    for (range = 0; range < fanout; range++) {
+        size_t last = count * (range + 1) / fanout;
+        if (last > first) {
+            zuuid_set_str (uuid, zyre_peer_identity (peers [last - 1]));
+            zre_msg_set_bound (msg, (byte *) zuuid_data (uuid));
+            zre_msg_set_span (msg, (uint32_t) (last - first));
+            zre_msg_t *copy = zre_msg_dup (msg);
+            zyre_peer_send (peers [first], &copy);
+            zre_msg_destroy (&copy);
+            first = last;
+        }
+    }
+    free (peers);
+    free (origin);
+    zuuid_destroy (&uuid);
+    return count;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send a SHOUT from us down a relay tree of the peers in group that relay,
+//  and directly to the other peers. Destroys the message.
+
+void
+zyre_group_send_relay (zyre_group_t *self, zre_msg_t **msg_p, zuuid_t *origin)
+{
+    void *item;
+    assert (self);
+    assert (origin);
+    for (item = zhash_first (self->peers); item != NULL;
+            item = zhash_next (self->peers))
+        if (!(zyre_peer_features ((zyre_peer_t *) item) & ZYRE_PEER_FEATURE_RELAY))
+            s_peer_send (zhash_cursor (self->peers), item, *msg_p);
+
+    zre_msg_t *relay = zre_msg_new ();
+    zre_msg_set_id (relay, ZRE_MSG_RELAY);
+    zre_msg_set_origin (relay, (byte *) zuuid_data (origin));
+    zre_msg_set_group (relay, self->name);
+    zre_msg_set_serial (relay, ++self->relay_serial);
+    zre_msg_set_fanout (relay, (byte) self->relay_fanout);
+    zmsg_t *content = zre_msg_get_content (*msg_p);
+    zre_msg_set_content (relay, &content);
+    s_relay_ranges (self, relay, NULL, NULL);
+    zre_msg_destroy (&relay);
+    zre_msg_destroy (msg_p);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Relay a RELAY message we got on to the rest of the peers it is bound
+//  for, that is the peers above us up to its bound. Returns 0 if OK, or -1
+//  if we know fewer peers in our range than the sender did, in which case
+//  the caller should give the range back to the sender.
+
+int
+zyre_group_relay (zyre_group_t *self, zre_msg_t *msg, zuuid_t *us)
+{
+    assert (self);
+    assert (msg);
+    assert (us);
+    zuuid_t *bound = zuuid_new ();
+    zuuid_set (bound, zre_msg_bound (msg));
+    //  The message we got was for us; the copies are for the next level
+    uint32_t span = zre_msg_span (msg);
+    size_t count = s_relay_ranges (self, msg, zuuid_str (us), zuuid_str (bound));
+    zuuid_destroy (&bound);
+    return count + 1 < span? -1: 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send a RELAY message that a peer gave back to us directly to each of the
+//  peers in the range we gave it, other than that peer, as the peer does
+//  not know them all. The copies are bound to their own peer, so they go
+//  no further.
+
+void
+zyre_group_relay_direct (zyre_group_t *self, zre_msg_t *msg, const char *low)
+{
+    assert (self);
+    assert (msg);
+    assert (low);
+    zuuid_t *uuid = zuuid_new ();
+    zuuid_set (uuid, zre_msg_bound (msg));
+    char *high = strdup (zuuid_str (uuid));
+    zuuid_set (uuid, zre_msg_origin (msg));
+    char *origin = strdup (zuuid_str (uuid));
+
+    zyre_peer_t *peer = (zyre_peer_t *) zhash_first (self->peers);
+    while (peer) {
+        const char *identity = zyre_peer_identity (peer);
+        if ((zyre_peer_features (peer) & ZYRE_PEER_FEATURE_RELAY)
+        &&  strneq (identity, origin)
+        &&  strcmp (identity, low) > 0
+        &&  strcmp (identity, high) <= 0) {
+            zuuid_set_str (uuid, identity);
+            zre_msg_set_bound (msg, (byte *) zuuid_data (uuid));
+            zre_msg_set_span (msg, 1);
+            zre_msg_t *copy = zre_msg_dup (msg);
+            zyre_peer_send (peer, &copy);
+            zre_msg_destroy (&copy);
+        }
+        peer = (zyre_peer_t *) zhash_next (self->peers);
+    }
+    free (high);
+    free (origin);
+    zuuid_destroy (&uuid);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return true if peer a comes before peer b, going round the peers in UUID
+//  order from just after the last peer we anycast to
+
+static bool
+s_anycast_before (zyre_group_t *self, zyre_peer_t *a, zyre_peer_t *b)
+{
+    const char *identity_a = zyre_peer_identity (a);
+    const char *identity_b = zyre_peer_identity (b);
+    if (self->anycast_last) {
+        bool wrapped_a = strcmp (identity_a, self->anycast_last) <= 0;
+        bool wrapped_b = strcmp (identity_b, self->anycast_last) <= 0;
+        if (wrapped_a != wrapped_b)
+            return wrapped_b;
+    }
+    return strcmp (identity_a, identity_b) < 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the peer in group that owns key on the group's ring, or NULL if
+//  the group has no peers. A key only moves to another peer when its owner
+//  leaves, or when a peer joins and takes over part of its owner's range.
+
+zyre_peer_t *
+zyre_group_owner_peer (zyre_group_t *self, const char *key)
+{
+    assert (self);
+    assert (key);
+    //  We are the only thread that changes the ring, so we don't lock
+    return s_ring_owner (self, key);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Share group in a table of groups by name, so other threads can look up
+//  key owners with zyre_group_find_owner
+
+void
+zyre_group_share (zyre_group_t *self, zhash_t *rings)
+{
+    assert (self);
+    assert (rings);
+    GROUP_LOCK;
+    zhash_insert (rings, self->name, self);
+    GROUP_UNLOCK;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy a table of shared groups, so no other thread can look into the
+//  groups once their owner starts to destroy them and their peers
+
+void
+zyre_group_unshare_all (zhash_t **rings_p)
+{
+    assert (rings_p);
+    GROUP_LOCK;
+    zhash_destroy (rings_p);
+    GROUP_UNLOCK;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the UUID of the peer that owns key in the named group, from a
+//  table of shared groups, or NULL if there is no such group or it has no
+//  peers. Safe to call from any thread. Caller owns the returned string.
+
+char *
+zyre_group_find_owner (zhash_t *rings, const char *name, const char *key)
+{
+    assert (rings);
+    assert (name);
+    assert (key);
+    GROUP_LOCK;
+    zyre_group_t *self = (zyre_group_t *) zhash_lookup (rings, name);
+    zyre_peer_t *peer = self? s_ring_owner (self, key): NULL;
+    char *owner = peer? strdup (zyre_peer_identity (peer)): NULL;
+    GROUP_UNLOCK;
+    return owner;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Apply a write to the store if it wins over the write we have for the
+//  key; returns true if it did. Either way we have seen the writer's write.
+
+static bool
+s_store_put (zyre_group_t *self, const char *key, const char *value,
+             uint64_t stamp, const char *writer)
+{
+    //  Other threads look into the store too, and even a lookup moves the
+    //  hash's cursor, so every access to it is under the lock
+    GROUP_LOCK;
+    store_entry_t *entry = (store_entry_t *) zhash_lookup (self->store, key);
+    bool won = !entry
+            || stamp > entry->stamp
+            || (stamp == entry->stamp && strcmp (writer, entry->writer) > 0);
+    if (won) {
+        if (!entry) {
+            entry = (store_entry_t *) zmalloc (sizeof (store_entry_t));
+            entry->key = strdup (key);
+            zhash_insert (self->store, key, entry);
+            zhash_freefn (self->store, key, s_store_entry_destroy);
+        }
+        free (entry->value);
+        entry->value = value? strdup (value): NULL;
+        free (entry->writer);
+        entry->writer = strdup (writer);
+        entry->stamp = stamp;
+    }
+    GROUP_UNLOCK;
+
+    const char *seen = (const char *) zhash_lookup (self->store_clock, writer);
+    if (!seen || strtoull (seen, NULL, 10) < stamp) {
+        char text [21];
+        snprintf (text, sizeof (text), "%" PRIu64, stamp);
+        zhash_update (self->store_clock, writer, text);
+    }
+    if (self->store_stamp < stamp)
+        self->store_stamp = stamp;
+    return won;
+}
+
+//  Return a STORE-SET message for a store entry
+
+static zre_msg_t *
+s_store_msg (zyre_group_t *self, store_entry_t *entry)
+{
+    zre_msg_t *msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_STORE_SET);
+    zre_msg_set_group (msg, self->name);
+    zre_msg_set_key (msg, entry->key);
+    zuuid_t *writer = zuuid_new ();
+    zuuid_set_str (writer, entry->writer);
+    zre_msg_set_origin (msg, (byte *) zuuid_data (writer));
+    zuuid_destroy (&writer);
+    zre_msg_set_stamp (msg, entry->stamp);
+    zmsg_t *content = zmsg_new ();
+    if (entry->value)
+        zmsg_addstr (content, entry->value);
+    zre_msg_set_content (msg, &content);
+    return msg;
+}
+
+static int
+s_store_compare (void *item1, void *item2)
+{
+    store_entry_t *entry1 = (store_entry_t *) item1;
+    store_entry_t *entry2 = (store_entry_t *) item2;
+    return entry1->stamp < entry2->stamp? -1:
+           entry1->stamp > entry2->stamp? 1: 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Write a value to the group's store, or delete the key if value is NULL,
+//  as node us, and send the write to the peers in group that keep stores.
+//  The write is stamped later than any write we have seen in the group.
+
+void
+zyre_group_store_write (zyre_group_t *self, const char *key, const char *value,
+                        zuuid_t *us)
+{
+    assert (self);
+    assert (key);
+    assert (us);
+    s_store_put (self, key, value, self->store_stamp + 1, zuuid_str (us));
+    GROUP_LOCK;
+    zre_msg_t *msg = s_store_msg (self, (store_entry_t *) zhash_lookup (self->store, key));
+    GROUP_UNLOCK;
+    void *item;
+    for (item = zhash_first (self->peers); item != NULL;
+            item = zhash_next (self->peers))
+        if (zyre_peer_features ((zyre_peer_t *) item) & ZYRE_PEER_FEATURE_STORE)
+            s_peer_send (zhash_cursor (self->peers), item, msg);
+    zre_msg_destroy (&msg);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Apply a STORE-SET from a peer to the group's store. Returns true if the
+//  write won over the one we had for the key.
+
+bool
+zyre_group_store_take (zyre_group_t *self, zre_msg_t *msg)
+{
+    assert (self);
+    assert (msg);
+    zuuid_t *writer = zuuid_new ();
+    zuuid_set (writer, zre_msg_origin (msg));
+    zmsg_t *content = zre_msg_content (msg);
+    char *value = content && zmsg_size (content)?
+                  zframe_strdup (zmsg_first (content)): NULL;
+    bool won = s_store_put (self, zre_msg_key (msg), value,
+                            zre_msg_stamp (msg), zuuid_str (writer));
+    zstr_free (&value);
+    zuuid_destroy (&writer);
+    return won;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Ask peer, or all peers in group that keep stores if peer is NULL, for
+//  the writes to the group's store that we don't have, by sending our
+//  clock in a STORE-SYNC
+
+void
+zyre_group_store_sync (zyre_group_t *self, zyre_peer_t *peer)
+{
+    assert (self);
+    zre_msg_t *msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_STORE_SYNC);
+    zre_msg_set_group (msg, self->name);
+    zhash_t *clock = zhash_dup (self->store_clock);
+    zre_msg_set_clock (msg, &clock);
+    void *item;
+    for (item = zhash_first (self->peers); item != NULL;
+            item = zhash_next (self->peers))
+        if ((!peer || item == peer)
+        &&  zyre_peer_features ((zyre_peer_t *) item) & ZYRE_PEER_FEATURE_STORE)
+            s_peer_send (zhash_cursor (self->peers), item, msg);
+    zre_msg_destroy (&msg);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Answer a STORE-SYNC from peer with the writes it doesn't have, that is,
+//  those stamped later than the latest it has from their writers. We send
+//  them oldest first, so if the peer loses us half way, its clock still
+//  covers only writes it has.
+
+void
+zyre_group_store_answer (zyre_group_t *self, zyre_peer_t *peer, zre_msg_t *msg)
+{
+    assert (self);
+    assert (peer);
+    assert (msg);
+    zhash_t *clock = zre_msg_clock (msg);
+    zlist_t *missing = zlist_new ();
+    store_entry_t *entry;
+    //  Only we change or free entries, so we can use them after we unlock
+    GROUP_LOCK;
+    for (entry = (store_entry_t *) zhash_first (self->store); entry;
+            entry = (store_entry_t *) zhash_next (self->store)) {
+        const char *seen = clock?
+            (const char *) zhash_lookup (clock, entry->writer): NULL;
+        if (!seen || strtoull (seen, NULL, 10) < entry->stamp)
+            zlist_append (missing, entry);
+    }
+    GROUP_UNLOCK;
+    zlist_sort (missing, s_store_compare);
+    for (entry = (store_entry_t *) zlist_first (missing); entry;
+            entry = (store_entry_t *) zlist_next (missing)) {
+        zre_msg_t *write = s_store_msg (self, entry);
+        zyre_peer_send (peer, &write);
+        zre_msg_destroy (&write);
+    }
+    zlist_destroy (&missing);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the value of key in the store of the named group, from a table of
+//  shared groups, or NULL if there is no such group, or key. Safe to call
+//  from any thread. Caller owns the returned string.
+
+char *
+zyre_group_find_value (zhash_t *groups, const char *name, const char *key)
+{
+    assert (groups);
+    assert (name);
+    assert (key);
+    GROUP_LOCK;
+    zyre_group_t *self = (zyre_group_t *) zhash_lookup (groups, name);
+    store_entry_t *entry = self?
+        (store_entry_t *) zhash_lookup (self->store, key): NULL;
+    char *value = entry && entry->value? strdup (entry->value): NULL;
+    GROUP_UNLOCK;
+    return value;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the keys in the store of the named group, from a table of shared
+//  groups; empty if there is no such group. Safe to call from any thread.
+//  Caller owns the returned list.
+
+zlist_t *
+zyre_group_find_keys (zhash_t *groups, const char *name)
+{
+    assert (groups);
+    assert (name);
+    zlist_t *keys = zlist_new ();
+    zlist_autofree (keys);
+    GROUP_LOCK;
+    zyre_group_t *self = (zyre_group_t *) zhash_lookup (groups, name);
+    store_entry_t *entry = self?
+        (store_entry_t *) zhash_first (self->store): NULL;
+    while (entry) {
+        if (entry->value)
+            zlist_append (keys, entry->key);
+        entry = (store_entry_t *) zhash_next (self->store);
+    }
+    GROUP_UNLOCK;
+    return keys;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the peer in group to anycast to, by the group's anycast policy,
+//  or by key if not NULL, in which case it is the key's owner on the
+//  group's ring; NULL if the group has no peers. Round robin goes
+//  round the peers in UUID order, so it survives peers joining and leaving.
+//  Least outstanding picks the peer with fewest requests it hasn't answered,
+//  in round robin order among equals.
+
+zyre_peer_t *
+zyre_group_anycast_peer (zyre_group_t *self, const char *key)
+{
+    assert (self);
+    zyre_peer_t *best = NULL;
+    zyre_peer_t *peer;
+    if (key)
+        return s_ring_owner (self, key);
+    if (self->anycast_policy == ZYRE_ANYCAST_RANDOM) {
+        if (zhash_size (self->peers) == 0)
+            return NULL;
+        int index = randof (zhash_size (self->peers));
+        best = (zyre_peer_t *) zhash_first (self->peers);
+        while (index--)
+            best = (zyre_peer_t *) zhash_next (self->peers);
+    }
+    else {
+        bool least = self->anycast_policy == ZYRE_ANYCAST_LEAST_OUTSTANDING;
+        for (peer = (zyre_peer_t *) zhash_first (self->peers); peer;
+                peer = (zyre_peer_t *) zhash_next (self->peers)) {
+            if (!best
+            ||  (least && zyre_peer_outstanding (peer) < zyre_peer_outstanding (best))
+            ||  ((!least || zyre_peer_outstanding (peer) == zyre_peer_outstanding (best))
+                 && s_anycast_before (self, peer, best)))
+                best = peer;
+        }
+    }
+    if (best) {
+        free (self->anycast_last);
+        self->anycast_last = strdup (zyre_peer_identity (best));
+    }
+    return best;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send message to all peers in group that take part in elections, that is
+//  all peers except a leader whose lease has lapsed. An ELECT-UUID names
+//  that leader, so the peers that support it leave out the same leader.
+
+void
+zyre_group_send_voters (zyre_group_t *self, zre_msg_t **msg_p)
+{
+    void *item;
+    assert (self);
+    if (zre_msg_id (*msg_p) == ZRE_MSG_ELECT_UUID)
+        zre_msg_set_lapsed (*msg_p, self->lapsed? zyre_peer_identity (self->lapsed): "");
+    for (item = zhash_first (self->peers); item != NULL;
+            item = zhash_next (self->peers))
+        if (item != self->lapsed)
+            s_peer_send (zhash_cursor (self->peers), item, *msg_p);
     zre_msg_destroy (msg_p);
 }
 
@@ -137,6 +900,22 @@ zyre_group_peers (zyre_group_t *self)
     return zhash_keys (self->peers);
 }
 
+
+//  --------------------------------------------------------------------------
+//  Return zlist of peer ids that take part in elections for this group.
+//  Caller owns return value and must destroy it when done.
+
+zlist_t *
+zyre_group_voters (zyre_group_t *self)
+{
+    assert (self);
+    zlist_t *voters = zhash_keys (self->peers);
+    zlist_comparefn (voters, s_string_compare);
+    if (self->lapsed)
+        zlist_remove (voters, (void *) zyre_peer_identity (self->lapsed));
+    return voters;
+}
+
 //  --------------------------------------------------------------------------
 //  Find or create an election for a group
 
@@ -206,6 +985,109 @@ void
 zyre_group_set_leader (zyre_group_t *self, zyre_peer_t *leader) {
     assert (self);
     self->leader = leader;
+    self->leading = false;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the leader lease of this group in msecs, 0 if disabled.
+
+int
+zyre_group_lease (zyre_group_t *self) {
+    assert (self);
+    return self->lease;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Sets the leader lease of this group in msecs, 0 to disable.
+
+void
+zyre_group_set_lease (zyre_group_t *self, int lease) {
+    assert (self);
+    self->lease = lease;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the fan-out of the relay tree we send SHOUTs on, 0 if none.
+
+int
+zyre_group_relay_fanout (zyre_group_t *self) {
+    assert (self);
+    return self->relay_fanout;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Sets the fan-out of the relay tree we send SHOUTs on, 0 for none.
+
+void
+zyre_group_set_relay_fanout (zyre_group_t *self, int fanout) {
+    assert (self);
+    self->relay_fanout = fanout;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the anycast policy of this group, a ZYRE_ANYCAST_* value.
+
+int
+zyre_group_anycast_policy (zyre_group_t *self) {
+    assert (self);
+    return self->anycast_policy;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Sets the anycast policy of this group, a ZYRE_ANYCAST_* value.
+
+void
+zyre_group_set_anycast_policy (zyre_group_t *self, int policy) {
+    assert (self);
+    self->anycast_policy = policy;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Returns true if this node has been elected leader of this group.
+
+bool
+zyre_group_leading (zyre_group_t *self) {
+    assert (self);
+    return self->leading;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Sets whether this node has been elected leader of this group.
+
+void
+zyre_group_set_leading (zyre_group_t *self, bool leading) {
+    assert (self);
+    self->leading = leading;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the leader whose lease has lapsed, if any.
+
+zyre_peer_t *
+zyre_group_lapsed (zyre_group_t *self) {
+    assert (self);
+    return self->lapsed;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Sets the leader whose lease has lapsed; this peer does not take part in
+//  elections until it is cleared again, when it challenges for the group
+//  or when we support a challenger that counts it again.
+
+void
+zyre_group_set_lapsed (zyre_group_t *self, zyre_peer_t *lapsed) {
+    assert (self);
+    self->lapsed = lapsed;
 }
 
 
@@ -231,6 +1113,7 @@ zyre_group_test (bool verbose)
     assert (zyre_peer_connected (peer));
 
     zyre_group_join (group, peer);
+    assert (zyre_group_has_peer (group, peer));
 
     zre_msg_t *msg = zre_msg_new ();
     zre_msg_set_id (msg, ZRE_MSG_HELLO);
@@ -245,6 +1128,135 @@ zyre_group_test (bool verbose)
 
     zre_msg_destroy (&msg);
 
+    //  A lapsed leader does not take part in elections
+    zlist_t *voters = zyre_group_voters (group);
+    assert (zlist_size (voters) == 1);
+    zlist_destroy (&voters);
+    zyre_group_set_lapsed (group, peer);
+    voters = zyre_group_voters (group);
+    assert (zlist_size (voters) == 0);
+    zlist_destroy (&voters);
+    zyre_group_leave (group, peer);
+    assert (zyre_group_lapsed (group) == NULL);
+
+    //  A peer that relays gets a SHOUT as RELAY, bound to itself when it
+    //  is the last in its range
+    zhash_t *headers = zhash_new ();
+    zhash_insert (headers, "X-ZRE-FEATURES", ZYRE_PEER_FEATURES);
+    zyre_peer_set_headers (peer, headers);
+    zhash_destroy (&headers);
+    zyre_group_join (group, peer);
+    zyre_group_set_relay_fanout (group, 4);
+    msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_SHOUT);
+    zre_msg_set_group (msg, "tests");
+    zyre_group_send_relay (group, &msg, me);
+
+    msg = zre_msg_new ();
+    rc = zre_msg_recv (msg, mailbox);
+    assert (rc == 0);
+    assert (zre_msg_id (msg) == ZRE_MSG_RELAY);
+    assert (zre_msg_serial (msg) == 1);
+    assert (zre_msg_fanout (msg) == 4);
+    assert (memcmp (zre_msg_origin (msg), zuuid_data (me), ZUUID_LEN) == 0);
+    assert (memcmp (zre_msg_bound (msg), zuuid_data (you), ZUUID_LEN) == 0);
+    zre_msg_destroy (&msg);
+
+    //  Anycast goes round the peers in turn, or to the peer with fewest
+    //  unanswered messages, and a key always goes to the same peer
+    zuuid_t *other = zuuid_new ();
+    zyre_peer_t *other_peer = zyre_peer_new (peers, other);
+    zyre_group_join (group, other_peer);
+    zyre_peer_t *first = zyre_group_anycast_peer (group, NULL);
+    assert (first);
+    zyre_peer_t *second = zyre_group_anycast_peer (group, NULL);
+    assert (second && second != first);
+    assert (zyre_group_anycast_peer (group, NULL) == first);
+    zyre_group_set_anycast_policy (group, ZYRE_ANYCAST_LEAST_OUTSTANDING);
+    zyre_peer_set_outstanding (first, 2);
+    zyre_peer_set_outstanding (second, 1);
+    assert (zyre_group_anycast_peer (group, NULL) == second);
+    zyre_peer_set_outstanding (first, 0);
+    zyre_peer_set_outstanding (second, 0);
+    zyre_peer_t *owner = zyre_group_anycast_peer (group, "key");
+    int count;
+    for (count = 0; count < 10; count++)
+        assert (zyre_group_anycast_peer (group, "key") == owner);
+    assert (owner == zyre_group_owner_peer (group, "key"));
+
+    //  Any thread can look up the owner of a key in a shared group, and
+    //  keys stay with their owners while other peers leave
+    zhash_t *rings = zhash_new ();
+    zyre_group_share (group, rings);
+    zyre_peer_t *owners [20];
+    char key [16];
+    for (count = 0; count < 20; count++) {
+        snprintf (key, sizeof (key), "key-%d", count);
+        owners [count] = zyre_group_owner_peer (group, key);
+        assert (owners [count]);
+        char *uuid = zyre_group_find_owner (rings, "tests", key);
+        assert (uuid && streq (uuid, zyre_peer_identity (owners [count])));
+        zstr_free (&uuid);
+    }
+    zyre_group_leave (group, other_peer);
+    for (count = 0; count < 20; count++) {
+        snprintf (key, sizeof (key), "key-%d", count);
+        if (owners [count] == peer)
+            assert (zyre_group_owner_peer (group, key) == peer);
+    }
+    zyre_group_leave (group, peer);
+    assert (zyre_group_owner_peer (group, "key") == NULL);
+    assert (zyre_group_find_owner (rings, "tests", "key") == NULL);
+    assert (zyre_group_find_owner (rings, "nothing", "key") == NULL);
+
+    //  The store sends our writes to peers, and keeps the later of two
+    //  writes to a key whatever order they come in
+    zyre_group_join (group, peer);
+    zyre_group_store_write (group, "colour", "red", me);
+    char *value = zyre_group_find_value (rings, "tests", "colour");
+    assert (value && streq (value, "red"));
+    zstr_free (&value);
+    msg = zre_msg_new ();
+    rc = zre_msg_recv (msg, mailbox);
+    assert (rc == 0);
+    assert (zre_msg_id (msg) == ZRE_MSG_STORE_SET);
+    assert (streq (zre_msg_key (msg), "colour"));
+    assert (zre_msg_stamp (msg) == 1);
+    assert (memcmp (zre_msg_origin (msg), zuuid_data (me), ZUUID_LEN) == 0);
+    zre_msg_set_origin (msg, (byte *) zuuid_data (you));
+    zre_msg_set_stamp (msg, 5);
+    zmsg_t *content = zmsg_new ();
+    zmsg_addstr (content, "blue");
+    zre_msg_set_content (msg, &content);
+    assert (zyre_group_store_take (group, msg));
+    zre_msg_set_stamp (msg, 3);
+    content = zmsg_new ();
+    zmsg_addstr (content, "green");
+    zre_msg_set_content (msg, &content);
+    assert (!zyre_group_store_take (group, msg));
+    value = zyre_group_find_value (rings, "tests", "colour");
+    assert (value && streq (value, "blue"));
+    zstr_free (&value);
+    zlist_t *keys = zyre_group_find_keys (rings, "tests");
+    assert (zlist_size (keys) == 1);
+    zlist_destroy (&keys);
+    zre_msg_destroy (&msg);
+
+    //  A peer that syncs with an empty clock gets every write we have
+    msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_STORE_SYNC);
+    zyre_group_store_answer (group, peer, msg);
+    zre_msg_destroy (&msg);
+    msg = zre_msg_new ();
+    rc = zre_msg_recv (msg, mailbox);
+    assert (rc == 0);
+    assert (zre_msg_id (msg) == ZRE_MSG_STORE_SET);
+    assert (zre_msg_stamp (msg) == 5);
+    zre_msg_destroy (&msg);
+    zyre_group_leave (group, peer);
+    zhash_destroy (&rings);
+    zuuid_destroy (&other);
+
     zuuid_destroy (&me);
     zuuid_destroy (&you);
     zhash_destroy (&peers);
@@ -36,15 +36,113 @@ ZYRE_PRIVATE void
 ZYRE_PRIVATE void
     zyre_group_leave (zyre_group_t *self, zyre_peer_t *peer);
 
+//  Return true if peer is in group
+ZYRE_PRIVATE bool
+    zyre_group_has_peer (zyre_group_t *self, zyre_peer_t *peer);
+
 //  Send message to all peers in group
 ZYRE_PRIVATE void
     zyre_group_send (zyre_group_t *self, zre_msg_t **msg_p);
 
+//  Send message to all peers in group, giving peers that can take it the
+//  compressed form instead
+ZYRE_PRIVATE void
+    zyre_group_send_compressed (zyre_group_t *self, zre_msg_t **msg_p,
+                                zre_msg_t **compressed_p, uint32_t dict_id);
+
+//  Send message to the peers in group that don't take the group's SHOUTs
+//  on the multicast endpoint; returns the number of peers that do
+ZYRE_PRIVATE size_t
+    zyre_group_send_multicast (zyre_group_t *self, zre_msg_t **msg_p,
+                               const char *endpoint);
+
+//  Send a SHOUT from us down a relay tree of the peers in group that relay,
+//  and directly to the other peers
+ZYRE_PRIVATE void
+    zyre_group_send_relay (zyre_group_t *self, zre_msg_t **msg_p, zuuid_t *origin);
+
+//  Relay a RELAY message we got on to the rest of the peers it is bound
+//  for. Returns -1 if we don't know all of them.
+ZYRE_PRIVATE int
+    zyre_group_relay (zyre_group_t *self, zre_msg_t *msg, zuuid_t *us);
+
+//  Send a RELAY message a peer gave back to us directly to the rest of the
+//  peers in its range
+ZYRE_PRIVATE void
+    zyre_group_relay_direct (zyre_group_t *self, zre_msg_t *msg, const char *low);
+
+//  Return the peer in group that owns key on the group's ring, or NULL if
+//  the group has no peers
+ZYRE_PRIVATE zyre_peer_t *
+    zyre_group_owner_peer (zyre_group_t *self, const char *key);
+
+//  Share group in a table of groups by name, so other threads can look up
+//  key owners with zyre_group_find_owner
+ZYRE_PRIVATE void
+    zyre_group_share (zyre_group_t *self, zhash_t *rings);
+
+//  Destroy a table of shared groups, so no other thread can look into the
+//  groups once their owner starts to destroy them and their peers
+ZYRE_PRIVATE void
+    zyre_group_unshare_all (zhash_t **rings_p);
+
+//  Return the UUID of the peer that owns key in the named group, from a
+//  table of shared groups, or NULL. Safe to call from any thread. Caller
+//  owns the returned string.
+ZYRE_PRIVATE char *
+    zyre_group_find_owner (zhash_t *rings, const char *name, const char *key);
+
+//  Write a value to the group's store, or delete the key if value is NULL,
+//  and send the write to the peers in group that keep stores
+ZYRE_PRIVATE void
+    zyre_group_store_write (zyre_group_t *self, const char *key, const char *value,
+                            zuuid_t *us);
+
+//  Apply a STORE-SET from a peer to the group's store. Returns true if the
+//  write won over the one we had for the key.
+ZYRE_PRIVATE bool
+    zyre_group_store_take (zyre_group_t *self, zre_msg_t *msg);
+
+//  Ask peer, or all peers in group if NULL, for the writes to the group's
+//  store that we don't have
+ZYRE_PRIVATE void
+    zyre_group_store_sync (zyre_group_t *self, zyre_peer_t *peer);
+
+//  Answer a STORE-SYNC from peer with the writes it doesn't have
+ZYRE_PRIVATE void
+    zyre_group_store_answer (zyre_group_t *self, zyre_peer_t *peer, zre_msg_t *msg);
+
+//  Return the value of key in the store of the named group, from a table of
+//  shared groups, or NULL. Safe to call from any thread. Caller owns the
+//  returned string.
+ZYRE_PRIVATE char *
+    zyre_group_find_value (zhash_t *groups, const char *name, const char *key);
+
+//  Return the keys in the store of the named group, from a table of shared
+//  groups. Safe to call from any thread.
+//  Caller owns return value and must destroy it when done.
+ZYRE_PRIVATE zlist_t *
+    zyre_group_find_keys (zhash_t *groups, const char *name);
+
+//  Return the peer in group to anycast to, by the group's anycast policy,
+//  or by key if not NULL; NULL if the group has no peers
+ZYRE_PRIVATE zyre_peer_t *
+    zyre_group_anycast_peer (zyre_group_t *self, const char *key);
+
+//  Send message to all peers in group except a lapsed leader
+ZYRE_PRIVATE void
+    zyre_group_send_voters (zyre_group_t *self, zre_msg_t **msg_p);
+
 //  Return zlist of peer ids currently in this group
 //  Caller owns return value and must destroy it when done.
 ZYRE_PRIVATE zlist_t *
    zyre_group_peers (zyre_group_t *self);
 
+//  Return zlist of peer ids that take part in elections for this group
+//  Caller owns return value and must destroy it when done.
+ZYRE_PRIVATE zlist_t *
+   zyre_group_voters (zyre_group_t *self);
+
 //  Find or create an election for a group
 zyre_election_t *
     zyre_group_require_election (zyre_group_t *self);
@@ -72,6 +170,46 @@ zyre_peer_t *
 void
     zyre_group_set_leader (zyre_group_t *self, zyre_peer_t *leader);
 
+//  Return the leader lease of this group in msecs, 0 if disabled.
+int
+    zyre_group_lease (zyre_group_t *self);
+
+//  Sets the leader lease of this group in msecs, 0 to disable.
+void
+    zyre_group_set_lease (zyre_group_t *self, int lease);
+
+//  Return the fan-out of the relay tree we send SHOUTs on, 0 if none.
+int
+    zyre_group_relay_fanout (zyre_group_t *self);
+
+//  Sets the fan-out of the relay tree we send SHOUTs on, 0 for none.
+void
+    zyre_group_set_relay_fanout (zyre_group_t *self, int fanout);
+
+//  Return the anycast policy of this group, a ZYRE_ANYCAST_* value.
+int
+    zyre_group_anycast_policy (zyre_group_t *self);
+
+//  Sets the anycast policy of this group, a ZYRE_ANYCAST_* value.
+void
+    zyre_group_set_anycast_policy (zyre_group_t *self, int policy);
+
+//  Returns true if this node has been elected leader of this group.
+bool
+    zyre_group_leading (zyre_group_t *self);
+
+//  Sets whether this node has been elected leader of this group.
+void
+    zyre_group_set_leading (zyre_group_t *self, bool leading);
+
+//  Return the leader whose lease has lapsed, if any.
+zyre_peer_t *
+    zyre_group_lapsed (zyre_group_t *self);
+
+//  Sets the leader whose lease has lapsed.
+void
+    zyre_group_set_lapsed (zyre_group_t *self, zyre_peer_t *lapsed);
+
 //  Self test of this class
 ZYRE_PRIVATE void
     zyre_group_test (bool verbose);
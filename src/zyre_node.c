@@ -15,6 +15,75 @@
 
 #include "zyre_classes.h"
 
+//  Peer connects waiting for the connect scheduler are queued by priority.
+//  Peers that greeted us and share one of our groups go first, then other
+//  peers that greeted us, then peers we only know of through discovery.
+
+#define PENDING_SHARED      0   //  Greeted us, in one of our groups
+#define PENDING_GREETED     1   //  Greeted us
+#define PENDING_DISCOVERED  2   //  Seen by discovery only
+#define PENDING_QUEUES      3
+
+//  Messages we hold for a peer that greeted us before we admit it
+#define PENDING_BACKLOG_MAX 1000
+
+//  Messages we take off a socket each time the poller wakes us, unless the
+//  application sets another budget
+#define RECV_BUDGET         32
+
+//  We hold back header changes this long, in msecs, so a burst of them
+//  goes to peers as one HEADERS message
+#define HEADERS_DELAY       100
+
+//  Size of stream chunks, and number of chunks a sender may have in flight
+#define STREAM_CHUNK        (256 * 1024)
+#define STREAM_WINDOW       16
+
+//  Largest SHOUT we multicast, as one UDP datagram; larger ones go over TCP
+#define MULTICAST_MAX_SIZE  8000
+
+//  Multicast uses libzmq's RADIO and DISH sockets, which are still draft
+#if defined (ZMQ_DISH) && defined (CZMQ_BUILD_DRAFT_API)
+#   define MULTICAST_UDP
+#endif
+
+//  We never decompress a content frame beyond this size
+#define COMPRESS_MAX_SIZE   (1024 * 1024 * 1024)
+
+#if defined (HAVE_LIBZSTD)
+#   include <zstd.h>
+#endif
+
+//  Streams read files through a mapping if they can map them
+#if defined (__UNIX__)
+#   define STREAM_MMAP
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+//  Applications that run the node in their own event loop wait on a single
+//  descriptor, where we can gather the ZMQ_FD of each socket we poll
+#if defined (__UTYPE_LINUX)
+#   define NODE_EPOLL
+#   include <sys/epoll.h>
+#endif
+
+//  Nodes that take messages by pointer register in a process-local
+//  directory, by UUID, while they run. Other nodes in the process look up
+//  a peer there before they connect to it, and if they find it, send to
+//  its direct inbox from the first message on.
+
+#if defined (__WINDOWS__)
+static SRWLOCK s_directory_lock = SRWLOCK_INIT;
+#   define DIRECTORY_LOCK   AcquireSRWLockExclusive (&s_directory_lock)
+#   define DIRECTORY_UNLOCK ReleaseSRWLockExclusive (&s_directory_lock)
+#else
+static pthread_mutex_t s_directory_lock = PTHREAD_MUTEX_INITIALIZER;
+#   define DIRECTORY_LOCK   pthread_mutex_lock (&s_directory_lock)
+#   define DIRECTORY_UNLOCK pthread_mutex_unlock (&s_directory_lock)
+#endif
+static zhash_t *s_directory = NULL;
+
 //  --------------------------------------------------------------------------
 //  Structure of our class
 
@@ -31,7 +100,13 @@ struct _zyre_node_t {
     uint64_t evasive_timeout;   //  Time since a message is received before a peer is considered evasive
     uint64_t expired_timeout;   //  Time since a message is received before a peer is considered gone
     size_t interval;            //  Beacon interval
-    zpoller_t *poller;          //  Socket poller
+    zlist_t *watched;           //  Sockets and actors we poll for input
+    zmq_pollitem_t *pollset;    //  Poll items for the watched sockets,
+                                //  then one for room in the outbox
+    void **polled;              //  Socket or actor for each poll item
+    size_t pollset_size;        //  Number of poll items
+    bool pollset_stale;         //  Rebuild poll items before next poll
+    int poll_fd;                //  Descriptor for embedding, or -1
     zactor_t *beacon;           //  Beacon actor
     zuuid_t *uuid;              //  Our UUID as object
     zsock_t *inbox;             //  Our inbox socket (ROUTER)
@@ -42,14 +117,76 @@ struct _zyre_node_t {
     byte status;                //  Our own change counter
     zhash_t *peers;             //  Hash of known peers, fast lookup
     zhash_t *peer_groups;       //  Groups that our peers are in
+    zhash_t *rings;             //  Same groups, shared with the API thread
     zlist_t *own_groups;        //  Groups that we are in
     zhash_t *headers;           //  Our header values
+    char *features;             //  Features we list in X-ZRE-FEATURES
+    bool ipc_upgrade;           //  Move peers on this host to IPC?
+    char *ipc_endpoint;         //  IPC endpoint we bound, if any
+    zhash_t *header_updates;    //  Changes to those peers haven't had yet
+    int64_t headers_at;         //  When we send those, 0 if none
+    uint32_t headers_version;   //  Number of times we sent changes
     zactor_t *gossip;           //  Gossip discovery service, if any
     char *gossip_bind;          //  Gossip bind endpoint, if any
     char *gossip_connect;       //  Gossip connect endpoint, if any
     char *public_key;           // Our curve public key
     char *secret_key;           // Our curve private key
+    zcert_t *cert;              //  Our curve keys, decoded once
     char *zap_domain;           // ZAP domain if any
+    int lease_interval;         //  Leader lease check interval, 0 if none
+    int64_t lease_at;           //  Next leader lease check
+    int64_t reaped_at;          //  When we last pinged and reaped peers
+    zhash_t *pending;           //  Peer connects waiting for admission
+    zlist_t *pending_queue [PENDING_QUEUES];    //  UUIDs of those, by priority
+    int connect_rate;           //  Peer connects per second, 0 if no limit
+    int max_handshakes;         //  Handshakes in flight, 0 if no limit
+    int handshakes;             //  Peers connected that haven't greeted us
+    double connect_tokens;      //  Peer connects we may make right now
+    int64_t connect_tokens_at;  //  When we last topped up connect tokens
+    zactor_t **workers;         //  Workers that own peer mailboxes, if any
+    int nbr_workers;            //  Number of workers
+    zsock_t *router;            //  Shared outbound socket, if any
+    uint32_t routes;            //  Peer connects made on shared socket
+    bool direct;                //  Exchange messages by pointer in-process?
+    zsock_t *direct_inbox;      //  Our direct inbox (PULL), if any
+    int recv_budget;            //  Messages we take off a socket per wakeup
+    uint64_t recv_bursts;       //  Wakeups that took peer messages
+    uint64_t recv_messages;     //  Peer messages those wakeups took
+    zyre_handler_fn *handler;   //  Application's event handler, if any
+    void *handler_arg;          //  Argument for event handler
+    int event_filter;           //  Events we deliver, ZYRE_EVENT_* flags
+    zlist_t *shout_prefixes;    //  Groups we deliver SHOUTs for, if any
+    zlist_t *backlog;           //  Events waiting for room in the outbox
+    size_t backlog_bytes;       //  Content size of those events
+    size_t outbox_max_events;   //  Events we hold, 0 if no limit
+    size_t outbox_max_bytes;    //  Event bytes we hold, 0 if no limit
+    uint64_t events_dropped;    //  Events dropped as the application lagged
+    zhash_t *outstreams;        //  Objects we stream to peers, by number
+    uint32_t last_stream;       //  Number of last stream we started
+    zhash_t *instreams;         //  Objects peers stream to us
+    char *stream_sink;          //  Directory we write streams to, if any
+    int compress_threshold;     //  Compress frames this size or over, 0 never
+    int compress_level;         //  zstd level, 0 for zstd's default
+    uint32_t compress_dict;     //  ID of our dictionary, 0 if none
+#if defined (HAVE_LIBZSTD)
+    ZSTD_CCtx *zstd_cctx;       //  Compression context
+    ZSTD_DCtx *zstd_dctx;       //  Decompression context
+    ZSTD_CDict *zstd_cdict;     //  Our dictionary, for compression
+    ZSTD_DDict *zstd_ddict;     //  Our dictionary, for decompression
+#endif
+    byte *compress_buffer;      //  Scratch buffer for compression
+    size_t compress_buffer_size;    //  Size of scratch buffer
+    uint64_t compress_bytes_in; //  Content bytes we compressed
+    uint64_t compress_bytes_out;    //  Size of those once compressed
+    int64_t compress_usecs;     //  Time we spent compressing
+    int64_t decompress_usecs;   //  Time we spent decompressing
+    zhash_t *multicast;         //  Groups we multicast SHOUTs for
+    zhash_t *histories;         //  SHOUTs we keep for groups, by group
+    zhash_t *requests;          //  Requests waiting for replies, by number
+    zlistx_t *request_timers;   //  Those with a timeout, soonest first
+    zhash_t *hello_states;      //  Our own states peers remember, by digest
+    zhash_t *hello_memory;      //  What peers that went knew, by UUID
+    zlist_t *hello_memory_order;    //  UUIDs of those, oldest first
 };
 
 //  Beacon frame has this format:
@@ -77,12 +214,53 @@ typedef struct {
     uint8_t public_key [32];
 } beacon_t;
 
+//  A peer connect waiting for admission by the connect scheduler
+
+typedef struct {
+    zuuid_t *uuid;              //  Peer identity
+    char *endpoint;             //  Peer endpoint
+    char *public_key;           //  Peer curve public key, if any
+    int queue;                  //  Which pending queue we're in
+    zlist_t *backlog;           //  Messages from peer, in arrival order
+} pending_t;
+
+//  A request we sent to a peer, waiting for its reply
+
+typedef struct {
+    uint64_t id;                //  Request number
+    char *peer;                 //  UUID of peer we asked
+    int64_t expires_at;         //  When we give up, if we have a timeout
+    void *timer;                //  Handle in request timers, if any
+} request_t;
+
+//  What a peer that went last knew of our groups and headers, and we of
+//  its, so that when it comes back with the same UUID our HELLOs need only
+//  carry what changed. We remember this for so many peers at most.
+
+#define HELLO_MEMORY_MAX 1024
+
+typedef struct {
+    uint64_t digest;            //  Digest of groups and headers
+    zlist_t *groups;            //  Group names
+    zhash_t *headers;           //  Header values
+    int refs;                   //  Peers that remember this state
+    bool shared;                //  Our own state, shared between peers?
+} hello_state_t;
+
+typedef struct {
+    hello_state_t *sent;        //  Our state as peer last knew it, if any
+    hello_state_t *received;    //  Peer's state as we last knew it, if any
+} hello_memory_t;
+
 //  --------------------------------------------------------------------------
 //  Local helper
 
 static zyre_group_t *
 zyre_node_require_peer_group (zyre_node_t *self, const char *name);
 
+static void
+zyre_node_forget_hello (zyre_node_t *self, const char *identity);
+
 static int
 s_string_compare (void *item1, void *item2)
 {
@@ -91,6 +269,37 @@ s_string_compare (void *item1, void *item2)
     return strcmp (str1, str2);
 }
 
+static void
+s_request_destroy (void *argument)
+{
+    request_t *request = (request_t *) argument;
+    free (request->peer);
+    free (request);
+}
+
+static int
+s_request_compare (const void *item1, const void *item2)
+{
+    const request_t *request1 = (const request_t *) item1;
+    const request_t *request2 = (const request_t *) item2;
+    return request1->expires_at < request2->expires_at? -1:
+           request1->expires_at > request2->expires_at? 1: 0;
+}
+
+static void
+s_pending_destroy (void *argument)
+{
+    pending_t *pending = (pending_t *) argument;
+    zre_msg_t *msg;
+    while ((msg = (zre_msg_t *) zlist_pop (pending->backlog)))
+        zre_msg_destroy (&msg);
+    zlist_destroy (&pending->backlog);
+    zuuid_destroy (&pending->uuid);
+    free (pending->endpoint);
+    free (pending->public_key);
+    free (pending);
+}
+
 static int64_t
 s_reap_interval (zyre_node_t *self)
 {
@@ -102,10 +311,90 @@ s_reap_interval (zyre_node_t *self)
     return interval;
 }
 
+//  --------------------------------------------------------------------------
+//  Add a socket or actor to, or remove it from, the embedding descriptor
+
+#if defined (NODE_EPOLL)
+static void
+s_poll_fd_ctl (zyre_node_t *self, int operation, void *handle)
+{
+    struct epoll_event event;
+    memset (&event, 0, sizeof (event));
+    event.events = EPOLLIN;
+    event.data.ptr = handle;
+    int rc = epoll_ctl (self->poll_fd, operation, zsock_fd (handle), &event);
+    assert (rc == 0);
+}
+#endif
+
+
+//  --------------------------------------------------------------------------
+//  Start polling a socket or actor for input
+
+static void
+zyre_node_watch (zyre_node_t *self, void *handle)
+{
+    if (zlist_exists (self->watched, handle))
+        return;
+    zlist_append (self->watched, handle);
+    self->pollset_stale = true;
+#if defined (NODE_EPOLL)
+    if (self->poll_fd != -1)
+        s_poll_fd_ctl (self, EPOLL_CTL_ADD, handle);
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Stop polling a socket or actor, before we destroy it
+
+static void
+zyre_node_unwatch (zyre_node_t *self, void *handle)
+{
+    if (!zlist_exists (self->watched, handle))
+        return;
+    zlist_remove (self->watched, handle);
+    self->pollset_stale = true;
+#if defined (NODE_EPOLL)
+    if (self->poll_fd != -1)
+        s_poll_fd_ctl (self, EPOLL_CTL_DEL, handle);
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Build the poll items for what we watch, when that changed. The last item
+//  waits for room in the outbox; we only poll it while we hold events.
+
+static void
+zyre_node_build_pollset (zyre_node_t *self)
+{
+    free (self->pollset);
+    free (self->polled);
+    self->pollset_size = zlist_size (self->watched);
+    self->pollset = (zmq_pollitem_t *) zmalloc ((self->pollset_size + 1) * sizeof (zmq_pollitem_t));
+    self->polled = (void **) zmalloc (self->pollset_size * sizeof (void *));
+    assert (self->pollset && self->polled);
+
+    size_t index = 0;
+    void *handle = zlist_first (self->watched);
+    while (handle) {
+        self->pollset [index].socket = zsock_resolve (handle);
+        self->pollset [index].events = ZMQ_POLLIN;
+        self->polled [index] = handle;
+        index++;
+        handle = zlist_next (self->watched);
+    }
+    self->pollset [index].socket = zsock_resolve (self->outbox);
+    self->pollset [index].events = ZMQ_POLLOUT;
+    self->pollset_stale = false;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Constructor
 
-static zyre_node_t *
+zyre_node_t *
 zyre_node_new (zsock_t *pipe, void *args)
 {
     zyre_node_t *self = (zyre_node_t *) zmalloc (sizeof (zyre_node_t));
@@ -121,7 +410,9 @@ zyre_node_new (zsock_t *pipe, void *args)
 
     self->pipe = pipe;
     self->outbox = (zsock_t *) args;
-    self->poller = zpoller_new (self->pipe, NULL);
+    self->watched = zlist_new ();
+    self->poll_fd = -1;
+    zyre_node_watch (self, self->pipe);
     self->beacon_port = ZRE_DISCOVERY_PORT;
     self->ephemeral_port = NULL; // random system assigned port
     self->evasive_timeout = 5000;
@@ -130,11 +421,41 @@ zyre_node_new (zsock_t *pipe, void *args)
     self->uuid = zuuid_new ();
     self->peers = zhash_new ();
     self->peer_groups = zhash_new ();
+    self->rings = zhash_new ();
+    self->requests = zhash_new ();
+    self->request_timers = zlistx_new ();
+    zlistx_set_comparator (self->request_timers, s_request_compare);
+    self->hello_states = zhash_new ();
+    self->hello_memory = zhash_new ();
+    self->hello_memory_order = zlist_new ();
+    zlist_autofree (self->hello_memory_order);
+    zlist_comparefn (self->hello_memory_order, s_string_compare);
     self->own_groups = zlist_new ();
     zlist_autofree (self->own_groups);
     zlist_comparefn (self->own_groups, s_string_compare);
     self->headers = zhash_new ();
     zhash_autofree (self->headers);
+    self->features = strdup (ZYRE_PEER_FEATURES);
+    self->header_updates = zhash_new ();
+    zhash_autofree (self->header_updates);
+    self->event_filter = ZYRE_EVENT_ALL;
+    self->recv_budget = RECV_BUDGET;
+    self->reaped_at = zclock_mono ();
+    self->shout_prefixes = zlist_new ();
+    zlist_autofree (self->shout_prefixes);
+    zlist_comparefn (self->shout_prefixes, s_string_compare);
+    self->backlog = zlist_new ();
+    self->outstreams = zhash_new ();
+    self->instreams = zhash_new ();
+    self->multicast = zhash_new ();
+    self->histories = zhash_new ();
+    self->pending = zhash_new ();
+    int queue;
+    for (queue = 0; queue < PENDING_QUEUES; queue++) {
+        self->pending_queue [queue] = zlist_new ();
+        zlist_autofree (self->pending_queue [queue]);
+        zlist_comparefn (self->pending_queue [queue], s_string_compare);
+    }
 
     self->beacon_version = BEACON_VERSION_V2;
     self->zap_domain = strdup(ZAP_DOMAIN_DEFAULT);
@@ -148,21 +469,119 @@ zyre_node_new (zsock_t *pipe, void *args)
 
 
 //  --------------------------------------------------------------------------
-//  Destructor
+//  Register or deregister a node in the process-local directory
 
 static void
+s_directory_register (const char *uuid, bool registered)
+{
+    DIRECTORY_LOCK;
+    if (registered) {
+        if (!s_directory)
+            s_directory = zhash_new ();
+        //  The item only marks the node as present
+        zhash_insert (s_directory, uuid, s_directory);
+    }
+    else
+    if (s_directory) {
+        zhash_delete (s_directory, uuid);
+        if (zhash_size (s_directory) == 0)
+            zhash_destroy (&s_directory);
+    }
+    DIRECTORY_UNLOCK;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return true if the node is in the process-local directory
+
+static bool
+s_directory_lookup (const char *uuid)
+{
+    DIRECTORY_LOCK;
+    bool found = s_directory && zhash_lookup (s_directory, uuid);
+    DIRECTORY_UNLOCK;
+    return found;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destructor
+
+void
 zyre_node_destroy (zyre_node_t **self_p)
 {
     assert (self_p);
     if (*self_p) {
         zyre_node_t *self = *self_p;
-        zpoller_destroy (&self->poller);
-        zuuid_destroy (&self->uuid);
-        zhash_destroy (&self->peers);
+        zlist_destroy (&self->watched);
+        free (self->pollset);
+        free (self->polled);
+#if defined (NODE_EPOLL)
+        if (self->poll_fd != -1)
+            close (self->poll_fd);
+#endif
+        //  Stop the API thread reading groups, then destroy the groups with
+        //  their rings and stores, which point at peers, before the peers
+        zyre_group_unshare_all (&self->rings);
         zhash_destroy (&self->peer_groups);
+        zhash_destroy (&self->peers);
+        //  Peers tell their workers to disconnect, so destroy workers after.
+        //  Let the worker pipes block again so the workers do get $TERM.
+        int worker;
+        for (worker = 0; worker < self->nbr_workers; worker++) {
+            zsock_set_sndtimeo (self->workers [worker], -1);
+            zactor_destroy (&self->workers [worker]);
+        }
+        free (self->workers);
+        zsock_destroy (&self->router);
+        if (self->direct_inbox) {
+            //  Destroy any messages that peers handed us but we never took
+            s_directory_register (zuuid_str (self->uuid), false);
+            zsock_set_rcvtimeo (self->direct_inbox, 0);
+            zre_msg_t *msg;
+            while (zsock_recv (self->direct_inbox, "p", &msg) == 0)
+                zre_msg_destroy (&msg);
+            zsock_destroy (&self->direct_inbox);
+        }
+        zuuid_destroy (&self->uuid);
+        zlistx_destroy (&self->request_timers);
+        while (zlist_size (self->hello_memory_order))
+            zyre_node_forget_hello (self, (const char *) zlist_first (self->hello_memory_order));
+        zhash_destroy (&self->hello_memory);
+        zhash_destroy (&self->hello_states);
+        zhash_destroy (&self->requests);
         zlist_destroy (&self->own_groups);
+        zlist_destroy (&self->shout_prefixes);
+        while (zlist_size (self->backlog)) {
+            zmsg_t *event = (zmsg_t *) zlist_pop (self->backlog);
+            zmsg_destroy (&event);
+        }
+        zlist_destroy (&self->backlog);
+        zhash_destroy (&self->outstreams);
+        zhash_destroy (&self->instreams);
+        zstr_free (&self->stream_sink);
+        zhash_destroy (&self->multicast);
+        zhash_destroy (&self->histories);
+#if defined (HAVE_LIBZSTD)
+        ZSTD_freeCCtx (self->zstd_cctx);
+        ZSTD_freeDCtx (self->zstd_dctx);
+        ZSTD_freeCDict (self->zstd_cdict);
+        ZSTD_freeDDict (self->zstd_ddict);
+#endif
+        free (self->compress_buffer);
         zhash_destroy (&self->headers);
+        zstr_free (&self->features);
+        zhash_destroy (&self->header_updates);
+        zhash_destroy (&self->pending);
+        int queue;
+        for (queue = 0; queue < PENDING_QUEUES; queue++)
+            zlist_destroy (&self->pending_queue [queue]);
         zsock_destroy (&self->inbox);
+        if (self->ipc_endpoint) {
+            //  Remove the socket file we created
+            zsys_file_delete (self->ipc_endpoint + strlen ("ipc://"));
+            zstr_free (&self->ipc_endpoint);
+        }
         zsock_destroy (&self->outbox);
         zactor_destroy (&self->beacon);
         zactor_destroy (&self->gossip);
@@ -171,6 +590,7 @@ zyre_node_destroy (zyre_node_t **self_p)
         zstr_free (&self->gossip_connect);
         zstr_free (&self->secret_key);
         zstr_free (&self->public_key);
+        zcert_destroy (&self->cert);
         zstr_free (&self->zap_domain);
         zstr_free (&self->advertised_endpoint);
         zstr_free (&self->ephemeral_port);
@@ -194,6 +614,354 @@ zyre_node_gossip_start (zyre_node_t *self)
     }
 }
 
+//  Return our curve keys as a certificate. The Z85 keys are decoded the
+//  first time we need them; the inbox and every peer mailbox then reuse
+//  the same certificate.
+
+static zcert_t *
+zyre_node_cert (zyre_node_t *self)
+{
+    if (!self->cert) {
+        assert (self->public_key);
+        assert (self->secret_key);
+
+        // convert keys from Z85 strings (40 bytes) to raw byte arrays (32 bytes)
+        byte public_key [32];
+        byte secret_key [32];
+        zmq_z85_decode (public_key, self->public_key);
+        zmq_z85_decode (secret_key, self->secret_key);
+        self->cert = zcert_new_from (public_key, secret_key);
+        assert (self->cert);
+    }
+    return self->cert;
+}
+
+//  Return a new event, with the type, peer UUID and peer name that all
+//  events start with
+
+static zmsg_t *
+s_event_new (const char *type, const char *uuid, const char *name)
+{
+    zmsg_t *event = zmsg_new ();
+    zmsg_addstr (event, type);
+    zmsg_addstr (event, uuid);
+    zmsg_addstr (event, name);
+    return event;
+}
+
+//  Return true if we deliver SHOUT events for this group
+
+static bool
+zyre_node_wants_shout (zyre_node_t *self, const char *group)
+{
+    if (!(self->event_filter & ZYRE_EVENT_SHOUT))
+        return false;
+    if (zlist_size (self->shout_prefixes) == 0)
+        return true;
+    const char *prefix = (const char *) zlist_first (self->shout_prefixes);
+    while (prefix) {
+        if (strncmp (group, prefix, strlen (prefix)) == 0)
+            return true;
+        prefix = (const char *) zlist_next (self->shout_prefixes);
+    }
+    return false;
+}
+
+//  Return true if we may drop this event when the application lags. We
+//  drop only traffic and liveness events; we always keep events that change
+//  membership, leadership or headers, requests the application must answer,
+//  and history it can't ask for again
+
+static bool
+s_event_droppable (zmsg_t *event)
+{
+    zframe_t *type = zmsg_first (event);
+    return zframe_streq (type, "WHISPER")
+        || zframe_streq (type, "SHOUT")
+        || zframe_streq (type, "EVASIVE")
+        || zframe_streq (type, "SILENT");
+}
+
+//  Return true if we hold more events than the outbox limits allow
+
+static bool
+zyre_node_backlog_full (zyre_node_t *self)
+{
+    return (self->outbox_max_events
+        &&  zlist_size (self->backlog) > self->outbox_max_events)
+        || (self->outbox_max_bytes
+        &&  self->backlog_bytes > self->outbox_max_bytes);
+}
+
+//  Hold an event until the outbox has room for it, dropping the oldest
+//  droppable events if we're over our limits; takes ownership of the event
+
+static void
+zyre_node_hold_event (zyre_node_t *self, zmsg_t **event_p)
+{
+    zlist_append (self->backlog, *event_p);
+    self->backlog_bytes += zmsg_content_size (*event_p);
+    *event_p = NULL;
+
+    zmsg_t *event = (zmsg_t *) zlist_first (self->backlog);
+    while (event && zyre_node_backlog_full (self)) {
+        if (s_event_droppable (event)) {
+            zlist_remove (self->backlog, event);
+            self->backlog_bytes -= zmsg_content_size (event);
+            zmsg_destroy (&event);
+            self->events_dropped++;
+        }
+        event = (zmsg_t *) zlist_next (self->backlog);
+    }
+}
+
+//  Send held events to the application for as long as the outbox has room.
+//  A PAIR socket takes a whole message once it takes the first frame, so
+//  we only have to check for room before each event.
+
+static void
+zyre_node_flush_events (zyre_node_t *self)
+{
+    while (zlist_size (self->backlog)
+    &&    (zsock_events (self->outbox) & ZMQ_POLLOUT)) {
+        zmsg_t *event = (zmsg_t *) zlist_pop (self->backlog);
+        self->backlog_bytes -= zmsg_content_size (event);
+        zmsg_send (&event, self->outbox);
+    }
+}
+
+//  Deliver an event to the application, either through the outbox or to
+//  its handler, which borrows the event; takes ownership of the event.
+//  We never wait for the application: if the outbox is full, we hold the
+//  event until it has room.
+
+static void
+zyre_node_emit (zyre_node_t *self, zmsg_t **event_p)
+{
+    if (self->handler) {
+        (self->handler) (*event_p, self->handler_arg);
+        zmsg_destroy (event_p);
+    }
+    else {
+        zyre_node_flush_events (self);
+        if (zlist_size (self->backlog) == 0
+        && (zsock_events (self->outbox) & ZMQ_POLLOUT))
+            zmsg_send (event_p, self->outbox);
+        else
+            zyre_node_hold_event (self, event_p);
+    }
+}
+
+//  Return a copy of a WHISPER or SHOUT with its large content frames
+//  compressed, as a WHISPER-ZSTD or SHOUT-ZSTD, or NULL if compressing
+//  saves nothing.
+
+static zre_msg_t *
+zyre_node_compress (zyre_node_t *self, zre_msg_t *msg)
+{
+#if defined (HAVE_LIBZSTD)
+    if (!self->zstd_cctx)
+        self->zstd_cctx = ZSTD_createCCtx ();
+    zmsg_t *content = zmsg_new ();
+    uint64_t compressed = 0;
+    int64_t started = zclock_usecs ();
+    int index = 0;
+    zframe_t *frame = zre_msg_content (msg)? zmsg_first (zre_msg_content (msg)): NULL;
+    while (frame) {
+        size_t size = zframe_size (frame);
+        zframe_t *copy = NULL;
+        if (index < 64 && size >= (size_t) self->compress_threshold) {
+            size_t bound = ZSTD_compressBound (size);
+            if (self->compress_buffer_size < bound) {
+                free (self->compress_buffer);
+                self->compress_buffer = (byte *) zmalloc (bound);
+                self->compress_buffer_size = bound;
+            }
+            size_t rc = self->zstd_cdict?
+                ZSTD_compress_usingCDict (self->zstd_cctx, self->compress_buffer, bound,
+                                          zframe_data (frame), size, self->zstd_cdict):
+                ZSTD_compressCCtx (self->zstd_cctx, self->compress_buffer, bound,
+                                   zframe_data (frame), size, self->compress_level);
+            if (!ZSTD_isError (rc) && rc < size) {
+                copy = zframe_new (self->compress_buffer, rc);
+                compressed |= (uint64_t) 1 << index;
+                self->compress_bytes_in += size;
+                self->compress_bytes_out += rc;
+            }
+        }
+        if (!copy)
+            copy = zframe_dup (frame);
+        zmsg_append (content, &copy);
+        frame = zmsg_next (zre_msg_content (msg));
+        index++;
+    }
+    self->compress_usecs += zclock_usecs () - started;
+    if (!compressed) {
+        zmsg_destroy (&content);
+        return NULL;
+    }
+    zre_msg_t *copy = zre_msg_new ();
+    if (zre_msg_id (msg) == ZRE_MSG_SHOUT) {
+        zre_msg_set_id (copy, ZRE_MSG_SHOUT_ZSTD);
+        zre_msg_set_group (copy, zre_msg_group (msg));
+    }
+    else
+        zre_msg_set_id (copy, ZRE_MSG_WHISPER_ZSTD);
+    zre_msg_set_compressed (copy, compressed);
+    zre_msg_set_content (copy, &content);
+    return copy;
+#else
+    return NULL;
+#endif
+}
+
+//  Turn a WHISPER-ZSTD or SHOUT-ZSTD back into a plain WHISPER or SHOUT.
+//  Returns 0 if OK, -1 if we could not decompress the content.
+
+static int
+zyre_node_decompress (zyre_node_t *self, zre_msg_t *msg)
+{
+    if (zre_msg_id (msg) != ZRE_MSG_WHISPER_ZSTD
+    &&  zre_msg_id (msg) != ZRE_MSG_SHOUT_ZSTD)
+        return 0;
+#if defined (HAVE_LIBZSTD)
+    if (!self->zstd_dctx)
+        self->zstd_dctx = ZSTD_createDCtx ();
+    zmsg_t *content = zre_msg_get_content (msg);
+    zmsg_t *plain = zmsg_new ();
+    int64_t started = zclock_usecs ();
+    int index = 0;
+    int rc = 0;
+    zframe_t *frame;
+    while (content && (frame = zmsg_pop (content))) {
+        if (index < 64 && (zre_msg_compressed (msg) & ((uint64_t) 1 << index))) {
+            //  Don't let a peer make us allocate more than we'd ever send
+            unsigned long long size = ZSTD_getFrameContentSize (zframe_data (frame), zframe_size (frame));
+            if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR
+            ||  size > COMPRESS_MAX_SIZE) {
+                zframe_destroy (&frame);
+                rc = -1;
+                break;
+            }
+            zframe_t *inflated = zframe_new (NULL, (size_t) size);
+            size_t inflated_size;
+            if (self->zstd_ddict
+            &&  ZSTD_getDictID_fromFrame (zframe_data (frame), zframe_size (frame)) == self->compress_dict)
+                inflated_size = ZSTD_decompress_usingDDict (self->zstd_dctx,
+                    zframe_data (inflated), zframe_size (inflated),
+                    zframe_data (frame), zframe_size (frame), self->zstd_ddict);
+            else
+                inflated_size = ZSTD_decompressDCtx (self->zstd_dctx,
+                    zframe_data (inflated), zframe_size (inflated),
+                    zframe_data (frame), zframe_size (frame));
+            zframe_destroy (&frame);
+            if (ZSTD_isError (inflated_size) || inflated_size != size) {
+                zframe_destroy (&inflated);
+                rc = -1;
+                break;
+            }
+            frame = inflated;
+        }
+        zmsg_append (plain, &frame);
+        index++;
+    }
+    self->decompress_usecs += zclock_usecs () - started;
+    zmsg_destroy (&content);
+    if (rc == 0) {
+        zre_msg_set_id (msg, zre_msg_id (msg) == ZRE_MSG_SHOUT_ZSTD? ZRE_MSG_SHOUT: ZRE_MSG_WHISPER);
+        zre_msg_set_content (msg, &plain);
+    }
+    zmsg_destroy (&plain);
+    return rc;
+#else
+    //  We don't advertise zstd, so no peer should send it to us
+    return -1;
+#endif
+}
+
+
+//  Send content to peer as a WHISPER, compressed if the peer takes it
+
+static void
+zyre_node_send_whisper (zyre_node_t *self, zyre_peer_t *peer, zmsg_t **content_p)
+{
+    zre_msg_t *msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_WHISPER);
+    zre_msg_set_content (msg, content_p);
+    if (self->compress_threshold
+    &&  zyre_peer_takes_compressed (peer, self->compress_dict)) {
+        zre_msg_t *compressed = zyre_node_compress (self, msg);
+        if (compressed) {
+            zre_msg_destroy (&msg);
+            msg = compressed;
+        }
+    }
+    zyre_peer_send (peer, &msg);
+}
+
+//  Tell the application a request will get no reply, and why
+
+static void
+zyre_node_noreply (zyre_node_t *self, const char *identity, uint64_t id, const char *reason)
+{
+    if (self->event_filter & ZYRE_EVENT_REPLY) {
+        zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, identity);
+        zmsg_t *event = s_event_new ("NOREPLY", identity, peer? zyre_peer_name (peer): "");
+        zmsg_addstrf (event, "%" PRIu64, id);
+        zmsg_addstr (event, reason);
+        zyre_node_emit (self, &event);
+    }
+}
+
+//  Stop waiting for the reply to a request
+
+static void
+zyre_node_forget_request (zyre_node_t *self, request_t *request)
+{
+    char key [21];
+    snprintf (key, sizeof (key), "%" PRIu64, request->id);
+    if (request->timer)
+        zlistx_delete (self->request_timers, request->timer);
+    zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, request->peer);
+    if (peer && zyre_peer_outstanding (peer))
+        zyre_peer_set_outstanding (peer, zyre_peer_outstanding (peer) - 1);
+    zhash_delete (self->requests, key);
+}
+
+//  Send a request to a peer, and wait for its reply for up to timeout
+//  msecs, or for as long as the peer is there if timeout is 0; we fail
+//  the request at once if the peer can't take it
+
+static void
+zyre_node_send_request (zyre_node_t *self, const char *identity, uint64_t id,
+                        int timeout, zmsg_t **content_p)
+{
+    zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, identity);
+    if (!peer || !(zyre_peer_features (peer) & ZYRE_PEER_FEATURE_RPC)) {
+        zyre_node_noreply (self, identity, id, peer? "unsupported": "unknown");
+        zmsg_destroy (content_p);
+        return;
+    }
+    request_t *request = (request_t *) zmalloc (sizeof (request_t));
+    request->id = id;
+    request->peer = strdup (identity);
+    char key [21];
+    snprintf (key, sizeof (key), "%" PRIu64, id);
+    zhash_update (self->requests, key, request);
+    zhash_freefn (self->requests, key, s_request_destroy);
+    if (timeout > 0) {
+        request->expires_at = zclock_mono () + timeout;
+        //  Requests mostly have the same timeout, so search from the end
+        request->timer = zlistx_insert (self->request_timers, request, false);
+    }
+    zyre_peer_set_outstanding (peer, zyre_peer_outstanding (peer) + 1);
+    zre_msg_t *msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_REQUEST);
+    zre_msg_set_correlation (msg, id);
+    zre_msg_set_content (msg, content_p);
+    zyre_peer_send (peer, &msg);
+}
+
 //  Start node, return 0 if OK, 1 if not possible
 
 static int
@@ -204,33 +972,33 @@ zyre_node_start (zyre_node_t *self)
         if (self->verbose)
             zsys_debug ("applying zcert to ->inbox");
 
-        assert (self->public_key);
-        assert (self->secret_key);
-
-        // zarmour use for string conversion
-        zarmour_t *armour = zarmour_new ();
-        zarmour_set_mode (armour, ZARMOUR_MODE_Z85);
-        zarmour_set_pad (armour, false);
-        zarmour_set_line_breaks (armour, false);
-
-        // convert keys from Z85 strings (40 bytes) to raw byte arrays (32 bytes)
-        zchunk_t *decoded_public_key =
-          zarmour_decode (armour, self->public_key);
-        zchunk_t *decoded_secret_key =
-          zarmour_decode (armour, self->secret_key);
-
-         // create zcert from the decoded keys
-        zcert_t *cert = zcert_new_from (zchunk_data (decoded_public_key),
-                                        zchunk_data (decoded_secret_key));
-
-        zcert_apply(cert, self->inbox);
+        zcert_apply (zyre_node_cert (self), self->inbox);
         zsock_set_curve_server (self->inbox, 1);
         zsock_set_zap_domain (self->inbox, self->zap_domain);
+    }
 
-        zcert_destroy (&cert);
-        zchunk_destroy (&decoded_secret_key);
-        zchunk_destroy (&decoded_public_key);
-        zarmour_destroy (&armour);
+#if defined (__UNIX__)
+    //  Peers on this host can reach us over IPC, which is cheaper than
+    //  loopback TCP; they find the endpoint in our HELLO headers
+    if (self->ipc_upgrade && !self->ipc_endpoint
+    &&  (!self->endpoint || strncmp (self->endpoint, "tcp://", 6) == 0)) {
+        self->ipc_endpoint = zsys_sprintf ("ipc:///tmp/zyre-%s", zuuid_str (self->uuid));
+        if (zsock_bind (self->inbox, "%s", self->ipc_endpoint))
+            zstr_free (&self->ipc_endpoint);
+    }
+#endif
+
+    //  Peers in this process cannot hand us messages by pointer if we
+    //  need CURVE to authenticate them
+    if (self->direct && !self->secret_key) {
+        if (!self->direct_inbox) {
+            char *endpoint = zsys_sprintf ("@" ZYRE_PEER_DIRECT_ENDPOINT, zuuid_str (self->uuid));
+            self->direct_inbox = zsock_new_pull (endpoint);
+            zstr_free (&endpoint);
+            assert (self->direct_inbox);
+        }
+        s_directory_register (zuuid_str (self->uuid), true);
+        zyre_node_watch (self, self->direct_inbox);
     }
 
     if (self->beacon_port) {
@@ -291,9 +1059,9 @@ zyre_node_start (zyre_node_t *self)
         zstr_free (&published_endpoint);
 
         //  Start polling on zgossip
-        zpoller_add (self->poller, self->gossip);
+        zyre_node_watch (self, self->gossip);
         //  Start polling on inbox
-        zpoller_add(self->poller, self->inbox);
+        zyre_node_watch (self, self->inbox);
     }
 
     // this needs to be tested after bind
@@ -339,15 +1107,18 @@ zyre_node_stop (zyre_node_t *self)
         zsock_send (self->beacon, "sbi", "PUBLISH",
             (byte *) &beacon, BEACON_SIZE(beacon), self->interval);
         zclock_sleep (1);           //  Allow 1 msec for beacon to go out
-        zpoller_remove (self->poller, self->beacon);
+        zyre_node_unwatch (self, self->beacon);
         zactor_destroy (&self->beacon);
     }
 
     //  Stop polling on inbox and stop outbox
-    zpoller_remove (self->poller, self->inbox);
-    zstr_sendm (self->outbox, "STOP");
-    zstr_sendm (self->outbox, zuuid_str (self->uuid));
-    zstr_send (self->outbox, self->name);
+    zyre_node_unwatch (self, self->inbox);
+    if (self->direct_inbox) {
+        s_directory_register (zuuid_str (self->uuid), false);
+        zyre_node_unwatch (self, self->direct_inbox);
+    }
+    zmsg_t *event = s_event_new ("STOP", zuuid_str (self->uuid), self->name);
+    zyre_node_emit (self, &event);
     return 0;
 }
 
@@ -418,6 +1189,9 @@ zyre_node_dump (zyre_node_t *self)
     for (item = zhash_first (self->peers); item != NULL;
             item = zhash_next (self->peers))
         zyre_node_log_peer((zyre_peer_t *)item);
+    if (zhash_size (self->pending))
+        zsys_info (" - pending peers=%zu, handshakes=%d",
+                   zhash_size (self->pending), self->handshakes);
 
     zsys_info (" - own groups=%zu:", zlist_size (self->own_groups));
     const char *group = (const char *) zlist_first (self->own_groups);
@@ -446,29 +1220,471 @@ zyre_node_dump (zyre_node_t *self)
 }
 
 
-//  Here we handle the different control messages from the front-end
+//  A group can keep the SHOUTs we send it, so that peers that join later
+//  can catch up. A peer that wants to sends us CATCHUP just before its
+//  JOIN, so the SHOUTs we replay as HISTORY are those it missed, and from
+//  its JOIN on it gets our SHOUTs as usual. Each peer only replays its own
+//  SHOUTs, so a joiner gets each SHOUT once however many peers it asks.
+//  We number the SHOUTs we keep, and note our number when a peer leaves
+//  the group, so a peer that comes back only gets what it missed.
 
-// Forward declaration so that REQUIRE PEER works
-static zyre_peer_t *
-zyre_node_require_peer (zyre_node_t *self, zuuid_t *uuid, const char *endpoint, const char *public_key);
+typedef struct {
+    int64_t sent_at;            //  When we sent the SHOUT
+    uint32_t serial;            //  Our number for it in the group
+    zmsg_t *content;            //  What we sent
+} history_item_t;
+
+typedef struct {
+    int max_messages;           //  SHOUTs we keep, 0 if no limit
+    int max_age;                //  Msecs we keep them, 0 if no limit
+    size_t max_bytes;           //  Content bytes we keep, 0 if no limit
+    zlist_t *items;             //  SHOUTs we kept, oldest first
+    size_t bytes;               //  Content size of those
+    uint32_t serial;            //  Number of the last SHOUT we kept
+    zhash_t *left;              //  Our number when peers left, by UUID
+} history_t;
 
 static void
-zyre_node_recv_api (zyre_node_t *self)
+s_history_destroy (void *argument)
 {
-    //  Get the whole message off the pipe in one go
-    zmsg_t *request = zmsg_recv (self->pipe);
-    if (!request)
-        return;                 //  Interrupted
-
-    char *command = zmsg_popstr (request);
+    history_t *history = (history_t *) argument;
+    history_item_t *item;
+    while ((item = (history_item_t *) zlist_pop (history->items))) {
+        zmsg_destroy (&item->content);
+        free (item);
+    }
+    zlist_destroy (&history->items);
+    zhash_destroy (&history->left);
+    free (history);
+}
 
-    if (self->verbose)
-        zsys_debug ("%s:     API command=%s", self->name, command);
+//  Keep a group's SHOUTs, as many and as long as the limits allow; all
+//  limits 0 means we stop keeping them
 
-    if (streq (command, "UUID"))
-        zstr_send (self->pipe, zuuid_str (self->uuid));
-    else
-    if (streq (command, "NAME"))
+static void
+zyre_node_set_history (zyre_node_t *self, const char *group,
+                       int max_messages, int max_age, size_t max_bytes)
+{
+    if (!max_messages && !max_age && !max_bytes) {
+        zhash_delete (self->histories, group);
+        return;
+    }
+    history_t *history = (history_t *) zhash_lookup (self->histories, group);
+    if (!history) {
+        history = (history_t *) zmalloc (sizeof (history_t));
+        history->items = zlist_new ();
+        history->left = zhash_new ();
+        zhash_autofree (history->left);
+        zhash_insert (self->histories, group, history);
+        zhash_freefn (self->histories, group, s_history_destroy);
+    }
+    history->max_messages = max_messages;
+    history->max_age = max_age;
+    history->max_bytes = max_bytes;
+}
+
+//  Drop the oldest SHOUTs we kept until we're within the limits, and
+//  forget where peers left before the oldest one we still have
+
+static void
+zyre_node_trim_history (zyre_node_t *self, history_t *history)
+{
+    int64_t now = zclock_mono ();
+    history_item_t *item = (history_item_t *) zlist_first (history->items);
+    while (item
+       && ((history->max_messages && zlist_size (history->items) > (size_t) history->max_messages)
+       ||  (history->max_bytes && history->bytes > history->max_bytes)
+       ||  (history->max_age && now - item->sent_at > history->max_age))) {
+        zlist_remove (history->items, item);
+        history->bytes -= zmsg_content_size (item->content);
+        zmsg_destroy (&item->content);
+        free (item);
+        item = (history_item_t *) zlist_first (history->items);
+    }
+    uint32_t oldest = item? item->serial: history->serial + 1;
+    zlist_t *gone = zlist_new ();
+    const char *serial;
+    for (serial = (const char *) zhash_first (history->left); serial;
+            serial = (const char *) zhash_next (history->left))
+        if ((uint32_t) atol (serial) + 1 < oldest)
+            zlist_append (gone, (void *) zhash_cursor (history->left));
+    const char *identity;
+    while ((identity = (const char *) zlist_pop (gone)))
+        zhash_delete (history->left, identity);
+    zlist_destroy (&gone);
+}
+
+//  Keep a copy of a SHOUT we send to a group, if we keep its SHOUTs
+
+static void
+zyre_node_keep_history (zyre_node_t *self, const char *group, zmsg_t *content)
+{
+    history_t *history = (history_t *) zhash_lookup (self->histories, group);
+    if (!history)
+        return;
+    history_item_t *item = (history_item_t *) zmalloc (sizeof (history_item_t));
+    item->sent_at = zclock_mono ();
+    item->serial = ++history->serial;
+    item->content = zmsg_dup (content);
+    zlist_append (history->items, item);
+    history->bytes += zmsg_content_size (item->content);
+    zyre_node_trim_history (self, history);
+}
+
+//  Note our number for a group's SHOUTs when a peer leaves it, so if it
+//  comes back it only catches up on what it missed
+
+static void
+zyre_node_history_left (zyre_node_t *self, zyre_peer_t *peer, const char *group)
+{
+    history_t *history = (history_t *) zhash_lookup (self->histories, group);
+    if (history) {
+        char serial [11];
+        snprintf (serial, sizeof (serial), "%" PRIu32, history->serial);
+        zhash_update (history->left, zyre_peer_identity (peer), serial);
+    }
+}
+
+//  Replay the SHOUTs we kept for a group to a peer that is about to join
+//  it, as HISTORY, skipping those it had before it last left
+
+static void
+zyre_node_replay_history (zyre_node_t *self, zyre_peer_t *peer, const char *group)
+{
+    history_t *history = (history_t *) zhash_lookup (self->histories, group);
+    if (!history)
+        return;
+    zyre_node_trim_history (self, history);
+    const char *left = (const char *) zhash_lookup (history->left, zyre_peer_identity (peer));
+    uint32_t after = left? (uint32_t) atol (left): 0;
+    history_item_t *item;
+    for (item = (history_item_t *) zlist_first (history->items); item;
+            item = (history_item_t *) zlist_next (history->items)) {
+        if (item->serial <= after)
+            continue;
+        zre_msg_t *msg = zre_msg_new ();
+        zre_msg_set_id (msg, ZRE_MSG_HISTORY);
+        zre_msg_set_group (msg, group);
+        zre_msg_set_serial (msg, item->serial);
+        zmsg_t *content = zmsg_dup (item->content);
+        zre_msg_set_content (msg, &content);
+        zyre_peer_send (peer, &msg);
+        zre_msg_destroy (&msg);
+    }
+}
+
+
+//  A group's SHOUTs can go by multicast to the peers that listen for them.
+//  A peer that listens tells the others with MULTICAST, and they answer
+//  with MULTICAST-OK and the multicast sequence number from which they
+//  stop sending it the group's SHOUTs over TCP. A peer that finds a gap in
+//  the sequence asks to go back to TCP the same way. A multicast SHOUT is
+//  one datagram, so larger SHOUTs still go over TCP.
+
+typedef struct {
+    char *group;                //  Group we multicast for
+    char *endpoint;             //  Multicast endpoint
+    char channel [16];          //  RADIO/DISH group we use for it
+    zsock_t *radio;             //  Socket we multicast on
+    zsock_t *dish;              //  Socket we listen on, if we could bind
+    uint32_t sequence;          //  Sequence of next SHOUT we multicast
+} multicast_t;
+
+static void
+s_multicast_destroy (void *argument)
+{
+    multicast_t *multicast = (multicast_t *) argument;
+    zsock_destroy (&multicast->radio);
+    zsock_destroy (&multicast->dish);
+    free (multicast->group);
+    free (multicast->endpoint);
+    free (multicast);
+}
+
+//  Return the endpoint we take a group's SHOUTs on, or "" if we take them
+//  over TCP
+
+static const char *
+zyre_node_multicast_endpoint (zyre_node_t *self, const char *group)
+{
+    multicast_t *multicast = (multicast_t *) zhash_lookup (self->multicast, group);
+    return multicast && multicast->dish? multicast->endpoint: "";
+}
+
+//  Tell a peer where we take its SHOUTs to a group
+
+static void
+zyre_node_tell_multicast (zyre_node_t *self, zyre_peer_t *peer,
+                          const char *group, const char *endpoint)
+{
+    if (zyre_peer_features (peer) & ZYRE_PEER_FEATURE_MULTICAST) {
+        zre_msg_t *msg = zre_msg_new ();
+        zre_msg_set_id (msg, ZRE_MSG_MULTICAST);
+        zre_msg_set_group (msg, group);
+        zre_msg_set_endpoint (msg, endpoint);
+        zyre_peer_send (peer, &msg);
+    }
+}
+
+//  Tell all peers where we take a group's SHOUTs
+
+static void
+zyre_node_tell_multicast_all (zyre_node_t *self, const char *group)
+{
+    const char *endpoint = zyre_node_multicast_endpoint (self, group);
+    zyre_peer_t *peer = (zyre_peer_t *) zhash_first (self->peers);
+    while (peer) {
+        zyre_node_tell_multicast (self, peer, group, endpoint);
+        peer = (zyre_peer_t *) zhash_next (self->peers);
+    }
+}
+
+//  Multicast a group's SHOUTs on this endpoint, and listen for them there,
+//  or stop if the endpoint is empty
+
+static void
+zyre_node_set_multicast (zyre_node_t *self, const char *group, const char *endpoint)
+{
+    multicast_t *multicast = (multicast_t *) zhash_lookup (self->multicast, group);
+#if defined (MULTICAST_UDP)
+    //  Peers we switched to multicast compare sequence numbers across the
+    //  change
+    uint32_t sequence = multicast? multicast->sequence: 0;
+#endif
+    if (multicast) {
+        if (multicast->dish)
+            zyre_node_unwatch (self, multicast->dish);
+        zhash_delete (self->multicast, group);
+    }
+    if (*endpoint) {
+#if defined (MULTICAST_UDP)
+        if (self->secret_key)
+            zsys_warning ("(%s) multicast is not encrypted, not using it with CURVE", self->name);
+        else {
+            multicast = (multicast_t *) zmalloc (sizeof (multicast_t));
+            multicast->group = strdup (group);
+            multicast->endpoint = strdup (endpoint);
+            multicast->sequence = sequence;
+            //  RADIO/DISH groups are short, so we use a hash of the name
+            uint32_t hash = 2166136261u;
+            const char *next;
+            for (next = group; *next; next++)
+                hash = (hash ^ (byte) *next) * 16777619u;
+            snprintf (multicast->channel, sizeof (multicast->channel), "zre-%08x", hash);
+            multicast->radio = zsock_new (ZMQ_RADIO);
+            if (zsock_connect (multicast->radio, "%s", endpoint)) {
+                zsys_warning ("(%s) cannot multicast to %s", self->name, endpoint);
+                s_multicast_destroy (multicast);
+                multicast = NULL;
+            }
+        }
+        if (multicast) {
+            //  Only one node may listen on a unicast UDP endpoint, so the
+            //  others multicast without listening
+            multicast->dish = zsock_new (ZMQ_DISH);
+            if (zsock_bind (multicast->dish, "%s", endpoint) == -1
+            ||  zsock_join (multicast->dish, multicast->channel)) {
+                zsys_warning ("(%s) cannot listen on %s, taking SHOUTs to %s over TCP",
+                              self->name, endpoint, group);
+                zsock_destroy (&multicast->dish);
+            }
+            else
+                zyre_node_watch (self, multicast->dish);
+            zhash_insert (self->multicast, group, multicast);
+            zhash_freefn (self->multicast, group, s_multicast_destroy);
+        }
+#else
+        zsys_warning ("(%s) built without RADIO/DISH sockets, cannot multicast", self->name);
+#endif
+    }
+    if (zlist_exists (self->own_groups, (char *) group))
+        zyre_node_tell_multicast_all (self, group);
+}
+
+//  Return one datagram with a SHOUT for the group's multicast, or NULL if
+//  the SHOUT is too large to multicast. The datagram holds our UUID and
+//  the multicast sequence number, the group name, then the content frames.
+
+static zframe_t *
+zyre_node_multicast_datagram (zyre_node_t *self, multicast_t *multicast, zre_msg_t *msg)
+{
+    zmsg_t *content = zre_msg_content (msg);
+    if (content && zmsg_content_size (content) + zmsg_size (content) * 5 > MULTICAST_MAX_SIZE)
+        return NULL;
+
+    zmsg_t *envelope = zmsg_new ();
+    byte header [ZUUID_LEN + 4];
+    memcpy (header, zuuid_data (self->uuid), ZUUID_LEN);
+    header [ZUUID_LEN]     = (byte) (multicast->sequence >> 24);
+    header [ZUUID_LEN + 1] = (byte) (multicast->sequence >> 16);
+    header [ZUUID_LEN + 2] = (byte) (multicast->sequence >> 8);
+    header [ZUUID_LEN + 3] = (byte) (multicast->sequence);
+    zmsg_addmem (envelope, header, sizeof (header));
+    zmsg_addstr (envelope, multicast->group);
+    zframe_t *frame = content? zmsg_first (content): NULL;
+    while (frame) {
+        zframe_t *copy = zframe_dup (frame);
+        zmsg_append (envelope, &copy);
+        frame = zmsg_next (content);
+    }
+    zframe_t *datagram = zmsg_encode (envelope);
+    zmsg_destroy (&envelope);
+    if (zframe_size (datagram) > MULTICAST_MAX_SIZE)
+        zframe_destroy (&datagram);
+    return datagram;
+}
+
+//  Multicast a datagram with the next sequence number; takes ownership
+//  of the datagram
+
+static void
+zyre_node_multicast (zyre_node_t *self, multicast_t *multicast, zframe_t **datagram_p)
+{
+#if defined (MULTICAST_UDP)
+    zframe_set_group (*datagram_p, multicast->channel);
+    zframe_send (datagram_p, multicast->radio, 0);
+    multicast->sequence++;
+#else
+    zframe_destroy (datagram_p);
+#endif
+}
+
+//  A peer told us where it takes our SHOUTs to a group. We only multicast
+//  to peers that listen where we send; others stay on TCP.
+
+static void
+zyre_node_peer_multicast (zyre_node_t *self, zyre_peer_t *peer, zre_msg_t *msg)
+{
+    multicast_t *multicast = (multicast_t *) zhash_lookup (self->multicast, zre_msg_group (msg));
+    const char *endpoint = zre_msg_endpoint (msg);
+    if (!multicast || strneq (endpoint, multicast->endpoint))
+        endpoint = "";
+    zyre_peer_set_multicast (peer, zre_msg_group (msg), endpoint);
+
+    zre_msg_t *reply = zre_msg_new ();
+    zre_msg_set_id (reply, ZRE_MSG_MULTICAST_OK);
+    zre_msg_set_group (reply, zre_msg_group (msg));
+    zre_msg_set_endpoint (reply, endpoint);
+    zre_msg_set_start (reply, multicast? multicast->sequence: 0);
+    zyre_peer_send (peer, &reply);
+}
+
+//  Return the multicast that listens on this socket, if any
+
+static multicast_t *
+zyre_node_multicast_on (zyre_node_t *self, zsock_t *which)
+{
+    multicast_t *multicast = (multicast_t *) zhash_first (self->multicast);
+    while (multicast && multicast->dish != which)
+        multicast = (multicast_t *) zhash_next (self->multicast);
+    return multicast;
+}
+
+//  Handle a SHOUT that a peer multicast to one of our groups. We take it
+//  only if the peer switched us to multicast, and ask to go back to TCP if
+//  we find we lost any.
+
+static void
+zyre_node_recv_multicast (zyre_node_t *self, multicast_t *multicast)
+{
+    zframe_t *datagram = zframe_recv (multicast->dish);
+    if (!datagram)
+        return;                 //  Interrupted
+    zmsg_t *envelope = zmsg_decode (datagram);
+    zframe_destroy (&datagram);
+    if (!envelope)
+        return;                 //  Malformed
+
+    zframe_t *header = zmsg_pop (envelope);
+    char *group = zmsg_popstr (envelope);
+    zyre_peer_t *peer = NULL;
+    if (header && zframe_size (header) == ZUUID_LEN + 4
+    &&  group && streq (group, multicast->group)
+    &&  zlist_exists (self->own_groups, group)) {
+        zuuid_t *uuid = zuuid_new ();
+        zuuid_set (uuid, zframe_data (header));
+        peer = (zyre_peer_t *) zhash_lookup (self->peers, zuuid_str (uuid));
+        zuuid_destroy (&uuid);
+    }
+    if (peer && zyre_peer_ready (peer)) {
+        byte *needle = zframe_data (header) + ZUUID_LEN;
+        uint32_t sequence = ((uint32_t) needle [0] << 24)
+                          + ((uint32_t) needle [1] << 16)
+                          + ((uint32_t) needle [2] << 8)
+                          +  (uint32_t) needle [3];
+        int rc = zyre_peer_multicast_check (peer, group, sequence);
+        if (rc == -1) {
+            zsys_warning ("(%s) multicast SHOUTs lost from %s, taking %s over TCP",
+                          self->name, zyre_peer_name (peer), group);
+            zyre_node_tell_multicast (self, peer, group, "");
+        }
+        if (rc && zyre_node_wants_shout (self, group)) {
+            zmsg_t *event = s_event_new ("SHOUT", zyre_peer_identity (peer), zyre_peer_name (peer));
+            zmsg_addstr (event, group);
+            zframe_t *frame;
+            while ((frame = zmsg_pop (envelope)))
+                zmsg_append (event, &frame);
+            zyre_node_emit (self, &event);
+        }
+    }
+    zframe_destroy (&header);
+    zstr_free (&group);
+    zmsg_destroy (&envelope);
+}
+
+
+//  Leaders renew three times per lease, so we check leases that often for
+//  the shortest lease of any group, or not at all if no group has one.
+
+static void
+zyre_node_update_lease_interval (zyre_node_t *self)
+{
+    self->lease_interval = 0;
+    zyre_group_t *group = (zyre_group_t *) zhash_first (self->peer_groups);
+    while (group) {
+        int lease = zyre_group_lease (group);
+        int interval = lease / 3 > 0? lease / 3: 1;
+        if (lease > 0
+        && (self->lease_interval == 0 || interval < self->lease_interval))
+            self->lease_interval = interval;
+        group = (zyre_group_t *) zhash_next (self->peer_groups);
+    }
+    if (self->lease_interval)
+        self->lease_at = zclock_mono () + self->lease_interval;
+}
+
+
+//  Here we handle the different control messages from the front-end
+
+// Forward declaration so that REQUIRE PEER works
+static zyre_peer_t *
+zyre_node_require_peer (zyre_node_t *self, zuuid_t *uuid, const char *endpoint, const char *public_key);
+
+// Forward declarations so that SEND FILE and SEND STREAM work
+static int
+zyre_node_send_file (zyre_node_t *self, const char *identity, const char *path,
+                     const char *name);
+static int
+zyre_node_send_stream (zyre_node_t *self, const char *identity, const char *name,
+                       zframe_t **data_p);
+
+static void
+zyre_node_recv_api (zyre_node_t *self)
+{
+    //  Get the whole message off the pipe in one go
+    zmsg_t *request = zmsg_recv (self->pipe);
+    if (!request)
+        return;                 //  Interrupted
+
+    char *command = zmsg_popstr (request);
+
+    if (self->verbose)
+        zsys_debug ("%s:     API command=%s", self->name, command);
+
+    if (streq (command, "UUID"))
+        zstr_send (self->pipe, zuuid_str (self->uuid));
+    else
+    if (streq (command, "NAME"))
         zstr_send (self->pipe, self->name);
     else
     if (streq (command, "SET NAME")) {
@@ -480,7 +1696,19 @@ zyre_node_recv_api (zyre_node_t *self)
     if (streq (command, "SET HEADER")) {
         char *name = zmsg_popstr (request);
         char *value = zmsg_popstr (request);
-        zhash_update (self->headers, name, value);
+        //  Peers take our features and IPC endpoint from HELLO; the node
+        //  owns those headers
+        if (streq (name, "X-ZRE-FEATURES") || streq (name, "X-ZRE-IPC"))
+            zsys_warning ("(%s) %s is set by the node, ignoring it", self->name, name);
+        else {
+            zhash_update (self->headers, name, value);
+            //  Peers we already sent our HELLO to get the change shortly
+            if (zhash_size (self->peers)) {
+                zhash_update (self->header_updates, name, value);
+                if (!self->headers_at)
+                    self->headers_at = zclock_mono () + HEADERS_DELAY;
+            }
+        }
         zstr_free (&name);
         zstr_free (&value);
     }
@@ -517,12 +1745,255 @@ zyre_node_recv_api (zyre_node_t *self)
         zstr_free (&value);
     }
     else
+    if (streq (command, "SET FEATURES")) {
+        //  For selftests only, so a node can act as an older peer; takes
+        //  effect for peers that connect after it
+        zstr_free (&self->features);
+        self->features = zmsg_popstr (request);
+    }
+    else
     if (streq (command, "SET INTERVAL")) {
         char *value = zmsg_popstr (request);
         self->interval = atol (value);
         zstr_free (&value);
     }
     else
+    if (streq (command, "SET CONNECT RATE")) {
+        char *value = zmsg_popstr (request);
+        self->connect_rate = atoi (value);
+        self->connect_tokens = self->connect_rate;
+        self->connect_tokens_at = zclock_mono ();
+        zstr_free (&value);
+    }
+    else
+    if (streq (command, "SET MAX HANDSHAKES")) {
+        char *value = zmsg_popstr (request);
+        self->max_handshakes = atoi (value);
+        zstr_free (&value);
+    }
+    else
+    if (streq (command, "SET SHARED MAILBOX")) {
+#ifdef ZMQ_CONNECT_ROUTING_ID
+        if (!self->router && zhash_size (self->peers) == 0) {
+            self->router = zsock_new (ZMQ_ROUTER);
+            assert (self->router);
+            //  Peers see the same identity as from a per-peer mailbox
+            byte routing_id [ZUUID_LEN + 1] = { ZYRE_PEER_LANE_DATA };
+            memcpy (routing_id + 1, zuuid_data (self->uuid), ZUUID_LEN);
+            int rc = zmq_setsockopt (zsock_resolve (self->router),
+                                     ZMQ_IDENTITY, routing_id, ZUUID_LEN + 1);
+            assert (rc == 0);
+            zsock_set_sndtimeo (self->router, 0);
+        }
+#else
+        zsys_warning ("(%s) shared mailbox needs ZMQ_CONNECT_ROUTING_ID, using one mailbox per peer",
+                      self->name);
+#endif
+    }
+    else
+    if (streq (command, "SET DIRECT"))
+        self->direct = true;
+    else
+    if (streq (command, "SET IPC UPGRADE"))
+        self->ipc_upgrade = true;
+    else
+    if (streq (command, "SET COMPRESSION")) {
+        char *threshold = zmsg_popstr (request);
+        char *level = zmsg_popstr (request);
+#if defined (HAVE_LIBZSTD)
+        self->compress_threshold = atoi (threshold) > 0? atoi (threshold): 0;
+        self->compress_level = atoi (level);
+#else
+        zsys_warning ("(%s) built without libzstd, cannot compress", self->name);
+#endif
+        zstr_free (&threshold);
+        zstr_free (&level);
+    }
+    else
+    if (streq (command, "SET COMPRESSION DICT")) {
+        zframe_t *dict = zmsg_pop (request);
+        assert (dict);
+#if defined (HAVE_LIBZSTD)
+        //  Peers match dictionaries by ID, so only a trained one will do
+        uint32_t dict_id = ZSTD_getDictID_fromDict (zframe_data (dict), zframe_size (dict));
+        if (dict_id) {
+            ZSTD_freeCDict (self->zstd_cdict);
+            ZSTD_freeDDict (self->zstd_ddict);
+            self->zstd_cdict = ZSTD_createCDict (zframe_data (dict), zframe_size (dict),
+                                                 self->compress_level);
+            self->zstd_ddict = ZSTD_createDDict (zframe_data (dict), zframe_size (dict));
+            self->compress_dict = dict_id;
+            char value [11];
+            snprintf (value, sizeof (value), "%u", dict_id);
+            zhash_update (self->headers, "X-ZRE-ZSTD-DICT", value);
+        }
+        else
+            zsys_warning ("(%s) compression dictionary has no ID, ignored", self->name);
+#else
+        zsys_warning ("(%s) built without libzstd, cannot compress", self->name);
+#endif
+        zframe_destroy (&dict);
+    }
+    else
+    if (streq (command, "STATS")) {
+        zhash_t *stats = zhash_new ();
+        zhash_autofree (stats);
+        char value [32];
+        snprintf (value, sizeof (value), "%" PRIu64, self->events_dropped);
+        zhash_insert (stats, "events-dropped", value);
+        snprintf (value, sizeof (value), "%" PRIu64, self->compress_bytes_in);
+        zhash_insert (stats, "compress-bytes-in", value);
+        snprintf (value, sizeof (value), "%" PRIu64, self->compress_bytes_out);
+        zhash_insert (stats, "compress-bytes-out", value);
+        snprintf (value, sizeof (value), "%.2f", self->compress_bytes_out?
+                  (double) self->compress_bytes_in / self->compress_bytes_out: 0.0);
+        zhash_insert (stats, "compress-ratio", value);
+        snprintf (value, sizeof (value), "%" PRId64, self->compress_usecs);
+        zhash_insert (stats, "compress-usecs", value);
+        snprintf (value, sizeof (value), "%" PRId64, self->decompress_usecs);
+        zhash_insert (stats, "decompress-usecs", value);
+        snprintf (value, sizeof (value), "%" PRIu64, self->recv_bursts);
+        zhash_insert (stats, "recv-bursts", value);
+        snprintf (value, sizeof (value), "%" PRIu64, self->recv_messages);
+        zhash_insert (stats, "recv-messages", value);
+        zsock_send (self->pipe, "p", stats);
+    }
+    else
+    if (streq (command, "SET RELAY")) {
+        char *name = zmsg_popstr (request);
+        char *fanout = zmsg_popstr (request);
+        zyre_group_t *group = zyre_node_require_peer_group (self, name);
+        int value = atoi (fanout);
+        zyre_group_set_relay_fanout (group, value < 0? 0: value > 255? 255: value);
+        zstr_free (&name);
+        zstr_free (&fanout);
+    }
+    else
+    if (streq (command, "SET HISTORY")) {
+        char *name = zmsg_popstr (request);
+        char *messages = zmsg_popstr (request);
+        char *msecs = zmsg_popstr (request);
+        char *bytes = zmsg_popstr (request);
+        zyre_node_set_history (self, name, atoi (messages), atoi (msecs),
+                               (size_t) strtoull (bytes, NULL, 10));
+        zstr_free (&name);
+        zstr_free (&messages);
+        zstr_free (&msecs);
+        zstr_free (&bytes);
+    }
+    else
+    if (streq (command, "SET ANYCAST POLICY")) {
+        char *name = zmsg_popstr (request);
+        char *policy = zmsg_popstr (request);
+        zyre_group_t *group = zyre_node_require_peer_group (self, name);
+        zyre_group_set_anycast_policy (group, atoi (policy));
+        zstr_free (&name);
+        zstr_free (&policy);
+    }
+    else
+    if (streq (command, "SET MULTICAST")) {
+        char *group = zmsg_popstr (request);
+        char *endpoint = zmsg_popstr (request);
+        zyre_node_set_multicast (self, group, endpoint);
+        zstr_free (&group);
+        zstr_free (&endpoint);
+    }
+    else
+    if (streq (command, "SET STREAM SINK")) {
+        zstr_free (&self->stream_sink);
+        self->stream_sink = zmsg_popstr (request);
+        if (streq (self->stream_sink, ""))
+            zstr_free (&self->stream_sink);
+    }
+    else
+    if (streq (command, "SEND FILE")) {
+        char *identity = zmsg_popstr (request);
+        char *path = zmsg_popstr (request);
+        char *name = zmsg_popstr (request);
+        int rc = zyre_node_send_file (self, identity, path, name);
+        zsock_signal (self->pipe, rc == 0? 0: 1);
+        zstr_free (&identity);
+        zstr_free (&path);
+        zstr_free (&name);
+    }
+    else
+    if (streq (command, "SEND STREAM")) {
+        char *identity = zmsg_popstr (request);
+        char *name = zmsg_popstr (request);
+        zframe_t *data = zmsg_pop (request);
+        int rc = zyre_node_send_stream (self, identity, name, &data);
+        zsock_signal (self->pipe, rc == 0? 0: 1);
+        zstr_free (&identity);
+        zstr_free (&name);
+    }
+    else
+    if (streq (command, "SET OUTBOX LIMITS")) {
+        char *max_events = zmsg_popstr (request);
+        char *max_bytes = zmsg_popstr (request);
+        self->outbox_max_events = atoi (max_events) > 0? atoi (max_events): 0;
+        self->outbox_max_bytes = atoi (max_bytes) > 0? atoi (max_bytes): 0;
+        zstr_free (&max_events);
+        zstr_free (&max_bytes);
+    }
+    else
+    if (streq (command, "SET RECV BUDGET")) {
+        char *budget = zmsg_popstr (request);
+        self->recv_budget = atoi (budget) > 0? atoi (budget): 1;
+        zstr_free (&budget);
+    }
+    else
+    if (streq (command, "EVENTS DROPPED"))
+        zsock_send (self->pipe, "8", self->events_dropped);
+    else
+    if (streq (command, "SET EVENT FILTER")) {
+        char *value = zmsg_popstr (request);
+        self->event_filter = atoi (value);
+        zstr_free (&value);
+    }
+    else
+    if (streq (command, "SUBSCRIBE SHOUTS")) {
+        char *prefix = zmsg_popstr (request);
+        if (!zlist_exists (self->shout_prefixes, prefix))
+            zlist_append (self->shout_prefixes, prefix);
+        zstr_free (&prefix);
+    }
+    else
+    if (streq (command, "UNSUBSCRIBE SHOUTS")) {
+        char *prefix = zmsg_popstr (request);
+        zlist_remove (self->shout_prefixes, prefix);
+        zstr_free (&prefix);
+    }
+    else
+    if (streq (command, "SET HANDLER")) {
+        zframe_t *handler = zmsg_pop (request);
+        zframe_t *handler_arg = zmsg_pop (request);
+        assert (handler && zframe_size (handler) == sizeof (self->handler));
+        assert (handler_arg && zframe_size (handler_arg) == sizeof (self->handler_arg));
+        memcpy (&self->handler, zframe_data (handler), sizeof (self->handler));
+        memcpy (&self->handler_arg, zframe_data (handler_arg), sizeof (self->handler_arg));
+        zframe_destroy (&handler);
+        zframe_destroy (&handler_arg);
+    }
+    else
+    if (streq (command, "SET WORKERS")) {
+        char *value = zmsg_popstr (request);
+        //  Workers are fixed once created, as peers are bound to them
+        if (!self->workers && zhash_size (self->peers) == 0 && atoi (value) > 0) {
+            self->nbr_workers = atoi (value);
+            self->workers = (zactor_t **) zmalloc (self->nbr_workers * sizeof (zactor_t *));
+            assert (self->workers);
+            int worker;
+            for (worker = 0; worker < self->nbr_workers; worker++) {
+                self->workers [worker] = zactor_new (zyre_peer_worker, NULL);
+                assert (self->workers [worker]);
+                //  Never block the node on a worker that can't keep up
+                zsock_set_sndtimeo (self->workers [worker], 0);
+                zyre_node_watch (self, self->workers [worker]);
+            }
+        }
+        zstr_free (&value);
+    }
+    else
     if (streq (command, "SET CONTEST")) {
         char *groupname = zmsg_popstr (request);
         zyre_group_t *group = zyre_node_require_peer_group (self, groupname);
@@ -530,6 +2001,16 @@ zyre_node_recv_api (zyre_node_t *self)
         zstr_free (&groupname);
     }
     else
+    if (streq (command, "SET LEADER LEASE")) {
+        char *groupname = zmsg_popstr (request);
+        char *value = zmsg_popstr (request);
+        zyre_group_t *group = zyre_node_require_peer_group (self, groupname);
+        zyre_group_set_lease (group, atoi (value));
+        zyre_node_update_lease_interval (self);
+        zstr_free (&groupname);
+        zstr_free (&value);
+    }
+    else
     if (streq (command, "SET ADVERTISED ENDPOINT")) {
         self->advertised_endpoint = zmsg_popstr (request);
     }
@@ -545,33 +2026,9 @@ zyre_node_recv_api (zyre_node_t *self)
             if (self->verbose)
                 zsys_debug ("applying zcert to ->inbox");
 
-            assert (self->public_key);
-            assert (self->secret_key);
-
-            // zarmour use for string conversion
-            zarmour_t *armour = zarmour_new ();
-            zarmour_set_mode (armour, ZARMOUR_MODE_Z85);
-            zarmour_set_pad (armour, false);
-            zarmour_set_line_breaks (armour, false);
-
-            // convert keys from Z85 strings (40 bytes) to raw byte arrays (32 bytes)
-            zchunk_t *decoded_public_key =
-              zarmour_decode (armour, self->public_key);
-            zchunk_t *decoded_secret_key =
-              zarmour_decode (armour, self->secret_key);
-
-            // create zcert from the decoded keys
-            zcert_t *cert = zcert_new_from (zchunk_data (decoded_public_key),
-                                            zchunk_data (decoded_secret_key));
-
-            zcert_apply(cert, self->inbox);
+            zcert_apply (zyre_node_cert (self), self->inbox);
             zsock_set_curve_server (self->inbox, 1);
             zsock_set_zap_domain (self->inbox, self->zap_domain);
-
-            zcert_destroy (&cert);
-            zchunk_destroy (&decoded_secret_key);
-            zchunk_destroy (&decoded_public_key);
-            zarmour_destroy (&armour);
         }
         if (zsock_bind (self->inbox, "%s", endpoint) != -1) {
             zstr_free(&self->endpoint);
@@ -595,12 +2052,16 @@ zyre_node_recv_api (zyre_node_t *self)
     }
     else
     if (streq (command, "SET PUBLICKEY")) {
+        zstr_free (&self->public_key);
+        zcert_destroy (&self->cert);
         self->public_key = zmsg_popstr (request);
         zhash_update (self->headers, "X-PUBLICKEY", self->public_key);
         assert (self->public_key);
     }
     else
     if (streq (command, "SET SECRETKEY")) {
+        zstr_free (&self->secret_key);
+        zcert_destroy (&self->cert);
         self->secret_key = zmsg_popstr (request);
         assert (self->secret_key);
     }
@@ -657,35 +2118,156 @@ zyre_node_recv_api (zyre_node_t *self)
 
         //  Send frame on out to peer's mailbox, drop message
         //  if peer doesn't exist (may have been destroyed)
-        if (peer) {
-            zre_msg_t *msg = zre_msg_new ();
-            zre_msg_set_id (msg, ZRE_MSG_WHISPER);
-            zre_msg_set_content (msg, &request);
-            zyre_peer_send (peer, &msg);
-        }
+        if (peer)
+            zyre_node_send_whisper (self, peer, &request);
         zstr_free (&identity);
     }
     else
-    if (streq (command, "SHOUT")) {
-        //  Get group to send message to
+    if (streq (command, "ANYCAST")) {
+        //  Get group and key, then pick one peer in group to send to;
+        //  drop message if the group has no peers
         char *name = zmsg_popstr (request);
+        char *key = zmsg_popstr (request);
         zyre_group_t *group = (zyre_group_t *) zhash_lookup (self->peer_groups, name);
-        if (group) {
-            zre_msg_t *msg = zre_msg_new ();
-            zre_msg_set_id (msg, ZRE_MSG_SHOUT);
-            zre_msg_set_group (msg, name);
-            zre_msg_set_content (msg, &request);
-            zyre_group_send (group, &msg);
-        }
+        zyre_peer_t *peer = group?
+            zyre_group_anycast_peer (group, key && *key? key: NULL): NULL;
+        if (peer)
+            zyre_node_send_whisper (self, peer, &request);
+        zstr_free (&name);
+        zstr_free (&key);
+    }
+    else
+    if (streq (command, "ANYCAST REQUEST")) {
+        //  As ANYCAST, but send the message as a request we track
+        char *name = zmsg_popstr (request);
+        char *key = zmsg_popstr (request);
+        char *timeout = zmsg_popstr (request);
+        char *id = zmsg_popstr (request);
+        zyre_group_t *group = (zyre_group_t *) zhash_lookup (self->peer_groups, name);
+        zyre_peer_t *peer = group?
+            zyre_group_anycast_peer (group, key && *key? key: NULL): NULL;
+        if (peer)
+            zyre_node_send_request (self, zyre_peer_identity (peer),
+                                    strtoull (id, NULL, 10), atoi (timeout), &request);
+        else
+            zyre_node_noreply (self, "", strtoull (id, NULL, 10), "unknown");
+        zstr_free (&name);
+        zstr_free (&key);
+        zstr_free (&timeout);
+        zstr_free (&id);
+    }
+    else
+    if (streq (command, "REQUEST")) {
+        char *identity = zmsg_popstr (request);
+        char *timeout = zmsg_popstr (request);
+        char *id = zmsg_popstr (request);
+        zyre_node_send_request (self, identity, strtoull (id, NULL, 10),
+                                atoi (timeout), &request);
+        zstr_free (&identity);
+        zstr_free (&timeout);
+        zstr_free (&id);
+    }
+    else
+    if (streq (command, "REPLY")) {
+        //  Send reply to peer, drop it if peer has gone
+        char *identity = zmsg_popstr (request);
+        char *id = zmsg_popstr (request);
+        zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, identity);
+        if (peer && (zyre_peer_features (peer) & ZYRE_PEER_FEATURE_RPC)) {
+            zre_msg_t *msg = zre_msg_new ();
+            zre_msg_set_id (msg, ZRE_MSG_REPLY);
+            zre_msg_set_correlation (msg, strtoull (id, NULL, 10));
+            zre_msg_set_content (msg, &request);
+            zyre_peer_send (peer, &msg);
+        }
+        zstr_free (&identity);
+        zstr_free (&id);
+    }
+    else
+    if (streq (command, "WHISPER OWNER")) {
+        //  Get group and key, then send to the peer that owns the key;
+        //  drop message if the group has no peers
+        char *name = zmsg_popstr (request);
+        char *key = zmsg_popstr (request);
+        zyre_group_t *group = (zyre_group_t *) zhash_lookup (self->peer_groups, name);
+        zyre_peer_t *peer = group? zyre_group_owner_peer (group, key): NULL;
+        if (peer)
+            zyre_node_send_whisper (self, peer, &request);
+        zstr_free (&name);
+        zstr_free (&key);
+    }
+    else
+    if (streq (command, "STORE SET") || streq (command, "STORE DELETE")) {
+        //  Write to the group's store, or delete the key, then signal so
+        //  the caller reads its own write
+        char *name = zmsg_popstr (request);
+        char *key = zmsg_popstr (request);
+        char *value = streq (command, "STORE SET")? zmsg_popstr (request): NULL;
+        zyre_group_t *group = zyre_node_require_peer_group (self, name);
+        zyre_group_store_write (group, key, value, self->uuid);
+        zsock_signal (self->pipe, 0);
+        zstr_free (&name);
+        zstr_free (&key);
+        zstr_free (&value);
+    }
+    else
+    if (streq (command, "SHOUT")) {
+        //  Get group to send message to
+        char *name = zmsg_popstr (request);
+        zyre_node_keep_history (self, name, request);
+        zyre_group_t *group = (zyre_group_t *) zhash_lookup (self->peer_groups, name);
+        if (group) {
+            zre_msg_t *msg = zre_msg_new ();
+            zre_msg_set_id (msg, ZRE_MSG_SHOUT);
+            zre_msg_set_group (msg, name);
+            zre_msg_set_content (msg, &request);
+            //  Peers that listen for the group's SHOUTs get one datagram
+            //  between them, the others get the SHOUT over TCP
+            multicast_t *multicast = (multicast_t *) zhash_lookup (self->multicast, name);
+            zframe_t *datagram = multicast?
+                                 zyre_node_multicast_datagram (self, multicast, msg): NULL;
+            //  In large groups, peers that relay pass the SHOUT on for us
+            bool relay = !datagram && zyre_group_relay_fanout (group);
+            //  Compress once, for all peers in the group that can take it
+            zre_msg_t *compressed = self->compress_threshold && !datagram && !relay?
+                                    zyre_node_compress (self, msg): NULL;
+            if (datagram) {
+                if (zyre_group_send_multicast (group, &msg, multicast->endpoint))
+                    zyre_node_multicast (self, multicast, &datagram);
+                else
+                    zframe_destroy (&datagram);
+            }
+            else
+            if (relay)
+                zyre_group_send_relay (group, &msg, self->uuid);
+            else
+            if (compressed)
+                zyre_group_send_compressed (group, &msg, &compressed, self->compress_dict);
+            else
+                zyre_group_send (group, &msg);
+        }
         zstr_free (&name);
     }
     else
     if (streq (command, "JOIN")) {
         char *name = zmsg_popstr (request);
+        char *catchup = zmsg_popstr (request);
         if (!zlist_exists (self->own_groups, name)) {
             void *item;
             //  Only send if we're not already in group
             zlist_append (self->own_groups, name);
+            if (catchup) {
+                //  Ask peers to replay what they sent the group so far,
+                //  just ahead of our JOIN
+                zre_msg_t *msg = zre_msg_new ();
+                zre_msg_set_id (msg, ZRE_MSG_CATCHUP);
+                zre_msg_set_group (msg, name);
+                for (item = zhash_first (self->peers); item != NULL;
+                        item = zhash_next (self->peers))
+                    if (zyre_peer_features ((zyre_peer_t *) item) & ZYRE_PEER_FEATURE_HISTORY)
+                        zyre_node_send_peer (zhash_cursor (self->peers), item, msg);
+                zre_msg_destroy (&msg);
+            }
             zre_msg_t *msg = zre_msg_new ();
             zre_msg_set_id (msg, ZRE_MSG_JOIN);
             zre_msg_set_group (msg, name);
@@ -696,10 +2278,17 @@ zyre_node_recv_api (zyre_node_t *self)
                 zyre_node_send_peer (zhash_cursor (self->peers), item, msg);
 
             zre_msg_destroy (&msg);
+            if (zhash_lookup (self->multicast, name))
+                zyre_node_tell_multicast_all (self, name);
+            //  Catch up with the writes to the group's store we missed
+            zyre_group_t *group = (zyre_group_t *) zhash_lookup (self->peer_groups, name);
+            if (group)
+                zyre_group_store_sync (group, NULL);
             if (self->verbose)
                 zsys_info ("(%s) JOIN group=%s", self->name, name);
         }
         zstr_free (&name);
+        zstr_free (&catchup);
     }
     else
     if (streq (command, "LEAVE")) {
@@ -782,140 +2371,1133 @@ zyre_node_recv_api (zyre_node_t *self)
         zstr_free (&uuid);
         zstr_free (&key);
     }
-    else
-    if (streq (command, "PEER GROUPS"))
-        zsock_send (self->pipe, "p", zhash_keys (self->peer_groups));
-    else
-    if (streq (command, "OWN GROUPS"))
-        zsock_send (self->pipe, "p", zlist_dup (self->own_groups));
-    else
-    if (streq (command, "DUMP"))
-        zyre_node_dump (self);
-    else
-    if (streq (command, "$TERM"))
-        self->terminated = true;
+    else
+    if (streq (command, "RINGS"))
+        zsock_send (self->pipe, "p", self->rings);
+    else
+    if (streq (command, "PEER GROUPS"))
+        zsock_send (self->pipe, "p", zhash_keys (self->peer_groups));
+    else
+    if (streq (command, "OWN GROUPS"))
+        zsock_send (self->pipe, "p", zlist_dup (self->own_groups));
+    else
+    if (streq (command, "DUMP"))
+        zyre_node_dump (self);
+    else
+    if (streq (command, "$TERM"))
+        self->terminated = true;
+    else {
+        zsys_error ("invalid command '%s'", command);
+        assert (false);
+    }
+    zstr_free (&command);
+    zmsg_destroy (&request);
+}
+
+//  Delete peer for a given endpoint
+
+static int
+zyre_node_purge_peer (const char *key, void *item, void *argument)
+{
+    zyre_peer_t *peer = (zyre_peer_t *) item;
+    char *endpoint = (char *) argument;
+    if (streq (zyre_peer_endpoint (peer), endpoint))
+        zyre_peer_disconnect (peer);
+    return 0;
+}
+
+//  Hash one group, or header if value isn't NULL, into a HELLO digest;
+//  the digest XORs these, so it doesn't depend on order
+
+static uint64_t
+s_hello_hash (const char *key, const char *value)
+{
+    uint64_t hash = 14695981039346656037u;
+    for (; *key; key++)
+        hash = (hash ^ (byte) *key) * 1099511628211u;
+    if (value) {
+        hash = (hash ^ 0xff) * 1099511628211u;
+        for (; *value; value++)
+            hash = (hash ^ (byte) *value) * 1099511628211u;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdu;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static uint64_t
+s_hello_digest (zlist_t *groups, zhash_t *headers)
+{
+    uint64_t digest = 0;
+    const char *name;
+    for (name = (const char *) zlist_first (groups); name;
+            name = (const char *) zlist_next (groups))
+        digest ^= s_hello_hash (name, NULL);
+    const char *value;
+    for (value = (const char *) zhash_first (headers); value;
+            value = (const char *) zhash_next (headers))
+        digest ^= s_hello_hash (zhash_cursor (headers), value);
+    return digest;
+}
+
+//  Drop a reference to a HELLO state, destroying it with the last one
+
+static void
+zyre_node_release_hello (zyre_node_t *self, hello_state_t **state_p)
+{
+    hello_state_t *state = *state_p;
+    if (state && --state->refs == 0) {
+        if (state->shared) {
+            char key [17];
+            snprintf (key, sizeof (key), "%016" PRIx64, state->digest);
+            zhash_delete (self->hello_states, key);
+        }
+        zlist_destroy (&state->groups);
+        zhash_destroy (&state->headers);
+        free (state);
+    }
+    *state_p = NULL;
+}
+
+//  Return the headers we send in a full HELLO: the application's headers,
+//  and those the node sets itself. Caller destroys the hash.
+
+static zhash_t *
+zyre_node_hello_headers (zyre_node_t *self)
+{
+    zhash_t *headers = zhash_dup (self->headers);
+    zhash_update (headers, "X-ZRE-FEATURES", (void *) self->features);
+    if (self->ipc_endpoint)
+        zhash_update (headers, "X-ZRE-IPC", self->ipc_endpoint);
+    return headers;
+}
+
+//  Forget what a peer that went knew of us, and we of it
+
+static void
+zyre_node_forget_hello (zyre_node_t *self, const char *identity)
+{
+    hello_memory_t *memory = (hello_memory_t *) zhash_lookup (self->hello_memory, identity);
+    if (memory) {
+        zyre_node_release_hello (self, &memory->sent);
+        zyre_node_release_hello (self, &memory->received);
+        free (memory);
+        zhash_delete (self->hello_memory, identity);
+        zlist_remove (self->hello_memory_order, (void *) identity);
+    }
+}
+
+//  Remember what a peer that is going knew of us, and we of it, if it can
+//  take a compact HELLO when it comes back
+
+static void
+zyre_node_remember_hello (zyre_node_t *self, zyre_peer_t *peer)
+{
+    if (self->secret_key
+    ||  !zyre_peer_ready (peer)
+    ||  !(zyre_peer_features (peer) & ZYRE_PEER_FEATURE_COMPACT_HELLO))
+        return;
+    const char *identity = zyre_peer_identity (peer);
+    zyre_node_forget_hello (self, identity);
+    if (zlist_size (self->hello_memory_order) >= HELLO_MEMORY_MAX)
+        zyre_node_forget_hello (self, (const char *) zlist_first (self->hello_memory_order));
+
+    //  Peer's groups are those it is in as it goes; the names belong to
+    //  our peer groups, which last as long as we do
+    hello_state_t *received = (hello_state_t *) zmalloc (sizeof (hello_state_t));
+    received->groups = zlist_new ();
+    zyre_group_t *group;
+    for (group = (zyre_group_t *) zhash_first (self->peer_groups); group;
+            group = (zyre_group_t *) zhash_next (self->peer_groups))
+        if (zyre_group_has_peer (group, peer))
+            zlist_append (received->groups, (void *) zhash_cursor (self->peer_groups));
+    received->headers = zyre_peer_headers (peer)?
+                        zhash_dup (zyre_peer_headers (peer)): zhash_new ();
+    received->digest = s_hello_digest (received->groups, received->headers);
+    received->refs = 1;
+
+    //  Our own state is the same for all peers that go at once, so we
+    //  share it between them
+    zhash_t *headers = zyre_node_hello_headers (self);
+    uint64_t digest = s_hello_digest (self->own_groups, headers);
+    char key [17];
+    snprintf (key, sizeof (key), "%016" PRIx64, digest);
+    hello_state_t *sent = (hello_state_t *) zhash_lookup (self->hello_states, key);
+    if (!sent) {
+        sent = (hello_state_t *) zmalloc (sizeof (hello_state_t));
+        sent->groups = zlist_dup (self->own_groups);
+        sent->headers = headers;
+        headers = NULL;
+        sent->digest = digest;
+        sent->shared = true;
+        zhash_insert (self->hello_states, key, sent);
+    }
+    zhash_destroy (&headers);
+    sent->refs++;
+
+    hello_memory_t *memory = (hello_memory_t *) zmalloc (sizeof (hello_memory_t));
+    memory->sent = sent;
+    memory->received = received;
+    zhash_insert (self->hello_memory, identity, memory);
+    zlist_append (self->hello_memory_order, (void *) identity);
+}
+
+//  Fill in HELLO groups and headers with what changed since the peer last
+//  knew us: groups as +name or -name, the headers that changed, and the
+//  names of headers we dropped, one per line, in X-ZRE-HELLO-DROP. The
+//  X-ZRE-HELLO-BASE header holds the digest of what the peer last knew.
+
+static void
+zyre_node_compact_hello (zyre_node_t *self, zre_msg_t *msg, hello_state_t *base)
+{
+    zlist_t *groups = zlist_new ();
+    zlist_autofree (groups);
+    zhash_t *before = zhash_new ();
+    const char *name;
+    for (name = (const char *) zlist_first (base->groups); name;
+            name = (const char *) zlist_next (base->groups))
+        zhash_insert (before, name, (void *) name);
+    for (name = (const char *) zlist_first (self->own_groups); name;
+            name = (const char *) zlist_next (self->own_groups)) {
+        if (zhash_lookup (before, name))
+            zhash_delete (before, name);
+        else {
+            char *change = zsys_sprintf ("+%s", name);
+            zlist_append (groups, change);
+            zstr_free (&change);
+        }
+    }
+    for (name = (const char *) zhash_first (before); name;
+            name = (const char *) zhash_next (before)) {
+        char *change = zsys_sprintf ("-%s", name);
+        zlist_append (groups, change);
+        zstr_free (&change);
+    }
+    zhash_destroy (&before);
+
+    zhash_t *current = zyre_node_hello_headers (self);
+    zhash_t *headers = zhash_new ();
+    zhash_autofree (headers);
+    const char *value;
+    for (value = (const char *) zhash_first (current); value;
+            value = (const char *) zhash_next (current)) {
+        const char *old_value = (const char *) zhash_lookup (base->headers,
+                                                             zhash_cursor (current));
+        if (!old_value || strneq (old_value, value))
+            zhash_insert (headers, zhash_cursor (current), (void *) value);
+    }
+    char *dropped = NULL;
+    for (value = (const char *) zhash_first (base->headers); value;
+            value = (const char *) zhash_next (base->headers)) {
+        if (!zhash_lookup (current, zhash_cursor (base->headers))) {
+            char *more = zsys_sprintf ("%s%s\n", dropped? dropped: "",
+                                       zhash_cursor (base->headers));
+            zstr_free (&dropped);
+            dropped = more;
+        }
+    }
+    if (dropped)
+        zhash_insert (headers, "X-ZRE-HELLO-DROP", dropped);
+    zstr_free (&dropped);
+    zhash_destroy (&current);
+    char key [17];
+    snprintf (key, sizeof (key), "%016" PRIx64, base->digest);
+    zhash_insert (headers, "X-ZRE-HELLO-BASE", key);
+
+    zre_msg_set_groups (msg, &groups);
+    zre_msg_set_headers (msg, &headers);
+}
+
+//  Rebuild a compact HELLO from a peer into a full one, from what we knew
+//  of the peer when it went. Returns 0 if the HELLO was already full or we
+//  rebuilt it, -1 if we no longer know what it builds on.
+
+static int
+zyre_node_expand_hello (zyre_node_t *self, zre_msg_t *msg, zuuid_t *uuid)
+{
+    zhash_t *changes = zre_msg_headers (msg);
+    const char *base = changes?
+        (const char *) zhash_lookup (changes, "X-ZRE-HELLO-BASE"): NULL;
+    hello_memory_t *memory = (hello_memory_t *) zhash_lookup (self->hello_memory, zuuid_str (uuid));
+    if (!base) {
+        //  A full HELLO replaces what we knew of the peer
+        if (memory) {
+            zyre_node_release_hello (self, &memory->received);
+            if (!memory->sent)
+                zyre_node_forget_hello (self, zuuid_str (uuid));
+        }
+        return 0;
+    }
+    hello_state_t *state = memory? memory->received: NULL;
+    char key [17];
+    if (state)
+        snprintf (key, sizeof (key), "%016" PRIx64, state->digest);
+    if (!state || strneq (key, base)) {
+        if (memory)
+            zyre_node_forget_hello (self, zuuid_str (uuid));
+        return -1;
+    }
+    zhash_t *headers = zhash_dup (state->headers);
+    const char *value;
+    for (value = (const char *) zhash_first (changes); value;
+            value = (const char *) zhash_next (changes))
+        zhash_update (headers, zhash_cursor (changes), (void *) value);
+    zhash_delete (headers, "X-ZRE-HELLO-BASE");
+    value = (const char *) zhash_lookup (headers, "X-ZRE-HELLO-DROP");
+    if (value) {
+        char *dropped = strdup (value);
+        zhash_delete (headers, "X-ZRE-HELLO-DROP");
+        char *name = strtok (dropped, "\n");
+        while (name) {
+            zhash_delete (headers, name);
+            name = strtok (NULL, "\n");
+        }
+        free (dropped);
+    }
+
+    //  Changes are keyed by group name, without the + or -
+    zhash_t *group_changes = zhash_new ();
+    const char *change;
+    for (change = (const char *) zlist_first (zre_msg_groups (msg)); change;
+            change = (const char *) zlist_next (zre_msg_groups (msg)))
+        if (*change)
+            zhash_update (group_changes, change + 1, (void *) change);
+    zlist_t *groups = zlist_new ();
+    zlist_autofree (groups);
+    const char *name;
+    for (name = (const char *) zlist_first (state->groups); name;
+            name = (const char *) zlist_next (state->groups))
+        if (!zhash_lookup (group_changes, name))
+            zlist_append (groups, (void *) name);
+    for (change = (const char *) zhash_first (group_changes); change;
+            change = (const char *) zhash_next (group_changes))
+        if (*change == '+')
+            zlist_append (groups, (void *) (change + 1));
+    zhash_destroy (&group_changes);
+
+    zre_msg_set_groups (msg, &groups);
+    zre_msg_set_headers (msg, &headers);
+    zyre_node_release_hello (self, &memory->received);
+    if (!memory->sent)
+        zyre_node_forget_hello (self, zuuid_str (uuid));
+    return 0;
+}
+
+//  Send our HELLO to a peer; a peer that comes back with the same UUID,
+//  and can take a compact HELLO, only gets what changed since it went
+
+static void
+zyre_node_send_hello (zyre_node_t *self, zyre_peer_t *peer)
+{
+    zre_msg_t *msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_HELLO);
+
+    //  If the endpoint is a link-local IPv6 address we must not send the
+    //  interface name to the peer, as it is relevant only on the local node
+    char endpoint_iface [NI_MAXHOST] = {0};
+    if (zsys_ipv6 () && strchr (self->endpoint, '%')) {
+        strcat (endpoint_iface, self->endpoint);
+        memmove (strchr (endpoint_iface, '%'),
+                strrchr (endpoint_iface, ':'),
+                strlen (strrchr (endpoint_iface, ':')) + 1);
+        zre_msg_set_endpoint (msg, endpoint_iface);
+    }
+    else
+    if (self->advertised_endpoint)
+        zre_msg_set_endpoint (msg, self->advertised_endpoint);
+    else
+        zre_msg_set_endpoint (msg, self->endpoint);
+
+    zlist_t *groups = zlist_dup (self->own_groups);
+    zhash_t *headers = zyre_node_hello_headers (self);
+    zre_msg_set_groups (msg, &groups);
+    zre_msg_set_headers (msg, &headers);
+    zre_msg_set_status (msg, self->status);
+    zre_msg_set_name (msg, self->name);
+
+    hello_memory_t *memory = (hello_memory_t *) zhash_lookup (self->hello_memory,
+                                                              zyre_peer_identity (peer));
+    if (memory && memory->sent) {
+        //  Keep the HELLO in full, for if the peer can't rebuild it
+        zre_msg_t *full = zre_msg_dup (msg);
+        zyre_peer_set_hello_full (peer, &full);
+        zyre_node_compact_hello (self, msg, memory->sent);
+        zyre_node_release_hello (self, &memory->sent);
+        if (!memory->received)
+            zyre_node_forget_hello (self, zyre_peer_identity (peer));
+    }
+    zyre_peer_send (peer, &msg);
+    zre_msg_destroy (&msg);
+    zyre_peer_set_headers_version (peer, self->headers_version);
+}
+
+//  Send a peer that couldn't rebuild our compact HELLO all of it. It gets
+//  the HELLO as it was when we sent it compact, since everything we sent
+//  after builds on that.
+
+static void
+zyre_node_resend_hello (zyre_node_t *self, zyre_peer_t *peer)
+{
+    if (zyre_peer_hello_full (peer)) {
+        zre_msg_t *msg = zre_msg_dup (zyre_peer_hello_full (peer));
+        zyre_peer_send (peer, &msg);
+        zre_msg_destroy (&msg);
+    }
+    else
+        zyre_node_send_hello (self, peer);
+}
+
+//  Send a peer header values in a HEADERS message, if it can take one
+
+static void
+zyre_node_send_headers (zyre_node_t *self, zyre_peer_t *peer, zhash_t *headers)
+{
+    if (zyre_peer_features (peer) & ZYRE_PEER_FEATURE_HEADERS) {
+        zre_msg_t *msg = zre_msg_new ();
+        zre_msg_set_id (msg, ZRE_MSG_HEADERS);
+        zhash_t *copy = zhash_dup (headers);
+        zre_msg_set_headers (msg, &copy);
+        zyre_peer_send (peer, &msg);
+        zre_msg_destroy (&msg);
+    }
+    zyre_peer_set_headers_version (peer, self->headers_version);
+}
+
+//  Send the header changes we held back to all ready peers. Peers that
+//  aren't ready yet don't know if they can take them; they get all our
+//  headers once they are.
+
+static void
+zyre_node_flush_headers (zyre_node_t *self)
+{
+    self->headers_version++;
+    zyre_peer_t *peer;
+    for (peer = (zyre_peer_t *) zhash_first (self->peers); peer;
+            peer = (zyre_peer_t *) zhash_next (self->peers))
+        if (zyre_peer_ready (peer))
+            zyre_node_send_headers (self, peer, self->header_updates);
+    zhash_destroy (&self->header_updates);
+    self->header_updates = zhash_new ();
+    zhash_autofree (self->header_updates);
+    self->headers_at = 0;
+}
+
+//  Take header changes from a peer, and tell the caller about them
+
+static void
+zyre_node_take_headers (zyre_node_t *self, zyre_peer_t *peer, zre_msg_t *msg)
+{
+    zhash_t *changes = zre_msg_headers (msg);
+    if (!changes)
+        return;
+    zhash_t *headers = zyre_peer_headers (peer)? zhash_dup (zyre_peer_headers (peer)): NULL;
+    if (!headers) {
+        headers = zhash_new ();
+        zhash_autofree (headers);
+    }
+    const char *value;
+    for (value = (const char *) zhash_first (changes); value;
+            value = (const char *) zhash_next (changes))
+        zhash_update (headers, zhash_cursor (changes), (void *) value);
+    zyre_peer_set_headers (peer, headers);
+    zhash_destroy (&headers);
+
+    if (self->event_filter & ZYRE_EVENT_HEADER_UPDATE) {
+        zmsg_t *event = s_event_new ("HEADER-UPDATE", zyre_peer_identity (peer), zyre_peer_name (peer));
+        zframe_t *packed = zhash_pack (changes);
+        zmsg_append (event, &packed);
+        zyre_node_emit (self, &event);
+    }
+}
+
+//  Create peer, connect to it and send it our HELLO
+
+static zyre_peer_t *
+zyre_node_connect_peer (zyre_node_t *self, zuuid_t *uuid, const char *endpoint, const char *public_key)
+{
+    //  Purge any previous peer on same endpoint
+    void *item;
+    for (item = zhash_first (self->peers); item != NULL;
+            item = zhash_next (self->peers))
+        zyre_node_purge_peer (zhash_cursor (self->peers), item, (char *) endpoint);
+
+    zyre_peer_t *peer = zyre_peer_new (self->peers, uuid);
+    assert (peer);
+
+    if (self->public_key && self->secret_key) {
+        assert (public_key != NULL);
+        // set my local keys
+        zyre_peer_set_cert (peer, zyre_node_cert (self));
+        // set the public key of the peer we're connecting to
+        // peer is acting as the 'server' curve role
+        zyre_peer_set_server_key(peer, public_key);
+    }
+
+    zyre_peer_set_origin (peer, self->name);
+    zyre_peer_set_verbose (peer, self->verbose);
+    if (self->direct && !self->secret_key
+    &&  s_directory_lookup (zuuid_str (uuid)))
+        zyre_peer_set_direct (peer, true);
+    else
+    if (self->nbr_workers) {
+        //  Spread peers over workers by their UUID, which is random
+        const byte *data = zuuid_data (uuid);
+        uint32_t hash = 0;
+        size_t index;
+        for (index = 0; index < ZUUID_LEN; index++)
+            hash = hash * 31 + data [index];
+        zyre_peer_set_worker (peer, self->workers [hash % self->nbr_workers]);
+    }
+    else
+    if (self->router)
+        zyre_peer_set_router (peer, self->router, ++self->routes);
+    int rc = zyre_peer_connect (peer, self->uuid, endpoint,
+            self->expired_timeout);
+    if (rc != 0) {
+        // TBD: removing the peer means it will keep retrying. Should
+        // it be kept in the hash table instead perhaps?
+        zhash_delete (self->peers, zyre_peer_identity (peer));
+        return NULL;
+    }
+    //  Handshake is in flight until the peer greets us
+    self->handshakes++;
+
+    //  Handshake discovery by sending HELLO as first message
+    zyre_node_send_hello (self, peer);
+    zyre_peer_refresh (peer, self->evasive_timeout, self->expired_timeout);
+    return peer;
+}
+
+
+//  Queue a peer connect for the connect scheduler, or move it up to a
+//  better queue. Returns the pending entry.
+
+static pending_t *
+zyre_node_queue_peer (zyre_node_t *self, zuuid_t *uuid, const char *endpoint,
+                      const char *public_key, int queue)
+{
+    pending_t *pending = (pending_t *) zhash_lookup (self->pending, zuuid_str (uuid));
+    if (!pending) {
+        pending = (pending_t *) zmalloc (sizeof (pending_t));
+        assert (pending);
+        pending->uuid = zuuid_dup (uuid);
+        pending->backlog = zlist_new ();
+        pending->queue = queue;
+        zhash_insert (self->pending, zuuid_str (uuid), pending);
+        zhash_freefn (self->pending, zuuid_str (uuid), s_pending_destroy);
+        zlist_append (self->pending_queue [queue], (void *) zuuid_str (uuid));
+    }
+    else
+    if (queue < pending->queue) {
+        zlist_remove (self->pending_queue [pending->queue], (void *) zuuid_str (uuid));
+        zlist_append (self->pending_queue [queue], (void *) zuuid_str (uuid));
+        pending->queue = queue;
+    }
+    //  Latest endpoint and key win, as they would for a connected peer
+    if (!pending->endpoint || strneq (pending->endpoint, endpoint)) {
+        free (pending->endpoint);
+        pending->endpoint = strdup (endpoint);
+    }
+    free (pending->public_key);
+    pending->public_key = public_key? strdup (public_key): NULL;
+    return pending;
+}
+
+
+//  Forget a queued peer connect, dropping any messages we held for it
+
+static void
+zyre_node_unqueue_peer (zyre_node_t *self, pending_t *pending)
+{
+    zlist_remove (self->pending_queue [pending->queue], (void *) zuuid_str (pending->uuid));
+    zhash_delete (self->pending, zuuid_str (pending->uuid));
+}
+
+
+//  Find or create peer via its UUID. If the connect scheduler is limiting
+//  connects, a new peer is queued and we return NULL.
+
+static zyre_peer_t *
+zyre_node_require_peer (zyre_node_t *self, zuuid_t *uuid, const char *endpoint, const char *public_key)
+{
+    assert (self);
+    assert (endpoint);
+
+    zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, zuuid_str (uuid));
+    if (!peer) {
+        if (self->connect_rate || self->max_handshakes)
+            zyre_node_queue_peer (self, uuid, endpoint, public_key, PENDING_DISCOVERED);
+        else
+            peer = zyre_node_connect_peer (self, uuid, endpoint, public_key);
+    }
+    return peer;
+}
+
+
+//  Remove peer from group, if it's a member
+
+static int
+zyre_node_delete_peer (const char *key, void *item, void *argument)
+{
+    zyre_group_t *group = (zyre_group_t *) item;
+    zyre_peer_t *peer = (zyre_peer_t *) argument;
+    zyre_group_leave (group, peer);
+    return 0;
+}
+
+static void
+zyre_node_leader_peer_group (zyre_node_t *self, const char *identity,
+                             const char *name, const char *group)
+{
+    //  Leader renews its lease for as long as it holds leadership
+    zyre_group_t *rgroup = (zyre_group_t *) zhash_lookup (self->peer_groups, group);
+    if (rgroup)
+        zyre_group_set_leading (rgroup, streq (identity, zuuid_str (self->uuid)));
+
+    //  Now tell the caller about the elected leader peer
+    if (self->event_filter & ZYRE_EVENT_LEADER) {
+        zmsg_t *event = s_event_new ("LEADER", identity, name);
+        zmsg_addstr (event, group);
+        zyre_node_emit (self, &event);
+    }
+
+    if (self->verbose)
+        zsys_info ("(%s) LEADER name=%s group=%s identity=%s",
+                   self->name,
+                   name,
+                   group,
+                   identity);
+}
+
+//  --------------------------------------------------------------------------
+//  Streams carry large objects to a peer in chunks. The sender keeps a
+//  window of chunks in flight, and the receiver opens the window as it
+//  takes chunks. If the peer goes away, the sender waits for it to come
+//  back and resends from the last chunk the peer took. The receiver keeps
+//  its part of a stream until the stream ends or goes quiet for as long as
+//  it takes a peer to expire.
+
+//  Seek to an offset in a file, which may be beyond 2GB
+
+static int
+s_file_seek (FILE *file, uint64_t offset)
+{
+#if defined (__WINDOWS__)
+    return _fseeki64 (file, (__int64) offset, SEEK_SET);
+#else
+    return fseeko (file, (off_t) offset, SEEK_SET);
+#endif
+}
+
+//  An object we are streaming to a peer
+
+typedef struct {
+    uint32_t number;            //  Stream number, unique for us
+    char *peer;                 //  UUID of peer we send to
+    char *name;                 //  Name of object
+    zframe_t *data;             //  Object, if we hold it in memory
+    FILE *file;                 //  File we read chunks from, if not
+#if defined (STREAM_MMAP)
+    byte *map;                  //  File mapping, if any
+#endif
+    uint64_t total;             //  Size of object
+    uint64_t sent;              //  Bytes sent so far
+    uint64_t taken;             //  Bytes peer took so far
+    bool started;               //  Sent the first chunk?
+    int64_t lost_at;            //  When peer went away, 0 if present
+} outstream_t;
+
+static void
+s_outstream_destroy (void *argument)
+{
+    outstream_t *stream = (outstream_t *) argument;
+#if defined (STREAM_MMAP)
+    if (stream->map)
+        munmap (stream->map, (size_t) stream->total);
+#endif
+    if (stream->file)
+        fclose (stream->file);
+    zframe_destroy (&stream->data);
+    free (stream->peer);
+    free (stream->name);
+    free (stream);
+}
+
+//  An object a peer is streaming to us
+
+typedef struct {
+    char *peer;                 //  UUID of peer sending to us
+    uint32_t number;            //  Stream number, unique for peer
+    char *name;                 //  Name of object
+    uint64_t total;             //  Size of object
+    uint64_t taken;             //  Bytes we took so far
+    uint64_t acked;             //  Bytes we told peer we took
+    FILE *sink;                 //  File we write chunks to, if any
+    char *path;                 //  Path of that file, which we created
+    char *final_path;           //  Where the file goes once complete
+    int64_t active_at;          //  When we last heard of stream
+} instream_t;
+
+static void
+s_instream_destroy (void *argument)
+{
+    instream_t *stream = (instream_t *) argument;
+    if (stream->sink) {
+        //  A stream that did not complete leaves no file
+        fclose (stream->sink);
+        zsys_file_delete (stream->path);
+    }
+    free (stream->peer);
+    free (stream->name);
+    free (stream->path);
+    free (stream->final_path);
+    free (stream);
+}
+
+//  Return true if the name a peer gave a stream is safe to use as a file
+//  name in the sink directory
+
+static bool
+s_stream_name_safe (const char *name)
+{
+    return *name
+        && !strchr (name, '/')
+        && !strchr (name, '\\')
+        && !strstr (name, "..");
+}
+
+//  Move a complete stream file into place, unless there is a file there
+//  already, which we leave alone. Returns 0 if OK, -1 if the file stays
+//  where it is.
+
+static int
+s_instream_place (instream_t *stream)
+{
+#if defined (__UNIX__)
+    //  Unlike rename, link does not replace a file that is in the way
+    if (link (stream->path, stream->final_path))
+        return -1;
+    unlink (stream->path);
+    return 0;
+#else
+    return rename (stream->path, stream->final_path);
+#endif
+}
+
+//  Send a stream's chunks to its peer for as long as its window is open.
+//  A chunk of a file is copied from the file mapping if we have one.
+
+static void
+zyre_node_pump_stream (zyre_node_t *self, outstream_t *stream)
+{
+    zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, stream->peer);
+    if (!peer || !zyre_peer_ready (peer) || stream->lost_at)
+        return;
+
+    while ((stream->sent < stream->total || !stream->started)
+    &&      stream->sent - stream->taken < STREAM_WINDOW * STREAM_CHUNK) {
+        size_t size = stream->total - stream->sent < STREAM_CHUNK?
+                      (size_t) (stream->total - stream->sent): STREAM_CHUNK;
+        zframe_t *chunk = NULL;
+        if (stream->data)
+            chunk = zframe_new (zframe_data (stream->data) + stream->sent, size);
+#if defined (STREAM_MMAP)
+        //  Another process may cut the file short under us, and reading a
+        //  mapped page past the end of the file faults. So we copy chunks
+        //  out of the mapping right after checking the file still holds
+        //  them, and never hand libzmq a pointer into the mapping, as its
+        //  I/O thread reads that later. Otherwise the read below fails, and
+        //  we drop the stream.
+        struct stat file_stat;
+        if (stream->map
+        &&  fstat (fileno (stream->file), &file_stat) == 0
+        &&  (uint64_t) file_stat.st_size >= stream->sent + size)
+            chunk = zframe_new (stream->map + stream->sent, size);
+#endif
+        if (!chunk) {
+            chunk = zframe_new (NULL, size);
+            if (s_file_seek (stream->file, stream->sent)
+            ||  fread (zframe_data (chunk), 1, size, stream->file) != size) {
+                zsys_warning ("(%s) cannot read stream name=%s: %s",
+                              self->name, stream->name, strerror (errno));
+                zframe_destroy (&chunk);
+                char key [11];
+                snprintf (key, sizeof (key), "%u", stream->number);
+                zhash_delete (self->outstreams, key);
+                return;
+            }
+        }
+        zre_msg_t *msg = zre_msg_new ();
+        zre_msg_set_id (msg, ZRE_MSG_STREAM);
+        zre_msg_set_stream (msg, stream->number);
+        zre_msg_set_name (msg, stream->name);
+        zre_msg_set_offset (msg, stream->sent);
+        zre_msg_set_total (msg, stream->total);
+        zmsg_t *content = zmsg_new ();
+        zmsg_append (content, &chunk);
+        zre_msg_set_content (msg, &content);
+        zyre_peer_send (peer, &msg);
+        stream->sent += size;
+        stream->started = true;
+    }
+}
+
+//  Return true if we can stream to a peer, which must be there and support
+//  streams
+
+static bool
+zyre_node_can_stream (zyre_node_t *self, const char *identity)
+{
+    zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, identity);
+    if (!peer || !(zyre_peer_features (peer) & ZYRE_PEER_FEATURE_STREAMS)) {
+        zsys_warning ("(%s) cannot stream to peer=%s, it is not there or does not support streams",
+                      self->name, peer? zyre_peer_name (peer): identity);
+        return false;
+    }
+    return true;
+}
+
+//  Number a new stream, and start sending it
+
+static void
+zyre_node_start_stream (zyre_node_t *self, outstream_t *stream)
+{
+    stream->number = ++self->last_stream;
+    char key [11];
+    snprintf (key, sizeof (key), "%u", stream->number);
+    zhash_insert (self->outstreams, key, stream);
+    zhash_freefn (self->outstreams, key, s_outstream_destroy);
+    zyre_node_pump_stream (self, stream);
+}
+
+//  Start streaming a file to a peer. Returns 0 if OK, -1 if we cannot
+//  stream to the peer or read the file.
+
+static int
+zyre_node_send_file (zyre_node_t *self, const char *identity, const char *path,
+                     const char *name)
+{
+    if (!zyre_node_can_stream (self, identity))
+        return -1;
+    FILE *file = fopen (path, "rb");
+    if (!file) {
+        zsys_warning ("(%s) cannot stream file=%s: %s", self->name, path, strerror (errno));
+        return -1;
+    }
+    outstream_t *stream = (outstream_t *) zmalloc (sizeof (outstream_t));
+    stream->peer = strdup (identity);
+    //  Peers only see the file name, not where it came from
+    const char *base = strrchr (path, '/');
+    stream->name = strdup (*name? name: base? base + 1: path);
+    stream->file = file;
+    stream->total = (uint64_t) zsys_file_size (path);
+#if defined (STREAM_MMAP)
+    if (stream->total > 0 && stream->total <= SIZE_MAX) {
+        void *data = mmap (NULL, (size_t) stream->total, PROT_READ, MAP_PRIVATE, fileno (file), 0);
+        if (data != MAP_FAILED)
+            stream->map = (byte *) data;
+    }
+#endif
+    zyre_node_start_stream (self, stream);
+    return 0;
+}
+
+//  Start streaming an object we hold in memory to a peer, taking ownership
+//  of it. Returns 0 if OK, -1 if we cannot stream to the peer, in which
+//  case we drop the object.
+
+static int
+zyre_node_send_stream (zyre_node_t *self, const char *identity, const char *name,
+                       zframe_t **data_p)
+{
+    if (!zyre_node_can_stream (self, identity)) {
+        zframe_destroy (data_p);
+        return -1;
+    }
+    outstream_t *stream = (outstream_t *) zmalloc (sizeof (outstream_t));
+    stream->peer = strdup (identity);
+    stream->name = strdup (name);
+    stream->data = *data_p;
+    *data_p = NULL;
+    stream->total = zframe_size (stream->data);
+    zyre_node_start_stream (self, stream);
+    return 0;
+}
+
+//  Handle a peer taking part of a stream we sent it
+
+static void
+zyre_node_stream_taken (zyre_node_t *self, zyre_peer_t *peer, zre_msg_t *msg)
+{
+    char key [11];
+    snprintf (key, sizeof (key), "%u", zre_msg_stream (msg));
+    outstream_t *stream = (outstream_t *) zhash_lookup (self->outstreams, key);
+    if (!stream || strneq (stream->peer, zyre_peer_identity (peer)))
+        return;
+    if (zre_msg_offset (msg) > stream->taken && zre_msg_offset (msg) <= stream->sent)
+        stream->taken = zre_msg_offset (msg);
+    if (stream->taken == stream->total) {
+        if (self->verbose)
+            zsys_info ("(%s) streamed name=%s to peer=%s",
+                       self->name, stream->name, zyre_peer_name (peer));
+        zhash_delete (self->outstreams, key);
+    }
+    else
+        zyre_node_pump_stream (self, stream);
+}
+
+//  Tell peer how much of a stream we took, if we took more since we last
+//  told it
+
+static void
+zyre_node_ack_stream (zyre_node_t *self, instream_t *stream)
+{
+    zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, stream->peer);
+    if (peer && zyre_peer_ready (peer) && stream->acked < stream->taken) {
+        zre_msg_t *msg = zre_msg_new ();
+        zre_msg_set_id (msg, ZRE_MSG_STREAM_ACK);
+        zre_msg_set_stream (msg, stream->number);
+        zre_msg_set_offset (msg, stream->taken);
+        zyre_peer_send (peer, &msg);
+        stream->acked = stream->taken;
+    }
+}
+
+//  Take a chunk of a stream from a peer. We pass the chunk to the
+//  application, or write it to the stream sink. We only open the sender's
+//  window once the application has taken all events we hold for it, so a
+//  slow application slows the sender down rather than filling our memory.
+
+static void
+zyre_node_take_stream (zyre_node_t *self, zyre_peer_t *peer, zre_msg_t *msg)
+{
+    char key [48];
+    snprintf (key, sizeof (key), "%s-%u", zyre_peer_identity (peer), zre_msg_stream (msg));
+    instream_t *stream = (instream_t *) zhash_lookup (self->instreams, key);
+    if (!stream) {
+        if (zre_msg_offset (msg) != 0)
+            return;             //  We dropped the start of this stream
+        stream = (instream_t *) zmalloc (sizeof (instream_t));
+        stream->peer = strdup (zyre_peer_identity (peer));
+        stream->number = zre_msg_stream (msg);
+        stream->name = strdup (zre_msg_name (msg));
+        stream->total = zre_msg_total (msg);
+        if (self->stream_sink) {
+            //  We write to a new file of our own until the stream is
+            //  complete. The peer names the file it ends up as, but never
+            //  outside the sink directory.
+            stream->path = zsys_sprintf ("%s/.%s.part", self->stream_sink, key);
+            stream->final_path = zsys_sprintf ("%s/%s", self->stream_sink,
+                                               s_stream_name_safe (stream->name)?
+                                               stream->name: key);
+            stream->sink = fopen (stream->path, "wbx");
+            if (!stream->sink)
+                zsys_warning ("(%s) cannot write stream to file=%s: %s",
+                              self->name, stream->path, strerror (errno));
+        }
+        zhash_insert (self->instreams, key, stream);
+        zhash_freefn (self->instreams, key, s_instream_destroy);
+    }
+    stream->active_at = zclock_mono ();
+    if (zre_msg_offset (msg) != stream->taken) {
+        //  A chunk we already took, resent after the peer came back
+        zyre_node_ack_stream (self, stream);
+        return;
+    }
+    zmsg_t *content = zre_msg_get_content (msg);
+    if (self->stream_sink) {
+        zframe_t *frame = content? zmsg_first (content): NULL;
+        while (frame) {
+            if (stream->sink
+            &&  fwrite (zframe_data (frame), 1, zframe_size (frame), stream->sink) != zframe_size (frame)) {
+                zsys_warning ("(%s) cannot write stream to file=%s: %s",
+                              self->name, stream->path, strerror (errno));
+                fclose (stream->sink);
+                stream->sink = NULL;
+                zsys_file_delete (stream->path);
+            }
+            stream->taken += zframe_size (frame);
+            frame = zmsg_next (content);
+        }
+    }
     else {
-        zsys_error ("invalid command '%s'", command);
-        assert (false);
+        zmsg_t *event = s_event_new ("STREAM", zyre_peer_identity (peer), zyre_peer_name (peer));
+        zmsg_addstr (event, stream->name);
+        zmsg_addstrf (event, "%" PRIu64, stream->taken);
+        zmsg_addstrf (event, "%" PRIu64, stream->total);
+        zframe_t *frame;
+        while (content && (frame = zmsg_pop (content))) {
+            stream->taken += zframe_size (frame);
+            zmsg_append (event, &frame);
+        }
+        if (self->event_filter & ZYRE_EVENT_STREAM)
+            zyre_node_emit (self, &event);
+        else
+            zmsg_destroy (&event);
+    }
+    zmsg_destroy (&content);
+    if (zlist_size (self->backlog) == 0)
+        zyre_node_ack_stream (self, stream);
+
+    if (stream->taken >= stream->total) {
+        if (self->stream_sink && stream->sink) {
+            //  Tell the application where the stream is, now it's complete
+            fclose (stream->sink);
+            stream->sink = NULL;
+            const char *path = stream->final_path;
+            if (s_instream_place (stream)) {
+                zsys_warning ("(%s) cannot move stream to file=%s, leaving it in file=%s",
+                              self->name, stream->final_path, stream->path);
+                path = stream->path;
+            }
+            if (self->event_filter & ZYRE_EVENT_STREAM) {
+                zmsg_t *event = s_event_new ("STREAM", zyre_peer_identity (peer), zyre_peer_name (peer));
+                zmsg_addstr (event, stream->name);
+                zmsg_addstrf (event, "%" PRIu64, stream->total);
+                zmsg_addstrf (event, "%" PRIu64, stream->total);
+                zmsg_addstr (event, path);
+                zyre_node_emit (self, &event);
+            }
+        }
+        zyre_node_ack_stream (self, stream);
+        zhash_delete (self->instreams, key);
     }
-    zstr_free (&command);
-    zmsg_destroy (&request);
 }
 
-//  Delete peer for a given endpoint
+//  Stop sending streams to a peer that went away, until it comes back
 
-static int
-zyre_node_purge_peer (const char *key, void *item, void *argument)
+static void
+zyre_node_pause_streams (zyre_node_t *self, zyre_peer_t *peer)
 {
-    zyre_peer_t *peer = (zyre_peer_t *) item;
-    char *endpoint = (char *) argument;
-    if (streq (zyre_peer_endpoint (peer), endpoint))
-        zyre_peer_disconnect (peer);
-    return 0;
+    outstream_t *stream = (outstream_t *) zhash_first (self->outstreams);
+    while (stream) {
+        if (streq (stream->peer, zyre_peer_identity (peer)))
+            stream->lost_at = zclock_mono ();
+        stream = (outstream_t *) zhash_next (self->outstreams);
+    }
 }
 
-//  Find or create peer via its UUID
+//  Resend streams to a peer that came back, from the last chunk it took
 
-static zyre_peer_t *
-zyre_node_require_peer (zyre_node_t *self, zuuid_t *uuid, const char *endpoint, const char *public_key)
+static void
+zyre_node_resume_streams (zyre_node_t *self, zyre_peer_t *peer)
 {
-    assert (self);
-    assert (endpoint);
-
-    zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, zuuid_str (uuid));
-    if (!peer) {
-        //  Purge any previous peer on same endpoint
-        void *item;
-        for (item = zhash_first (self->peers); item != NULL;
-                item = zhash_next (self->peers))
-            zyre_node_purge_peer (zhash_cursor (self->peers), item, (char *) endpoint);
+    outstream_t *stream = (outstream_t *) zhash_first (self->outstreams);
+    while (stream) {
+        if (streq (stream->peer, zyre_peer_identity (peer))) {
+            stream->lost_at = 0;
+            stream->sent = stream->taken;
+            stream->started = stream->taken > 0;
+            zyre_node_pump_stream (self, stream);
+        }
+        stream = (outstream_t *) zhash_next (self->outstreams);
+    }
+}
 
-        peer = zyre_peer_new (self->peers, uuid);
-        assert (peer);
+//  Tell peers how much of their streams we took, once the application
+//  has caught up with us
 
-        if (self->public_key && self->secret_key) {
-            assert (public_key != NULL);
-            // set my local keys
-            zyre_peer_set_public_key(peer, self->public_key);
-            zyre_peer_set_secret_key(peer, self->secret_key);
-            // set the public key of the peer we're connecting to
-            // peer is acting as the 'server' curve role
-            zyre_peer_set_server_key(peer, public_key);
-        }
-
-        zyre_peer_set_origin (peer, self->name);
-        zyre_peer_set_verbose (peer, self->verbose);
-        int rc = zyre_peer_connect (peer, self->uuid, endpoint,
-                self->expired_timeout);
-        if (rc != 0) {
-            // TBD: removing the peer means it will keep retrying. Should
-            // it be kept in the hash table instead perhaps?
-            zhash_delete (self->peers, zyre_peer_identity (peer));
-            return NULL;
-        }
-
-        //  Handshake discovery by sending HELLO as first message
-        zlist_t *groups = zlist_dup (self->own_groups);
-        zhash_t *headers = zhash_dup (self->headers);
-        zre_msg_t *msg = zre_msg_new ();
-        zre_msg_set_id (msg, ZRE_MSG_HELLO);
-
-        //  If the endpoint is a link-local IPv6 address we must not send the
-        //  interface name to the peer, as it is relevant only on the local node
-        char endpoint_iface [NI_MAXHOST] = {0};
-        if (zsys_ipv6 () && strchr (self->endpoint, '%')) {
-            strcat (endpoint_iface, self->endpoint);
-            memmove (strchr (endpoint_iface, '%'),
-                    strrchr (endpoint_iface, ':'),
-                    strlen (strrchr (endpoint_iface, ':')) + 1);
-            zre_msg_set_endpoint (msg, endpoint_iface);
-        }
-        else
-        if (self->advertised_endpoint)
-            zre_msg_set_endpoint (msg, self->advertised_endpoint);
-        else
-            zre_msg_set_endpoint (msg, self->endpoint);
+static void
+zyre_node_ack_streams (zyre_node_t *self)
+{
+    instream_t *stream = (instream_t *) zhash_first (self->instreams);
+    while (stream) {
+        zyre_node_ack_stream (self, stream);
+        stream = (instream_t *) zhash_next (self->instreams);
+    }
+}
 
-        zre_msg_set_groups (msg, &groups);
-        zre_msg_set_status (msg, self->status);
-        zre_msg_set_name (msg, self->name);
-        zre_msg_set_headers (msg, &headers);
-        zyre_peer_send (peer, &msg);
-        zre_msg_destroy (&msg);
+//  Give up on streams whose peer has been gone for as long as it takes a
+//  peer to expire, in either direction
 
-        zyre_peer_refresh (peer, self->evasive_timeout, self->expired_timeout);
+static void
+zyre_node_reap_streams (zyre_node_t *self)
+{
+    int64_t now = zclock_mono ();
+    zlist_t *keys = zhash_keys (self->outstreams);
+    char *key = (char *) zlist_first (keys);
+    while (key) {
+        outstream_t *stream = (outstream_t *) zhash_lookup (self->outstreams, key);
+        if (stream->lost_at && now - stream->lost_at > (int64_t) self->expired_timeout) {
+            zsys_warning ("(%s) peer did not come back, dropping stream name=%s",
+                          self->name, stream->name);
+            zhash_delete (self->outstreams, key);
+        }
+        key = (char *) zlist_next (keys);
     }
-    return peer;
+    zlist_destroy (&keys);
+
+    keys = zhash_keys (self->instreams);
+    key = (char *) zlist_first (keys);
+    while (key) {
+        instream_t *stream = (instream_t *) zhash_lookup (self->instreams, key);
+        if (now - stream->active_at > (int64_t) self->expired_timeout) {
+            zsys_warning ("(%s) stream went quiet, dropping stream name=%s",
+                          self->name, stream->name);
+            zhash_delete (self->instreams, key);
+        }
+        key = (char *) zlist_next (keys);
+    }
+    zlist_destroy (&keys);
 }
 
 
-//  Remove peer from group, if it's a member
+//  Pass a peer's reply to the application, if we're still waiting for it;
+//  we drop late replies, and replies from peers we didn't ask
 
-static int
-zyre_node_delete_peer (const char *key, void *item, void *argument)
+static void
+zyre_node_take_reply (zyre_node_t *self, zyre_peer_t *peer, zre_msg_t *msg)
 {
-    zyre_group_t *group = (zyre_group_t *) item;
-    zyre_peer_t *peer = (zyre_peer_t *) argument;
-    zyre_group_leave (group, peer);
-    return 0;
+    char key [21];
+    snprintf (key, sizeof (key), "%" PRIu64, zre_msg_correlation (msg));
+    request_t *request = (request_t *) zhash_lookup (self->requests, key);
+    if (!request || strneq (request->peer, zyre_peer_identity (peer)))
+        return;
+    zyre_node_forget_request (self, request);
+    if (self->event_filter & ZYRE_EVENT_REPLY) {
+        zmsg_t *event = s_event_new ("REPLY", zyre_peer_identity (peer), zyre_peer_name (peer));
+        zmsg_addstr (event, key);
+        zmsg_t *content = zre_msg_get_content (msg);
+        zframe_t *frame;
+        while (content && (frame = zmsg_pop (content)))
+            zmsg_append (event, &frame);
+        zmsg_destroy (&content);
+        zyre_node_emit (self, &event);
+    }
 }
 
+//  Fail requests whose time is up
+
 static void
-zyre_node_leader_peer_group (zyre_node_t *self, const char *identity,
-                             const char *name, const char *group)
+zyre_node_expire_requests (zyre_node_t *self)
 {
-    //  Now tell the caller about the elected leader peer
-    zstr_sendm (self->outbox, "LEADER");
-    zstr_sendm (self->outbox, identity);
-    zstr_sendm (self->outbox, name);
-    zstr_send (self->outbox, group);
+    int64_t now = zclock_mono ();
+    request_t *request = (request_t *) zlistx_first (self->request_timers);
+    while (request && request->expires_at <= now) {
+        zyre_node_noreply (self, request->peer, request->id, "timeout");
+        zyre_node_forget_request (self, request);
+        request = (request_t *) zlistx_first (self->request_timers);
+    }
+}
 
-    if (self->verbose)
-        zsys_info ("(%s) LEADER name=%s group=%s identity=%s",
-                   self->name,
-                   name,
-                   group,
-                   identity);
+//  Fail the requests we sent a peer that has gone, rather than let them
+//  wait out their timeouts
+
+static void
+zyre_node_fail_requests (zyre_node_t *self, zyre_peer_t *peer)
+{
+    zlist_t *failed = zlist_new ();
+    request_t *request;
+    for (request = (request_t *) zhash_first (self->requests); request;
+            request = (request_t *) zhash_next (self->requests))
+        if (streq (request->peer, zyre_peer_identity (peer)))
+            zlist_append (failed, request);
+    while ((request = (request_t *) zlist_pop (failed))) {
+        zyre_node_noreply (self, request->peer, request->id, "exit");
+        zyre_node_forget_request (self, request);
+    }
+    zlist_destroy (&failed);
 }
 
 //  Remove a peer from our data structures
@@ -924,10 +3506,15 @@ static void
 zyre_node_remove_peer (zyre_node_t *self, zyre_peer_t *peer)
 {
     void *item;
+    zyre_node_pause_streams (self, peer);
     //  Tell the calling application the peer has gone
-    zstr_sendm (self->outbox, "EXIT");
-    zstr_sendm (self->outbox, zyre_peer_identity (peer));
-    zstr_send (self->outbox, zyre_peer_name (peer));
+    if (self->event_filter & ZYRE_EVENT_EXIT) {
+        zmsg_t *event = s_event_new ("EXIT", zyre_peer_identity (peer), zyre_peer_name (peer));
+        zyre_node_emit (self, &event);
+    }
+    if (zhash_size (self->requests))
+        zyre_node_fail_requests (self, peer);
+    zyre_node_remember_hello (self, peer);
 
 #ifdef ZYRE_BUILD_DRAFT_API
     //  Clean this peer in our gossip table if needed
@@ -951,9 +3538,10 @@ zyre_node_remove_peer (zyre_node_t *self, zyre_peer_t *peer)
                     zyre_group_set_election (group, NULL);
                 }
 
-                zlist_t *peer_attendees = zyre_group_peers (group);
+                zlist_t *peer_attendees = zyre_group_voters (group);
+                zlist_remove (peer_attendees, (void *) zyre_peer_identity (peer));
                 size_t nb = zlist_size (peer_attendees);
-                if (nb == 1) {
+                if (nb == 0) {
                     // We are last in an election because leader left, we are therefore the leader
                     zyre_group_set_leader(group, NULL);
                     zyre_node_leader_peer_group (self,
@@ -970,14 +3558,14 @@ zyre_node_remove_peer (zyre_node_t *self, zyre_peer_t *peer)
                     zyre_group_set_leader(group, NULL);
 
                     //  Start challenge for leadership
-                    zyre_election_set_caw (election, strdup (zuuid_str (self->uuid)));
+                    zyre_election_set_caw (election, zuuid_data (self->uuid));
                     zre_msg_t *election_msg = zyre_election_build_elect_msg (election);
                     zre_msg_set_group (election_msg, group_name);
 
                     if (self->verbose)
                         zsys_info ("(%s) [%s] send ELECT message - %s",
                                 self->name, group_name, zuuid_str (self->uuid));
-                    zyre_group_send (group, &election_msg);
+                    zyre_group_send_voters (group, &election_msg);
                 }
                 zlist_destroy (&peer_attendees);
             }
@@ -994,6 +3582,8 @@ zyre_node_remove_peer (zyre_node_t *self, zyre_peer_t *peer)
             item = zhash_next (self->peer_groups))
         zyre_node_delete_peer (zhash_cursor (self->peer_groups), item, peer);
     //  To destroy peer, we remove from peers hash table
+    if (!zyre_peer_ready (peer))
+        self->handshakes--;
     zhash_delete (self->peers, zyre_peer_identity (peer));
 
 
@@ -1006,8 +3596,10 @@ static zyre_group_t *
 zyre_node_require_peer_group (zyre_node_t *self, const char *name)
 {
     zyre_group_t *group = (zyre_group_t *) zhash_lookup (self->peer_groups, name);
-    if (!group)
+    if (!group) {
         group = zyre_group_new (name, self->peer_groups);
+        zyre_group_share (group, self->rings);
+    }
 
     return group;
 }
@@ -1018,11 +3610,17 @@ zyre_node_join_peer_group (zyre_node_t *self, zyre_peer_t *peer, const char *nam
     zyre_group_t *group = zyre_node_require_peer_group (self, name);
     zyre_group_join (group, peer);
 
+    //  If we're in the group too, catch up with the writes to its store
+    //  the peer has and we don't; the peer does the same with us
+    if (zlist_exists (self->own_groups, (void *) name))
+        zyre_group_store_sync (group, peer);
+
     //  Now tell the caller about the peer joined group
-    zstr_sendm (self->outbox, "JOIN");
-    zstr_sendm (self->outbox, zyre_peer_identity (peer));
-    zstr_sendm (self->outbox, zyre_peer_name (peer));
-    zstr_send (self->outbox, name);
+    if (self->event_filter & ZYRE_EVENT_JOIN) {
+        zmsg_t *event = s_event_new ("JOIN", zyre_peer_identity (peer), zyre_peer_name (peer));
+        zmsg_addstr (event, name);
+        zyre_node_emit (self, &event);
+    }
 
     if (self->verbose)
         zsys_info ("(%s) JOIN name=%s group=%s",
@@ -1036,12 +3634,14 @@ zyre_node_leave_peer_group (zyre_node_t *self, zyre_peer_t *peer, const char *na
 {
     zyre_group_t *group = zyre_node_require_peer_group (self, name);
     zyre_group_leave (group, peer);
+    zyre_node_history_left (self, peer, name);
 
     //  Now tell the caller about the peer left group
-    zstr_sendm (self->outbox, "LEAVE");
-    zstr_sendm (self->outbox, zyre_peer_identity (peer));
-    zstr_sendm (self->outbox, zyre_peer_name (peer));
-    zstr_send (self->outbox, name);
+    if (self->event_filter & ZYRE_EVENT_LEAVE) {
+        zmsg_t *event = s_event_new ("LEAVE", zyre_peer_identity (peer), zyre_peer_name (peer));
+        zmsg_addstr (event, name);
+        zyre_node_emit (self, &event);
+    }
 
     if (self->verbose)
         zsys_info ("(%s) LEAVE name=%s group=%s",
@@ -1050,33 +3650,316 @@ zyre_node_leave_peer_group (zyre_node_t *self, zyre_peer_t *peer, const char *na
     return group;
 }
 
-//  Here we handle messages coming from other peers
+//  Restart the election in a group we contest, leaving out any leader
+//  whose lease has lapsed
 
 static void
-zyre_node_recv_peer (zyre_node_t *self)
+zyre_node_restart_election (zyre_node_t *self, zyre_group_t *group, const char *name)
 {
-    //  Router socket tells us the identity of this peer
-    zre_msg_t *msg = zre_msg_new ();
-    int rc = zre_msg_recv (msg, self->inbox);
-    if (rc == -1)
-        return;                 //  Interrupted
-    if (rc == -2) {
-        zre_msg_destroy (&msg);
-        return;                 //  Malformed
+    zyre_election_t *election = zyre_group_election (group);
+    if (election) {
+        //  Discard running election because the set of voters changed
+        zyre_election_destroy (&election);
+        zyre_group_set_election (group, NULL);
+    }
+    zyre_group_set_leader (group, NULL);
+
+    //  Start challenge for leadership. The challenge names the leader we
+    //  leave out, so every voter counts the same voters, and we send it to
+    //  that leader too, so it knows to step down.
+    election = zyre_election_new ();
+    zyre_election_set_caw (election, zuuid_data (self->uuid));
+    zre_msg_t *election_msg = zyre_election_build_elect_msg (election);
+    zre_msg_set_group (election_msg, name);
+    zyre_peer_t *lapsed = zyre_group_lapsed (group);
+    if (lapsed) {
+        zre_msg_set_lapsed (election_msg, zyre_peer_identity (lapsed));
+        zre_msg_t *notice = zre_msg_dup (election_msg);
+        zyre_peer_send (lapsed, &notice);
+    }
+    zlist_t *voters = zyre_group_voters (group);
+    if (zlist_size (voters) == 0) {
+        //  Nobody else can vote, we are therefore the leader
+        zyre_election_destroy (&election);
+        zre_msg_destroy (&election_msg);
+        zyre_node_leader_peer_group (self, zuuid_str (self->uuid), self->name, name);
+        if (self->verbose)
+            zsys_info ("(%s) [%s] Election finished %s, LEADER (because alone)!\n",
+                       self->name, name, zuuid_str (self->uuid));
     }
+    else {
+        zyre_group_set_election (group, election);
+        if (self->verbose)
+            zsys_info ("(%s) [%s] send ELECT message - %s",
+                       self->name, name, zuuid_str (self->uuid));
+        zyre_group_send_voters (group, &election_msg);
+    }
+    zlist_destroy (&voters);
+}
 
-    //  First frame is sender identity
-    byte *peerid_data = zframe_data (zre_msg_routing_id (msg));
-    size_t peerid_size = zframe_size (zre_msg_routing_id (msg));
 
-    //  Identity must be [1] followed by 16-byte UUID
-    if (peerid_size != ZUUID_LEN + 1) {
-        zre_msg_destroy (&msg);
+//  The leader of a group let its lease lapse. We stop counting it as a
+//  voter and, if we contest the group, challenge for leadership straight
+//  away rather than waiting for the peer to expire.
+
+static void
+zyre_node_lapse_leader (zyre_node_t *self, zyre_group_t *group, const char *name)
+{
+    zyre_peer_t *leader = zyre_group_leader (group);
+    assert (leader);
+    if (self->verbose)
+        zsys_info ("(%s) [%s] leader lease lapsed - %s",
+                   self->name, name, zyre_peer_identity (leader));
+
+    zyre_group_set_lapsed (group, leader);
+    zyre_group_set_leader (group, NULL);
+    if (zyre_group_contest (group))
+        zyre_node_restart_election (self, group, name);
+}
+
+
+//  A leader we left out of elections is challenging for the group again.
+//  Let it back into the vote, and restart the election so that it counts.
+
+static void
+zyre_node_restore_lapsed (zyre_node_t *self, zyre_group_t *group, const char *name)
+{
+    if (self->verbose)
+        zsys_info ("(%s) [%s] lapsed leader is back - %s",
+                   self->name, name, zyre_peer_identity (zyre_group_lapsed (group)));
+
+    zyre_group_set_lapsed (group, NULL);
+    zyre_election_t *election = zyre_group_election (group);
+    if (election) {
+        zyre_election_destroy (&election);
+        zyre_group_set_election (group, NULL);
+    }
+    if (zyre_group_contest (group))
+        zyre_node_restart_election (self, group, name);
+}
+
+
+//  We lead a group, but we've not heard from a majority of its voters for
+//  a whole lease, or a challenger told us our lease lapsed. The others may
+//  have elected a new leader already, so we stop leading at once. We only
+//  lead again by winning a new election.
+
+static void
+zyre_node_step_down (zyre_node_t *self, zyre_group_t *group, const char *name)
+{
+    if (self->verbose)
+        zsys_info ("(%s) [%s] step down as leader - %s",
+                   self->name, name, zuuid_str (self->uuid));
+
+    zyre_group_set_leading (group, false);
+    zyre_group_set_leader (group, NULL);
+    if (self->event_filter & ZYRE_EVENT_STEP_DOWN) {
+        zmsg_t *event = s_event_new ("STEP-DOWN", zuuid_str (self->uuid), self->name);
+        zmsg_addstr (event, name);
+        zyre_node_emit (self, &event);
+    }
+}
+
+
+//  Return true if we've heard from a majority of a group's voters, counting
+//  ourselves, within the last lease
+
+static bool
+zyre_node_hears_majority (zyre_node_t *self, zyre_group_t *group)
+{
+    int64_t now = zclock_mono ();
+    zlist_t *voters = zyre_group_voters (group);
+    size_t members = zlist_size (voters) + 1;
+    size_t heard = 1;
+    const char *identity = (const char *) zlist_first (voters);
+    while (identity) {
+        zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, identity);
+        if (peer && now - zyre_peer_active_at (peer) <= zyre_group_lease (group))
+            heard++;
+        identity = (const char *) zlist_next (voters);
+    }
+    zlist_destroy (&voters);
+    return heard * 2 > members;
+}
+
+
+//  Check leader leases in the groups we are in. As leader, we send a PING
+//  to any voter we've not sent to or heard from for a third of the lease,
+//  and step down if we've not heard from a majority of voters for a whole
+//  lease. As follower, we lapse a leader we've not heard from for a whole
+//  lease. If we contest a group that has no leader and no election, we
+//  challenge again once we hear from a majority.
+
+static void
+zyre_node_check_leases (zyre_node_t *self)
+{
+    int64_t now = zclock_mono ();
+    const char *name = (const char *) zlist_first (self->own_groups);
+    while (name) {
+        zyre_group_t *group = (zyre_group_t *) zhash_lookup (self->peer_groups, name);
+        int lease = group? zyre_group_lease (group): 0;
+        if (lease > 0 && zyre_group_leading (group)) {
+            zlist_t *voters = zyre_group_voters (group);
+            const char *identity = (const char *) zlist_first (voters);
+            while (identity) {
+                zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, identity);
+                if (peer
+                && (now - zyre_peer_sent_at (peer) >= lease / 3
+                ||  now - zyre_peer_active_at (peer) >= lease / 3)) {
+                    zre_msg_t *msg = zre_msg_new ();
+                    zre_msg_set_id (msg, ZRE_MSG_PING);
+                    zyre_peer_send_control (peer, &msg);
+                }
+                identity = (const char *) zlist_next (voters);
+            }
+            zlist_destroy (&voters);
+            if (!zyre_node_hears_majority (self, group))
+                zyre_node_step_down (self, group, name);
+        }
+        else
+        if (lease > 0 && zyre_group_leader (group)) {
+            if (now - zyre_peer_active_at (zyre_group_leader (group)) > lease)
+                zyre_node_lapse_leader (self, group, name);
+        }
+        else
+        if (lease > 0 && zyre_group_contest (group)
+        &&  zyre_group_election (group) == NULL
+        &&  zyre_node_hears_majority (self, group))
+            zyre_node_restart_election (self, group, name);
+
+        name = (const char *) zlist_next (self->own_groups);
+    }
+}
+
+
+//  Return true if a TCP endpoint is on this host: a loopback address, our
+//  own host, or the address of one of our interfaces
+
+static bool
+zyre_node_local_endpoint (zyre_node_t *self, const char *endpoint)
+{
+    if (strncmp (endpoint, "tcp://", 6))
+        return false;
+    char host [NI_MAXHOST] = {0};
+    const char *start = endpoint + 6;
+    const char *end = strrchr (start, ':');
+    if (!end || end - start >= NI_MAXHOST)
+        return false;
+    if (*start == '[' && end [-1] == ']') {
+        start++;
+        end--;
+    }
+    memcpy (host, start, end - start);
+    char *iface = strchr (host, '%');
+    if (iface)
+        *iface = 0;
+
+    if (streq (host, "127.0.0.1") || streq (host, "::1") || streq (host, "localhost"))
+        return true;
+    if (self->endpoint && strncmp (self->endpoint, endpoint, 6 + strlen (host)) == 0
+    &&  self->endpoint [6 + strlen (host)] == ':')
+        return true;
+
+    bool local = false;
+    ziflist_t *iflist = ziflist_new ();
+    const char *name = ziflist_first (iflist);
+    while (name && !local) {
+        local = streq (ziflist_address (iflist), host);
+        name = ziflist_next (iflist);
+    }
+    ziflist_destroy (&iflist);
+    return local;
+}
+
+
+//  If we take IPC ourselves, and a peer that greeted us runs on this host
+//  and has an IPC endpoint, move our mailbox to that endpoint
+
+static void
+zyre_node_upgrade_peer (zyre_node_t *self, zyre_peer_t *peer)
+{
+    const char *ipc_endpoint = zyre_peer_header (peer, "X-ZRE-IPC", NULL);
+    if (self->ipc_endpoint
+    &&  ipc_endpoint
+    &&  strncmp (ipc_endpoint, "ipc://", 6) == 0
+    &&  zyre_node_local_endpoint (self, zyre_peer_endpoint (peer))
+    &&  zsys_file_exists (ipc_endpoint + 6))
+        zyre_peer_upgrade (peer, ipc_endpoint);
+}
+
+
+//  Take a SHOUT that came to us down a relay tree: pass it on to the rest
+//  of the peers it is bound for, then up to the caller as a SHOUT event
+//  from the node that sent it. We only take relays of SHOUTs from nodes we
+//  know to be in the group, and drop copies we already had. The SHOUT event
+//  names the origin the relaying peer gave us, which we can't check; it is
+//  only as good as the peers that relayed it.
+//
+//  If we know fewer peers in our range than the peer that sent it to us,
+//  we give the range back to that peer, which sends to the rest of the
+//  range directly. Peers drop the copies they get twice.
+
+static void
+zyre_node_take_relay (zyre_node_t *self, zyre_peer_t *peer, zre_msg_t *msg)
+{
+    const char *name = zre_msg_group (msg);
+    zyre_group_t *group = (zyre_group_t *) zhash_lookup (self->peer_groups, name);
+    if (zre_msg_span (msg) == 0) {
+        //  A peer we relayed to gives its range back
+        if (group && zyre_group_has_peer (group, peer))
+            zyre_group_relay_direct (group, msg, zyre_peer_identity (peer));
         return;
     }
     zuuid_t *uuid = zuuid_new ();
-    zuuid_set (uuid, peerid_data + 1);
+    zuuid_set (uuid, zre_msg_origin (msg));
+    zyre_peer_t *origin = (zyre_peer_t *) zhash_lookup (self->peers, zuuid_str (uuid));
+    zuuid_destroy (&uuid);
+    if (!origin || !group || !zyre_group_has_peer (group, origin)) {
+        if (self->verbose)
+            zsys_info ("(%s) dropping relay to group=%s from unknown origin",
+                       self->name, name);
+        return;
+    }
+    if (zyre_peer_relay_seen (origin, name, zre_msg_serial (msg)))
+        return;
+
+    //  Relaying sets the bound of the copies on the message
+    byte bound [ZUUID_LEN];
+    memcpy (bound, zre_msg_bound (msg), ZUUID_LEN);
+    if (zyre_group_relay (group, msg, self->uuid)) {
+        if (self->verbose)
+            zsys_info ("(%s) giving relay range back to peer=%s",
+                       self->name, zyre_peer_name (peer));
+        zre_msg_t *range = zre_msg_dup (msg);
+        zre_msg_set_bound (range, bound);
+        zre_msg_set_span (range, 0);
+        zyre_peer_send (peer, &range);
+        zre_msg_destroy (&range);
+    }
+
+    if (zyre_peer_ready (origin)
+    &&  zlist_exists (self->own_groups, (char *) name)
+    &&  zyre_node_wants_shout (self, name)) {
+        zmsg_t *event = s_event_new ("SHOUT", zyre_peer_identity (origin), zyre_peer_name (origin));
+        zmsg_addstr (event, name);
+        zmsg_t *content = zre_msg_get_content (msg);
+        zframe_t *frame;
+        while (content && (frame = zmsg_pop (content)))
+            zmsg_append (event, &frame);
+        zmsg_destroy (&content);
+        zyre_node_emit (self, &event);
+    }
+}
+
+
+//  Here we handle messages coming from other peers
 
+//  Process a message from a peer; takes ownership of the message and
+//  the sender's UUID
+
+static void
+zyre_node_process_peer (zyre_node_t *self, zre_msg_t *msg, zuuid_t *uuid)
+{
     //  On HELLO we may create the peer if it's unknown
     //  On other commands the peer must already exist
     zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, zuuid_str (uuid));
@@ -1095,6 +3978,21 @@ zyre_node_recv_peer (zyre_node_t *self)
                 return;
             }
         }
+        if (zyre_node_expand_hello (self, msg, uuid)) {
+            //  We no longer know what the peer's compact HELLO builds on,
+            //  so connect back and ask for all of its HELLO
+            peer = self->secret_key? NULL:
+                   zyre_node_require_peer (self, uuid, zre_msg_endpoint (msg), NULL);
+            if (peer && !zyre_peer_hello_wanted (peer)) {
+                zyre_peer_set_hello_wanted (peer, true);
+                zre_msg_t *wanted = zre_msg_new ();
+                zre_msg_set_id (wanted, ZRE_MSG_HELLO_WANTED);
+                zyre_peer_send (peer, &wanted);
+            }
+            zre_msg_destroy (&msg);
+            zuuid_destroy (&uuid);
+            return;
+        }
         if (!self->secret_key) {
             peer = zyre_node_require_peer (self, uuid, zre_msg_endpoint (msg), NULL);
         } else {
@@ -1109,8 +4007,31 @@ zyre_node_recv_peer (zyre_node_t *self)
                 peer = NULL;
             }
         }
-        if (peer)
+        if (peer) {
             zyre_peer_set_ready (peer, true);
+            self->handshakes--;
+        }
+    }
+    //  A peer that can't rebuild our compact HELLO asks for all of it,
+    //  maybe before we have its HELLO
+    if (zre_msg_id (msg) == ZRE_MSG_HELLO_WANTED
+    &&  peer && !zyre_peer_ready (peer)) {
+        zyre_node_resend_hello (self, peer);
+        zre_msg_destroy (&msg);
+        zuuid_destroy (&uuid);
+        return;
+    }
+    //  We hold what a peer sends after a compact HELLO we couldn't rebuild,
+    //  and take it once its full HELLO comes in place of the compact one
+    if (zre_msg_id (msg) != ZRE_MSG_HELLO
+    &&  peer && !zyre_peer_ready (peer) && zyre_peer_hello_wanted (peer)) {
+        if (zyre_peer_hold (peer, &msg)) {
+            zsys_warning ("(%s) too many messages from %s before its HELLO",
+                          self->name, zuuid_str (uuid));
+            zyre_node_remove_peer (self, peer);
+        }
+        zuuid_destroy (&uuid);
+        return;
     }
     //  Ignore command if peer isn't ready
     if (peer == NULL || !zyre_peer_ready (peer)) {
@@ -1125,26 +4046,61 @@ zyre_node_recv_peer (zyre_node_t *self)
         zuuid_destroy (&uuid);
         return;
     }
+    //  Peers without binary IDs send us elections in the legacy string form
+    if (zyre_election_msg_upgrade (msg)) {
+        zsys_warning ("(%s) bad election ID from %s", self->name, zyre_peer_name (peer));
+        zre_msg_destroy (&msg);
+        zuuid_destroy (&uuid);
+        return;
+    }
+    //  Peers that compress content send it as WHISPER-ZSTD and SHOUT-ZSTD
+    if (zyre_node_decompress (self, msg)) {
+        zsys_warning ("(%s) bad compressed content from %s", self->name, zyre_peer_name (peer));
+        zre_msg_destroy (&msg);
+        zuuid_destroy (&uuid);
+        return;
+    }
     //  Now process each command
+    bool take_held = false;
     if (zre_msg_id (msg) == ZRE_MSG_HELLO) {
         //  Store properties from HELLO command into peer
+        take_held = zyre_peer_hello_wanted (peer);
+        zyre_peer_set_hello_wanted (peer, false);
         zyre_peer_set_name (peer, zre_msg_name (msg));
         zyre_peer_set_headers (peer, zre_msg_headers (msg));
+        zyre_node_upgrade_peer (self, peer);
 
         //  Tell the caller about the peer
-        zstr_sendm (self->outbox, "ENTER");
-        zstr_sendm (self->outbox, zyre_peer_identity (peer));
-        zstr_sendm (self->outbox, zyre_peer_name (peer));
-        if (zyre_peer_headers (peer)) {
-            zframe_t *headers = zhash_pack (zyre_peer_headers (peer));
-            zframe_send (&headers, self->outbox, ZFRAME_MORE);
+        if (self->event_filter & ZYRE_EVENT_ENTER) {
+            zmsg_t *event = s_event_new ("ENTER", zyre_peer_identity (peer), zyre_peer_name (peer));
+            if (zyre_peer_headers (peer)) {
+                zframe_t *headers = zhash_pack (zyre_peer_headers (peer));
+                zmsg_append (event, &headers);
+            }
+            zmsg_addstr (event, zre_msg_endpoint (msg));
+            zyre_node_emit (self, &event);
         }
-        zstr_send (self->outbox, zre_msg_endpoint (msg));
 
         if (self->verbose)
             zsys_info ("(%s) ENTER name=%s endpoint=%s",
                 self->name, zyre_peer_name (peer), zyre_peer_endpoint (peer));
 
+        //  Pick up any streams to the peer where we left off
+        zyre_node_resume_streams (self, peer);
+
+        //  If our headers changed after our HELLO, before we knew if the
+        //  peer could take a HEADERS message, send it all of them
+        if (zyre_peer_headers_version (peer) < self->headers_version)
+            zyre_node_send_headers (self, peer, self->headers);
+
+        //  Tell peer which of our groups we take by multicast
+        multicast_t *multicast = (multicast_t *) zhash_first (self->multicast);
+        while (multicast) {
+            if (multicast->dish && zlist_exists (self->own_groups, multicast->group))
+                zyre_node_tell_multicast (self, peer, multicast->group, multicast->endpoint);
+            multicast = (multicast_t *) zhash_next (self->multicast);
+        }
+
         //  Join peer to listed groups
         zlist_t *groups = zre_msg_groups (msg);
         const char *name = (const char *) zlist_first (groups);
@@ -1162,13 +4118,13 @@ zyre_node_recv_peer (zyre_node_t *self)
                 zyre_group_set_leader(group, NULL);
 
                 //  Start challenge for leadership
-                zyre_election_set_caw (election, strdup (zuuid_str (self->uuid)));
+                zyre_election_set_caw (election, zuuid_data (self->uuid));
                 zre_msg_t *election_msg = zyre_election_build_elect_msg (election);
                 zre_msg_set_group (election_msg, name);
                 if (self->verbose)
                     zsys_info ("(%s) [%s] send ELECT message - %s",
                                self->name, name, zuuid_str (self->uuid));
-                zyre_group_send (group, &election_msg);
+                zyre_group_send_voters (group, &election_msg);
             }
             name = (const char *) zlist_next (groups);
         }
@@ -1176,29 +4132,115 @@ zyre_node_recv_peer (zyre_node_t *self)
         zyre_peer_set_status (peer, zre_msg_status (msg));
     }
     else
-    if (zre_msg_id (msg) == ZRE_MSG_WHISPER) {
-        //  Pass up to caller API as WHISPER event
-        zstr_sendm (self->outbox, "WHISPER");
-        zstr_sendm (self->outbox, zuuid_str (uuid));
-        zstr_sendm (self->outbox, zyre_peer_name (peer));
-        zmsg_t *content = zmsg_dup (zre_msg_content (msg));
-        zmsg_send (&content, self->outbox);
+    if (zre_msg_id (msg) == ZRE_MSG_WHISPER) {
+        //  Pass up to caller API as WHISPER event; the content frames move
+        //  to the event without a copy
+        if (self->event_filter & ZYRE_EVENT_WHISPER) {
+            zmsg_t *event = s_event_new ("WHISPER", zuuid_str (uuid), zyre_peer_name (peer));
+            zmsg_t *content = zre_msg_get_content (msg);
+            zframe_t *frame;
+            while (content && (frame = zmsg_pop (content)))
+                zmsg_append (event, &frame);
+            zmsg_destroy (&content);
+            zyre_node_emit (self, &event);
+        }
+    }
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_SHOUT) {
+        //  Pass up to caller as SHOUT event
+        if (zyre_node_wants_shout (self, zre_msg_group (msg))) {
+            zmsg_t *event = s_event_new ("SHOUT", zuuid_str (uuid), zyre_peer_name (peer));
+            zmsg_addstr (event, zre_msg_group (msg));
+            zmsg_t *content = zre_msg_get_content (msg);
+            zframe_t *frame;
+            while (content && (frame = zmsg_pop (content)))
+                zmsg_append (event, &frame);
+            zmsg_destroy (&content);
+            zyre_node_emit (self, &event);
+        }
+    }
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_PING) {
+        zre_msg_t *msg = zre_msg_new ();
+        zre_msg_set_id (msg, ZRE_MSG_PING_OK);
+        zyre_peer_send (peer, &msg);
+    }
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_PING_OK)
+        zyre_peer_ping_ok (peer);
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_STREAM)
+        zyre_node_take_stream (self, peer, msg);
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_STREAM_ACK)
+        zyre_node_stream_taken (self, peer, msg);
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_RELAY)
+        zyre_node_take_relay (self, peer, msg);
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_REQUEST) {
+        //  Pass up to caller as REQUEST event, with the request number
+        //  to reply to
+        if (self->event_filter & ZYRE_EVENT_REQUEST) {
+            zmsg_t *event = s_event_new ("REQUEST", zuuid_str (uuid), zyre_peer_name (peer));
+            zmsg_addstrf (event, "%" PRIu64, zre_msg_correlation (msg));
+            zmsg_t *content = zre_msg_get_content (msg);
+            zframe_t *frame;
+            while (content && (frame = zmsg_pop (content)))
+                zmsg_append (event, &frame);
+            zmsg_destroy (&content);
+            zyre_node_emit (self, &event);
+        }
+    }
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_REPLY)
+        zyre_node_take_reply (self, peer, msg);
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_HELLO_WANTED)
+        zyre_node_resend_hello (self, peer);
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_HEADERS)
+        zyre_node_take_headers (self, peer, msg);
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_STORE_SET) {
+        zyre_group_t *group = zyre_node_require_peer_group (self, zre_msg_group (msg));
+        zyre_group_store_take (group, msg);
+    }
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_CATCHUP)
+        zyre_node_replay_history (self, peer, zre_msg_group (msg));
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_HISTORY) {
+        //  Pass up to caller as HISTORY event, like a SHOUT
+        if (self->event_filter & ZYRE_EVENT_HISTORY
+        &&  zyre_node_wants_shout (self, zre_msg_group (msg))) {
+            zmsg_t *event = s_event_new ("HISTORY", zuuid_str (uuid), zyre_peer_name (peer));
+            zmsg_addstr (event, zre_msg_group (msg));
+            zmsg_t *content = zre_msg_get_content (msg);
+            zframe_t *frame;
+            while (content && (frame = zmsg_pop (content)))
+                zmsg_append (event, &frame);
+            zmsg_destroy (&content);
+            zyre_node_emit (self, &event);
+        }
     }
     else
-    if (zre_msg_id (msg) == ZRE_MSG_SHOUT) {
-        //  Pass up to caller as SHOUT event
-        zstr_sendm (self->outbox, "SHOUT");
-        zstr_sendm (self->outbox, zuuid_str (uuid));
-        zstr_sendm (self->outbox, zyre_peer_name (peer));
-        zstr_sendm (self->outbox, zre_msg_group (msg));
-        zmsg_t *content = zmsg_dup (zre_msg_content (msg));
-        zmsg_send (&content, self->outbox);
+    if (zre_msg_id (msg) == ZRE_MSG_STORE_SYNC) {
+        zyre_group_t *group = (zyre_group_t *) zhash_lookup (self->peer_groups, zre_msg_group (msg));
+        if (group)
+            zyre_group_store_answer (group, peer, msg);
     }
     else
-    if (zre_msg_id (msg) == ZRE_MSG_PING) {
-        zre_msg_t *msg = zre_msg_new ();
-        zre_msg_set_id (msg, ZRE_MSG_PING_OK);
-        zyre_peer_send (peer, &msg);
+    if (zre_msg_id (msg) == ZRE_MSG_MULTICAST)
+        zyre_node_peer_multicast (self, peer, msg);
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_MULTICAST_OK) {
+        //  Take the peer's SHOUTs by multicast only if it switched us to
+        //  where we still listen
+        const char *endpoint = zre_msg_endpoint (msg);
+        bool on = *endpoint && streq (endpoint,
+                  zyre_node_multicast_endpoint (self, zre_msg_group (msg)));
+        zyre_peer_set_multicast_in (peer, zre_msg_group (msg), on, zre_msg_start (msg));
     }
     else
     if (zre_msg_id (msg) == ZRE_MSG_JOIN) {
@@ -1217,14 +4259,14 @@ zyre_node_recv_peer (zyre_node_t *self)
                 zyre_group_set_leader(group, NULL);
 
                 //  Start challenge for leadership
-                zyre_election_set_caw (election, strdup (zuuid_str (self->uuid)));
+                zyre_election_set_caw (election, zuuid_data (self->uuid));
                 zre_msg_t *election_msg = zyre_election_build_elect_msg (election);
                 zre_msg_set_group (election_msg, zre_msg_group (msg));
                 if (self->verbose)
                     zsys_info ("(%s) [%s] send ELECT message - %s",
                         self->name, zre_msg_group (msg), zuuid_str (self->uuid));
 
-                zyre_group_send (group, &election_msg);
+                zyre_group_send_voters (group, &election_msg);
             }
         }
     }
@@ -1243,7 +4285,7 @@ zyre_node_recv_peer (zyre_node_t *self)
                         zyre_election_destroy (&election);
                         zyre_group_set_election (group, NULL);
                     }
-                    zlist_t *peer_attendees = zyre_group_peers (group);
+                    zlist_t *peer_attendees = zyre_group_voters (group);
                     size_t nb = zlist_size (peer_attendees);
                     if (nb == 0) {
                         // We are alone in an election, we are therefore the leader
@@ -1264,14 +4306,14 @@ zyre_node_recv_peer (zyre_node_t *self)
                         zyre_group_set_leader(group, NULL);
 
                         //  Start challenge for leadership
-                        zyre_election_set_caw (election, strdup (zuuid_str (self->uuid)));
+                        zyre_election_set_caw (election, zuuid_data (self->uuid));
                         zre_msg_t *election_msg = zyre_election_build_elect_msg (election);
                         zre_msg_set_group (election_msg, zre_msg_group (msg));
 
                         if (self->verbose)
                             zsys_info ("(%s) [%s] send ELECT message - %s",
                                     self->name, zre_msg_group (msg), zuuid_str (self->uuid));
-                        zyre_group_send (group, &election_msg);
+                        zyre_group_send_voters (group, &election_msg);
                     }
                     zlist_destroy (&peer_attendees);
                 }
@@ -1279,22 +4321,48 @@ zyre_node_recv_peer (zyre_node_t *self)
         }
     }
     else
-    if (zre_msg_id (msg) == ZRE_MSG_ELECT) {
+    if (zre_msg_id (msg) == ZRE_MSG_ELECT_UUID
+    &&  streq (zre_msg_lapsed (msg), zuuid_str (self->uuid))) {
+        //  The challenger let our lease lapse and leaves us out of its
+        //  election, so we must not act as leader any longer
+        zyre_group_t *group = zyre_node_require_peer_group (self, zre_msg_group (msg));
+        if (zyre_group_leading (group))
+            zyre_node_step_down (self, group, zre_msg_group (msg));
+    }
+    else
+    if (zre_msg_id (msg) == ZRE_MSG_ELECT_UUID) {
         zyre_group_t *group = zyre_node_require_peer_group (self, zre_msg_group (msg));
+        //  A leader we left out takes part in elections again by
+        //  challenging, and in no other way
+        if (zyre_group_lapsed (group) == peer)
+            zyre_node_restore_lapsed (self, group, zre_msg_group (msg));
         zyre_election_t *election = zyre_group_require_election (group);
-        const char *challenger = zre_msg_challenger_id (msg);
+        const byte *challenger = zre_msg_challenger (msg);
+        char challenger_str [ZUUID_LEN * 2 + 1];
+        if (self->verbose)
+            zyre_election_format_id (challenger, challenger_str);
 
         if (zyre_election_challenger_superior (election, challenger)) {
             //  Initiate or re-initiate leader election
             zyre_election_reset (election);
-            zyre_election_set_caw (election, strdup (challenger));
+            zyre_election_set_caw (election, challenger);
             zyre_election_set_father (election, peer);
 
+            //  We count the voters the challenger counts, leaving out the
+            //  leader it leaves out, if any, so its echo waves complete
+            zyre_peer_t *lapsed = NULL;
+            if (*zre_msg_lapsed (msg))
+                lapsed = (zyre_peer_t *) zhash_lookup (self->peers, zre_msg_lapsed (msg));
+            zyre_group_set_lapsed (group, lapsed);
+            if (lapsed && zyre_group_leader (group) == lapsed)
+                zyre_group_set_leader (group, NULL);
+
             zre_msg_t *election_msg = zyre_election_build_elect_msg (election);
             zre_msg_set_group (election_msg, zre_msg_group (msg));
+            zre_msg_set_lapsed (election_msg, zre_msg_lapsed (msg));
 
             //  Send election message to all neighbors but emitting peer (also new father)
-            zlist_t *group_peers = zyre_group_peers (group);
+            zlist_t *group_peers = zyre_group_voters (group);
             char *group_peer = (char *) zlist_first (group_peers);
             while (group_peer) {
                 if (strneq (group_peer, zyre_peer_identity (peer))) {
@@ -1308,19 +4376,19 @@ zyre_node_recv_peer (zyre_node_t *self)
             zre_msg_destroy (&election_msg);
             if (self->verbose)
                 zsys_info ("(%s) [%s] support challenger - %s",
-                           self->name, zre_msg_group (msg), challenger);
+                           self->name, zre_msg_group (msg), challenger_str);
         }
 
         //  Support the challenger by participating in its current active wave
         if (zyre_election_supporting_challenger (election, challenger)) {
             zyre_election_increment_erec (election);
             if (zyre_election_erec_complete (election, group)) {
-                if (streq (zyre_election_caw (election), zuuid_str (self->uuid))) {
+                if (memcmp (zyre_election_caw (election), zuuid_data (self->uuid), ZUUID_LEN) == 0) {
                     zre_msg_t *leader_msg = zyre_election_build_leader_msg (election);
                     zre_msg_set_group (leader_msg, zre_msg_group (msg));
 
                     //  Send leader message to all neighbors
-                    zyre_group_send (group, &leader_msg);
+                    zyre_group_send_voters (group, &leader_msg);
                     if (self->verbose)
                         zsys_info ("(%s) [%s] LEADER decision - %s",
                                    self->name, zre_msg_group (msg), zuuid_str (self->uuid));
@@ -1328,46 +4396,48 @@ zyre_node_recv_peer (zyre_node_t *self)
                 else {
                     zre_msg_t *election_msg = zyre_election_build_elect_msg (election);
                     zre_msg_set_group (election_msg, zre_msg_group (msg));
+                    zre_msg_set_lapsed (election_msg, zre_msg_lapsed (msg));
 
                     //  Send election message to father
                     zyre_peer_send (zyre_election_father (election), &election_msg);
                     if (self->verbose)
                         zsys_info ("(%s) [%s] Echo wave to father - %s",
-                                   self->name, zre_msg_group (msg), challenger);
+                                   self->name, zre_msg_group (msg), challenger_str);
                 }
             }
         }
         //  If challenger is unworthy the message is ignored!
     }
     else
-    if (zre_msg_id (msg) == ZRE_MSG_LEADER) {
+    if (zre_msg_id (msg) == ZRE_MSG_LEADER_UUID) {
         zyre_group_t *group = zyre_node_require_peer_group (self, zre_msg_group (msg));
         zyre_election_t *election = zyre_group_require_election (group);
         assert (election);
-        const char *leader = zre_msg_leader_id (msg);
+        const byte *leader = zre_msg_leader (msg);
+        bool own_leader = memcmp (zuuid_data (self->uuid), leader, ZUUID_LEN) == 0;
 
-        const char *caw = zyre_election_caw(election);
+        const byte *caw = zyre_election_caw(election);
         if (caw) {
             // Only propagate if not leader
-            if (strneq (zuuid_str (self->uuid), leader) && !zyre_election_lrec_started (election)) {
+            if (!own_leader && !zyre_election_lrec_started (election)) {
                 zre_msg_t *leader_msg = zyre_election_build_leader_msg (election);
                 zre_msg_set_group (leader_msg, zre_msg_group (msg));
 
                 //  Send leader message to all neighbors
-                zyre_group_send (group, &leader_msg);
+                zyre_group_send_voters (group, &leader_msg);
                 if (self->verbose)
                     zsys_info ("(%s) [%s] Propagate LEADER - %s\n",
                                self->name, zre_msg_group (msg), zuuid_str (self->uuid));
             }
             zyre_election_increment_lrec (election);
-            zyre_election_set_leader (election, strdup (leader));
+            zyre_election_set_leader (election, leader);
             if (self->verbose)
                 zsys_info ("(%s) [%s] Received LEADER - %s\n",
                            self->name, zre_msg_group (msg), zuuid_str (self->uuid));
 
             // Check if election is finished
             if (zyre_election_lrec_complete (election, group)) {
-                if (streq (zyre_election_leader (election), zuuid_str (self->uuid))) {
+                if (own_leader) {
                     //  This node is leader
                     zyre_node_leader_peer_group (self,
                                                  zuuid_str (self->uuid),
@@ -1376,7 +4446,9 @@ zyre_node_recv_peer (zyre_node_t *self)
                 }
                 else {
                     //  Peer is leader
-                    zyre_peer_t *leader_peer = (zyre_peer_t *) zhash_lookup (self->peers, zyre_election_leader (election));
+                    char leader_str [ZUUID_LEN * 2 + 1];
+                    zyre_election_format_id (leader, leader_str);
+                    zyre_peer_t *leader_peer = (zyre_peer_t *) zhash_lookup (self->peers, leader_str);
                     if (leader_peer) {
                         zyre_group_set_leader (group, leader_peer);
                         zyre_node_leader_peer_group (self,
@@ -1389,7 +4461,7 @@ zyre_node_recv_peer (zyre_node_t *self)
                 if (self->verbose)
                     zsys_info ("(%s) [%s] Election finished %s, %s!\n",
                                self->name, zre_msg_group (msg), zuuid_str (self->uuid),
-                               streq (zyre_election_leader (election), zuuid_str (self->uuid))? "LEADER": "FOLLOWER");
+                               own_leader? "LEADER": "FOLLOWER");
 
                 zyre_election_destroy (&election);
                 zyre_group_set_election (group, NULL);
@@ -1409,15 +4481,206 @@ zyre_node_recv_peer (zyre_node_t *self)
             peer = NULL;
         }
     }
-
-    zuuid_destroy (&uuid);
     zre_msg_destroy (&msg);
 
     //  Activity from peer resets peer timers
     if (peer)
         zyre_peer_refresh (peer, self->evasive_timeout, self->expired_timeout);
+
+    //  Now the full HELLO we asked for is in place, take what the peer sent
+    //  after its compact HELLO, in order; any of it may lose us the peer
+    if (take_held) {
+        zre_msg_t *held;
+        while ((peer = (zyre_peer_t *) zhash_lookup (self->peers, zuuid_str (uuid)))
+        &&     (held = zyre_peer_unhold (peer)))
+            zyre_node_process_peer (self, held, zuuid_dup (uuid));
+    }
+    zuuid_destroy (&uuid);
+}
+
+//  Hold a message from a peer that is waiting for the connect scheduler.
+//  A HELLO from an unknown peer queues it, ahead of peers we only know
+//  from discovery. Returns true if we took the message.
+
+static bool
+zyre_node_hold_peer (zyre_node_t *self, zre_msg_t *msg, zuuid_t *uuid)
+{
+    pending_t *pending = (pending_t *) zhash_lookup (self->pending, zuuid_str (uuid));
+    if (zre_msg_id (msg) == ZRE_MSG_HELLO
+    && (self->connect_rate || self->max_handshakes)) {
+        zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, zuuid_str (uuid));
+        //  A ready peer saying HELLO again has restarted, so replace it
+        if (peer && zyre_peer_ready (peer)) {
+            zyre_node_remove_peer (self, peer);
+            peer = NULL;
+        }
+        if (!peer) {
+            const char *public_key = NULL;
+            if (self->secret_key) {
+                public_key = (const char *) zhash_lookup (zre_msg_headers (msg), "X-PUBLICKEY");
+                if (!public_key) {
+                    if (self->verbose)
+                        zsys_debug ("ignoring HELLO to avoid security downgrade, does not contain public key");
+                    return false;
+                }
+            }
+            //  Peers in one of our groups go first
+            int queue = PENDING_GREETED;
+            const char *group = (const char *) zlist_first (zre_msg_groups (msg));
+            while (group) {
+                if (zlist_exists (self->own_groups, (void *) group)) {
+                    queue = PENDING_SHARED;
+                    break;
+                }
+                group = (const char *) zlist_next (zre_msg_groups (msg));
+            }
+            pending = zyre_node_queue_peer (self, uuid, zre_msg_endpoint (msg), public_key, queue);
+        }
+    }
+    if (!pending)
+        return false;
+
+    if (zlist_size (pending->backlog) >= PENDING_BACKLOG_MAX) {
+        zsys_warning ("(%s) too many messages from pending peer, dropping it", self->name);
+        zyre_node_unqueue_peer (self, pending);
+        zre_msg_destroy (&msg);
+    }
+    else
+        zlist_append (pending->backlog, msg);
+    return true;
+}
+
+
+//  Handle a message on a peer's control lane. It only tells us the peer is
+//  alive, so we answer PINGs on the same lane and do not check sequence.
+
+static void
+zyre_node_recv_control (zyre_node_t *self, zre_msg_t *msg, zuuid_t *uuid)
+{
+    zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, zuuid_str (uuid));
+    if (peer && zyre_peer_ready (peer)) {
+        if (zre_msg_id (msg) == ZRE_MSG_PING) {
+            zre_msg_t *reply = zre_msg_new ();
+            zre_msg_set_id (reply, ZRE_MSG_PING_OK);
+            zyre_peer_send_control (peer, &reply);
+        }
+        else
+        if (zre_msg_id (msg) == ZRE_MSG_PING_OK)
+            zyre_peer_control_ping_ok (peer);
+        zyre_peer_refresh (peer, self->evasive_timeout, self->expired_timeout);
+    }
+    zre_msg_destroy (&msg);
+    zuuid_destroy (&uuid);
+}
+
+
+//  Handle message from a peer
+
+static void
+zyre_node_recv_peer (zyre_node_t *self)
+{
+    //  Router socket tells us the identity of this peer
+    zre_msg_t *msg = zre_msg_new ();
+    int rc = zre_msg_recv (msg, self->inbox);
+    if (rc == -1)
+        return;                 //  Interrupted
+    if (rc == -2) {
+        zre_msg_destroy (&msg);
+        return;                 //  Malformed
+    }
+
+    //  First frame is sender identity
+    byte *peerid_data = zframe_data (zre_msg_routing_id (msg));
+    size_t peerid_size = zframe_size (zre_msg_routing_id (msg));
+
+    //  Identity must be the lane followed by 16-byte UUID
+    if (peerid_size != ZUUID_LEN + 1) {
+        zre_msg_destroy (&msg);
+        return;
+    }
+    zuuid_t *uuid = zuuid_new ();
+    zuuid_set (uuid, peerid_data + 1);
+
+    if (peerid_data [0] == ZYRE_PEER_LANE_CONTROL)
+        zyre_node_recv_control (self, msg, uuid);
+    else
+    if (zyre_node_hold_peer (self, msg, uuid))
+        zuuid_destroy (&uuid);
+    else
+        zyre_node_process_peer (self, msg, uuid);
+}
+
+
+//  Handle a message a peer in this process handed us by pointer; it is
+//  already decoded, and the peer set its identity as the routing id
+
+static void
+zyre_node_recv_direct (zyre_node_t *self)
+{
+    zre_msg_t *msg;
+    if (zsock_recv (self->direct_inbox, "p", &msg) || !msg)
+        return;                 //  Interrupted
+
+    zuuid_t *uuid = zuuid_new ();
+    zuuid_set (uuid, zframe_data (zre_msg_routing_id (msg)) + 1);
+
+    if (zyre_node_hold_peer (self, msg, uuid))
+        zuuid_destroy (&uuid);
+    else
+        zyre_node_process_peer (self, msg, uuid);
+}
+
+
+//  Admit queued peer connects, as fast as the connect rate and handshake
+//  limit allow. Peers that greeted us are processed with the messages they
+//  sent while they waited.
+
+static void
+zyre_node_admit_peers (zyre_node_t *self)
+{
+    int64_t now = zclock_mono ();
+    if (self->connect_rate) {
+        //  Allow bursts of up to one second's worth of connects
+        self->connect_tokens += (double) (now - self->connect_tokens_at) * self->connect_rate / 1000;
+        if (self->connect_tokens > self->connect_rate)
+            self->connect_tokens = self->connect_rate;
+    }
+    self->connect_tokens_at = now;
+
+    while (zhash_size (self->pending)) {
+        if (self->connect_rate && self->connect_tokens < 1)
+            break;
+        //  Peers that greeted us complete their handshake at once, so only
+        //  discovered peers count against the handshake limit
+        int queue;
+        for (queue = 0; queue < PENDING_QUEUES; queue++)
+            if (zlist_size (self->pending_queue [queue]))
+                break;
+        assert (queue < PENDING_QUEUES);
+        if (queue == PENDING_DISCOVERED
+        &&  self->max_handshakes && self->handshakes >= self->max_handshakes)
+            break;
+
+        char *key = (char *) zlist_pop (self->pending_queue [queue]);
+        pending_t *pending = (pending_t *) zhash_lookup (self->pending, key);
+        assert (pending);
+        zhash_freefn (self->pending, key, NULL);
+        zhash_delete (self->pending, key);
+        zstr_free (&key);
+        if (self->connect_rate)
+            self->connect_tokens -= 1;
+
+        if (!zhash_lookup (self->peers, zuuid_str (pending->uuid))
+        &&  zyre_node_connect_peer (self, pending->uuid, pending->endpoint, pending->public_key)) {
+            zre_msg_t *msg;
+            while ((msg = (zre_msg_t *) zlist_pop (pending->backlog)))
+                zyre_node_process_peer (self, msg, zuuid_dup (pending->uuid));
+        }
+        s_pending_destroy (pending);
+    }
 }
 
+
 //  Handle beacon data
 
 static void
@@ -1478,6 +4741,10 @@ zyre_node_recv_beacon (zyre_node_t *self)
             self->peers, zuuid_str (uuid));
         if (peer)
             zyre_node_remove_peer (self, peer);
+        pending_t *pending = (pending_t *) zhash_lookup (
+            self->pending, zuuid_str (uuid));
+        if (pending)
+            zyre_node_unqueue_peer (self, pending);
     }
     zuuid_destroy (&uuid);
     zstr_free (&ipaddress);
@@ -1524,6 +4791,30 @@ zyre_node_recv_gossip (zyre_node_t *self)
 }
 
 
+//  Handle a report from a worker that it lost a peer's mailbox; we treat
+//  that like a failed send and disconnect the peer, so it will expire
+
+static void
+zyre_node_recv_worker (zyre_node_t *self, zactor_t *worker)
+{
+    char *command = NULL, *identity = NULL;
+    zstr_recvx (worker, &command, &identity, NULL);
+    if (command == NULL)
+        return;                 //  Interrupted
+
+    assert (streq (command, "LOST"));
+    zyre_peer_t *peer = (zyre_peer_t *) zhash_lookup (self->peers, identity);
+    if (peer) {
+        if (self->verbose)
+            zsys_info ("(%s) lost mailbox to peer name=%s endpoint=%s",
+                self->name, zyre_peer_name (peer), zyre_peer_endpoint (peer));
+        zyre_peer_disconnect (peer);
+    }
+    zstr_free (&command);
+    zstr_free (&identity);
+}
+
+
 //  We do this once a second:
 //  - if peer has gone quiet, send TCP ping and emit EVASIVE event
 //  - if peer has disappeared, expire it
@@ -1535,6 +4826,7 @@ zyre_node_ping_peer (const char *key, void *item, void *argument)
     zyre_node_t *self = (zyre_node_t *) argument;
     if (!peer)
         return 0;
+    zyre_peer_check_upgrade (peer);
     if (zclock_mono () >= zyre_peer_expired_at (peer)) {
         if (self->verbose)
             zsys_info ("(%s) peer expired name=%s endpoint=%s",
@@ -1552,12 +4844,13 @@ zyre_node_ping_peer (const char *key, void *item, void *argument)
                        self->name, zyre_peer_name (peer), zyre_peer_endpoint (peer));
         zre_msg_t *msg = zre_msg_new ();
         zre_msg_set_id (msg, ZRE_MSG_PING);
-        zyre_peer_send (peer, &msg);
+        zyre_peer_send_control (peer, &msg);
         zre_msg_destroy (&msg);
         // Inform the calling application this peer is being evasive
-        zstr_sendm (self->outbox, "EVASIVE");
-        zstr_sendm (self->outbox, zyre_peer_identity (peer));
-        zstr_send (self->outbox, zyre_peer_name (peer));
+        if (self->event_filter & ZYRE_EVENT_EVASIVE) {
+            zmsg_t *event = s_event_new ("EVASIVE", zyre_peer_identity (peer), zyre_peer_name (peer));
+            zyre_node_emit (self, &event);
+        }
         if (zclock_mono () >= zyre_peer_evasive_at (peer) + s_reap_interval (self)) {
             // Inform the calling application this peer is being silent
             // despite having tried to ping it. Something is wrong with
@@ -1567,15 +4860,308 @@ zyre_node_ping_peer (const char *key, void *item, void *argument)
             if (self->verbose)
                 zsys_info ("(%s) peer '%s' has not answered ping after %d milliseconds (silent)",
                            self->name, zyre_peer_name(peer), s_reap_interval (self));
-            zstr_sendm (self->outbox, "SILENT");
-            zstr_sendm (self->outbox, zyre_peer_identity (peer));
-            zstr_send (self->outbox, zyre_peer_name (peer));
+            if (self->event_filter & ZYRE_EVENT_SILENT) {
+                zmsg_t *event = s_event_new ("SILENT", zyre_peer_identity (peer), zyre_peer_name (peer));
+                zyre_node_emit (self, &event);
+            }
         }
     }
     return 0;
 }
 
 
+//  --------------------------------------------------------------------------
+//  Start our beacon, once it's configured: bind the inbox on the beacon's
+//  interface, publish our port and start listening to other nodes
+
+static void
+zyre_node_start_beacon (zyre_node_t *self)
+{
+    //  Our hostname is provided by zbeacon
+    zsock_send(self->beacon, "si", "CONFIGURE", self->beacon_port);
+    char *hostname = zstr_recv(self->beacon);
+
+    // Is UDP broadcast interface available?
+    if (!streq(hostname, "")) {
+        const char *iface = zsys_interface ();
+        if (zsys_ipv6() && iface && !streq (iface, "") && !streq (iface, "*") && !streq (zsys_ipv6_address (), "")) {
+            self->port = zsock_bind(self->inbox, "tcp://%s%%%s:%s", zsys_ipv6_address (),
+                iface, self->ephemeral_port ? self->ephemeral_port : "*");
+        } else
+            self->port = zsock_bind(self->inbox, "tcp://%s:%s", hostname,
+                self->ephemeral_port ? self->ephemeral_port : "*");
+
+        if (self->port > 0) {
+            assert(!self->endpoint);   //  If caller set this, we'd be using gossip
+            if (streq(zsys_interface(), "*")) {
+                char *hostname = zsys_hostname();
+                self->endpoint = zsys_sprintf("tcp://%s:%d", hostname, self->port);
+                zstr_free(&hostname);
+            }
+            else {
+                self->endpoint = strdup(zsock_endpoint(self->inbox));
+            }
+
+            //  Set broadcast/listen beacon
+            beacon_t beacon;
+            beacon.protocol[0] = 'Z';
+            beacon.protocol[1] = 'R';
+            beacon.protocol[2] = 'E';
+            beacon.version = self->beacon_version;
+            beacon.port = htons(self->port);
+            zuuid_export(self->uuid, beacon.uuid);
+            // SEND
+            if (self->public_key) {
+                zmq_z85_decode(beacon.public_key, self->public_key);
+            }
+            zsock_send(self->beacon, "sbi", "PUBLISH",
+                (byte *)&beacon, BEACON_SIZE(beacon), self->interval);
+            zsock_send(self->beacon, "sb", "SUBSCRIBE", (byte *) "ZRE", 3);
+            zyre_node_watch (self, self->beacon);
+
+            //  Start polling on inbox
+            zyre_node_watch (self, self->inbox);
+        }
+    }
+    zstr_free(&hostname);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return how many msecs until the node next has timed work to do, which
+//  is zero if that's overdue. Each timer the node runs is accounted for
+//  here, and run in zyre_node_run_timers.
+
+static int
+zyre_node_next_timer (zyre_node_t *self)
+{
+    //  If nothing else happens, wait until the next reap
+    int64_t now = zclock_mono ();
+    int timeout = (int) ((self->reaped_at + s_reap_interval (self)) - now);
+    if (self->lease_interval
+    &&  self->lease_at - now < timeout)
+        timeout = (int) (self->lease_at - now);
+    //  Come back for queued peer connects once we have a token
+    if (zhash_size (self->pending) && self->connect_rate
+    &&  self->connect_tokens < 1) {
+        int token_wait = 1 + (int) ((1 - self->connect_tokens) * 1000 / self->connect_rate);
+        if (token_wait < timeout)
+            timeout = token_wait;
+    }
+    //  Come back when the next request times out
+    request_t *request = (request_t *) zlistx_first (self->request_timers);
+    if (request && request->expires_at - now < timeout)
+        timeout = (int) (request->expires_at - now);
+    //  Come back when it's time to send header changes
+    if (self->headers_at && self->headers_at - now < timeout)
+        timeout = (int) (self->headers_at - now);
+    if (timeout < 0)
+        timeout = 0;
+    return timeout;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Run whichever timers are due. Timers run on their own deadlines, not
+//  only when the poller times out, so a node that's kept busy by traffic
+//  still pings and reaps its peers.
+
+static void
+zyre_node_run_timers (zyre_node_t *self)
+{
+    if (zclock_mono () >= self->reaped_at + s_reap_interval (self)) {
+        void *item;
+        self->reaped_at = zclock_mono ();
+        //  Ping all peers and reap any expired ones
+        for (item = zhash_first (self->peers); item != NULL;
+                item = zhash_next (self->peers))
+            zyre_node_ping_peer (zhash_cursor (self->peers), item, self);
+        zyre_node_reap_streams (self);
+    }
+    if (self->lease_interval && zclock_mono () >= self->lease_at) {
+        self->lease_at = zclock_mono () + self->lease_interval;
+        zyre_node_check_leases (self);
+    }
+    if (zlistx_size (self->request_timers))
+        zyre_node_expire_requests (self);
+    if (self->headers_at && zclock_mono () >= self->headers_at)
+        zyre_node_flush_headers (self);
+    if (zhash_size (self->pending))
+        zyre_node_admit_peers (self);
+    zyre_node_flush_events (self);
+    if (zlist_size (self->backlog) == 0)
+        zyre_node_ack_streams (self);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Take input from one socket or actor that has some. We take commands and
+//  peer messages in bursts, while more are waiting, so we pay for the poll
+//  once per burst rather than once per message; the budget bounds how long
+//  the other sockets wait.
+
+static void
+zyre_node_recv_from (zyre_node_t *self, void *which)
+{
+    multicast_t *multicast;
+    int budget = self->recv_budget;
+    if (which == self->pipe) {
+        do
+            zyre_node_recv_api (self);
+        while (--budget > 0 && !self->terminated
+            && (zsock_events (self->pipe) & ZMQ_POLLIN));
+    }
+    else
+    if (which == self->inbox) {
+        self->recv_bursts++;
+        do {
+            zyre_node_recv_peer (self);
+            self->recv_messages++;
+        }
+        while (--budget > 0
+            && (zsock_events (self->inbox) & ZMQ_POLLIN));
+    }
+    else
+    if (self->direct_inbox
+    &&  which == self->direct_inbox) {
+        do
+            zyre_node_recv_direct (self);
+        while (--budget > 0 && self->direct_inbox
+            && (zsock_events (self->direct_inbox) & ZMQ_POLLIN));
+    }
+    else
+    if (self->beacon
+    &&  which == self->beacon)
+        zyre_node_recv_beacon (self);
+    else
+    if (self->gossip
+    &&  which == self->gossip)
+        zyre_node_recv_gossip (self);
+    else
+    if (zhash_size (self->multicast)
+    &&  (multicast = zyre_node_multicast_on (self, (zsock_t *) which)))
+        zyre_node_recv_multicast (self, multicast);
+    else
+    if (self->nbr_workers) {
+        int worker;
+        for (worker = 0; worker < self->nbr_workers; worker++)
+            if (which == self->workers [worker])
+                zyre_node_recv_worker (self, self->workers [worker]);
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Run one turn of the node: wait for input up to timeout msecs, or until
+//  the next timer is due if that's sooner, or if timeout is -1. Handles
+//  whatever came in, then runs any timers that are due. Returns 0 if the
+//  node should carry on, or -1 if it was terminated or interrupted. Pass
+//  a zero timeout to poll the node without blocking.
+
+int
+zyre_node_step (zyre_node_t *self, int timeout)
+{
+    int next_timer = zyre_node_next_timer (self);
+    if (timeout < 0 || timeout > next_timer)
+        timeout = next_timer;
+
+    if (self->pollset_stale)
+        zyre_node_build_pollset (self);
+    //  While we hold events, room in the outbox wakes us to send them
+    int items = (int) self->pollset_size;
+    if (zlist_size (self->backlog))
+        items++;
+    int rc = zmq_poll (self->pollset, items, timeout);
+    if (rc == -1 || (rc == 0 && zsys_interrupted))
+        return -1;          //  Interrupted
+
+    //  Take input from every socket that has some, so an embedding
+    //  application gets all of it for one wakeup of the descriptor
+    size_t index;
+    for (index = 0; index < self->pollset_size && !self->terminated; index++) {
+        if (!(self->pollset [index].revents & ZMQ_POLLIN))
+            continue;
+        //  What we handled so far may have stopped us polling this one
+        void *which = self->polled [index];
+        if (self->pollset_stale
+        && (!zlist_exists (self->watched, which)
+        ||  !(zsock_events (which) & ZMQ_POLLIN)))
+            continue;
+        zyre_node_recv_from (self, which);
+    }
+    //  Start beacon as soon as we can
+    if (self->beacon && self->port <= 0)
+        zyre_node_start_beacon (self);
+
+    zyre_node_run_timers (self);
+    return self->terminated? -1: 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Handle every command waiting on the pipe. If the node runs in the
+//  application's thread, it calls this to have the node answer a method
+//  that waits on it.
+
+void
+zyre_node_recv_commands (zyre_node_t *self)
+{
+    while (!self->terminated
+       && (zsock_events (self->pipe) & ZMQ_POLLIN))
+        zyre_node_recv_api (self);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return how many msecs until the node next has work to do, which is zero
+//  if input is waiting or a timer is overdue. The descriptor doesn't signal
+//  input that was already waiting when the node last looked, such as
+//  messages over its receive budget, so an application must use this
+//  along with the descriptor.
+
+int
+zyre_node_timeout (zyre_node_t *self)
+{
+    if (zlist_size (self->backlog)
+    && (zsock_events (self->outbox) & ZMQ_POLLOUT))
+        return 0;
+    void *handle = zlist_first (self->watched);
+    while (handle) {
+        if (zsock_events (handle) & ZMQ_POLLIN)
+            return 0;
+        handle = zlist_next (self->watched);
+    }
+    return zyre_node_next_timer (self);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return a descriptor that's readable when the node may have input, so an
+//  application can run the node in its own event loop, or -1 if we can't
+//  provide one on this platform. This gathers the ZMQ_FD of each socket
+//  the node polls, and like those, it only tells us to look: the node may
+//  then find nothing to do.
+
+int
+zyre_node_fd (zyre_node_t *self)
+{
+#if defined (NODE_EPOLL)
+    if (self->poll_fd == -1) {
+        self->poll_fd = epoll_create1 (EPOLL_CLOEXEC);
+        assert (self->poll_fd != -1);
+        void *handle = zlist_first (self->watched);
+        while (handle) {
+            s_poll_fd_ctl (self, EPOLL_CTL_ADD, handle);
+            handle = zlist_next (self->watched);
+        }
+        //  The outbox signals too when the application takes events
+        s_poll_fd_ctl (self, EPOLL_CTL_ADD, self->outbox);
+    }
+#endif
+    return self->poll_fd;
+}
+
+
 //  --------------------------------------------------------------------------
 //  This is the actor that runs a single node; it uses one thread, creates
 //  a zyre_node object at start and destroys that when finishing.
@@ -1592,94 +5178,8 @@ zyre_node_actor (zsock_t *pipe, void *args)
     zsock_signal (self->pipe, 0);
 
     //  Loop until the agent is terminated one way or another
-    int64_t last_reaped_at = zclock_mono ();
-    while (!self->terminated) {
-
-        // Start beacon as soon as we can
-        if (self->beacon && self->port <= 0) {
-            //  Our hostname is provided by zbeacon
-            zsock_send(self->beacon, "si", "CONFIGURE", self->beacon_port);
-            char *hostname = zstr_recv(self->beacon);
-
-            // Is UDP broadcast interface available?
-            if (!streq(hostname, "")) {
-                const char *iface = zsys_interface ();
-                if (zsys_ipv6() && iface && !streq (iface, "") && !streq (iface, "*") && !streq (zsys_ipv6_address (), "")) {
-                    self->port = zsock_bind(self->inbox, "tcp://%s%%%s:%s", zsys_ipv6_address (),
-                        iface, self->ephemeral_port ? self->ephemeral_port : "*");
-                } else
-                    self->port = zsock_bind(self->inbox, "tcp://%s:%s", hostname,
-                        self->ephemeral_port ? self->ephemeral_port : "*");
-
-                if (self->port > 0) {
-                    assert(!self->endpoint);   //  If caller set this, we'd be using gossip
-                    if (streq(zsys_interface(), "*")) {
-                        char *hostname = zsys_hostname();
-                        self->endpoint = zsys_sprintf("tcp://%s:%d", hostname, self->port);
-                        zstr_free(&hostname);
-                    }
-                    else {
-                        self->endpoint = strdup(zsock_endpoint(self->inbox));
-                    }
-
-                    //  Set broadcast/listen beacon
-                    beacon_t beacon;
-                    beacon.protocol[0] = 'Z';
-                    beacon.protocol[1] = 'R';
-                    beacon.protocol[2] = 'E';
-                    beacon.version = self->beacon_version;
-                    beacon.port = htons(self->port);
-                    zuuid_export(self->uuid, beacon.uuid);
-                    // SEND
-                    if (self->public_key) {
-                        zmq_z85_decode(beacon.public_key, self->public_key);
-                    }
-                    zsock_send(self->beacon, "sbi", "PUBLISH",
-                        (byte *)&beacon, BEACON_SIZE(beacon), self->interval);
-                    zsock_send(self->beacon, "sb", "SUBSCRIBE", (byte *) "ZRE", 3);
-                    zpoller_add(self->poller, self->beacon);
-
-                    //  Start polling on inbox
-                    zpoller_add(self->poller, self->inbox);
-                }
-            }
-            zstr_free(&hostname);
-        }
-
-        // If nothing else happens, wait until the next reap
-        int timeout = (int) ((last_reaped_at + s_reap_interval (self)) - zclock_mono ());
-        if (timeout < 0)
-            timeout = 0;
-
-        zsock_t *which = (zsock_t *) zpoller_wait (self->poller, timeout);
-        if (which == self->pipe)
-            zyre_node_recv_api (self);
-        else
-        if (which == self->inbox)
-            zyre_node_recv_peer (self);
-        else
-        if (self->beacon
-        && (void *) which == self->beacon)
-            zyre_node_recv_beacon (self);
-        else
-        if (self->gossip
-        && (zactor_t *) which == self->gossip)
-            zyre_node_recv_gossip (self);
-        else
-        if (zpoller_terminated (self->poller))
-            break;          //  Interrupted, check before expired
-        else
-        if (zpoller_expired (self->poller)) {
-            if (zclock_mono () >= (last_reaped_at + s_reap_interval (self))) {
-                void *item;
-                last_reaped_at = zclock_mono ();
-                //  Ping all peers and reap any expired ones
-                for (item = zhash_first (self->peers); item != NULL;
-                        item = zhash_next (self->peers))
-                    zyre_node_ping_peer (zhash_cursor (self->peers), item, self);
-            }
-        }
-    }
+    while (zyre_node_step (self, -1) == 0)
+        ;
     zyre_node_destroy (&self);
 }
 
@@ -1691,11 +5191,322 @@ void
 zyre_node_test (bool verbose)
 {
     printf (" * zyre_node: ");
+    int rc;
     zsock_t *pipe = zsock_new (ZMQ_PAIR);
     zsock_t *outbox = zsock_new (ZMQ_PAIR);
     zyre_node_t *node = zyre_node_new (pipe, outbox);
+
+    //  Nothing reads the outbox, so the node holds events, and drops the
+    //  oldest droppable ones once it's over its limit
+    node->outbox_max_events = 2;
+    zmsg_t *event = s_event_new ("WHISPER", "uuid", "name");
+    zyre_node_emit (node, &event);
+    event = s_event_new ("JOIN", "uuid", "name");
+    zyre_node_emit (node, &event);
+    event = s_event_new ("WHISPER", "uuid", "name");
+    zyre_node_emit (node, &event);
+    event = s_event_new ("SHOUT", "uuid", "name");
+    zyre_node_emit (node, &event);
+    assert (zlist_size (node->backlog) == 2);
+    assert (node->events_dropped == 2);
+    event = (zmsg_t *) zlist_first (node->backlog);
+    assert (zframe_streq (zmsg_first (event), "JOIN"));
+    event = (zmsg_t *) zlist_next (node->backlog);
+    assert (zframe_streq (zmsg_first (event), "SHOUT"));
+
+    //  Requests, history and header changes are never dropped, even when
+    //  that leaves the node over its limit
+    event = s_event_new ("REQUEST", "uuid", "name");
+    zyre_node_emit (node, &event);
+    event = s_event_new ("HISTORY", "uuid", "name");
+    zyre_node_emit (node, &event);
+    event = s_event_new ("HEADER-UPDATE", "uuid", "name");
+    zyre_node_emit (node, &event);
+    assert (zlist_size (node->backlog) == 4);
+    assert (node->events_dropped == 3);
+    event = (zmsg_t *) zlist_first (node->backlog);
+    assert (zframe_streq (zmsg_first (event), "JOIN"));
+    event = (zmsg_t *) zlist_next (node->backlog);
+    assert (zframe_streq (zmsg_first (event), "REQUEST"));
+    event = (zmsg_t *) zlist_next (node->backlog);
+    assert (zframe_streq (zmsg_first (event), "HISTORY"));
+    event = (zmsg_t *) zlist_next (node->backlog);
+    assert (zframe_streq (zmsg_first (event), "HEADER-UPDATE"));
+
+    //  A compact HELLO carries what changed since the peer last knew us,
+    //  and the peer rebuilds all of it from what it knew
+    zlist_append (node->own_groups, "alpha");
+    zlist_append (node->own_groups, "beta");
+    zhash_update (node->headers, "X-NEW", "new");
+    hello_state_t *base = (hello_state_t *) zmalloc (sizeof (hello_state_t));
+    base->groups = zlist_new ();
+    zlist_autofree (base->groups);
+    zlist_append (base->groups, "alpha");
+    zlist_append (base->groups, "gamma");
+    base->headers = zhash_dup (node->headers);
+    zhash_delete (base->headers, "X-NEW");
+    zhash_update (base->headers, "X-OLD", "old");
+    base->digest = s_hello_digest (base->groups, base->headers);
+    base->refs = 1;
+    zre_msg_t *hello = zre_msg_new ();
+    zre_msg_set_id (hello, ZRE_MSG_HELLO);
+    zyre_node_compact_hello (node, hello, base);
+    assert (zlist_size (zre_msg_groups (hello)) == 2);
+    assert (zhash_size (zre_msg_headers (hello)) == 3);
+    assert (streq ((char *) zhash_lookup (zre_msg_headers (hello), "X-ZRE-HELLO-DROP"), "X-OLD\n"));
+
+    zuuid_t *uuid = zuuid_new ();
+    hello_memory_t *memory = (hello_memory_t *) zmalloc (sizeof (hello_memory_t));
+    memory->received = base;
+    zhash_insert (node->hello_memory, zuuid_str (uuid), memory);
+    zlist_append (node->hello_memory_order, (void *) zuuid_str (uuid));
+    assert (zyre_node_expand_hello (node, hello, uuid) == 0);
+    assert (s_hello_digest (zre_msg_groups (hello), zre_msg_headers (hello))
+         == s_hello_digest (node->own_groups, node->headers));
+    assert (zhash_size (node->hello_memory) == 0);
+    //  Once used, what we knew is gone, so the same HELLO can't be rebuilt
+    zhash_update (zre_msg_headers (hello), "X-ZRE-HELLO-BASE", "0000000000000000");
+    assert (zyre_node_expand_hello (node, hello, uuid) == -1);
+    zre_msg_destroy (&hello);
+    zuuid_destroy (&uuid);
+    zlist_remove (node->own_groups, "alpha");
+    zlist_remove (node->own_groups, "beta");
+    zhash_delete (node->headers, "X-NEW");
+
+#if defined (HAVE_LIBZSTD)
+    //  Large frames are compressed, small ones go as they are, and the
+    //  receiver gets back the message we started with
+    node->compress_threshold = 100;
+    zre_msg_t *msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_SHOUT);
+    zre_msg_set_group (msg, "GLOBAL");
+    zmsg_t *content = zmsg_new ();
+    zmsg_addstr (content, "small");
+    char large [1000];
+    memset (large, 'A', sizeof (large));
+    zmsg_addmem (content, large, sizeof (large));
+    zre_msg_set_content (msg, &content);
+    zre_msg_t *compressed = zyre_node_compress (node, msg);
+    assert (compressed);
+    assert (zre_msg_id (compressed) == ZRE_MSG_SHOUT_ZSTD);
+    assert (zre_msg_compressed (compressed) == 2);
+    assert (node->compress_bytes_out < node->compress_bytes_in);
+    rc = zyre_node_decompress (node, compressed);
+    assert (rc == 0);
+    assert (zre_msg_id (compressed) == ZRE_MSG_SHOUT);
+    assert (streq (zre_msg_group (compressed), "GLOBAL"));
+    content = zre_msg_content (compressed);
+    assert (zmsg_size (content) == 2);
+    assert (zframe_streq (zmsg_first (content), "small"));
+    assert (zframe_size (zmsg_next (content)) == sizeof (large));
+    assert (memcmp (zframe_data (zmsg_last (content)), large, sizeof (large)) == 0);
+    zre_msg_destroy (&compressed);
+
+    //  Small messages aren't worth compressing
+    content = zmsg_new ();
+    zmsg_addstr (content, "small");
+    zre_msg_set_content (msg, &content);
+    assert (zyre_node_compress (node, msg) == NULL);
+    zre_msg_destroy (&msg);
+#endif
+
+    //  Stepping the node without blocking runs its timers when they're due
+    assert (zyre_node_timeout (node) >= 0);
+    node->reaped_at = 0;
+    assert (zyre_node_timeout (node) == 0);
+    assert (zyre_node_step (node, 0) == 0);
+    assert (node->reaped_at > 0);
+
+    zyre_node_destroy (&node);
+    zsock_destroy (&pipe);
+
+    //  A node that holds events wakes as soon as the application makes room
+    //  in the outbox, rather than at its next timer
+    zsock_t *app = zsock_new (ZMQ_PAIR);
+    zsock_set_rcvhwm (app, 1);
+    rc = zsock_bind (app, "inproc://zyre-node-test-outbox");
+    assert (rc == 0);
+    outbox = zsock_new (ZMQ_PAIR);
+    zsock_set_sndhwm (outbox, 1);
+    rc = zsock_connect (outbox, "inproc://zyre-node-test-outbox");
+    assert (rc == 0);
+    pipe = zsock_new (ZMQ_PAIR);
+    node = zyre_node_new (pipe, outbox);
+    int count;
+    for (count = 0; count < 5; count++) {
+        event = s_event_new ("WHISPER", "uuid", "name");
+        zyre_node_emit (node, &event);
+    }
+    size_t held = zlist_size (node->backlog);
+    assert (held > 0);
+    assert (zyre_node_step (node, 0) == 0);
+    event = zmsg_recv (app);
+    zmsg_destroy (&event);
+    int64_t started = zclock_mono ();
+    assert (zyre_node_step (node, -1) == 0);
+    assert (zclock_mono () - started < REAP_INTERVAL / 2);
+    assert (zlist_size (node->backlog) < held);
+    zyre_node_destroy (&node);
+    zsock_destroy (&pipe);
+    zsock_destroy (&app);
+
+    //  From here on the test sets the node up through its pipe, as the API
+    //  would, and the node's peers connect to a socket of ours
+    zsock_t *api = zsock_new_pair ("@inproc://zyre-node-test-api");
+    assert (api);
+    pipe = zsock_new_pair (">inproc://zyre-node-test-api");
+    assert (pipe);
+    node = zyre_node_new (pipe, zsock_new (ZMQ_PAIR));
+    rc = zsock_bind (node->inbox, "inproc://zyre-node-test-inbox");
+    assert (rc == 0);
+    node->endpoint = strdup ("inproc://zyre-node-test-inbox");
+    zsock_t *remote = zsock_new_router ("@inproc://zyre-node-test-remote");
+    assert (remote);
+
+    //  The connect scheduler admits peers in one of our groups first, then
+    //  peers that greeted us, then peers we only discovered, each in the
+    //  order they came, and no faster than the connect rate allows
+    zstr_sendx (api, "SET CONNECT RATE", "10", NULL);
+    zyre_node_recv_api (node);
+    int queues [] = { PENDING_DISCOVERED, PENDING_DISCOVERED, PENDING_GREETED,
+                      PENDING_SHARED, PENDING_DISCOVERED };
+    zuuid_t *queued [5];
+    for (count = 0; count < 5; count++) {
+        queued [count] = zuuid_new ();
+        zyre_node_queue_peer (node, queued [count], "inproc://zyre-node-test-remote",
+                              NULL, queues [count]);
+    }
+    node->connect_tokens = 3;
+    node->connect_tokens_at = zclock_mono ();
+    zyre_node_admit_peers (node);
+    assert (zhash_size (node->peers) == 3);
+    assert (zhash_lookup (node->peers, zuuid_str (queued [3])));
+    assert (zhash_lookup (node->peers, zuuid_str (queued [2])));
+    assert (zhash_lookup (node->peers, zuuid_str (queued [0])));
+    //  Until time brings more tokens, nobody else gets in
+    zyre_node_admit_peers (node);
+    assert (zhash_size (node->peers) == 3);
+    zclock_sleep (150);
+    zyre_node_admit_peers (node);
+    assert (zhash_size (node->peers) >= 4);
+    assert (zhash_lookup (node->peers, zuuid_str (queued [1])));
+    //  Each admitted peer got our HELLO
+    for (count = 0; count < (int) zhash_size (node->peers); count++) {
+        zre_msg_t *hello = zre_msg_new ();
+        rc = zre_msg_recv (hello, remote);
+        assert (rc == 0);
+        assert (zre_msg_id (hello) == ZRE_MSG_HELLO);
+        zre_msg_destroy (&hello);
+    }
+
+    //  With the handshake limit reached, a peer we discovered waits, while
+    //  one that greeted us gets in, as its handshake is already done
+    zstr_sendx (api, "SET CONNECT RATE", "0", NULL);
+    zyre_node_recv_api (node);
+    zstr_sendx (api, "SET MAX HANDSHAKES", "1", NULL);
+    zyre_node_recv_api (node);
+    zuuid_t *discovered = zuuid_new ();
+    zyre_node_queue_peer (node, discovered, "inproc://zyre-node-test-remote",
+                          NULL, PENDING_DISCOVERED);
+    zuuid_t *greeted = zuuid_new ();
+    zyre_node_queue_peer (node, greeted, "inproc://zyre-node-test-remote",
+                          NULL, PENDING_GREETED);
+    zyre_node_admit_peers (node);
+    assert (zhash_lookup (node->peers, zuuid_str (greeted)));
+    assert (!zhash_lookup (node->peers, zuuid_str (discovered)));
+    assert (zhash_lookup (node->pending, zuuid_str (discovered)));
+    for (count = 0; count < 5; count++)
+        zuuid_destroy (&queued [count]);
+    zuuid_destroy (&discovered);
+    zuuid_destroy (&greeted);
+    zyre_node_destroy (&node);
+
+    //  Peers go to workers, so a node with workers can take a peer whose
+    //  mailbox can't be connected; the worker reports it lost, and the node
+    //  disconnects it so that it will expire
+    node = zyre_node_new (pipe, zsock_new (ZMQ_PAIR));
+    node->endpoint = strdup ("inproc://zyre-node-test-inbox");
+    zstr_sendx (api, "SET WORKERS", "2", NULL);
+    zyre_node_recv_api (node);
+    assert (node->nbr_workers == 2);
+    zuuid_t *lost = zuuid_new ();
+    zyre_peer_t *peer = zyre_node_connect_peer (node, lost, "bogus://zyre-node-test", NULL);
+    assert (peer);
+    assert (zyre_peer_connected (peer));
+    int64_t deadline = zclock_mono () + 5000;
+    while (zyre_peer_connected (peer) && zclock_mono () < deadline)
+        zyre_node_step (node, 100);
+    assert (!zyre_peer_connected (peer));
+    zuuid_destroy (&lost);
+    zyre_node_destroy (&node);
+
+    //  A node with a shared mailbox sends to its peers through one ROUTER,
+    //  which they see under the identity a mailbox of its own would have.
+    //  Without ZMQ_CONNECT_ROUTING_ID it keeps a mailbox per peer instead.
+    node = zyre_node_new (pipe, zsock_new (ZMQ_PAIR));
+    node->endpoint = strdup ("inproc://zyre-node-test-inbox");
+    zstr_sendx (api, "SET SHARED MAILBOX", NULL);
+    zyre_node_recv_api (node);
+#if defined (ZMQ_CONNECT_ROUTING_ID)
+    assert (node->router);
+#else
+    assert (!node->router);
+#endif
+    zsock_t *shared = zsock_new_router ("@inproc://zyre-node-test-shared");
+    assert (shared);
+    zuuid_t *routed = zuuid_new ();
+    peer = zyre_node_connect_peer (node, routed, "inproc://zyre-node-test-shared", NULL);
+    assert (peer);
+    hello = zre_msg_new ();
+    rc = zre_msg_recv (hello, shared);
+    assert (rc == 0);
+    assert (zre_msg_id (hello) == ZRE_MSG_HELLO);
+    byte routing_id [ZUUID_LEN + 1] = { ZYRE_PEER_LANE_DATA };
+    memcpy (routing_id + 1, zuuid_data (node->uuid), ZUUID_LEN);
+    assert (zframe_size (zre_msg_routing_id (hello)) == sizeof (routing_id));
+    assert (memcmp (zframe_data (zre_msg_routing_id (hello)), routing_id,
+                    sizeof (routing_id)) == 0);
+    zre_msg_destroy (&hello);
+    zuuid_destroy (&routed);
     zyre_node_destroy (&node);
+    zsock_destroy (&shared);
+
+    //  The node takes peer messages in bursts of up to its receive budget,
+    //  so other sockets still get their turn, and counts them
+    node = zyre_node_new (pipe, zsock_new (ZMQ_PAIR));
+    rc = zsock_bind (node->inbox, "inproc://zyre-node-test-burst");
+    assert (rc == 0);
+    zyre_node_watch (node, node->inbox);
+    zstr_sendx (api, "SET RECV BUDGET", "4", NULL);
+    zyre_node_recv_api (node);
+    zsock_t *sender = zsock_new_dealer (">inproc://zyre-node-test-burst");
+    assert (sender);
+    zre_msg_t *ping = zre_msg_new ();
+    zre_msg_set_id (ping, ZRE_MSG_PING);
+    for (count = 0; count < 10; count++) {
+        rc = zre_msg_send (ping, sender);
+        assert (rc == 0);
+    }
+    zre_msg_destroy (&ping);
+    while (node->recv_messages < 10) {
+        rc = zyre_node_step (node, 1000);
+        assert (rc == 0);
+    }
+    assert (node->recv_messages == 10);
+    assert (node->recv_bursts == 3);
+    zstr_sendx (api, "STATS", NULL);
+    zyre_node_recv_api (node);
+    zhash_t *stats;
+    zsock_recv (api, "p", &stats);
+    assert (streq ((char *) zhash_lookup (stats, "recv-bursts"), "3"));
+    assert (streq ((char *) zhash_lookup (stats, "recv-messages"), "10"));
+    zhash_destroy (&stats);
+    zsock_destroy (&sender);
+    zyre_node_destroy (&node);
+
     zsock_destroy (&pipe);
+    zsock_destroy (&api);
+    zsock_destroy (&remote);
     //  Node takes ownership of outbox and destroys it
 #if defined (__WINDOWS__)
     zsys_shutdown();
@@ -20,11 +20,44 @@
 extern "C" {
 #endif
 
+//  Create a node that takes commands on the pipe and sends events to the
+//  outbox socket passed as args, which it takes ownership of. The actor
+//  does this for a node with a thread of its own; an embedded node runs in
+//  the thread that created it, through zyre_node_step.
+ZYRE_PRIVATE zyre_node_t *
+    zyre_node_new (zsock_t *pipe, void *args);
+
+//  Destroy a node
+ZYRE_PRIVATE void
+    zyre_node_destroy (zyre_node_t **self_p);
+
 //  This is the actor that runs a single node; it uses one thread, creates
 //  a zyre_node object at start and destroys that when finishing.
 ZYRE_PRIVATE void
     zyre_node_actor (zsock_t *pipe, void *args);
 
+//  Run one turn of the node: wait for input up to timeout msecs, or until
+//  the next timer is due if that's sooner, or if timeout is -1. Handles
+//  whatever came in, then runs any timers that are due. Returns 0 if the
+//  node should carry on, or -1 if it was terminated or interrupted.
+ZYRE_PRIVATE int
+    zyre_node_step (zyre_node_t *self, int timeout);
+
+//  Handle every command waiting on the pipe, so a method that waits on an
+//  embedded node gets its answer.
+ZYRE_PRIVATE void
+    zyre_node_recv_commands (zyre_node_t *self);
+
+//  Return how many msecs until the node next has work to do, which is zero
+//  if input is waiting or a timer is overdue.
+ZYRE_PRIVATE int
+    zyre_node_timeout (zyre_node_t *self);
+
+//  Return a descriptor that's readable when the node may have input, or -1
+//  if we can't provide one on this platform.
+ZYRE_PRIVATE int
+    zyre_node_fd (zyre_node_t *self);
+
 //  Self test of this class
 ZYRE_PRIVATE void
     zyre_node_test (bool verbose);
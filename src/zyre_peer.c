@@ -20,25 +20,99 @@
 
 struct _zyre_peer_t {
     zsock_t *mailbox;           //  Socket through to peer
+    zsock_t *control;           //  Control lane to peer, if any
+    zactor_t *worker;           //  Worker that owns our mailbox, if any
+    zsock_t *router;            //  Shared outbound socket, if any
+    byte routing_id [5];        //  Peer's routing id on shared socket
+    bool direct;                //  Hand peer messages by pointer?
+    byte from [ZUUID_LEN + 1];  //  Our identity on the peer's inbox
+    uint64_t expired_timeout;   //  Sets the high-water mark of our mailbox
+    char *upgrade_endpoint;     //  Endpoint we're moving our mailbox to
+    zsock_t *upgrade_probe;     //  Control lane over that endpoint, on trial
+    int64_t upgrade_expires_at; //  When we give up on the trial
+    zlist_t *upgrade_held;      //  Messages held until the mailbox moves
+    uint32_t upgrade_ping;      //  PING whose answer lets the mailbox move
+    uint32_t pings_sent;        //  PINGs we sent to the peer
+    uint32_t pings_answered;    //  PING-OKs the peer sent us
     zuuid_t *uuid;              //  Identity object
     char *endpoint;             //  Endpoint connected to
     char *name;                 //  Peer's public name
     char *origin;               //  Origin node's public name
     uint64_t evasive_at;        //  Peer is being evasive
     uint64_t expired_at;        //  Peer has expired by now
+    int64_t active_at;          //  Last time we heard from peer
+    int64_t sent_at;            //  Last time we sent to peer
+    size_t outstanding;         //  Requests to peer it has not answered
+    bool hello_wanted;          //  We asked peer to send its HELLO again
+    zlist_t *hello_held;        //  Messages held until that HELLO comes
+    uint16_t hello_sequence;    //  Where that HELLO came in its sequence
+    zre_msg_t *hello_full;      //  Our HELLO in full, if we sent it compact
+    uint32_t headers_version;   //  How many of our header changes it had
     bool connected;             //  Peer will send messages
     bool ready;                 //  Peer has said Hello to us
     byte status;                //  Our status counter
     uint16_t sent_sequence;     //  Outgoing message sequence
     uint16_t want_sequence;     //  Incoming message sequence
     zhash_t *headers;           //  Peer headers
+    int features;               //  Protocol features peer supports
+    uint32_t zstd_dict;         //  Peer's compression dictionary, 0 if none
+    zhash_t *multicast_out;     //  Multicast endpoints peer takes our SHOUTs on
+    zhash_t *multicast_in;      //  Groups we take peer's SHOUTs to by multicast
+    zhash_t *relay_seen;        //  Messages we had from peer by relay, by group
     bool verbose;               //  Do we log traffic & failures?
-    char *public_key;     // curve public key
-    char *secret_key;     // curve secret key
+    zcert_t *cert;        // curve keys, owned by the node
     char *server_key;     // curve server [remote endpoint] key
 };
 
 
+//  Optional protocol features, by the names peers advertise them under
+
+static struct {
+    const char *name;
+    int flag;
+} s_features [] = {
+    { "binary-ids", ZYRE_PEER_FEATURE_BINARY_IDS },
+    { "control-lane", ZYRE_PEER_FEATURE_CONTROL_LANE },
+    { "streams", ZYRE_PEER_FEATURE_STREAMS },
+    { "zstd", ZYRE_PEER_FEATURE_ZSTD },
+    { "multicast", ZYRE_PEER_FEATURE_MULTICAST },
+    { "relay", ZYRE_PEER_FEATURE_RELAY },
+    { "rpc", ZYRE_PEER_FEATURE_RPC },
+    { "compact-hello", ZYRE_PEER_FEATURE_COMPACT_HELLO },
+    { "headers", ZYRE_PEER_FEATURE_HEADERS },
+    { "store", ZYRE_PEER_FEATURE_STORE },
+    { "history", ZYRE_PEER_FEATURE_HISTORY },
+    { NULL, 0 }
+};
+
+
+//  Where we are in the SHOUTs a peer multicasts to one group
+
+typedef struct {
+    bool stopping;              //  Peer goes back to TCP at until
+    bool lost;                  //  We already found a gap
+    uint32_t expected;          //  Sequence of next SHOUT we want
+    uint32_t until;             //  First sequence we get over TCP
+} multicast_in_t;
+
+//  The serial numbers we had of the messages a peer relayed to one group.
+//  Relays may reorder messages, so we keep a window of recent ones.
+
+#define RELAY_WINDOW    64
+
+//  How long, in msecs, the peer has to answer a PING over an endpoint we
+//  want to move our mailbox to, before we stay where we are
+#define UPGRADE_TIMEOUT 1000
+
+//  Messages we hold from a peer while we wait for its full HELLO, at most
+#define HELLO_HELD_MAX  1000
+
+typedef struct {
+    uint32_t highest;           //  Highest serial number we had
+    uint64_t window;            //  Bit n set if we had highest - n
+} relay_seen_t;
+
+
 //  Callback when we remove peer from container
 
 static void
@@ -83,31 +157,60 @@ zyre_peer_destroy (zyre_peer_t **self_p)
         zyre_peer_t *self = *self_p;
         zyre_peer_disconnect (self);
         zhash_destroy (&self->headers);
+        zhash_destroy (&self->multicast_out);
+        zhash_destroy (&self->multicast_in);
+        zhash_destroy (&self->relay_seen);
+        if (self->hello_held) {
+            zre_msg_t *msg;
+            while ((msg = (zre_msg_t *) zlist_pop (self->hello_held)))
+                zre_msg_destroy (&msg);
+            zlist_destroy (&self->hello_held);
+        }
+        zre_msg_destroy (&self->hello_full);
         zuuid_destroy (&self->uuid);
         free (self->name);
         free (self->origin);
         free (self->server_key);
-        free (self->public_key);
-        free (self->secret_key);
         free (self);
         *self_p = NULL;
     }
 }
 
 void
-zyre_peer_set_public_key (zyre_peer_t *self, const char *key)
+zyre_peer_set_worker (zyre_peer_t *self, zactor_t *worker)
+{
+    assert (self);
+    assert (!self->connected);
+    self->worker = worker;
+}
+
+void
+zyre_peer_set_router (zyre_peer_t *self, zsock_t *router, uint32_t route)
+{
+    assert (self);
+    assert (!self->connected);
+    self->router = router;
+    //  Routing ids may not start with a zero byte
+    self->routing_id [0] = 1;
+    self->routing_id [1] = (byte) (route >> 24);
+    self->routing_id [2] = (byte) (route >> 16);
+    self->routing_id [3] = (byte) (route >> 8);
+    self->routing_id [4] = (byte) route;
+}
+
+void
+zyre_peer_set_direct (zyre_peer_t *self, bool direct)
 {
     assert (self);
-    free (self->public_key);
-    self->public_key = strdup (key);
+    assert (!self->connected);
+    self->direct = direct;
 }
 
 void
-zyre_peer_set_secret_key (zyre_peer_t *self, const char *key)
+zyre_peer_set_cert (zyre_peer_t *self, zcert_t *cert)
 {
     assert (self);
-    free (self->secret_key);
-    self->secret_key = strdup (key);
+    self->cert = cert;
 }
 
 void
@@ -119,42 +222,15 @@ zyre_peer_set_server_key (zyre_peer_t *self, const char *key)
 }
 
 //  --------------------------------------------------------------------------
-//  Connect peer mailbox
-//  Configures mailbox and connects to peer's router endpoint
+//  If the peer is a link-local IPv6 address but the interface is not set,
+//  use ZSYS_INTERFACE_ADDRESS if provided. The endpoint_iface buffer must
+//  hold NI_MAXHOST characters.
 
-int
-zyre_peer_connect (zyre_peer_t *self, zuuid_t *from, const char *endpoint, uint64_t expired_timeout)
+static void
+s_endpoint_iface (const char *endpoint, char *endpoint_iface)
 {
-    assert (self);
-    assert (!self->connected);
-
-    //  Create new outgoing socket (drop any messages in transit)
-    self->mailbox = zsock_new (ZMQ_DEALER);
-    if (!self->mailbox)
-        return -1;             //  Null when we're shutting down
-
-    //  Set our own identity on the socket so that receiving node
-    //  knows who each message came from. Note that we cannot use
-    //  the UUID directly as the identity since it may contain a
-    //  zero byte at the start, which libzmq does not like for
-    //  historical and arguably bogus reasons that it nonetheless
-    //  enforces.
-    byte routing_id [ZUUID_LEN + 1] = { 1 };
-    memcpy (routing_id + 1, zuuid_data (from), ZUUID_LEN);
-    int rc = zmq_setsockopt (zsock_resolve (self->mailbox),
-                             ZMQ_IDENTITY, routing_id, ZUUID_LEN + 1);
-    assert (rc == 0);
-
-    //  Set a high-water mark that allows for reasonable activity
-    zsock_set_sndhwm (self->mailbox, expired_timeout * 100);
-
-    //  Send messages immediately or return EAGAIN
-    zsock_set_sndtimeo (self->mailbox, 0);
-
-    //  If the peer is a link-local IPv6 address but the interface is not set,
-    //  use ZSYS_INTERFACE_ADDRESS if provided
     zrex_t *rex = zrex_new (NULL);
-    char endpoint_iface [NI_MAXHOST] = {0};
+    endpoint_iface [0] = 0;
     if (zsys_ipv6 () && zsys_interface () && strlen(zsys_interface ()) &&
             !streq (zsys_interface (), "*") &&
             zrex_eq (rex, endpoint, "^tcp://(fe80[^%]+)(:\\d+)$")) {
@@ -168,48 +244,148 @@ zyre_peer_connect (zyre_peer_t *self, zuuid_t *from, const char *endpoint, uint6
     } else
         strcat (endpoint_iface, endpoint);
     zrex_destroy (&rex);
+}
 
-    if (self->server_key) {
-        assert (self->public_key);
-        assert (self->secret_key);
 
-        // zarmour use for string conversion
-        zarmour_t *armour = zarmour_new ();
-        zarmour_set_mode (armour, ZARMOUR_MODE_Z85);
-        zarmour_set_pad (armour, false);
-        zarmour_set_line_breaks (armour, false);
+//  --------------------------------------------------------------------------
+//  Create a mailbox and connect it to a peer's router endpoint, on the
+//  given lane. If a server key is given, the mailbox uses CURVE with our
+//  keys from cert. Returns NULL if the socket could not be created or
+//  connected.
+
+static zsock_t *
+s_mailbox_new (byte lane, const byte *from, const char *endpoint, uint64_t expired_timeout,
+               zcert_t *cert, const char *server_key)
+{
+    //  Create new outgoing socket (drop any messages in transit)
+    zsock_t *mailbox = zsock_new (ZMQ_DEALER);
+    if (!mailbox)
+        return NULL;            //  Null when we're shutting down
 
-        // convert keys from Z85 strings (40 bytes) to raw byte arrays (32 bytes)
-        zchunk_t *decoded_public_key =
-          zarmour_decode (armour, self->public_key);
-        zchunk_t *decoded_secret_key =
-          zarmour_decode (armour, self->secret_key);
+    //  Set our own identity on the socket so that receiving node
+    //  knows who each message came from. Note that we cannot use
+    //  the UUID directly as the identity since it may contain a
+    //  zero byte at the start, which libzmq does not like for
+    //  historical and arguably bogus reasons that it nonetheless
+    //  enforces. The first byte tells the peer which lane this is.
+    byte routing_id [ZUUID_LEN + 1] = { lane };
+    memcpy (routing_id + 1, from, ZUUID_LEN);
+    int rc = zmq_setsockopt (zsock_resolve (mailbox),
+                             ZMQ_IDENTITY, routing_id, ZUUID_LEN + 1);
+    assert (rc == 0);
 
-        zcert_t *cert = zcert_new_from (zchunk_data (decoded_public_key), zchunk_data (decoded_secret_key));
+    //  Set a high-water mark that allows for reasonable activity
+    zsock_set_sndhwm (mailbox, expired_timeout * 100);
 
-        zcert_apply(cert, self->mailbox);
-        zsock_set_curve_serverkey (self->mailbox, self->server_key);
+    //  Send messages immediately or return EAGAIN
+    zsock_set_sndtimeo (mailbox, 0);
 
-        zcert_destroy (&cert);
-        zchunk_destroy (&decoded_secret_key);
-        zchunk_destroy (&decoded_public_key);
-        zarmour_destroy (&armour);
+    if (server_key) {
+        assert (cert);
+        zcert_apply (cert, mailbox);
+        zsock_set_curve_serverkey (mailbox, server_key);
 
 #ifndef ZMQ_CURVE
         // legacy ZMQ support
         // inline incase the underlying assert is removed
         bool ZMQ_CURVE = false;
 #endif
-        assert (zsock_mechanism (self->mailbox) == ZMQ_CURVE);
+        assert (zsock_mechanism (mailbox) == ZMQ_CURVE);
     }
 
     //  Connect through to peer node
-    rc = zsock_connect (self->mailbox, "%s", endpoint_iface);
-    if (rc != 0) {
-        zsys_debug ("(%s) cannot connect to endpoint=%s",
-                    self->origin, endpoint_iface);
-        zsock_destroy (&self->mailbox);
-        return -1;
+    rc = zsock_connect (mailbox, "%s", endpoint);
+    if (rc != 0)
+        zsock_destroy (&mailbox);
+    return mailbox;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Connect a shared outbound ROUTER socket to a peer's router endpoint,
+//  under the given routing id. Returns 0 if OK, -1 if not.
+
+static int
+s_router_connect (zsock_t *router, const byte *routing_id, size_t size,
+                  const char *endpoint, uint64_t expired_timeout,
+                  zcert_t *cert, const char *server_key)
+{
+#ifdef ZMQ_CONNECT_ROUTING_ID
+    //  These options apply to the next connect only
+    int rc = zmq_setsockopt (zsock_resolve (router),
+                             ZMQ_CONNECT_ROUTING_ID, routing_id, size);
+    assert (rc == 0);
+    zsock_set_sndhwm (router, expired_timeout * 100);
+    if (server_key) {
+        assert (cert);
+        zcert_apply (cert, router);
+        zsock_set_curve_serverkey (router, server_key);
+    }
+    return zsock_connect (router, "%s", endpoint);
+#else
+    return -1;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Connect peer mailbox
+//  Configures mailbox and connects to peer's router endpoint. If the peer
+//  has a worker, the worker creates and owns the mailbox. If the peer uses
+//  a shared outbound socket, we connect that instead.
+
+int
+zyre_peer_connect (zyre_peer_t *self, zuuid_t *from, const char *endpoint, uint64_t expired_timeout)
+{
+    assert (self);
+    assert (!self->connected);
+
+    char endpoint_iface [NI_MAXHOST];
+    s_endpoint_iface (endpoint, endpoint_iface);
+    self->from [0] = ZYRE_PEER_LANE_DATA;
+    memcpy (self->from + 1, zuuid_data (from), ZUUID_LEN);
+    self->expired_timeout = expired_timeout;
+
+    if (self->direct) {
+        //  Peer runs in this process; the endpoint only identifies it
+        self->mailbox = zsock_new (ZMQ_PUSH);
+        if (!self->mailbox)
+            return -1;          //  Null when we're shutting down
+        zsock_set_sndhwm (self->mailbox, expired_timeout * 100);
+        zsock_set_sndtimeo (self->mailbox, 0);
+        zsock_connect (self->mailbox, ZYRE_PEER_DIRECT_ENDPOINT, zuuid_str (self->uuid));
+    }
+    else
+    if (self->worker) {
+        //  The worker pipe does not block; if the worker is that far behind
+        //  we treat the peer as lost, as if its mailbox were full
+        if (zsock_send (self->worker, "ssbsisp", "CONNECT",
+                        zuuid_str (self->uuid), zuuid_data (from), (size_t) ZUUID_LEN,
+                        endpoint_iface, (int) expired_timeout,
+                        self->server_key? self->server_key: "", self->cert)) {
+            zsys_debug ("(%s) cannot hand endpoint=%s to worker",
+                        self->origin, endpoint_iface);
+            return -1;
+        }
+    }
+    else
+    if (self->router) {
+        if (s_router_connect (self->router, self->routing_id, sizeof (self->routing_id),
+                              endpoint_iface, expired_timeout,
+                              self->cert, self->server_key)) {
+            zsys_debug ("(%s) cannot connect to endpoint=%s",
+                        self->origin, endpoint_iface);
+            return -1;
+        }
+    }
+    else {
+        self->mailbox = s_mailbox_new (ZYRE_PEER_LANE_DATA, self->from + 1, endpoint_iface,
+                                       expired_timeout, self->cert, self->server_key);
+        if (!self->mailbox) {
+            zsys_debug ("(%s) cannot connect to endpoint=%s",
+                        self->origin, endpoint_iface);
+            return -1;
+        }
     }
     if (self->verbose)
         zsys_info ("(%s) connect to peer: endpoint=%s",
@@ -233,8 +409,24 @@ zyre_peer_disconnect (zyre_peer_t *self)
     //  If connected, destroy socket and drop all pending messages
     assert (self);
     if (self->connected) {
+        //  If the worker pipe is full we lose the DISCONNECT; the worker
+        //  then replaces the stale mailbox on the next CONNECT
+        if (self->worker)
+            zstr_sendx (self->worker, "DISCONNECT", zuuid_str (self->uuid), NULL);
+        else
+        if (self->router)
+            zsock_disconnect (self->router, "%s", self->endpoint);
         zsock_destroy (&self->mailbox);
+        zsock_destroy (&self->control);
         free (self->endpoint);
+        zstr_free (&self->upgrade_endpoint);
+        zsock_destroy (&self->upgrade_probe);
+        if (self->upgrade_held) {
+            zre_msg_t *msg;
+            while ((msg = (zre_msg_t *) zlist_pop (self->upgrade_held)))
+                zre_msg_destroy (&msg);
+            zlist_destroy (&self->upgrade_held);
+        }
         self->mailbox = NULL;
         self->endpoint = NULL;
         self->connected = false;
@@ -254,15 +446,74 @@ zyre_peer_send (zyre_peer_t *self, zre_msg_t **msg_p)
     assert (msg);
     if (self->connected) {
         self->sent_sequence += 1;
+        self->sent_at = zclock_mono ();
         zre_msg_set_sequence (msg, self->sent_sequence);
+        if (!(self->features & ZYRE_PEER_FEATURE_BINARY_IDS))
+            zyre_election_msg_downgrade (msg);
         if (self->verbose)
             zsys_info ("(%s) send %s to peer=%s sequence=%d",
                 self->origin,
                 zre_msg_command (msg),
                 self->name? self->name: "-",
                 zre_msg_sequence (msg));
+        if (zre_msg_id (msg) == ZRE_MSG_PING)
+            self->pings_sent++;
 
-        if (zre_msg_send (msg, self->mailbox)) {
+        if (self->upgrade_held) {
+            //  Hold message until we've moved our mailbox, and give up on
+            //  the peer if it does not answer as fast as we send
+            if (zlist_size (self->upgrade_held) >= self->expired_timeout * 100) {
+                if (self->verbose)
+                    zsys_info ("(%s) disconnect from peer (EAGAIN): name=%s",
+                        self->origin, self->name);
+                zyre_peer_disconnect (self);
+                return -1;
+            }
+            zlist_append (self->upgrade_held, msg);
+            *msg_p = NULL;
+            return 0;
+        }
+        if (self->worker) {
+            //  Worker sends and destroys the message. The worker pipe does
+            //  not block, so a worker that can't keep up loses us the peer
+            //  the same way a full mailbox does
+            if (zsock_send (self->worker, "ssp", "SEND", zuuid_str (self->uuid), msg)) {
+                if (self->verbose)
+                    zsys_info ("(%s) disconnect from peer (EAGAIN): name=%s",
+                        self->origin, self->name);
+                zyre_peer_disconnect (self);
+                return -1;
+            }
+            *msg_p = NULL;
+            return 0;
+        }
+        if (self->direct) {
+            //  Peer takes the message as it is, and tells who sent it by
+            //  the routing id, as if it came through its inbox
+            zframe_t *routing_id = zframe_new (self->from, sizeof (self->from));
+            zre_msg_set_routing_id (msg, routing_id);
+            zframe_destroy (&routing_id);
+            if (zsock_send (self->mailbox, "p", msg) == 0) {
+                *msg_p = NULL;
+                return 0;
+            }
+            if (self->verbose)
+                zsys_info ("(%s) disconnect from peer (EAGAIN): name=%s",
+                    self->origin, self->name);
+            zyre_peer_disconnect (self);
+            return -1;
+        }
+        zsock_t *output = self->mailbox;
+        if (self->router) {
+            //  A full pipe on the shared socket drops the message rather
+            //  than returning EAGAIN; the peer sees the gap in sequence
+            //  numbers and drops us, and we expire it in turn
+            zframe_t *routing_id = zframe_new (self->routing_id, sizeof (self->routing_id));
+            zre_msg_set_routing_id (msg, routing_id);
+            zframe_destroy (&routing_id);
+            output = self->router;
+        }
+        if (zre_msg_send (msg, output)) {
             if (errno == EAGAIN) {
                 if (self->verbose)
                     zsys_info ("(%s) disconnect from peer (EAGAIN): name=%s",
@@ -281,6 +532,183 @@ zyre_peer_send (zyre_peer_t *self, zre_msg_t **msg_p)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Send a PING or PING-OK to peer on its control lane, so that it does not
+//  wait behind the data we sent. The peer must support the control lane,
+//  and we must have our own mailbox to it; otherwise we send the message
+//  like any other. Messages on the control lane carry no sequence number,
+//  and if the lane is full we drop them, as the next one will do as well.
+
+int
+zyre_peer_send_control (zyre_peer_t *self, zre_msg_t **msg_p)
+{
+    assert (self);
+    zre_msg_t *msg = *msg_p;
+    assert (msg);
+    assert (zre_msg_id (msg) == ZRE_MSG_PING || zre_msg_id (msg) == ZRE_MSG_PING_OK);
+    if (!self->connected || !self->mailbox || self->direct || self->upgrade_endpoint
+    ||  !(self->features & ZYRE_PEER_FEATURE_CONTROL_LANE))
+        return zyre_peer_send (self, msg_p);
+
+    if (!self->control) {
+        self->control = s_mailbox_new (ZYRE_PEER_LANE_CONTROL, self->from + 1, self->endpoint,
+                                       self->expired_timeout, self->cert, self->server_key);
+        if (!self->control)
+            return zyre_peer_send (self, msg_p);
+    }
+    self->sent_at = zclock_mono ();
+    if (self->verbose)
+        zsys_info ("(%s) send %s to peer=%s on control lane",
+            self->origin,
+            zre_msg_command (msg),
+            self->name? self->name: "-");
+    if (zre_msg_send (msg, self->control)) {
+        assert (errno == EAGAIN);
+        if (self->verbose)
+            zsys_info ("(%s) control lane full, dropped %s to peer=%s",
+                self->origin, zre_msg_command (msg), self->name);
+    }
+    zre_msg_destroy (msg_p);
+    return 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Move our mailbox to another endpoint of the peer, such as an IPC endpoint
+//  on this host. First we try the endpoint: we open our control lane over it
+//  and send a PING there, while data keeps going over the old connection.
+//  Only if the peer answers do we move the mailbox itself (see
+//  zyre_peer_control_ping_ok); if it does not answer in time, we stay where
+//  we are. Only a peer with its own mailbox and a control lane can move.
+
+void
+zyre_peer_upgrade (zyre_peer_t *self, const char *endpoint)
+{
+    assert (self);
+    assert (endpoint);
+    if (!self->connected || !self->mailbox || self->direct || self->upgrade_endpoint
+    ||  !(self->features & ZYRE_PEER_FEATURE_CONTROL_LANE))
+        return;
+
+    zsock_t *probe = s_mailbox_new (ZYRE_PEER_LANE_CONTROL, self->from + 1, endpoint,
+                                    self->expired_timeout, self->cert, self->server_key);
+    if (!probe) {
+        zsys_debug ("(%s) cannot connect to endpoint=%s, staying on endpoint=%s",
+                    self->origin, endpoint, self->endpoint);
+        return;
+    }
+    zre_msg_t *msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_PING);
+    int rc = zre_msg_send (msg, probe);
+    zre_msg_destroy (&msg);
+    if (rc) {
+        zsock_destroy (&probe);
+        return;
+    }
+    if (self->verbose)
+        zsys_info ("(%s) try endpoint=%s to peer=%s",
+                   self->origin, endpoint, self->name? self->name: "-");
+    self->upgrade_endpoint = strdup (endpoint);
+    self->upgrade_probe = probe;
+    self->upgrade_expires_at = zclock_mono () + UPGRADE_TIMEOUT;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Tell peer it answered a PING on our control lane. If that lane was on
+//  trial over the endpoint we want to move to, the endpoint works: the lane
+//  stays there, and we start moving our mailbox. We send a PING on the data
+//  lane and hold all further messages; when the peer answers that PING, it
+//  has read everything we sent on the old connection, so we can reconnect
+//  and send the held messages without losing any.
+
+void
+zyre_peer_control_ping_ok (zyre_peer_t *self)
+{
+    assert (self);
+    if (!self->upgrade_probe)
+        return;
+
+    if (self->verbose)
+        zsys_info ("(%s) move mailbox to peer=%s to endpoint=%s",
+                   self->origin, self->name? self->name: "-", self->upgrade_endpoint);
+    //  The peer now routes our control lane to the probe
+    zsock_destroy (&self->control);
+    self->control = self->upgrade_probe;
+    self->upgrade_probe = NULL;
+
+    //  The PING goes on the data lane, behind everything we sent so far
+    zre_msg_t *msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_PING);
+    if (zyre_peer_send (self, &msg) == 0) {
+        self->upgrade_held = zlist_new ();
+        self->upgrade_ping = self->pings_sent;
+    }
+    zre_msg_destroy (&msg);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Give up on the endpoint we're trying, if the peer did not answer our
+//  PING over it in time. We stay on the old connection, where the control
+//  lane comes back the next time we use it.
+
+void
+zyre_peer_check_upgrade (zyre_peer_t *self)
+{
+    assert (self);
+    if (!self->upgrade_probe || zclock_mono () < self->upgrade_expires_at)
+        return;
+
+    zsys_debug ("(%s) no answer over endpoint=%s, staying on endpoint=%s",
+                self->origin, self->upgrade_endpoint, self->endpoint);
+    zsock_destroy (&self->upgrade_probe);
+    zsock_destroy (&self->control);
+    zstr_free (&self->upgrade_endpoint);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Tell peer it answered one of our PINGs. If we were waiting on that to
+//  move our mailbox, we do it now.
+
+void
+zyre_peer_ping_ok (zyre_peer_t *self)
+{
+    assert (self);
+    self->pings_answered++;
+    if (!self->upgrade_held
+    ||  (int32_t) (self->pings_answered - self->upgrade_ping) < 0)
+        return;
+
+    zsock_t *mailbox = s_mailbox_new (ZYRE_PEER_LANE_DATA, self->from + 1, self->upgrade_endpoint,
+                                      self->expired_timeout, self->cert, self->server_key);
+    if (mailbox) {
+        zsock_destroy (&self->mailbox);
+        self->mailbox = mailbox;
+    }
+    else
+        zsys_debug ("(%s) cannot connect to endpoint=%s, staying on endpoint=%s",
+                    self->origin, self->upgrade_endpoint, self->endpoint);
+    zstr_free (&self->upgrade_endpoint);
+
+    zlist_t *held = self->upgrade_held;
+    self->upgrade_held = NULL;
+    zre_msg_t *msg;
+    while ((msg = (zre_msg_t *) zlist_pop (held))) {
+        if (self->connected && zre_msg_send (msg, self->mailbox)) {
+            assert (errno == EAGAIN);
+            if (self->verbose)
+                zsys_info ("(%s) disconnect from peer (EAGAIN): name=%s",
+                    self->origin, self->name);
+            zyre_peer_disconnect (self);
+        }
+        zre_msg_destroy (&msg);
+    }
+    zlist_destroy (&held);
+}
+
+
 //  --------------------------------------------------------------------------
 //  Return peer connected status
 
@@ -324,8 +752,9 @@ void
 zyre_peer_refresh (zyre_peer_t *self, uint64_t evasive_timeout, uint64_t expired_timeout)
 {
     assert (self);
-    self->evasive_at = zclock_mono () + evasive_timeout;
-    self->expired_at = zclock_mono () + expired_timeout;
+    self->active_at = zclock_mono ();
+    self->evasive_at = self->active_at + evasive_timeout;
+    self->expired_at = self->active_at + expired_timeout;
 }
 
 
@@ -351,6 +780,154 @@ zyre_peer_expired_at (zyre_peer_t *self)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Return time of last activity at peer
+
+int64_t
+zyre_peer_active_at (zyre_peer_t *self)
+{
+    assert (self);
+    return self->active_at;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return time we last sent a message to peer
+
+int64_t
+zyre_peer_sent_at (zyre_peer_t *self)
+{
+    assert (self);
+    return self->sent_at;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return number of requests we sent peer that it has not answered
+
+size_t
+zyre_peer_outstanding (zyre_peer_t *self)
+{
+    assert (self);
+    return self->outstanding;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set number of requests we sent peer that it has not answered
+
+void
+zyre_peer_set_outstanding (zyre_peer_t *self, size_t outstanding)
+{
+    assert (self);
+    self->outstanding = outstanding;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return true if we asked peer to send its HELLO again
+
+bool
+zyre_peer_hello_wanted (zyre_peer_t *self)
+{
+    assert (self);
+    return self->hello_wanted;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set whether we asked peer to send its HELLO again
+
+void
+zyre_peer_set_hello_wanted (zyre_peer_t *self, bool hello_wanted)
+{
+    assert (self);
+    self->hello_wanted = hello_wanted;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Hold a message the peer sent after a compact HELLO we couldn't rebuild,
+//  until its full HELLO comes; takes ownership of the message. Returns -1
+//  if the peer sent more than we hold, and destroys the message.
+
+int
+zyre_peer_hold (zyre_peer_t *self, zre_msg_t **msg_p)
+{
+    assert (self);
+    assert (msg_p);
+    if (!self->hello_held)
+        self->hello_held = zlist_new ();
+    if (zlist_size (self->hello_held) >= HELLO_HELD_MAX) {
+        zre_msg_destroy (msg_p);
+        return -1;
+    }
+    zlist_append (self->hello_held, *msg_p);
+    *msg_p = NULL;
+    return 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the next message we held from the peer, in the order it came, or
+//  NULL if there are no more. Caller owns the message.
+
+zre_msg_t *
+zyre_peer_unhold (zyre_peer_t *self)
+{
+    assert (self);
+    return self->hello_held? (zre_msg_t *) zlist_pop (self->hello_held): NULL;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return our HELLO to the peer in full, if we sent it compact, else NULL
+
+zre_msg_t *
+zyre_peer_hello_full (zyre_peer_t *self)
+{
+    assert (self);
+    return self->hello_full;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Keep our HELLO to the peer in full, when we send it compact; takes
+//  ownership of the message
+
+void
+zyre_peer_set_hello_full (zyre_peer_t *self, zre_msg_t **msg_p)
+{
+    assert (self);
+    assert (msg_p);
+    zre_msg_destroy (&self->hello_full);
+    self->hello_full = *msg_p;
+    *msg_p = NULL;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return how many of our header changes peer has had
+
+uint32_t
+zyre_peer_headers_version (zyre_peer_t *self)
+{
+    assert (self);
+    return self->headers_version;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set how many of our header changes peer has had
+
+void
+zyre_peer_set_headers_version (zyre_peer_t *self, uint32_t headers_version)
+{
+    assert (self);
+    self->headers_version = headers_version;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Return peer name
 
@@ -469,6 +1046,51 @@ zyre_peer_set_headers (zyre_peer_t *self, zhash_t *headers)
     assert (self);
     zhash_destroy (&self->headers);
     self->headers = zhash_dup (headers);
+
+    //  Pick up the protocol features the peer advertises
+    self->features = 0;
+    const char *features = self->headers?
+        (const char *) zhash_lookup (self->headers, "X-ZRE-FEATURES"): NULL;
+    while (features && *features) {
+        size_t length = strcspn (features, " ");
+        int index;
+        for (index = 0; s_features [index].name; index++)
+            if (strlen (s_features [index].name) == length
+            &&  memcmp (s_features [index].name, features, length) == 0)
+                self->features |= s_features [index].flag;
+        features += length;
+        features += strspn (features, " ");
+    }
+    const char *dict_id = self->headers?
+        (const char *) zhash_lookup (self->headers, "X-ZRE-ZSTD-DICT"): NULL;
+    self->zstd_dict = dict_id? (uint32_t) strtoul (dict_id, NULL, 10): 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the protocol features the peer supports, as a bitmask of
+//  ZYRE_PEER_FEATURE_* flags
+
+int
+zyre_peer_features (zyre_peer_t *self)
+{
+    assert (self);
+    return self->features;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return true if peer can take content we compressed with the given
+//  dictionary, or with none if dict_id is 0. A peer in this process takes
+//  messages by pointer, so compressing for it would only cost us.
+
+bool
+zyre_peer_takes_compressed (zyre_peer_t *self, uint32_t dict_id)
+{
+    assert (self);
+    return (self->features & ZYRE_PEER_FEATURE_ZSTD)
+        && !self->direct
+        && (dict_id == 0 || dict_id == self->zstd_dict);
 }
 
 
@@ -490,11 +1112,25 @@ zyre_peer_messages_lost (zyre_peer_t *self, zre_msg_t *msg)
             self->name? self->name: "-",
             zre_msg_sequence (msg));
 
-    //  HELLO always MUST have sequence = 1
+    //  HELLO always MUST have sequence = 1. If we asked the peer for its
+    //  HELLO again, that comes later in the peer's sequence, and takes the
+    //  place of its first HELLO: what the peer sent in between, which we
+    //  held, comes next, and we skip the HELLO's own place when we get there
+    if (zre_msg_id (msg) == ZRE_MSG_HELLO && self->hello_wanted) {
+        self->want_sequence = 1;
+        self->hello_sequence = zre_msg_sequence (msg);
+        return false;
+    }
     if (zre_msg_id (msg) == ZRE_MSG_HELLO)
         self->want_sequence = 1;
-    else
+    else {
         self->want_sequence += 1;
+        if (self->hello_sequence
+        &&  self->want_sequence == self->hello_sequence) {
+            self->want_sequence += 1;
+            self->hello_sequence = 0;
+        }
+    }
 
     if (self->want_sequence != zre_msg_sequence (msg)) {
         zsys_info ("(%s) seq error from peer=%s expect=%d, got=%d",
@@ -508,6 +1144,134 @@ zyre_peer_messages_lost (zyre_peer_t *self, zre_msg_t *msg)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Set the multicast endpoint on which peer takes our SHOUTs to a group,
+//  or NULL if it takes them over TCP
+
+void
+zyre_peer_set_multicast (zyre_peer_t *self, const char *group, const char *endpoint)
+{
+    assert (self);
+    assert (group);
+    if (!self->multicast_out) {
+        self->multicast_out = zhash_new ();
+        zhash_autofree (self->multicast_out);
+    }
+    if (endpoint && *endpoint)
+        zhash_update (self->multicast_out, group, (void *) endpoint);
+    else
+        zhash_delete (self->multicast_out, group);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the multicast endpoint on which peer takes our SHOUTs to a group,
+//  or NULL if it takes them over TCP
+
+const char *
+zyre_peer_multicast (zyre_peer_t *self, const char *group)
+{
+    assert (self);
+    return self->multicast_out?
+        (const char *) zhash_lookup (self->multicast_out, group): NULL;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Start or stop taking peer's SHOUTs to a group by multicast, from the
+//  given multicast sequence number on. Once stopped, we still take SHOUTs
+//  the peer multicast before start.
+
+void
+zyre_peer_set_multicast_in (zyre_peer_t *self, const char *group, bool on, uint32_t start)
+{
+    assert (self);
+    assert (group);
+    if (!self->multicast_in)
+        self->multicast_in = zhash_new ();
+    multicast_in_t *state = (multicast_in_t *) zhash_lookup (self->multicast_in, group);
+    if (on) {
+        state = (multicast_in_t *) zmalloc (sizeof (multicast_in_t));
+        state->expected = start;
+        zhash_update (self->multicast_in, group, state);
+        zhash_freefn (self->multicast_in, group, free);
+    }
+    else
+    if (state && !state->stopping) {
+        state->stopping = true;
+        state->until = start;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Check a SHOUT that peer sent to a group by multicast. Returns 1 if we
+//  should take it, 0 if we get it over TCP instead, and -1 the first time
+//  we find we missed some. Sequence numbers wrap, so we compare them as
+//  signed differences.
+
+int
+zyre_peer_multicast_check (zyre_peer_t *self, const char *group, uint32_t sequence)
+{
+    assert (self);
+    multicast_in_t *state = self->multicast_in?
+        (multicast_in_t *) zhash_lookup (self->multicast_in, group): NULL;
+    if (!state
+    ||  (int32_t) (sequence - state->expected) < 0
+    ||  (state->stopping && (int32_t) (sequence - state->until) >= 0))
+        return 0;
+
+    int rc = 1;
+    if (sequence != state->expected && !state->lost) {
+        if (self->verbose)
+            zsys_info ("(%s) multicast seq error from peer=%s expect=%u, got=%u",
+                self->origin, self->name? self->name: "-",
+                state->expected, sequence);
+        state->lost = true;
+        rc = -1;
+    }
+    state->expected = sequence + 1;
+    return rc;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return true if we already had the message with this serial number that
+//  peer sent to a group through a relay tree. We treat messages older than
+//  our window as seen, as we can't tell.
+
+bool
+zyre_peer_relay_seen (zyre_peer_t *self, const char *group, uint32_t serial)
+{
+    assert (self);
+    assert (group);
+    if (!self->relay_seen)
+        self->relay_seen = zhash_new ();
+    relay_seen_t *seen = (relay_seen_t *) zhash_lookup (self->relay_seen, group);
+    if (!seen) {
+        seen = (relay_seen_t *) zmalloc (sizeof (relay_seen_t));
+        seen->highest = serial;
+        seen->window = 1;
+        zhash_insert (self->relay_seen, group, seen);
+        zhash_freefn (self->relay_seen, group, free);
+        return false;
+    }
+    int32_t ahead = (int32_t) (serial - seen->highest);
+    if (ahead > 0) {
+        seen->window = ahead < RELAY_WINDOW? (seen->window << ahead) | 1: 1;
+        seen->highest = serial;
+        return false;
+    }
+    if (-ahead >= RELAY_WINDOW)
+        return true;
+    uint64_t bit = (uint64_t) 1 << -ahead;
+    if (seen->window & bit)
+        return true;
+    seen->window |= bit;
+    return false;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Ask peer to log all traffic via zsys
 
@@ -538,6 +1302,234 @@ zyre_peer_sent_sequence (zyre_peer_t *self)
     return self->sent_sequence;
 }
 
+//  --------------------------------------------------------------------------
+//  A SHOUT fan-out to the peers owned by one worker: the peers get the same
+//  message, each with its own sequence number.
+
+typedef struct {
+    char identity [ZUUID_STR_LEN + 1];
+    uint16_t sequence;
+} batch_entry_t;
+
+typedef struct {
+    zactor_t *worker;
+    zchunk_t *entries;          //  Array of batch_entry_t
+    zlist_t *peers;             //  Peers in the batch, same order
+} batch_t;
+
+static void
+s_batch_destroy (void *argument)
+{
+    batch_t *batch = (batch_t *) argument;
+    zchunk_destroy (&batch->entries);
+    zlist_destroy (&batch->peers);
+    free (batch);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Add the peer to the worker batches for a fan-out of msg, if a worker owns
+//  its mailbox. Returns true if batched, false if the caller should send
+//  to the peer directly. Batches are held in a hash that is created on
+//  first use; pass it to zyre_peer_send_batches when done.
+
+bool
+zyre_peer_batch (zyre_peer_t *self, zhash_t **batches_p, zre_msg_t *msg)
+{
+    assert (self);
+    assert (batches_p);
+    if (!self->worker || !self->connected)
+        return false;
+
+    if (!*batches_p)
+        *batches_p = zhash_new ();
+    zhash_t *batches = *batches_p;
+
+    char key [32];
+    snprintf (key, sizeof (key), "%p", (void *) self->worker);
+    batch_t *batch = (batch_t *) zhash_lookup (batches, key);
+    if (!batch) {
+        batch = (batch_t *) zmalloc (sizeof (batch_t));
+        assert (batch);
+        batch->worker = self->worker;
+        batch->entries = zchunk_new (NULL, 16 * sizeof (batch_entry_t));
+        batch->peers = zlist_new ();
+        zhash_insert (batches, key, batch);
+        zhash_freefn (batches, key, s_batch_destroy);
+    }
+    self->sent_sequence += 1;
+    self->sent_at = zclock_mono ();
+    if (self->verbose)
+        zsys_info ("(%s) send %s to peer=%s sequence=%d",
+            self->origin,
+            zre_msg_command (msg),
+            self->name? self->name: "-",
+            self->sent_sequence);
+
+    batch_entry_t entry;
+    memcpy (entry.identity, zuuid_str (self->uuid), sizeof (entry.identity));
+    entry.sequence = self->sent_sequence;
+    zchunk_extend (batch->entries, &entry, sizeof (entry));
+    zlist_append (batch->peers, self);
+    return true;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Hand each worker its batch of a fan-out of msg, and destroy the batches.
+//  If a worker pipe is full, we disconnect the peers in its batch, as we do
+//  for a single send.
+
+void
+zyre_peer_send_batches (zhash_t **batches_p, zre_msg_t *msg)
+{
+    assert (batches_p);
+    zhash_t *batches = *batches_p;
+    if (batches) {
+        batch_t *batch = (batch_t *) zhash_first (batches);
+        while (batch) {
+            zre_msg_t *copy = zre_msg_dup (msg);
+            if (zsock_send (batch->worker, "spb", "SHOUT", copy,
+                            zchunk_data (batch->entries), zchunk_size (batch->entries))) {
+                zre_msg_destroy (&copy);
+                zyre_peer_t *peer = (zyre_peer_t *) zlist_first (batch->peers);
+                while (peer) {
+                    if (peer->verbose)
+                        zsys_info ("(%s) disconnect from peer (EAGAIN): name=%s",
+                            peer->origin, peer->name);
+                    zyre_peer_disconnect (peer);
+                    peer = (zyre_peer_t *) zlist_next (batch->peers);
+                }
+            }
+            batch = (batch_t *) zhash_next (batches);
+        }
+        zhash_destroy (batches_p);
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Worker actor. It owns the mailboxes for a share of a node's peers, so a
+//  node can spread the work of encoding and sending across threads. Takes
+//  these commands from the node:
+//
+//  CONNECT identity from endpoint expired-timeout server-key cert
+//  DISCONNECT identity
+//  SEND identity msg       - worker sends and destroys the zre_msg_t
+//  SHOUT msg entries       - sends msg to each batch entry, then destroys it
+//
+//  and tells the node "LOST identity" when a mailbox could not be connected
+//  or is full, in which case the node should disconnect the peer.
+
+static void *
+s_pop_pointer (zmsg_t *msg)
+{
+    void *pointer = NULL;
+    zframe_t *frame = zmsg_pop (msg);
+    if (frame && zframe_size (frame) == sizeof (void *))
+        memcpy (&pointer, zframe_data (frame), sizeof (void *));
+    zframe_destroy (&frame);
+    return pointer;
+}
+
+static void
+s_mailbox_destroy (void *argument)
+{
+    zsock_t *mailbox = (zsock_t *) argument;
+    zsock_destroy (&mailbox);
+}
+
+static void
+s_worker_send (zsock_t *pipe, zhash_t *mailboxes, const char *identity, zre_msg_t *msg)
+{
+    zsock_t *mailbox = (zsock_t *) zhash_lookup (mailboxes, identity);
+    if (mailbox && zre_msg_send (msg, mailbox)) {
+        //  Can't get any other error here
+        assert (errno == EAGAIN);
+        zhash_delete (mailboxes, identity);
+        zstr_sendx (pipe, "LOST", identity, NULL);
+    }
+}
+
+void
+zyre_peer_worker (zsock_t *pipe, void *args)
+{
+    zhash_t *mailboxes = zhash_new ();
+    zsock_signal (pipe, 0);
+
+    bool terminated = false;
+    while (!terminated) {
+        zmsg_t *request = zmsg_recv (pipe);
+        if (!request)
+            break;              //  Interrupted
+        char *command = zmsg_popstr (request);
+        char *identity = NULL;
+        if (streq (command, "$TERM"))
+            terminated = true;
+        else
+        if (streq (command, "CONNECT")) {
+            identity = zmsg_popstr (request);
+            zframe_t *from = zmsg_pop (request);
+            char *endpoint = zmsg_popstr (request);
+            char *expired_timeout = zmsg_popstr (request);
+            char *server_key = zmsg_popstr (request);
+            zcert_t *cert = (zcert_t *) s_pop_pointer (request);
+            assert (from && zframe_size (from) == ZUUID_LEN);
+
+            zhash_delete (mailboxes, identity);
+            zsock_t *mailbox = s_mailbox_new (ZYRE_PEER_LANE_DATA, zframe_data (from), endpoint,
+                atoi (expired_timeout), cert, *server_key? server_key: NULL);
+            if (mailbox) {
+                zhash_insert (mailboxes, identity, mailbox);
+                zhash_freefn (mailboxes, identity, s_mailbox_destroy);
+            }
+            else
+                zstr_sendx (pipe, "LOST", identity, NULL);
+
+            zframe_destroy (&from);
+            zstr_free (&endpoint);
+            zstr_free (&expired_timeout);
+            zstr_free (&server_key);
+        }
+        else
+        if (streq (command, "DISCONNECT")) {
+            identity = zmsg_popstr (request);
+            zhash_delete (mailboxes, identity);
+        }
+        else
+        if (streq (command, "SEND")) {
+            identity = zmsg_popstr (request);
+            zre_msg_t *msg = (zre_msg_t *) s_pop_pointer (request);
+            s_worker_send (pipe, mailboxes, identity, msg);
+            zre_msg_destroy (&msg);
+        }
+        else
+        if (streq (command, "SHOUT")) {
+            zre_msg_t *msg = (zre_msg_t *) s_pop_pointer (request);
+            zframe_t *entries = zmsg_pop (request);
+            size_t nbr_entries = zframe_size (entries) / sizeof (batch_entry_t);
+            size_t index;
+            for (index = 0; index < nbr_entries; index++) {
+                batch_entry_t entry;
+                memcpy (&entry, zframe_data (entries) + index * sizeof (batch_entry_t),
+                        sizeof (batch_entry_t));
+                zre_msg_set_sequence (msg, entry.sequence);
+                s_worker_send (pipe, mailboxes, entry.identity, msg);
+            }
+            zframe_destroy (&entries);
+            zre_msg_destroy (&msg);
+        }
+        else
+            zsys_error ("zyre_peer_worker: invalid command '%s'", command);
+
+        zstr_free (&identity);
+        zstr_free (&command);
+        zmsg_destroy (&request);
+    }
+    zhash_destroy (&mailboxes);
+}
+
+
 //  --------------------------------------------------------------------------
 //  Self test of this class
 
@@ -564,6 +1556,7 @@ zyre_peer_test (bool verbose)
     zre_msg_set_endpoint (msg, "inproc://selftest-zyre_peer");
     int rc = zyre_peer_send (peer, &msg);
     assert (rc == 0);
+    assert (zyre_peer_sent_at (peer) > 0);
 
     msg = zre_msg_new ();
     rc = zre_msg_recv (msg, mailbox);
@@ -572,8 +1565,152 @@ zyre_peer_test (bool verbose)
         zre_msg_print (msg);
     zre_msg_destroy (&msg);
 
+    //  A peer with a control lane gets PINGs on it, out of sequence
+    zhash_t *headers = zhash_new ();
+    zhash_insert (headers, "X-ZRE-FEATURES", ZYRE_PEER_FEATURES);
+    zyre_peer_set_headers (peer, headers);
+    zhash_destroy (&headers);
+    assert (zyre_peer_features (peer) & ZYRE_PEER_FEATURE_CONTROL_LANE);
+    msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_PING);
+    rc = zyre_peer_send_control (peer, &msg);
+    assert (rc == 0);
+    assert (zyre_peer_sent_sequence (peer) == 1);
+
+    msg = zre_msg_new ();
+    rc = zre_msg_recv (msg, mailbox);
+    assert (rc == 0);
+    assert (zre_msg_id (msg) == ZRE_MSG_PING);
+    zre_msg_destroy (&msg);
+
+    //  We take multicast SHOUTs from where the peer switched us, report
+    //  the first gap, and leave SHOUTs after it switches us back to TCP
+    assert (zyre_peer_multicast_check (peer, "GLOBAL", 5) == 0);
+    zyre_peer_set_multicast_in (peer, "GLOBAL", true, 5);
+    assert (zyre_peer_multicast_check (peer, "GLOBAL", 4) == 0);
+    assert (zyre_peer_multicast_check (peer, "GLOBAL", 5) == 1);
+    assert (zyre_peer_multicast_check (peer, "GLOBAL", 7) == -1);
+    assert (zyre_peer_multicast_check (peer, "GLOBAL", 9) == 1);
+    zyre_peer_set_multicast_in (peer, "GLOBAL", false, 11);
+    assert (zyre_peer_multicast_check (peer, "GLOBAL", 10) == 1);
+    assert (zyre_peer_multicast_check (peer, "GLOBAL", 11) == 0);
+    zyre_peer_set_multicast (peer, "GLOBAL", "udp://239.192.1.1:5670");
+    assert (streq (zyre_peer_multicast (peer, "GLOBAL"), "udp://239.192.1.1:5670"));
+    zyre_peer_set_multicast (peer, "GLOBAL", NULL);
+    assert (zyre_peer_multicast (peer, "GLOBAL") == NULL);
+
+    //  Relayed messages may come out of order, and more than once
+    assert (!zyre_peer_relay_seen (peer, "GLOBAL", 10));
+    assert (!zyre_peer_relay_seen (peer, "GLOBAL", 12));
+    assert (!zyre_peer_relay_seen (peer, "GLOBAL", 11));
+    assert (zyre_peer_relay_seen (peer, "GLOBAL", 11));
+    assert (zyre_peer_relay_seen (peer, "GLOBAL", 10));
+    assert (!zyre_peer_relay_seen (peer, "GLOBAL", 100));
+    assert (zyre_peer_relay_seen (peer, "GLOBAL", 12));
+
+    //  A full HELLO we asked for, as 4th in the peer's sequence, takes the
+    //  place of its first HELLO: the 2nd and 3rd, which we held, come next,
+    //  and then the 5th
+    zyre_peer_set_hello_wanted (peer, true);
+    int sequence;
+    for (sequence = 2; sequence < 4; sequence++) {
+        msg = zre_msg_new ();
+        zre_msg_set_id (msg, ZRE_MSG_WHISPER);
+        zre_msg_set_sequence (msg, sequence);
+        rc = zyre_peer_hold (peer, &msg);
+        assert (rc == 0);
+        assert (msg == NULL);
+    }
+    msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_HELLO);
+    zre_msg_set_sequence (msg, 4);
+    assert (!zyre_peer_messages_lost (peer, msg));
+    zre_msg_destroy (&msg);
+    zyre_peer_set_hello_wanted (peer, false);
+    for (sequence = 2; sequence < 4; sequence++) {
+        msg = zyre_peer_unhold (peer);
+        assert (msg && zre_msg_sequence (msg) == sequence);
+        assert (!zyre_peer_messages_lost (peer, msg));
+        zre_msg_destroy (&msg);
+    }
+    assert (zyre_peer_unhold (peer) == NULL);
+    msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_WHISPER);
+    zre_msg_set_sequence (msg, 5);
+    assert (!zyre_peer_messages_lost (peer, msg));
+    //  A gap after that is still a loss
+    zre_msg_set_sequence (msg, 7);
+    assert (zyre_peer_messages_lost (peer, msg));
+    zre_msg_destroy (&msg);
+
+    //  A peer with a worker has no mailbox of its own: the worker connects
+    //  one and sends through it, and reports one it can't connect as lost
+    zactor_t *worker = zactor_new (zyre_peer_worker, NULL);
+    assert (worker);
+    zuuid_t *worked_uuid = zuuid_new ();
+    zyre_peer_t *worked = zyre_peer_new (peers, worked_uuid);
+    zyre_peer_set_worker (worked, worker);
+    rc = zyre_peer_connect (worked, me, "inproc://selftest-zyre_peer", 30000);
+    assert (rc == 0);
+    assert (worked->mailbox == NULL);
+    msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_PING);
+    rc = zyre_peer_send (worked, &msg);
+    assert (rc == 0);
+    msg = zre_msg_new ();
+    rc = zre_msg_recv (msg, mailbox);
+    assert (rc == 0);
+    assert (zre_msg_id (msg) == ZRE_MSG_PING);
+    zre_msg_destroy (&msg);
+
+    zuuid_t *lost_uuid = zuuid_new ();
+    zyre_peer_t *lost = zyre_peer_new (peers, lost_uuid);
+    zyre_peer_set_worker (lost, worker);
+    rc = zyre_peer_connect (lost, me, "bogus://selftest-zyre_peer", 30000);
+    assert (rc == 0);
+    char *command, *identity;
+    zstr_recvx (worker, &command, &identity, NULL);
+    assert (streq (command, "LOST"));
+    assert (streq (identity, zyre_peer_identity (lost)));
+    zstr_free (&command);
+    zstr_free (&identity);
+
+#if defined (ZMQ_CONNECT_ROUTING_ID)
+    //  A peer on a shared outbound ROUTER has no mailbox of its own, and
+    //  sends through the ROUTER, which the other side sees by its identity
+    zsock_t *inbox = zsock_new_router ("@inproc://selftest-zyre_peer-router");
+    assert (inbox);
+    zsock_t *router = zsock_new (ZMQ_ROUTER);
+    assert (router);
+    zsock_set_identity (router, "selftest-router");
+    zuuid_t *routed_uuid = zuuid_new ();
+    zyre_peer_t *routed = zyre_peer_new (peers, routed_uuid);
+    zyre_peer_set_router (routed, router, 1);
+    rc = zyre_peer_connect (routed, me, "inproc://selftest-zyre_peer-router", 30000);
+    assert (rc == 0);
+    assert (routed->mailbox == NULL);
+    msg = zre_msg_new ();
+    zre_msg_set_id (msg, ZRE_MSG_PING);
+    rc = zyre_peer_send (routed, &msg);
+    assert (rc == 0);
+    msg = zre_msg_new ();
+    rc = zre_msg_recv (msg, inbox);
+    assert (rc == 0);
+    assert (zre_msg_id (msg) == ZRE_MSG_PING);
+    assert (zframe_streq (zre_msg_routing_id (msg), "selftest-router"));
+    zre_msg_destroy (&msg);
+#endif
+
     //  Destroying container destroys all peers it contains
     zhash_destroy (&peers);
+    zactor_destroy (&worker);
+#if defined (ZMQ_CONNECT_ROUTING_ID)
+    zsock_destroy (&router);
+    zsock_destroy (&inbox);
+    zuuid_destroy (&routed_uuid);
+#endif
+    zuuid_destroy (&worked_uuid);
+    zuuid_destroy (&lost_uuid);
     zuuid_destroy (&me);
     zuuid_destroy (&you);
     zsock_destroy (&mailbox);
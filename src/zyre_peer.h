@@ -16,6 +16,35 @@
 #ifndef __ZYRE_PEER_H_INCLUDED__
 #define __ZYRE_PEER_H_INCLUDED__
 
+//  Optional protocol features. A node lists the ones it supports by name
+//  in its X-ZRE-FEATURES header, and only sends a peer the messages that
+//  peer has advertised.
+#if defined (HAVE_LIBZSTD)
+#   define ZYRE_PEER_FEATURES           "binary-ids control-lane streams zstd multicast relay rpc compact-hello headers store history"
+#else
+#   define ZYRE_PEER_FEATURES           "binary-ids control-lane streams multicast relay rpc compact-hello headers store history"
+#endif
+#define ZYRE_PEER_FEATURE_BINARY_IDS    1   //  ELECT-UUID, LEADER-UUID
+#define ZYRE_PEER_FEATURE_CONTROL_LANE  2   //  PING, PING-OK on own connection
+#define ZYRE_PEER_FEATURE_STREAMS       4   //  STREAM, STREAM-ACK
+#define ZYRE_PEER_FEATURE_ZSTD          8   //  WHISPER-ZSTD, SHOUT-ZSTD
+#define ZYRE_PEER_FEATURE_MULTICAST     16  //  MULTICAST, MULTICAST-OK
+#define ZYRE_PEER_FEATURE_RELAY         32  //  RELAY
+#define ZYRE_PEER_FEATURE_RPC           64  //  REQUEST, REPLY
+#define ZYRE_PEER_FEATURE_COMPACT_HELLO 128 //  Compact HELLO, HELLO-WANTED
+#define ZYRE_PEER_FEATURE_HEADERS       256 //  HEADERS
+#define ZYRE_PEER_FEATURE_STORE         512 //  STORE-SET, STORE-SYNC
+#define ZYRE_PEER_FEATURE_HISTORY       1024 // CATCHUP, HISTORY
+
+//  A peer's routing id on our inbox is a lane byte followed by its UUID.
+//  The control lane carries liveness traffic outside the message sequence.
+#define ZYRE_PEER_LANE_DATA             1
+#define ZYRE_PEER_LANE_CONTROL          2
+
+//  Nodes in one process that exchange messages by pointer bind their
+//  direct inbox here, by UUID
+#define ZYRE_PEER_DIRECT_ENDPOINT       "inproc://zyre-direct-%s"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -48,6 +77,10 @@ ZYRE_PRIVATE const char *
 ZYRE_PRIVATE int
     zyre_peer_send (zyre_peer_t *self, zre_msg_t **msg_p);
 
+//  Send a PING or PING-OK to peer on its control lane, if it has one
+ZYRE_PRIVATE int
+    zyre_peer_send_control (zyre_peer_t *self, zre_msg_t **msg_p);
+
 //  Return peer identity string
 ZYRE_PRIVATE const char *
     zyre_peer_identity (zyre_peer_t *self);
@@ -64,6 +97,57 @@ ZYRE_PRIVATE int64_t
 ZYRE_PRIVATE int64_t
     zyre_peer_expired_at (zyre_peer_t *self);
 
+//  Return time of last activity at peer
+ZYRE_PRIVATE int64_t
+    zyre_peer_active_at (zyre_peer_t *self);
+
+//  Return time we last sent a message to peer
+ZYRE_PRIVATE int64_t
+    zyre_peer_sent_at (zyre_peer_t *self);
+
+//  Return number of requests we sent peer that it has not answered
+ZYRE_PRIVATE size_t
+    zyre_peer_outstanding (zyre_peer_t *self);
+
+//  Set number of requests we sent peer that it has not answered
+ZYRE_PRIVATE void
+    zyre_peer_set_outstanding (zyre_peer_t *self, size_t outstanding);
+
+//  Return true if we asked peer to send its HELLO again
+ZYRE_PRIVATE bool
+    zyre_peer_hello_wanted (zyre_peer_t *self);
+
+//  Set whether we asked peer to send its HELLO again
+ZYRE_PRIVATE void
+    zyre_peer_set_hello_wanted (zyre_peer_t *self, bool hello_wanted);
+
+//  Hold a message the peer sent after a compact HELLO we couldn't rebuild,
+//  until its full HELLO comes; takes ownership of the message. Returns -1
+//  if the peer sent more than we hold, and destroys the message.
+ZYRE_PRIVATE int
+    zyre_peer_hold (zyre_peer_t *self, zre_msg_t **msg_p);
+
+//  Return the next message we held from the peer, or NULL
+ZYRE_PRIVATE zre_msg_t *
+    zyre_peer_unhold (zyre_peer_t *self);
+
+//  Return our HELLO to the peer in full, if we sent it compact, else NULL
+ZYRE_PRIVATE zre_msg_t *
+    zyre_peer_hello_full (zyre_peer_t *self);
+
+//  Keep our HELLO to the peer in full, when we send it compact; takes
+//  ownership of the message
+ZYRE_PRIVATE void
+    zyre_peer_set_hello_full (zyre_peer_t *self, zre_msg_t **msg_p);
+
+//  Return how many of our header changes peer has had
+ZYRE_PRIVATE uint32_t
+    zyre_peer_headers_version (zyre_peer_t *self);
+
+//  Set how many of our header changes peer has had
+ZYRE_PRIVATE void
+    zyre_peer_set_headers_version (zyre_peer_t *self, uint32_t headers_version);
+
 //  Return peer name
 ZYRE_PRIVATE const char *
     zyre_peer_name (zyre_peer_t *self);
@@ -104,10 +188,46 @@ ZYRE_PRIVATE zhash_t *
 ZYRE_PRIVATE void
     zyre_peer_set_headers (zyre_peer_t *self, zhash_t *headers);
 
+//  Return the protocol features the peer supports, as a bitmask of
+//  ZYRE_PEER_FEATURE_* flags
+ZYRE_PRIVATE int
+    zyre_peer_features (zyre_peer_t *self);
+
+//  Return true if peer can take content we compressed with the given
+//  dictionary, or with none if dict_id is 0
+ZYRE_PRIVATE bool
+    zyre_peer_takes_compressed (zyre_peer_t *self, uint32_t dict_id);
+
 //  Check if messages were lost from peer, returns true if they were.
 ZYRE_PRIVATE bool
     zyre_peer_messages_lost (zyre_peer_t *self, zre_msg_t *msg);
 
+//  Set the multicast endpoint on which peer takes our SHOUTs to a group,
+//  or NULL if it takes them over TCP
+ZYRE_PRIVATE void
+    zyre_peer_set_multicast (zyre_peer_t *self, const char *group, const char *endpoint);
+
+//  Return the multicast endpoint on which peer takes our SHOUTs to a group,
+//  or NULL if it takes them over TCP
+ZYRE_PRIVATE const char *
+    zyre_peer_multicast (zyre_peer_t *self, const char *group);
+
+//  Start or stop taking peer's SHOUTs to a group by multicast, from the
+//  given multicast sequence number on
+ZYRE_PRIVATE void
+    zyre_peer_set_multicast_in (zyre_peer_t *self, const char *group, bool on, uint32_t start);
+
+//  Check a SHOUT that peer sent to a group by multicast. Returns 1 if we
+//  should take it, 0 if we get it over TCP instead, and -1 the first time
+//  we find we missed some.
+ZYRE_PRIVATE int
+    zyre_peer_multicast_check (zyre_peer_t *self, const char *group, uint32_t sequence);
+
+//  Return true if we already had the message with this serial number that
+//  peer sent to a group through a relay tree
+ZYRE_PRIVATE bool
+    zyre_peer_relay_seen (zyre_peer_t *self, const char *group, uint32_t serial);
+
 //  Ask peer to log all traffic via zsys
 ZYRE_PRIVATE void
     zyre_peer_set_verbose (zyre_peer_t *self, bool verbose);
@@ -124,11 +244,56 @@ ZYRE_PRIVATE uint16_t
 ZYRE_PRIVATE void
     zyre_peer_set_server_key (zyre_peer_t *self, const char *key);
 
+//  Set the worker actor that owns the peer's mailbox. Must be set before
+//  the peer connects.
+ZYRE_PRIVATE void
+    zyre_peer_set_worker (zyre_peer_t *self, zactor_t *worker);
+
+//  Send to the peer through a shared outbound ROUTER socket, under a route
+//  number that is unique on that socket. Must be set before the peer
+//  connects.
+ZYRE_PRIVATE void
+    zyre_peer_set_router (zyre_peer_t *self, zsock_t *router, uint32_t route);
+
+//  Hand messages to the peer by pointer, through its direct inbox, as it
+//  runs in this process. Must be set before the peer connects.
+ZYRE_PRIVATE void
+    zyre_peer_set_direct (zyre_peer_t *self, bool direct);
+
+//  Move our mailbox to another endpoint of the peer, once the peer has
+//  answered a PING over that endpoint and read everything we sent it so far
+ZYRE_PRIVATE void
+    zyre_peer_upgrade (zyre_peer_t *self, const char *endpoint);
+
+//  Tell peer it answered a PING on our control lane
+ZYRE_PRIVATE void
+    zyre_peer_control_ping_ok (zyre_peer_t *self);
+
+//  Give up moving our mailbox if the peer did not answer over the new
+//  endpoint in time
+ZYRE_PRIVATE void
+    zyre_peer_check_upgrade (zyre_peer_t *self);
+
+//  Tell peer it answered one of our PINGs
+ZYRE_PRIVATE void
+    zyre_peer_ping_ok (zyre_peer_t *self);
+
+//  Add peer to the worker batches for a fan-out of msg. Returns true if the
+//  peer was batched, false if the caller should send to it directly.
+ZYRE_PRIVATE bool
+    zyre_peer_batch (zyre_peer_t *self, zhash_t **batches_p, zre_msg_t *msg);
+
+//  Hand each worker its batch of a fan-out of msg, and destroy the batches
+ZYRE_PRIVATE void
+    zyre_peer_send_batches (zhash_t **batches_p, zre_msg_t *msg);
+
+//  Worker actor that owns the mailboxes for a share of a node's peers
 ZYRE_PRIVATE void
-    zyre_peer_set_public_key (zyre_peer_t *self, const char *key);
+    zyre_peer_worker (zsock_t *pipe, void *args);
 
+//  Set our curve keys, as a certificate the caller keeps ownership of
 ZYRE_PRIVATE void
-    zyre_peer_set_secret_key (zyre_peer_t *self, const char *key);
+    zyre_peer_set_cert (zyre_peer_t *self, zcert_t *cert);
 
 //  Self test of this class
 ZYRE_PRIVATE void